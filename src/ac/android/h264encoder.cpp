@@ -49,6 +49,9 @@ static constexpr int32_t kDefaultBitrate = 5000000;
 // By default send an I frame every 15 seconds which is the
 // same Android currently configures in its WiFi Display code path.
 static constexpr std::chrono::seconds kDefaultIFrameInterval{15};
+// How long to wait for new input at once before checking whether we
+// got stopped in the meantime.
+static constexpr std::chrono::milliseconds kInputWaitTimeout{10};
 // From frameworks/av/include/media/stagefright/MediaErrors.h
 enum AndroidMediaError {
     kAndroidMediaErrorBase = -1000,
@@ -76,6 +79,32 @@ static constexpr const char *kFormatKeyProfileIdc{"profile-idc"};
 static constexpr const char *kFormatKeyLevelIdc{"level-idc"};
 static constexpr const char *kFormatKeyConstraintSet{"constraint-set"};
 static constexpr const char *kFormatKeyPrependSpsPpstoIdrFrames{"prepend-sps-pps-to-idr-frames"};
+
+// Name and version the encoder is known as in the encoder registry. The
+// version needs to be bumped whenever probing changes so that results
+// cached on devices are thrown away.
+static constexpr const char *kBackendName{"android"};
+static constexpr const char *kBackendVersion{"1"};
+
+struct ProbeMode {
+    unsigned int width;
+    unsigned int height;
+    unsigned int framerate;
+    unsigned int level_idc;
+};
+
+// WiFi Display modes from the largest down to the smallest. The first
+// one the hardware accepts determines the maximum.
+static const ProbeMode kProbeModes[] = {
+    { 1920, 1080, 60, 42 },
+    { 1920, 1080, 30, 40 },
+    { 1280, 720, 60, 32 },
+    { 1280, 720, 30, 31 },
+    { 640, 480, 60, 31 },
+};
+
+// Constrained baseline and constrained high profile
+static constexpr unsigned int kProbeProfiles[] = { 66, 100 };
 }
 
 namespace ac {
@@ -90,6 +119,8 @@ public:
         if (!buffer_)
             return;
 
+        video::MemoryBudget::Instance()->Release(video::MemoryBudget::Stage::kEncoder, size_);
+
         const auto ref_count = media_buffer_get_refcount(buffer_);
 
         // If someone has set a reference on the buffer we just have to
@@ -106,6 +137,12 @@ public:
         const auto sp = std::shared_ptr<MediaSourceBuffer>(new MediaSourceBuffer);
         sp->buffer_ = buffer;
         sp->ExtractTimestamp();
+
+        // The memory is owned by the encoder but still is held by our
+        // pipeline as long as the buffer is alive.
+        sp->size_ = media_buffer_get_size(buffer);
+        video::MemoryBudget::Instance()->Acquire(video::MemoryBudget::Stage::kEncoder, sp->size_);
+
         return sp;
     }
 
@@ -136,6 +173,7 @@ private:
 
 private:
     MediaBufferWrapper *buffer_;
+    std::size_t size_;
 };
 
 video::BaseEncoder::Config H264Encoder::DefaultConfiguration() {
@@ -156,10 +194,12 @@ H264Encoder::H264Encoder(const video::EncoderReport::Ptr &report) :
     format_(nullptr),
     source_format_(nullptr),
     encoder_(nullptr),
+    intra_refresh_period_(0),
     running_(false),
-    input_queue_(ac::video::BufferQueue::Create()),
+    input_queue_(ac::video::BufferQueue::Create(0, "H264Encoder")),
     start_time_(-1ll),
-    frame_count_(0) {
+    frame_count_(0),
+    last_progress_(0) {
 }
 
 H264Encoder::~H264Encoder() {
@@ -208,7 +248,8 @@ bool H264Encoder::Configure(const Config &config) {
     // completely update a whole video frame. If the frame rate is 30,
     // it takes about 333 ms in the best case (if next frame is not an IDR)
     // to recover from a lost/corrupted packet.
-    const int32_t mbs = (((config.width + 15) / 16) * ((config.height + 15) / 16) * 10) / 100;
+    const int32_t total_mbs = ((config.width + 15) / 16) * ((config.height + 15) / 16);
+    const int32_t mbs = (total_mbs * 10) / 100;
     media_message_set_int32(format, kFormatKeyIntraRefreshCIRMbs, mbs);
 
     if (config.i_frame_interval > 0)
@@ -292,6 +333,7 @@ bool H264Encoder::Configure(const Config &config) {
     config_ = config;
     format_ = format;
     source_format_ = source_format;
+    intra_refresh_period_ = mbs > 0 ? (total_mbs + mbs - 1) / mbs : 0;
 
     AC_DEBUG("Configured encoder succesfully");
 
@@ -394,7 +436,15 @@ int H264Encoder::OnSourceRead(MediaBufferWrapper **buffer, void *user_data) {
     if (!buffer)
         return kAndroidMediaErrorBufferTooSmall;
 
-    const auto input_buffer = thiz->input_queue_->Next();
+    // Never wait for input without limit. When stopped the codec source
+    // waits for this callback to return which it wouldn't do without a
+    // producer feeding us anymore.
+    while (!thiz->input_queue_->WaitToBeFilled(kInputWaitTimeout)) {
+        if (!thiz->running_)
+            return kAndroidMediaErrorEndOfStream;
+    }
+
+    const auto input_buffer = thiz->input_queue_->Pop();
     if (!input_buffer)
         return kAndroidMediaErrorEndOfStream;
 
@@ -478,6 +528,8 @@ bool H264Encoder::Execute() {
     if (auto sp = delegate_.lock())
         sp->OnBufferAvailable(mbuf);
 
+    last_progress_ = ac::Utils::GetNowUs();
+
     return true;
 }
 
@@ -485,11 +537,15 @@ bool H264Encoder::Stop() {
     if (!encoder_ || !running_)
         return false;
 
-    if (!media_codec_source_stop(encoder_))
-        return false;
-
+    // Has to happen before stopping the codec source so that a read
+    // pending in OnSourceRead gives up and lets the source stop.
     running_ = false;
 
+    if (!media_codec_source_stop(encoder_)) {
+        running_ = true;
+        return false;
+    }
+
     report_->Stopped();
 
     return true;
@@ -517,9 +573,64 @@ void H264Encoder::SendIDRFrame() {
     media_codec_source_request_idr_frame(encoder_);
 }
 
+unsigned int H264Encoder::IntraRefreshPeriod() const {
+    return intra_refresh_period_;
+}
+
 std::string H264Encoder::Name() const {
     return kEncoderThreadName;
 }
 
+ac::TimestampUs H264Encoder::LastProgress() const {
+    return last_progress_;
+}
+
+void H264Encoder::Register(const video::EncoderRegistry::Ptr &registry) {
+    registry->Register(kBackendName, kBackendVersion, &H264Encoder::Probe, &H264Encoder::Create);
+}
+
+bool H264Encoder::Probe(video::EncoderRegistry::Capabilities *capabilities) {
+    // The encoder only allocates its codec with Configure so a fresh
+    // instance is needed for every attempt.
+    const auto accepts = [](unsigned int width, unsigned int height, unsigned int framerate, unsigned int profile_idc) {
+        std::shared_ptr<H264Encoder> encoder(new H264Encoder(nullptr));
+
+        auto config = encoder->DefaultConfiguration();
+        config.width = width;
+        config.height = height;
+        config.framerate = framerate;
+        config.profile_idc = profile_idc;
+        return encoder->Configure(config);
+    };
+
+    for (const auto &mode : kProbeModes) {
+        if (!accepts(mode.width, mode.height, mode.framerate, 0))
+            continue;
+
+        capabilities->max_width = mode.width;
+        capabilities->max_height = mode.height;
+        capabilities->max_framerate = mode.framerate;
+        capabilities->max_level = mode.level_idc;
+        break;
+    }
+
+    if (capabilities->max_width == 0)
+        return false;
+
+    for (const auto profile : kProbeProfiles) {
+        if (accepts(capabilities->max_width, capabilities->max_height, capabilities->max_framerate, profile))
+            capabilities->profiles.push_back(profile);
+    }
+
+    // Frames come in as GPU buffers only the compositor can produce, so
+    // there is nothing to time here. The hardware encodes everything it
+    // accepts in real time, so its throughput is the pixel rate of the
+    // largest accepted mode.
+    capabilities->throughput = std::uint64_t(capabilities->max_width) *
+            capabilities->max_height * capabilities->max_framerate;
+
+    return !capabilities->profiles.empty();
+}
+
 } // namespace android
 } // namespace ac
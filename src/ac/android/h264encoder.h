@@ -18,6 +18,7 @@
 #ifndef AC_ANDORID_ENCODER_H_
 #define AC_ANDORID_ENCODER_H_
 
+#include <atomic>
 #include <memory>
 #include <thread>
 
@@ -30,6 +31,7 @@
 
 #include "ac/video/baseencoder.h"
 #include "ac/video/encoderreport.h"
+#include "ac/video/encoderregistry.h"
 #include "ac/video/bufferqueue.h"
 
 namespace ac {
@@ -41,6 +43,9 @@ public:
 
     static BaseEncoder::Ptr Create(const video::EncoderReport::Ptr &report);
 
+    // Makes the hardware encoder available through registry
+    static void Register(const video::EncoderRegistry::Ptr &registry);
+
     ~H264Encoder();
 
     BaseEncoder::Config DefaultConfiguration() override;
@@ -54,15 +59,20 @@ public:
 
     void SendIDRFrame() override;
 
+    unsigned int IntraRefreshPeriod() const override;
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    ac::TimestampUs LastProgress() const override;
 
 private:
     H264Encoder(const video::EncoderReport::Ptr &report);
 
+    static bool Probe(video::EncoderRegistry::Capabilities *capabilities);
+
     bool DoesBufferContainCodecConfig(MediaBufferWrapper *buffer);
 
     MediaBufferWrapper* PackBuffer(const ac::video::Buffer::Ptr &input_buffer, const ac::TimestampUs &timestamp);
@@ -87,11 +97,13 @@ private:
     MediaMessageWrapper *format_;
     MediaMetaDataWrapper *source_format_;
     MediaCodecSourceWrapper *encoder_;
-    bool running_;
+    unsigned int intra_refresh_period_;
+    std::atomic<bool> running_;
     ac::video::BufferQueue::Ptr input_queue_;
     std::vector<BufferItem> pending_buffers_;
     ac::TimestampUs start_time_;
     uint32_t frame_count_;
+    std::atomic<ac::TimestampUs> last_progress_;
 };
 
 } // namespace android
@@ -19,6 +19,7 @@
 
 #include "ac/logger.h"
 #include "ac/basesourcemediamanager.h"
+#include "ac/video/thermalgovernor.h"
 #include "ac/video/videoformat.h"
 
 namespace {
@@ -62,30 +63,43 @@ int BaseSourceMediaManager::GetLocalRtpPort() const {
 
 std::vector<wds::H264VideoCodec> BaseSourceMediaManager::GetH264VideoCodecs() {
     static std::vector<wds::H264VideoCodec> codecs;
-    if (codecs.empty()) {
+    static std::vector<wds::H264VideoCodec> reduced_codecs;
+
+    const auto reduce_resolution = ac::video::ThermalGovernor::Instance()->CurrentLevel() >=
+            ac::video::ThermalGovernor::Level::kReduceResolution;
+
+    auto &selected = reduce_resolution ? reduced_codecs : codecs;
+    if (selected.empty()) {
         wds::RateAndResolutionsBitmap cea_rr;
         wds::RateAndResolutionsBitmap vesa_rr;
         wds::RateAndResolutionsBitmap hh_rr;
 
-        // We only support 720p here for now as that is our best performing
-        // resolution with regard of all other bits in the pipeline. Eventually
-        // we will add 60 Hz here too but for now only everything up to 30 Hz.
-        cea_rr.set(wds::CEA1280x720p30);
-        cea_rr.set(wds::CEA1280x720p25);
-        cea_rr.set(wds::CEA1280x720p24);
+        if (reduce_resolution) {
+            // Close to thermal throttling we only offer the one format
+            // every sink has to support. Together with the lowered frame
+            // rate that is about a third of the pixels of 720p30.
+            cea_rr.set(wds::CEA640x480p60);
+        } else {
+            // We only support 720p here for now as that is our best performing
+            // resolution with regard of all other bits in the pipeline. Eventually
+            // we will add 60 Hz here too but for now only everything up to 30 Hz.
+            cea_rr.set(wds::CEA1280x720p30);
+            cea_rr.set(wds::CEA1280x720p25);
+            cea_rr.set(wds::CEA1280x720p24);
+        }
 
         // FIXME which profiles and formats we support highly depends on what
         // android supports. But for now we just consider CBP with level 3.1
         // as that is the same Android configures its setup with.
         wds::H264VideoCodec codec1(wds::CBP, wds::k3_1, cea_rr, vesa_rr, hh_rr);
-        codecs.push_back(codec1);
+        selected.push_back(codec1);
 
         AC_DEBUG("Video codecs supported by us:");
-        for (auto c : codecs)
+        for (auto c : selected)
             ac::video::DumpVideoCodec(c);
     }
 
-    return codecs;
+    return selected;
 }
 
 bool BaseSourceMediaManager::InitOptimalVideoFormat(const wds::NativeVideoFormat& sink_native_format,
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "ac/non_copyable.h"
+#include "ac/utils.h"
 
 namespace ac {
 namespace common {
@@ -39,6 +40,11 @@ public:
 
     virtual std::string Name() const = 0;
 
+    // Time the executable last got work done, like passing on a buffer,
+    // or found that there is nothing to do. Used to detect stalled
+    // stages; executables not tracking it return a negative value.
+    virtual ac::TimestampUs LastProgress() const { return -1; }
+
 protected:
     Executable() = default;
 };
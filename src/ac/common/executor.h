@@ -18,8 +18,11 @@
 #ifndef AC_COMMON_EXECUTOR_H_
 #define AC_COMMON_EXECUTOR_H_
 
+#include <chrono>
 #include <memory>
 
+#include <boost/concept_check.hpp>
+
 #include "ac/non_copyable.h"
 
 namespace ac {
@@ -33,6 +36,17 @@ public:
     virtual bool Stop() = 0;
     virtual bool Running() const = 0;
 
+    // Lets the executor know it should stop but doesn't wait for it to
+    // do so. Stop() or StopUntil() still have to be called afterwards.
+    virtual void RequestStop() {}
+
+    // Same as Stop() but gives up waiting for the executor once the
+    // deadline has passed.
+    virtual bool StopUntil(const std::chrono::steady_clock::time_point &deadline) {
+        boost::ignore_unused_variable_warning(deadline);
+        return Stop();
+    }
+
 protected:
     Executor() = default;
 };
@@ -15,14 +15,24 @@
  *
  */
 
+#include <algorithm>
+
+#include "ac/logger.h"
+
 #include "ac/common/executorpool.h"
 
 namespace ac {
 namespace common {
 
-ExecutorPool::ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size) :
+constexpr std::chrono::milliseconds ExecutorPool::kDefaultStopTimeout;
+constexpr std::chrono::milliseconds ExecutorPool::kDefaultStallBudget;
+
+ExecutorPool::ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size,
+                           const std::chrono::milliseconds &stop_timeout) :
     size_(size),
+    stop_timeout_(stop_timeout),
     running_(false),
+    started_(0),
     factory_(factory) {
 }
 
@@ -30,12 +40,14 @@ ExecutorPool::~ExecutorPool() {
     Stop();
 }
 
-bool ExecutorPool::Add(const Executable::Ptr &executable) {
+bool ExecutorPool::Add(const Executable::Ptr &executable,
+                       const std::chrono::milliseconds &stall_budget) {
     if (items_.size() == size_ || running_)
         return false;
 
     auto executor = factory_->Create(executable);
-    items_.emplace_back(Item{executable, executor});
+    const auto budget = std::chrono::duration_cast<std::chrono::microseconds>(stall_budget).count();
+    items_.emplace_back(Item{executable, executor, budget});
 
     return true;
 }
@@ -61,6 +73,8 @@ bool ExecutorPool::Start() {
     }
 
     running_ = result;
+    if (running_)
+        started_ = ac::Utils::GetNowUs();
 
     return result;
 }
@@ -69,9 +83,25 @@ bool ExecutorPool::Stop() {
     if (!running_)
         return false;
 
+    const auto started = std::chrono::steady_clock::now();
+
+    // Tell everyone first so all stages unwind at the same time rather
+    // than one waiting for the next one to be stopped. The deadline is
+    // shared so the time to stop is bound by the slowest executor and
+    // not the sum of all.
+    for (auto &item : items_)
+        item.executor->RequestStop();
+
+    const auto deadline = started + stop_timeout_;
+
     bool result = true;
     for (auto &item : items_)
-        result &= item.executor->Stop();
+        result &= item.executor->StopUntil(deadline);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started);
+    if (elapsed >= stop_timeout_)
+        AC_WARNING("Stopping executors took %d ms", elapsed.count());
 
     if (result)
         running_ = false;
@@ -83,5 +113,23 @@ bool ExecutorPool::Running() const {
     return running_;
 }
 
+std::vector<ExecutorPool::Stall> ExecutorPool::FindStalled(ac::TimestampUs now) const {
+    std::vector<Stall> stalls;
+    if (!running_)
+        return stalls;
+
+    for (const auto &item : items_) {
+        const auto progress = item.executable->LastProgress();
+        if (progress < 0)
+            continue;
+
+        const auto duration = now - std::max(progress, started_);
+        if (duration > item.stall_budget)
+            stalls.push_back(Stall{item.executable->Name(), duration});
+    }
+
+    return stalls;
+}
+
 } // namespace common
 } // namespace ac
@@ -20,9 +20,12 @@
 
 #include <cstddef>
 
+#include <chrono>
+#include <string>
 #include <vector>
 
 #include "ac/non_copyable.h"
+#include "ac/utils.h"
 
 #include "ac/common/executor.h"
 #include "ac/common/executorfactory.h"
@@ -34,24 +37,48 @@ namespace common {
 
 class ExecutorPool : public ac::NonCopyable {
 public:
-    ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size);
+    // Upper bound for Stop() to wait for the executors to wind down.
+    // Executors still busy after it are given up on and Stop() fails.
+    static constexpr std::chrono::milliseconds kDefaultStopTimeout{500};
+    // Time an executable may go without progress before it counts as
+    // stalled.
+    static constexpr std::chrono::milliseconds kDefaultStallBudget{1000};
+
+    struct Stall {
+        std::string name;
+        ac::TimestampUs duration;
+    };
+
+    ExecutorPool(const ExecutorFactory::Ptr &factory, const size_t &size,
+                 const std::chrono::milliseconds &stop_timeout = kDefaultStopTimeout);
     ~ExecutorPool();
 
-    bool Add(const Executable::Ptr &executable);
+    bool Add(const Executable::Ptr &executable,
+             const std::chrono::milliseconds &stall_budget = kDefaultStallBudget);
 
     bool Start();
+    // Returns false if an executor didn't stop in time. The pool then
+    // stays in the running state and can't be started again as the
+    // executable left behind might still be busy; it has to be replaced.
     bool Stop();
 
     bool Running() const;
 
+    // Executables which made no progress within their budget. Time
+    // before the pool was started doesn't count.
+    std::vector<Stall> FindStalled(ac::TimestampUs now) const;
+
 private:
     struct Item {
         Executable::Ptr executable;
         Executor::Ptr executor;
+        ac::TimestampUs stall_budget;
     };
 
     std::uint32_t size_;
+    std::chrono::milliseconds stop_timeout_;
     bool running_;
+    ac::TimestampUs started_;
     ExecutorFactory::Ptr factory_;
     std::vector<Item> items_;
 };
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/common/lockprofiler.h"
+
+namespace {
+static constexpr ac::TimestampUs kSampleIntervalUs{1000000};
+
+void UpdateMax(std::atomic<std::uint64_t> &max, std::uint64_t value) {
+    auto current = max.load();
+    while (value > current && !max.compare_exchange_weak(current, value));
+}
+}
+
+namespace ac {
+namespace common {
+
+LockProfiler::Site::Site(const std::string &name) :
+    name(name),
+    acquisitions(0),
+    contentions(0),
+    wait(0),
+    max_wait(0),
+    hold(0),
+    max_hold(0) {
+}
+
+LockProfiler::Ptr LockProfiler::Instance() {
+    static const auto instance = Create();
+    return instance;
+}
+
+LockProfiler::Ptr LockProfiler::Create() {
+    return std::shared_ptr<LockProfiler>(new LockProfiler);
+}
+
+LockProfiler::LockProfiler() :
+    last_sample_(0) {
+}
+
+void LockProfiler::SetReport(const video::LockReport::Ptr &report) {
+    std::lock_guard<std::mutex> lock(report_lock_);
+    report_ = report;
+}
+
+LockProfiler::Site* LockProfiler::Register(const std::string &name) {
+    std::lock_guard<std::mutex> lock(sites_lock_);
+    auto &site = sites_[name];
+    if (!site)
+        site.reset(new Site(name));
+    return site.get();
+}
+
+void LockProfiler::Record(Site *site, bool contended, const std::chrono::nanoseconds &wait,
+                          const std::chrono::nanoseconds &hold) {
+    site->acquisitions++;
+    if (contended)
+        site->contentions++;
+
+    site->wait += wait.count();
+    UpdateMax(site->max_wait, wait.count());
+    site->hold += hold.count();
+    UpdateMax(site->max_hold, hold.count());
+
+    Sample();
+}
+
+std::vector<LockProfiler::Statistics> LockProfiler::Hottest(std::size_t count) const {
+    std::vector<Statistics> hottest;
+    {
+        std::lock_guard<std::mutex> lock(sites_lock_);
+        for (const auto &entry : sites_) {
+            const auto &site = entry.second;
+            if (site->acquisitions == 0)
+                continue;
+
+            hottest.push_back(Statistics{site->name, site->acquisitions, site->contentions,
+                                         std::chrono::nanoseconds{site->wait},
+                                         std::chrono::nanoseconds{site->max_wait},
+                                         std::chrono::nanoseconds{site->hold},
+                                         std::chrono::nanoseconds{site->max_hold}});
+        }
+    }
+
+    std::stable_sort(hottest.begin(), hottest.end(), [](const Statistics &lhs, const Statistics &rhs) {
+        if (lhs.wait != rhs.wait)
+            return lhs.wait > rhs.wait;
+        return lhs.contentions > rhs.contentions;
+    });
+
+    if (count > 0 && hottest.size() > count)
+        hottest.resize(count);
+
+    return hottest;
+}
+
+void LockProfiler::Reset() {
+    std::lock_guard<std::mutex> lock(sites_lock_);
+    for (auto &entry : sites_) {
+        auto &site = entry.second;
+        site->acquisitions = 0;
+        site->contentions = 0;
+        site->wait = 0;
+        site->max_wait = 0;
+        site->hold = 0;
+        site->max_hold = 0;
+    }
+}
+
+void LockProfiler::Sample() {
+    std::unique_lock<std::mutex> lock(report_lock_, std::try_to_lock);
+    if (!lock.owns_lock() || !report_)
+        return;
+
+    const auto now = ac::Utils::GetNowUs();
+    if (now - last_sample_ < kSampleIntervalUs)
+        return;
+
+    last_sample_ = now;
+
+    for (const auto &site : Hottest())
+        report_->LockSampled(site.site, site.acquisitions, site.contentions,
+                             site.wait.count(), site.hold.count());
+}
+
+ProfiledMutex::ProfiledMutex(const std::string &site, const LockProfiler::Ptr &profiler) :
+    profiler_(profiler),
+    site_(profiler_->Register(site)),
+    contended_(false),
+    wait_(LockProfiler::Clock::duration::zero()) {
+}
+
+void ProfiledMutex::SetSite(const std::string &site) {
+    site_ = profiler_->Register(site);
+}
+
+void ProfiledMutex::lock() {
+    if (mutex_.try_lock()) {
+        contended_ = false;
+        wait_ = LockProfiler::Clock::duration::zero();
+        acquired_ = LockProfiler::Clock::now();
+        return;
+    }
+
+    const auto start = LockProfiler::Clock::now();
+    mutex_.lock();
+    acquired_ = LockProfiler::Clock::now();
+    contended_ = true;
+    wait_ = acquired_ - start;
+}
+
+bool ProfiledMutex::try_lock() {
+    if (!mutex_.try_lock())
+        return false;
+
+    contended_ = false;
+    wait_ = LockProfiler::Clock::duration::zero();
+    acquired_ = LockProfiler::Clock::now();
+    return true;
+}
+
+void ProfiledMutex::unlock() {
+    const auto hold = LockProfiler::Clock::now() - acquired_;
+    const auto contended = contended_;
+    const auto wait = wait_;
+    auto site = site_;
+
+    mutex_.unlock();
+
+    profiler_->Record(site, contended,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(wait),
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(hold));
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_LOCKPROFILER_H_
+#define AC_COMMON_LOCKPROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/lockreport.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Collects how long locks are waited for and held, aggregated by
+ * the site (a name given to the lock by its owner) they belong to.
+ *
+ * Only locks of type ProfiledMutex feed into the profiler. Those are used
+ * instead of std::mutex when building with AETHERCAST_LOCK_PROFILING.
+ */
+class LockProfiler : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<LockProfiler> Ptr;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Site {
+        explicit Site(const std::string &name);
+
+        const std::string name;
+        std::atomic<std::uint64_t> acquisitions;
+        std::atomic<std::uint64_t> contentions;
+        // Nanoseconds
+        std::atomic<std::uint64_t> wait;
+        std::atomic<std::uint64_t> max_wait;
+        std::atomic<std::uint64_t> hold;
+        std::atomic<std::uint64_t> max_hold;
+    };
+
+    struct Statistics {
+        std::string site;
+        std::uint64_t acquisitions;
+        std::uint64_t contentions;
+        std::chrono::nanoseconds wait;
+        std::chrono::nanoseconds max_wait;
+        std::chrono::nanoseconds hold;
+        std::chrono::nanoseconds max_hold;
+    };
+
+    static Ptr Instance();
+
+    static Ptr Create();
+
+    void SetReport(const video::LockReport::Ptr &report);
+
+    // Sites are never released again so the returned pointer stays valid
+    // for the lifetime of the profiler. All locks registering the same
+    // name share a site.
+    Site* Register(const std::string &name);
+
+    void Record(Site *site, bool contended, const std::chrono::nanoseconds &wait,
+                const std::chrono::nanoseconds &hold);
+
+    // Sites ordered by the total time spent waiting for them, the most
+    // contended one first. A count of zero returns all of them.
+    std::vector<Statistics> Hottest(std::size_t count = 0) const;
+
+    void Reset();
+
+private:
+    LockProfiler();
+
+    void Sample();
+
+private:
+    mutable std::mutex sites_lock_;
+    std::map<std::string, std::unique_ptr<Site>> sites_;
+    std::mutex report_lock_;
+    video::LockReport::Ptr report_;
+    ac::TimestampUs last_sample_;
+};
+
+/**
+ * @brief Drop-in replacement for std::mutex which records the time spent
+ * acquiring and holding it with a LockProfiler.
+ *
+ * Satisfies the Lockable concept so it works with std::lock_guard,
+ * std::unique_lock and std::condition_variable_any.
+ */
+class ProfiledMutex : public ac::NonCopyable {
+public:
+    explicit ProfiledMutex(const std::string &site = "unnamed",
+                           const LockProfiler::Ptr &profiler = LockProfiler::Instance());
+
+    void SetSite(const std::string &site);
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    std::mutex mutex_;
+    LockProfiler::Ptr profiler_;
+    LockProfiler::Site *site_;
+    // Only touched by the current owner of mutex_
+    bool contended_;
+    LockProfiler::Clock::duration wait_;
+    LockProfiler::Clock::time_point acquired_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_MUTEX_H_
+#define AC_COMMON_MUTEX_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/common/lockprofiler.h"
+
+namespace ac {
+namespace common {
+
+// Locks on hot paths of the pipeline use these instead of the std types
+// so a build with AETHERCAST_LOCK_PROFILING can tell which of them are
+// contended. Without it they are exactly the std types.
+#if defined(AC_LOCK_PROFILING)
+typedef ProfiledMutex Mutex;
+typedef std::condition_variable_any ConditionVariable;
+#else
+typedef std::mutex Mutex;
+typedef std::condition_variable ConditionVariable;
+#endif
+
+inline void NameLock(std::mutex &mutex, const std::string &site) {
+    boost::ignore_unused_variable_warning(mutex);
+    boost::ignore_unused_variable_warning(site);
+}
+
+inline void NameLock(ProfiledMutex &mutex, const std::string &site) {
+    mutex.SetSite(site);
+}
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include "ac/logger.h"
+
+#include "ac/common/perfcounters.h"
+
+namespace {
+static constexpr int kCounterCount{static_cast<int>(ac::common::PerfCounters::Counter::kCount)};
+
+std::uint64_t EventFor(ac::common::PerfCounters::Counter counter) {
+    switch (counter) {
+    case ac::common::PerfCounters::Counter::kInstructions:
+        return PERF_COUNT_HW_INSTRUCTIONS;
+    case ac::common::PerfCounters::Counter::kCacheMisses:
+        return PERF_COUNT_HW_CACHE_MISSES;
+    case ac::common::PerfCounters::Counter::kBranchMisses:
+        return PERF_COUNT_HW_BRANCH_MISSES;
+    default:
+        break;
+    }
+    return PERF_COUNT_HW_CPU_CYCLES;
+}
+
+int OpenCounter(ac::common::PerfCounters::Counter counter, int group_fd) {
+    struct perf_event_attr attr;
+    ::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = EventFor(counter);
+    attr.read_format = PERF_FORMAT_GROUP;
+    // Only what the stage itself does. Counting the kernel as well needs
+    // privileges we don't have with the default perf_event_paranoid.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+
+    return ::syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+}
+
+namespace ac {
+namespace common {
+
+PerfCounters::Values::Values() {
+    for (auto &count : counts)
+        count = -1;
+}
+
+PerfCounters::Values PerfCounters::Values::operator-(const Values &other) const {
+    Values result;
+    for (int n = 0; n < kCounterCount; n++) {
+        if (counts[n] >= 0 && other.counts[n] >= 0)
+            result.counts[n] = counts[n] - other.counts[n];
+    }
+    return result;
+}
+
+PerfCounters::Values& PerfCounters::Values::operator+=(const Values &other) {
+    for (int n = 0; n < kCounterCount; n++) {
+        if (other.counts[n] < 0)
+            continue;
+        counts[n] = counts[n] < 0 ? other.counts[n] : counts[n] + other.counts[n];
+    }
+    return *this;
+}
+
+PerfCounters::Ptr PerfCounters::OpenForCurrentThread() {
+    std::vector<int> fds;
+    std::vector<Counter> counters;
+
+    for (int n = 0; n < kCounterCount; n++) {
+        const auto counter = static_cast<Counter>(n);
+        const auto fd = OpenCounter(counter, fds.empty() ? -1 : fds.front());
+        if (fd < 0)
+            continue;
+
+        fds.push_back(fd);
+        counters.push_back(counter);
+    }
+
+    if (fds.empty()) {
+        // Every pipeline thread tries this; no need to tell more than once.
+        static std::once_flag warned;
+        const auto error = errno;
+        std::call_once(warned, [error]() {
+            AC_WARNING("Hardware performance counters are not available: %s (%d)",
+                       ::strerror(error), error);
+        });
+        return nullptr;
+    }
+
+    if (::ioctl(fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) < 0 ||
+        ::ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+        AC_WARNING("Failed to enable performance counters: %s (%d)", ::strerror(errno), errno);
+        for (const auto fd : fds)
+            ::close(fd);
+        return nullptr;
+    }
+
+    return std::shared_ptr<PerfCounters>(new PerfCounters(fds, counters));
+}
+
+PerfCounters::PerfCounters(const std::vector<int> &fds, const std::vector<Counter> &counters) :
+    fds_(fds),
+    counters_(counters) {
+}
+
+PerfCounters::~PerfCounters() {
+    // The group leader goes last; closing it first would turn the
+    // others into counters of their own.
+    for (auto it = fds_.rbegin(); it != fds_.rend(); ++it)
+        ::close(*it);
+}
+
+bool PerfCounters::Read(Values *values) const {
+    if (!values)
+        return false;
+
+    // Layout of a group read: the number of counters followed by
+    // their values in the order they were added to the group.
+    std::uint64_t data[1 + kCounterCount];
+    const auto bytes = ::read(fds_.front(), data, sizeof(data));
+    if (bytes < static_cast<ssize_t>(sizeof(std::uint64_t)))
+        return false;
+
+    const auto count = std::min<std::size_t>(data[0], counters_.size());
+    if (static_cast<std::size_t>(bytes) < (1 + count) * sizeof(std::uint64_t))
+        return false;
+
+    *values = Values{};
+    for (std::size_t n = 0; n < count; n++)
+        values->counts[static_cast<int>(counters_[n])] = static_cast<std::int64_t>(data[1 + n]);
+
+    return true;
+}
+
+} // namespace common
+} // namespace ac
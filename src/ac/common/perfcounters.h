@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_PERFCOUNTERS_H_
+#define AC_COMMON_PERFCOUNTERS_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Hardware performance counters of the thread which opened them.
+ *
+ * The counters are opened as one perf event group so that they are
+ * always scheduled together and their values relate to the same period
+ * of time. Counters the CPU or the kernel doesn't provide are left out
+ * and read as -1.
+ */
+class PerfCounters : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<PerfCounters> Ptr;
+
+    enum class Counter {
+        kCycles = 0,
+        kInstructions,
+        kCacheMisses,
+        kBranchMisses,
+        kCount
+    };
+
+    struct Values {
+        Values();
+
+        Values operator-(const Values &other) const;
+        Values& operator+=(const Values &other);
+
+        std::int64_t counts[static_cast<int>(Counter::kCount)];
+    };
+
+    // Returns nullptr if none of the counters can be opened, for example
+    // because perf_event_paranoid doesn't allow it or we are running in
+    // a virtual machine without a PMU.
+    static Ptr OpenForCurrentThread();
+
+    ~PerfCounters();
+
+    // Counts since the counters were opened
+    bool Read(Values *values) const;
+
+private:
+    PerfCounters(const std::vector<int> &fds, const std::vector<Counter> &counters);
+
+private:
+    // The first one is the group leader
+    std::vector<int> fds_;
+    // In the order they appear in the group
+    std::vector<Counter> counters_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/common/stallwatchdog.h"
+
+namespace {
+ac::TimestampUs ToUs(const std::chrono::milliseconds &duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+}
+
+namespace ac {
+namespace common {
+
+constexpr std::chrono::milliseconds StallWatchdog::kActionInterval;
+constexpr std::chrono::milliseconds StallWatchdog::kRecoveryPeriod;
+constexpr std::size_t StallWatchdog::kMaxRecords;
+
+std::string StallWatchdog::ActionToString(Action action) {
+    switch (action) {
+    case Action::kRequestIDR:
+        return "request-idr";
+    case Action::kFlushQueues:
+        return "flush-queues";
+    case Action::kRestartEncoder:
+        return "restart-encoder";
+    case Action::kTeardown:
+        return "teardown";
+    default:
+        break;
+    }
+    return "none";
+}
+
+StallWatchdog::Ptr StallWatchdog::Create() {
+    return std::shared_ptr<StallWatchdog>(new StallWatchdog);
+}
+
+StallWatchdog::StallWatchdog() :
+    last_action_(Action::kNone),
+    last_action_time_(0),
+    healthy_since_(0) {
+}
+
+void StallWatchdog::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    delegate_ = delegate;
+}
+
+void StallWatchdog::ResetDelegate() {
+    delegate_.reset();
+}
+
+StallWatchdog::Action StallWatchdog::Check(const ExecutorPool &pool, ac::TimestampUs now) {
+    const auto stalls = pool.FindStalled(now);
+
+    if (stalls.empty()) {
+        if (last_action_ == Action::kNone)
+            return Action::kNone;
+
+        if (healthy_since_ == 0)
+            healthy_since_ = now;
+
+        if (now - healthy_since_ >= ToUs(kRecoveryPeriod)) {
+            AC_INFO("Pipeline recovered from stall after %s", ActionToString(last_action_));
+            last_action_ = Action::kNone;
+            healthy_since_ = 0;
+        }
+
+        return Action::kNone;
+    }
+
+    healthy_since_ = 0;
+
+    // Tearing down is the last resort; if it didn't help there is
+    // nothing left for us to do.
+    if (last_action_ == Action::kTeardown)
+        return Action::kNone;
+
+    if (last_action_ != Action::kNone && now - last_action_time_ < ToUs(kActionInterval))
+        return Action::kNone;
+
+    const auto stall = *std::max_element(stalls.begin(), stalls.end(),
+                                         [](const ExecutorPool::Stall &a, const ExecutorPool::Stall &b) {
+        return a.duration < b.duration;
+    });
+
+    last_action_ = static_cast<Action>(static_cast<int>(last_action_) + 1);
+    last_action_time_ = now;
+
+    AC_WARNING("%s made no progress for %d ms; trying to recover with %s",
+               stall.name, stall.duration / 1000, ActionToString(last_action_));
+
+    AddRecord(Record{now, last_action_, stall.name, stall.duration});
+
+    if (auto sp = delegate_.lock())
+        sp->OnStallAction(last_action_);
+
+    return last_action_;
+}
+
+void StallWatchdog::Reset() {
+    last_action_ = Action::kNone;
+    last_action_time_ = 0;
+    healthy_since_ = 0;
+}
+
+StallWatchdog::Action StallWatchdog::LastAction() const {
+    return last_action_;
+}
+
+std::vector<StallWatchdog::Record> StallWatchdog::Records() const {
+    return std::vector<Record>(records_.begin(), records_.end());
+}
+
+void StallWatchdog::AddRecord(const Record &record) {
+    records_.push_back(record);
+    if (records_.size() > kMaxRecords)
+        records_.pop_front();
+}
+
+} // namespace common
+} // namespace ac
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_COMMON_STALLWATCHDOG_H_
+#define AC_COMMON_STALLWATCHDOG_H_
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/common/executorpool.h"
+
+namespace ac {
+namespace common {
+
+/**
+ * @brief Gets a pipeline going again when one of its stages stops making
+ * progress.
+ *
+ * The watchdog is checked periodically and looks for executables of a
+ * pool which went without progress for longer than their budget, for
+ * example an encoder not returning any buffers anymore or a sender
+ * blocked on a sink which doesn't read. It then escalates one step at a
+ * time, giving each action kActionInterval to have an effect, from
+ * requesting an IDR frame up to tearing the session down. Once the pool
+ * made progress again for kRecoveryPeriod it starts over with the first
+ * step for the next stall.
+ */
+class StallWatchdog : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<StallWatchdog> Ptr;
+
+    static constexpr std::chrono::milliseconds kActionInterval{1000};
+    static constexpr std::chrono::milliseconds kRecoveryPeriod{5000};
+    // Number of actions kept for Records()
+    static constexpr std::size_t kMaxRecords{32};
+
+    enum class Action {
+        kNone = 0,
+        kRequestIDR,
+        kFlushQueues,
+        kRestartEncoder,
+        kTeardown
+    };
+
+    struct Record {
+        ac::TimestampUs time;
+        Action action;
+        // Stage which stalled the longest and for how long
+        std::string stage;
+        ac::TimestampUs stalled_for;
+    };
+
+    class Delegate : private ac::NonCopyable {
+    public:
+        virtual void OnStallAction(Action action) = 0;
+
+    protected:
+        Delegate() = default;
+    };
+
+    static std::string ActionToString(Action action);
+
+    static Ptr Create();
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+    void ResetDelegate();
+
+    // Looks for stalled executables in pool and takes the next action
+    // if needed. Returns the action taken.
+    Action Check(const ExecutorPool &pool, ac::TimestampUs now);
+
+    // Starts over as if no stall had happened so far, for example when
+    // the pipeline was restarted for a new session.
+    void Reset();
+
+    Action LastAction() const;
+    std::vector<Record> Records() const;
+
+private:
+    StallWatchdog();
+
+    void AddRecord(const Record &record);
+
+private:
+    std::weak_ptr<Delegate> delegate_;
+    Action last_action_;
+    ac::TimestampUs last_action_time_;
+    ac::TimestampUs healthy_since_;
+    std::deque<Record> records_;
+};
+
+} // namespace common
+} // namespace ac
+
+#endif
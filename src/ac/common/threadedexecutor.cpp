@@ -18,53 +18,148 @@
 #include "ac/utils.h"
 #include "ac/logger.h"
 
+#include "ac/common/perfcounters.h"
 #include "ac/common/threadedexecutor.h"
 
+namespace {
+void ReportCounters(const ac::video::PerfCounterReport::Ptr &report, const std::string &stage,
+                    std::uint64_t iterations, const ac::common::PerfCounters::Values &values) {
+    typedef ac::common::PerfCounters::Counter Counter;
+    const auto count = [&](Counter counter) { return values.counts[static_cast<int>(counter)]; };
+
+    report->CountersSampled(stage, iterations,
+                            count(Counter::kCycles), count(Counter::kInstructions),
+                            count(Counter::kCacheMisses), count(Counter::kBranchMisses));
+}
+}
+
 namespace ac {
 namespace common {
 
+constexpr std::chrono::milliseconds ThreadedExecutor::kPerfCounterInterval;
 
-ThreadedExecutor::ThreadedExecutor(const Executable::Ptr &executable) :
+ThreadedExecutor::State::State() :
+    running(false),
+    iteration_started(0),
+    exited(false) {
+}
+
+ThreadedExecutor::ThreadedExecutor(const Executable::Ptr &executable,
+                                   const video::PerfCounterReport::Ptr &perf_report) :
     executable_(executable),
-    running_(false) {
+    perf_report_(perf_report),
+    state_(std::make_shared<State>()),
+    abandoned_(false) {
 }
 
 ThreadedExecutor::~ThreadedExecutor() {
     Stop();
 }
 
-void ThreadedExecutor::ThreadWorker() {
-    if (executable_->Name().length() > 0) {
-        ac::Utils::SetThreadName(executable_->Name());
-        AC_DEBUG("Started threaded executor %s", executable_->Name());
+void ThreadedExecutor::ThreadWorker(const Executable::Ptr &executable, const std::shared_ptr<State> &state,
+                                    const video::PerfCounterReport::Ptr &perf_report) {
+    if (executable->Name().length() > 0) {
+        ac::Utils::SetThreadName(executable->Name());
+        AC_DEBUG("Started threaded executor %s", executable->Name());
     }
 
-    while (running_) {
-        if (!executable_->Execute())
+    // Counters only count the thread which opened them
+    const auto counters = perf_report ? PerfCounters::OpenForCurrentThread() : nullptr;
+    const ac::TimestampUs interval = std::chrono::duration_cast<std::chrono::microseconds>(
+                kPerfCounterInterval).count();
+
+    PerfCounters::Values before, after, sampled;
+    std::uint64_t iterations = 0;
+    ac::TimestampUs last_sample = ac::Utils::GetNowUs();
+
+    while (state->running) {
+        state->iteration_started = ac::Utils::GetNowUs();
+
+        if (!counters) {
+            if (!executable->Execute())
+                break;
+            continue;
+        }
+
+        const auto have_before = counters->Read(&before);
+        const auto result = executable->Execute();
+        if (have_before && counters->Read(&after))
+            sampled += after - before;
+
+        iterations++;
+
+        const ac::TimestampUs now = ac::Utils::GetNowUs();
+        if (now - last_sample >= interval) {
+            ReportCounters(perf_report, executable->Name(), iterations, sampled);
+            sampled = PerfCounters::Values{};
+            iterations = 0;
+            last_sample = now;
+        }
+
+        if (!result)
             break;
     }
+
+    std::lock_guard<Mutex> l(state->lock);
+    state->exited = true;
+    state->exited_changed.notify_all();
 }
 
 bool ThreadedExecutor::Start() {
-    if (running_)
+    if (state_->running || thread_.joinable())
         return false;
 
+    // The thread we gave up on is still using the executable and we
+    // don't get it back. Whoever owns the executable has to replace it.
+    if (abandoned_) {
+        AC_ERROR("Refusing to start executor %s again after giving up on it", executable_->Name());
+        return false;
+    }
+
     if (!executable_->Start())
         return false;
 
-    running_.exchange(true);
+    state_ = std::make_shared<State>();
+    NameLock(state_->lock, "ThreadedExecutor:" + executable_->Name());
+    state_->running = true;
 
-    thread_ = std::thread(&ThreadedExecutor::ThreadWorker, this);
+    thread_ = std::thread(&ThreadedExecutor::ThreadWorker, executable_, state_, perf_report_);
 
     return true;
 }
 
-bool ThreadedExecutor::Stop() {
-    if (!running_.exchange(false))
-        return false;
+void ThreadedExecutor::RequestStop() {
+    if (!state_->running.exchange(false))
+        return;
 
+    // The executable is expected to unblock any wait it is currently
+    // in so that the thread can wind down.
     if (!executable_->Stop())
         AC_ERROR("Failed to stop exutable");
+}
+
+bool ThreadedExecutor::Stop() {
+    return StopUntil(std::chrono::steady_clock::time_point::max());
+}
+
+bool ThreadedExecutor::StopUntil(const std::chrono::steady_clock::time_point &deadline) {
+    RequestStop();
+
+    if (!thread_.joinable())
+        return false;
+
+    std::unique_lock<Mutex> l(state_->lock);
+    if (deadline == std::chrono::steady_clock::time_point::max())
+        state_->exited_changed.wait(l, [&]() { return state_->exited; });
+    else if (!state_->exited_changed.wait_until(l, deadline, [&]() { return state_->exited; })) {
+        AC_ERROR("Executor %s didn't stop in time, it is in an iteration for %lld us already; giving up on it",
+                 executable_->Name(), ac::Utils::GetNowUs() - state_->iteration_started);
+        l.unlock();
+        thread_.detach();
+        abandoned_ = true;
+        return false;
+    }
+    l.unlock();
 
     thread_.join();
 
@@ -72,7 +167,7 @@ bool ThreadedExecutor::Stop() {
 }
 
 bool ThreadedExecutor::Running() const {
-    return running_;
+    return state_->running;
 }
 
 } // namespace common
@@ -19,18 +19,30 @@
 #define AC_COMMON_THREADEDEXECUTOR_H_
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <thread>
 
+#include "ac/utils.h"
+
+#include "ac/video/perfcounterreport.h"
+
 #include "ac/common/executor.h"
 #include "ac/common/executable.h"
+#include "ac/common/mutex.h"
 
 namespace ac {
 namespace common {
 
 class ThreadedExecutor : public Executor {
 public:
-    ThreadedExecutor(const Executable::Ptr &executable);
+    // With a report given hardware performance counters are read around
+    // every iteration of the executable and reported in intervals of
+    // kPerfCounterInterval.
+    static constexpr std::chrono::milliseconds kPerfCounterInterval{1000};
+
+    ThreadedExecutor(const Executable::Ptr &executable,
+                     const video::PerfCounterReport::Ptr &perf_report = nullptr);
     ~ThreadedExecutor();
 
     bool Start() override;
@@ -38,14 +50,34 @@ public:
 
     bool Running() const override;
 
+    void RequestStop() override;
+    // Returns false if the thread didn't stop before the deadline. It is
+    // left behind then and the executor refuses to be started again.
+    bool StopUntil(const std::chrono::steady_clock::time_point &deadline) override;
+
 private:
+    // Everything the worker thread touches. It is shared with the thread
+    // so that a thread we had to give up on can't outlive its state.
+    struct State {
+        State();
+
+        std::atomic<bool> running;
+        std::atomic<ac::TimestampUs> iteration_started;
+        Mutex lock;
+        ConditionVariable exited_changed;
+        bool exited;
+    };
 
-    void ThreadWorker();
+    static void ThreadWorker(const Executable::Ptr &executable, const std::shared_ptr<State> &state,
+                             const video::PerfCounterReport::Ptr &perf_report);
 
 private:
     Executable::Ptr executable_;
-    std::atomic<bool> running_;
+    video::PerfCounterReport::Ptr perf_report_;
+    std::shared_ptr<State> state_;
     std::thread thread_;
+    // Set once StopUntil() had to leave the thread behind
+    bool abandoned_;
 };
 
 } // namespace common
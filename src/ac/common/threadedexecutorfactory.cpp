@@ -21,8 +21,12 @@
 namespace ac {
 namespace common {
 
+ThreadedExecutorFactory::ThreadedExecutorFactory(const video::PerfCounterReport::Ptr &perf_report) :
+    perf_report_(perf_report) {
+}
+
 Executor::Ptr ThreadedExecutorFactory::Create(const Executable::Ptr &executable) {
-    return std::make_shared<ThreadedExecutor>(executable);
+    return std::make_shared<ThreadedExecutor>(executable, perf_report_);
 }
 
 } // namespace common
@@ -18,6 +18,8 @@
 #ifndef AC_COMMON_THREADEDEXECUTORFACTORY_H_
 #define AC_COMMON_THREADEDEXECUTORFACTORY_H_
 
+#include "ac/video/perfcounterreport.h"
+
 #include "ac/common/executorfactory.h"
 
 namespace ac {
@@ -25,7 +27,14 @@ namespace common {
 
 class ThreadedExecutorFactory : public ExecutorFactory {
 public:
+    // All executors created share the report for their performance
+    // counters; without one no counters are read.
+    ThreadedExecutorFactory(const video::PerfCounterReport::Ptr &perf_report = nullptr);
+
     Executor::Ptr Create(const Executable::Ptr &executable) override;
+
+private:
+    video::PerfCounterReport::Ptr perf_report_;
 };
 
 } // namespace common
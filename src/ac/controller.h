@@ -21,6 +21,7 @@
 #include <chrono>
 #include <memory>
 
+#include "inputprovider.h"
 #include "networkmanager.h"
 #include "networkdevice.h"
 #include "non_copyable.h"
@@ -63,6 +64,10 @@ public:
 
     virtual Error SetEnabled(bool enabled) = 0;
 
+    // Only a single input provider can be registered at a time
+    virtual Error RegisterInputProvider(const InputProvider::Ptr &provider) = 0;
+    virtual Error UnregisterInputProvider(const InputProvider::Ptr &provider) = 0;
+
 protected:
     Controller() = default;
 };
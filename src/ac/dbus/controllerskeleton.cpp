@@ -69,6 +69,16 @@ void ControllerSkeleton::SyncProperties() {
 
     aethercast_interface_manager_set_scanning(manager_obj_.get(), Scanning());
     aethercast_interface_manager_set_enabled(manager_obj_.get(), Enabled());
+
+    const auto sessions = video::QualityHistory::Instance()->Sessions();
+    aethercast_interface_manager_set_last_session_quality(manager_obj_.get(), sessions.empty() ?
+        g_variant_new("a{sv}", nullptr) : Helpers::GenerateSessionQuality(sessions.back()));
+
+    aethercast_interface_manager_set_thermal_state(manager_obj_.get(),
+        Helpers::GenerateThermalState(video::ThermalGovernor::Instance()->CurrentStatus()));
+
+    aethercast_interface_manager_set_main_loop_statistics(manager_obj_.get(),
+        Helpers::GenerateMainLoopStatistics(MainLoopMonitor::Instance()->CurrentStatistics()));
 }
 
 void ControllerSkeleton::OnStateChanged(NetworkDeviceState state) {
@@ -79,7 +89,7 @@ void ControllerSkeleton::OnStateChanged(NetworkDeviceState state) {
                                            NetworkDevice::StateToStr(State()).c_str());
 }
 
-std::string ControllerSkeleton::GenerateDevicePath(const NetworkDevice::Ptr &device) const {
+std::string ControllerSkeleton::GenerateDevicePath(const NetworkDevice::Ptr &device) {
     std::string address = device->Address();
     std::replace(address.begin(), address.end(), ':', '_');
     // FIXME using kManagerPath doesn't seem to work. Fails at link time ...
@@ -118,6 +128,30 @@ void ControllerSkeleton::OnChanged() {
     SyncProperties();
 }
 
+void ControllerSkeleton::OnSessionFinished(const video::QualityHistory::Session &session) {
+    if (!manager_obj_)
+        return;
+
+    aethercast_interface_manager_set_last_session_quality(manager_obj_.get(),
+                                                          Helpers::GenerateSessionQuality(session));
+}
+
+void ControllerSkeleton::OnThermalLevelChanged(const video::ThermalGovernor::Status &status) {
+    if (!manager_obj_)
+        return;
+
+    aethercast_interface_manager_set_thermal_state(manager_obj_.get(),
+                                                   Helpers::GenerateThermalState(status));
+}
+
+void ControllerSkeleton::OnMainLoopStatisticsChanged(const MainLoopMonitor::Statistics &statistics) {
+    if (!manager_obj_)
+        return;
+
+    aethercast_interface_manager_set_main_loop_statistics(manager_obj_.get(),
+                                                          Helpers::GenerateMainLoopStatistics(statistics));
+}
+
 static std::string HyphenNameFromPropertyName(const std::string &property_name) {
     auto hyphen_name = property_name;
     // NOTE: Once we have more complex property names which have to
@@ -197,6 +231,18 @@ void ControllerSkeleton::OnNameAcquired(GDBusConnection *connection, const gchar
                      [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
                      GConnectFlags(0));
 
+    g_signal_connect_data(inst->manager_obj_.get(), "handle-register-input-provider",
+                     G_CALLBACK(&ControllerSkeleton::OnHandleRegisterInputProvider),
+                     new WeakKeepAlive<ControllerSkeleton>(inst),
+                     [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
+                     GConnectFlags(0));
+
+    g_signal_connect_data(inst->manager_obj_.get(), "handle-unregister-input-provider",
+                     G_CALLBACK(&ControllerSkeleton::OnHandleUnregisterInputProvider),
+                     new WeakKeepAlive<ControllerSkeleton>(inst),
+                     [](gpointer data, GClosure *) { delete static_cast<WeakKeepAlive<ControllerSkeleton>*>(data); },
+                     GConnectFlags(0));
+
     inst->SyncProperties();
 
     g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(inst->manager_obj_.get()),
@@ -260,6 +306,85 @@ gboolean ControllerSkeleton::OnHandleDisconnectAll(AethercastInterfaceManager *s
     return TRUE;
 }
 
+gboolean ControllerSkeleton::OnHandleRegisterInputProvider(AethercastInterfaceManager *skeleton,
+                                                           GDBusMethodInvocation *invocation, const gchar *path,
+                                                           GVariant *options, gpointer user_data) {
+    boost::ignore_unused_variable_warning(skeleton);
+    // There are no options specified yet
+    boost::ignore_unused_variable_warning(options);
+
+    const auto inst = static_cast<WeakKeepAlive<ControllerSkeleton>*>(user_data)->GetInstance().lock();
+
+    if (not inst) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_INVALID_STATE, "Invalid state");
+        return TRUE;
+    }
+
+    if (inst->input_provider_) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AethercastErrorFromError(Error::kAlready), "%s", ac::ErrorToString(Error::kAlready).c_str());
+        return TRUE;
+    }
+
+    const std::weak_ptr<ControllerSkeleton> weak_inst{inst};
+    const std::string sender = g_dbus_method_invocation_get_sender(invocation);
+
+    auto provider = InputProviderProxy::Create(inst->bus_connection_, sender, path, [weak_inst]() {
+        const auto thiz = weak_inst.lock();
+        if (!thiz || !thiz->input_provider_)
+            return;
+
+        thiz->UnregisterInputProvider(thiz->input_provider_);
+        thiz->input_provider_.reset();
+    });
+
+    const auto error = inst->RegisterInputProvider(provider);
+    if (error != ac::Error::kNone) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AethercastErrorFromError(error), "%s", ac::ErrorToString(error).c_str());
+        return TRUE;
+    }
+
+    inst->input_provider_ = provider;
+
+    AC_INFO("Registered input provider %s at %s", sender, path);
+
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+
+    return TRUE;
+}
+
+gboolean ControllerSkeleton::OnHandleUnregisterInputProvider(AethercastInterfaceManager *skeleton,
+                                                             GDBusMethodInvocation *invocation, const gchar *path,
+                                                             gpointer user_data) {
+    boost::ignore_unused_variable_warning(skeleton);
+    const auto inst = static_cast<WeakKeepAlive<ControllerSkeleton>*>(user_data)->GetInstance().lock();
+
+    if (not inst) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AETHERCAST_ERROR_INVALID_STATE, "Invalid state");
+        return TRUE;
+    }
+
+    const std::string sender = g_dbus_method_invocation_get_sender(invocation);
+
+    // Only the one who registered the provider may unregister it again
+    if (!inst->input_provider_ || inst->input_provider_->BusName() != sender ||
+            inst->input_provider_->Path() != path) {
+        g_dbus_method_invocation_return_error(invocation, AETHERCAST_ERROR,
+            AethercastErrorFromError(Error::kParamInvalid), "%s", ac::ErrorToString(Error::kParamInvalid).c_str());
+        return TRUE;
+    }
+
+    inst->UnregisterInputProvider(inst->input_provider_);
+    inst->input_provider_.reset();
+
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+
+    return TRUE;
+}
+
 std::shared_ptr<ControllerSkeleton> ControllerSkeleton::FinalizeConstruction() {
     auto sp = shared_from_this();
 
@@ -277,6 +402,9 @@ std::shared_ptr<ControllerSkeleton> ControllerSkeleton::FinalizeConstruction() {
         AC_WARNING("Failed to register bus name");
 
     SetDelegate(sp);
+    video::QualityHistory::Instance()->SetDelegate(sp);
+    video::ThermalGovernor::Instance()->SetDelegate(sp);
+    MainLoopMonitor::Instance()->SetDelegate(sp);
     return sp;
 }
 } // namespace dbus
@@ -31,16 +31,24 @@ extern "C" {
 #include <memory>
 #include <unordered_map>
 
+#include "ac/mainloopmonitor.h"
 #include "ac/scoped_gobject.h"
 #include "ac/forwardingcontroller.h"
 
+#include "ac/video/qualityhistory.h"
+#include "ac/video/thermalgovernor.h"
+
+#include "ac/dbus/inputproviderproxy.h"
 #include "ac/dbus/networkdeviceskeleton.h"
 
 namespace ac {
 namespace dbus {
 class ControllerSkeleton : public std::enable_shared_from_this<ControllerSkeleton>,
                            public ForwardingController,
-                           public Controller::Delegate {
+                           public Controller::Delegate,
+                           public video::QualityHistory::Delegate,
+                           public video::ThermalGovernor::Delegate,
+                           public MainLoopMonitor::Delegate {
 public:
     static constexpr const char *kBusName{"org.aethercast"};
     static constexpr const char *kManagerPath{"/org/aethercast"};
@@ -48,6 +56,8 @@ public:
 
     static std::shared_ptr<ControllerSkeleton> Create(const std::shared_ptr<Controller> &controller);
 
+    static std::string GenerateDevicePath(const NetworkDevice::Ptr &device);
+
     ~ControllerSkeleton();
 
     void OnStateChanged(NetworkDeviceState state) override;
@@ -56,6 +66,12 @@ public:
     void OnDeviceChanged(const NetworkDevice::Ptr &peer) override;
     void OnChanged() override;
 
+    void OnSessionFinished(const video::QualityHistory::Session &session) override;
+
+    void OnThermalLevelChanged(const video::ThermalGovernor::Status &status) override;
+
+    void OnMainLoopStatisticsChanged(const MainLoopMonitor::Statistics &statistics) override;
+
 private:
     static void OnNameAcquired(GDBusConnection *connection, const gchar *name, gpointer user_data);
 
@@ -65,6 +81,10 @@ private:
                                  gpointer user_data);
     static gboolean OnHandleDisconnectAll(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
                                           gpointer user_data);
+    static gboolean OnHandleRegisterInputProvider(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
+                                                  const gchar *path, GVariant *options, gpointer user_data);
+    static gboolean OnHandleUnregisterInputProvider(AethercastInterfaceManager *skeleton, GDBusMethodInvocation *invocation,
+                                                    const gchar *path, gpointer user_data);
 
     static gboolean OnSetProperty(GDBusConnection *connection, const gchar *sender,
                                   const gchar *object_path,const gchar *interface_name,
@@ -76,14 +96,13 @@ private:
 
     void SyncProperties();
 
-    std::string GenerateDevicePath(const NetworkDevice::Ptr &device) const;
-
 private:
     ScopedGObject<AethercastInterfaceManager> manager_obj_;
     SharedGObject<GDBusConnection> bus_connection_;
     guint bus_id_;
     ScopedGObject<GDBusObjectManagerServer> object_manager_;
     std::unordered_map<std::string,NetworkDeviceSkeleton::Ptr> devices_;
+    InputProviderProxy::Ptr input_provider_;
 };
 } // namespace dbus
 } // namespace ac
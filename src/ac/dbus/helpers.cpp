@@ -40,6 +40,71 @@ gchar** Helpers::GenerateCapabilities(const std::vector<NetworkManager::Capabili
     return out_capabilities;
 }
 
+GVariant* Helpers::GenerateSessionQuality(const video::QualityHistory::Session &session) {
+    const auto &quality = session.quality;
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "Address", g_variant_new_string(session.remote_address.c_str()));
+    g_variant_builder_add(&builder, "{sv}", "Width", g_variant_new_uint32(session.width));
+    g_variant_builder_add(&builder, "{sv}", "Height", g_variant_new_uint32(session.height));
+    g_variant_builder_add(&builder, "{sv}", "Framerate", g_variant_new_uint32(session.framerate));
+    g_variant_builder_add(&builder, "{sv}", "Score", g_variant_new_double(quality.score));
+    g_variant_builder_add(&builder, "{sv}", "Duration", g_variant_new_int64(quality.duration));
+    g_variant_builder_add(&builder, "{sv}", "DeliveredFramerate", g_variant_new_double(quality.framerate));
+    g_variant_builder_add(&builder, "{sv}", "LatencyP50", g_variant_new_int64(quality.latency_p50));
+    g_variant_builder_add(&builder, "{sv}", "LatencyP95", g_variant_new_int64(quality.latency_p95));
+    g_variant_builder_add(&builder, "{sv}", "LatencyP99", g_variant_new_int64(quality.latency_p99));
+    g_variant_builder_add(&builder, "{sv}", "Freezes", g_variant_new_uint64(quality.freezes));
+    g_variant_builder_add(&builder, "{sv}", "FrozenTime", g_variant_new_int64(quality.frozen_time));
+    g_variant_builder_add(&builder, "{sv}", "Recoveries", g_variant_new_uint64(quality.recoveries));
+    g_variant_builder_add(&builder, "{sv}", "IDRFrames", g_variant_new_uint64(session.idr_frames));
+    g_variant_builder_add(&builder, "{sv}", "Bitrate", g_variant_new_uint64(quality.bitrate));
+    g_variant_builder_add(&builder, "{sv}", "BitrateVariation", g_variant_new_double(quality.bitrate_variation));
+    if (quality.loss_rate >= 0)
+        g_variant_builder_add(&builder, "{sv}", "LossRate", g_variant_new_double(quality.loss_rate));
+    return g_variant_builder_end(&builder);
+}
+
+GVariant* Helpers::GenerateThermalState(const video::ThermalGovernor::Status &status) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "Level",
+                          g_variant_new_string(video::ThermalGovernor::LevelToString(status.level).c_str()));
+    if (status.zone.length() > 0) {
+        g_variant_builder_add(&builder, "{sv}", "Zone", g_variant_new_string(status.zone.c_str()));
+        g_variant_builder_add(&builder, "{sv}", "Temperature", g_variant_new_int32(status.temperature));
+        g_variant_builder_add(&builder, "{sv}", "Headroom", g_variant_new_int32(status.headroom));
+    }
+    return g_variant_builder_end(&builder);
+}
+
+static GVariant* GenerateHistogram(const MainLoopMonitor::Histogram &histogram) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(xt)"));
+    for (const auto &bucket : histogram.Buckets())
+        g_variant_builder_add(&builder, "(xt)", bucket.upper_bound, bucket.count);
+    return g_variant_builder_end(&builder);
+}
+
+GVariant* Helpers::GenerateMainLoopStatistics(const MainLoopMonitor::Statistics &statistics) {
+    GVariantBuilder sources;
+    g_variant_builder_init(&sources, G_VARIANT_TYPE("a(stxx)"));
+    for (const auto &source : statistics.slow_sources)
+        g_variant_builder_add(&sources, "(stxx)", source.first.c_str(), source.second.count,
+                              source.second.total, source.second.longest);
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "Iterations", g_variant_new_uint64(statistics.dispatch.Count()));
+    g_variant_builder_add(&builder, "{sv}", "SlowDispatches", g_variant_new_uint64(statistics.slow_dispatches));
+    g_variant_builder_add(&builder, "{sv}", "LongestDispatch", g_variant_new_int64(statistics.longest_dispatch));
+    g_variant_builder_add(&builder, "{sv}", "DispatchHistogram", GenerateHistogram(statistics.dispatch));
+    g_variant_builder_add(&builder, "{sv}", "ProbeDelayHistogram", GenerateHistogram(statistics.probe_delay));
+    g_variant_builder_add(&builder, "{sv}", "SlowSources", g_variant_builder_end(&sources));
+    return g_variant_builder_end(&builder);
+}
+
 void Helpers::ParseDictionary(GVariant *properties, std::function<void(std::string, GVariant*)> callback, const std::string &key_filter) {
     if (!callback || !properties)
         return;
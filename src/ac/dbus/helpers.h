@@ -21,15 +21,22 @@
 #include <functional>
 
 #include "ac/glib_wrapper.h"
+#include "ac/mainloopmonitor.h"
 
 #include "ac/networkmanager.h"
 #include "ac/scoped_gobject.h"
 
+#include "ac/video/qualityhistory.h"
+#include "ac/video/thermalgovernor.h"
+
 namespace ac {
 namespace dbus {
 struct Helpers {
     static gchar** GenerateCapabilities(const std::vector<NetworkManager::Capability> &capabilities);
     static gchar** GenerateDeviceCapabilities(const std::vector<NetworkDeviceRole> &roles);
+    static GVariant* GenerateSessionQuality(const video::QualityHistory::Session &session);
+    static GVariant* GenerateThermalState(const video::ThermalGovernor::Status &status);
+    static GVariant* GenerateMainLoopStatistics(const MainLoopMonitor::Statistics &statistics);
     static void ParseDictionary(GVariant *properties, std::function<void(std::string, GVariant*)> callback, const std::string &key_filter = "");
     static void ParseArray(GVariant *array, std::function<void(GVariant*)> callback);
 };
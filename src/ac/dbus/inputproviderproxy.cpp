@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gio/gunixfdlist.h>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/keep_alive.h"
+#include "ac/logger.h"
+
+#include "ac/dbus/controllerskeleton.h"
+#include "ac/dbus/inputproviderproxy.h"
+
+namespace ac {
+namespace dbus {
+
+InputProviderProxy::Ptr InputProviderProxy::Create(const SharedGObject<GDBusConnection> &connection,
+                                                   const std::string &bus_name, const std::string &path,
+                                                   const VanishedCallback &vanished) {
+    return std::shared_ptr<InputProviderProxy>(new InputProviderProxy(connection, bus_name, path, vanished))
+            ->FinalizeConstruction();
+}
+
+InputProviderProxy::InputProviderProxy(const SharedGObject<GDBusConnection> &connection,
+                                       const std::string &bus_name, const std::string &path,
+                                       const VanishedCallback &vanished) :
+    connection_(connection),
+    bus_name_(bus_name),
+    path_(path),
+    vanished_(vanished),
+    watch_id_(0) {
+}
+
+std::shared_ptr<InputProviderProxy> InputProviderProxy::FinalizeConstruction() {
+    auto sp = shared_from_this();
+
+    watch_id_ = g_bus_watch_name_on_connection(connection_.get(), bus_name_.c_str(),
+                   G_BUS_NAME_WATCHER_FLAGS_NONE, nullptr, &InputProviderProxy::OnNameVanished,
+                   new WeakKeepAlive<InputProviderProxy>(sp),
+                   [](gpointer data) { delete static_cast<WeakKeepAlive<InputProviderProxy>*>(data); });
+
+    return sp;
+}
+
+InputProviderProxy::~InputProviderProxy() {
+    if (watch_id_ > 0)
+        g_bus_unwatch_name(watch_id_);
+}
+
+std::string InputProviderProxy::BusName() const {
+    return bus_name_;
+}
+
+std::string InputProviderProxy::Path() const {
+    return path_;
+}
+
+void InputProviderProxy::OnNameVanished(GDBusConnection *connection, const gchar *name, gpointer user_data) {
+    boost::ignore_unused_variable_warning(connection);
+
+    auto thiz = static_cast<WeakKeepAlive<InputProviderProxy>*>(user_data)->GetInstance().lock();
+    if (!thiz || !thiz->vanished_)
+        return;
+
+    AC_DEBUG("Input provider %s went away", name);
+
+    thiz->vanished_();
+}
+
+void InputProviderProxy::NewConnection(const NetworkDevice::Ptr &device, int fd, ResultCallback callback) {
+    auto fd_list = g_unix_fd_list_new();
+
+    GError *error = nullptr;
+    const auto index = g_unix_fd_list_append(fd_list, fd, &error);
+    if (index < 0) {
+        AC_ERROR("Failed to hand over input descriptor: %s", error->message);
+        g_error_free(error);
+        g_object_unref(fd_list);
+        if (callback)
+            callback(Error::kFailed);
+        return;
+    }
+
+    const auto device_path = ControllerSkeleton::GenerateDevicePath(device);
+
+    g_dbus_connection_call_with_unix_fd_list(connection_.get(), bus_name_.c_str(), path_.c_str(),
+        kInterface, "NewConnection",
+        g_variant_new("(oha{sv})", device_path.c_str(), index, nullptr),
+        nullptr, G_DBUS_CALL_FLAGS_NONE, -1, fd_list, nullptr,
+        [](GObject *source, GAsyncResult *res, gpointer user_data) {
+            std::unique_ptr<ResultCallback> callback{static_cast<ResultCallback*>(user_data)};
+
+            GError *error = nullptr;
+            auto result = g_dbus_connection_call_with_unix_fd_list_finish(
+                        G_DBUS_CONNECTION(source), nullptr, res, &error);
+            if (!result) {
+                AC_WARNING("Input provider failed to take new connection: %s", error->message);
+                g_error_free(error);
+                if (*callback)
+                    (*callback)(Error::kFailed);
+                return;
+            }
+
+            g_variant_unref(result);
+
+            if (*callback)
+                (*callback)(Error::kNone);
+        }, new ResultCallback{callback});
+
+    // The call holds its own reference to the list
+    g_object_unref(fd_list);
+}
+
+void InputProviderProxy::RequestDisconnection(const NetworkDevice::Ptr &device) {
+    const auto device_path = ControllerSkeleton::GenerateDevicePath(device);
+
+    g_dbus_connection_call(connection_.get(), bus_name_.c_str(), path_.c_str(),
+        kInterface, "RequestDisconnection",
+        g_variant_new("(o)", device_path.c_str()),
+        nullptr, G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, nullptr, nullptr, nullptr);
+}
+
+void InputProviderProxy::Release() {
+    g_dbus_connection_call(connection_.get(), bus_name_.c_str(), path_.c_str(),
+        kInterface, "Release", nullptr,
+        nullptr, G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, nullptr, nullptr, nullptr);
+}
+
+} // namespace dbus
+} // namespace ac
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_DBUS_INPUTPROVIDERPROXY_H_
+#define AC_DBUS_INPUTPROVIDERPROXY_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "ac/glib_wrapper.h"
+
+#include "ac/inputprovider.h"
+#include "ac/shared_gobject.h"
+
+namespace ac {
+namespace dbus {
+
+// Talks to an input provider registered by another process over the bus.
+class InputProviderProxy : public std::enable_shared_from_this<InputProviderProxy>,
+                           public ac::InputProvider {
+public:
+    typedef std::shared_ptr<InputProviderProxy> Ptr;
+    typedef std::function<void()> VanishedCallback;
+
+    static constexpr const char *kInterface{"org.aethercast.InputProvider"};
+
+    // Calls vanished once the provider's bus name goes away without it
+    // having unregistered.
+    static Ptr Create(const SharedGObject<GDBusConnection> &connection,
+                      const std::string &bus_name, const std::string &path,
+                      const VanishedCallback &vanished);
+
+    ~InputProviderProxy();
+
+    std::string BusName() const;
+    std::string Path() const;
+
+    void NewConnection(const NetworkDevice::Ptr &device, int fd, ResultCallback callback) override;
+    void RequestDisconnection(const NetworkDevice::Ptr &device) override;
+    void Release() override;
+
+private:
+    static void OnNameVanished(GDBusConnection *connection, const gchar *name, gpointer user_data);
+
+    InputProviderProxy(const SharedGObject<GDBusConnection> &connection,
+                       const std::string &bus_name, const std::string &path,
+                       const VanishedCallback &vanished);
+    std::shared_ptr<InputProviderProxy> FinalizeConstruction();
+
+private:
+    SharedGObject<GDBusConnection> connection_;
+    std::string bus_name_;
+    std::string path_;
+    VanishedCallback vanished_;
+    guint watch_id_;
+};
+
+} // namespace dbus
+} // namespace ac
+
+#endif
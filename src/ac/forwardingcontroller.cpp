@@ -69,4 +69,12 @@ bool ForwardingController::Enabled() const {
 Error ForwardingController::SetEnabled(bool enabled) {
     return fwd_->SetEnabled(enabled);
 }
+
+Error ForwardingController::RegisterInputProvider(const InputProvider::Ptr &provider) {
+    return fwd_->RegisterInputProvider(provider);
+}
+
+Error ForwardingController::UnregisterInputProvider(const InputProvider::Ptr &provider) {
+    return fwd_->UnregisterInputProvider(provider);
+}
 }
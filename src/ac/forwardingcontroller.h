@@ -43,6 +43,9 @@ public:
 
     virtual Error SetEnabled(bool enabled) override;
 
+    virtual Error RegisterInputProvider(const InputProvider::Ptr &provider) override;
+    virtual Error UnregisterInputProvider(const InputProvider::Ptr &provider) override;
+
 private:
     Controller::Ptr fwd_;
 };
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_INPUTPROVIDER_H_
+#define AC_INPUTPROVIDER_H_
+
+#include <memory>
+
+#include "ac/networkdevice.h"
+#include "ac/non_copyable.h"
+#include "ac/types.h"
+
+namespace ac {
+/**
+ * @brief Component in the system supplying the input events which are
+ * streamed to a connected remote display. See docs/input-provider.txt
+ */
+class InputProvider : private ac::NonCopyable {
+public:
+    typedef std::shared_ptr<InputProvider> Ptr;
+
+    // Hands over fd for the provider to write struct input_event records
+    // to while connected with device. The provider gets its own copy of
+    // fd; the caller closes its one once this returns.
+    virtual void NewConnection(const NetworkDevice::Ptr &device, int fd, ResultCallback callback) = 0;
+    virtual void RequestDisconnection(const NetworkDevice::Ptr &device) = 0;
+    virtual void Release() = 0;
+
+protected:
+    InputProvider() = default;
+};
+} // namespace ac
+#endif
@@ -0,0 +1,495 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <string.h>
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+
+#include <boost/concept_check.hpp>
+#include <boost/format.hpp>
+
+#include "ac/logger.h"
+#include "ac/keep_alive.h"
+
+#include "ac/mainloopmonitor.h"
+
+namespace {
+// Upper bounds of the histogram buckets in microseconds
+static constexpr ac::TimestampUs kBucketBounds[] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000
+};
+static constexpr std::size_t kBucketCount{sizeof(kBucketBounds) / sizeof(kBucketBounds[0]) + 1};
+
+// The first frames of a sample are our signal handler and the
+// trampoline of the C library calling it.
+static constexpr int kSignalFrames{2};
+
+// Not a constant expression with glibc
+int SampleSignal() {
+    return SIGRTMIN + 3;
+}
+
+ac::TimestampUs ToUs(const std::chrono::milliseconds &duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+std::string Symbolize(void *address, const Dl_info &info) {
+    if (info.dli_sname) {
+        int status = 0;
+        auto demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        if (status == 0 && demangled) {
+            std::string name{demangled};
+            std::free(demangled);
+            return name;
+        }
+        return info.dli_sname;
+    }
+
+    // Without exported symbols at least tell where to look with addr2line
+    const auto object = info.dli_fname ? ::basename(info.dli_fname) : "?";
+    return (boost::format("%s+0x%x") % object %
+            (static_cast<char*>(address) - static_cast<char*>(info.dli_fbase))).str();
+}
+}
+
+namespace ac {
+
+constexpr std::chrono::milliseconds MainLoopMonitor::kDefaultThreshold;
+constexpr std::chrono::milliseconds MainLoopMonitor::kProbeInterval;
+constexpr std::chrono::seconds MainLoopMonitor::kPublishInterval;
+constexpr int MainLoopMonitor::Sample::kMaxFrames;
+
+std::atomic<MainLoopMonitor*> MainLoopMonitor::active_{nullptr};
+
+MainLoopMonitor::Histogram::Histogram() :
+    counts_(kBucketCount, 0),
+    total_(0) {
+}
+
+void MainLoopMonitor::Histogram::Add(ac::TimestampUs duration) {
+    const auto bound = std::lower_bound(std::begin(kBucketBounds), std::end(kBucketBounds), duration);
+    counts_[bound - std::begin(kBucketBounds)]++;
+    total_++;
+}
+
+std::uint64_t MainLoopMonitor::Histogram::Count() const {
+    return total_;
+}
+
+ac::TimestampUs MainLoopMonitor::Histogram::Percentile(double percentile) const {
+    if (total_ == 0)
+        return 0;
+
+    const auto wanted = static_cast<std::uint64_t>(std::ceil(total_ * percentile / 100.0));
+
+    std::uint64_t seen = 0;
+    for (std::size_t n = 0; n < kBucketCount - 1; n++) {
+        seen += counts_[n];
+        if (seen >= wanted)
+            return kBucketBounds[n];
+    }
+
+    return -1;
+}
+
+std::vector<MainLoopMonitor::Histogram::Bucket> MainLoopMonitor::Histogram::Buckets() const {
+    std::vector<Bucket> buckets;
+    for (std::size_t n = 0; n < kBucketCount; n++)
+        buckets.push_back(Bucket{n < kBucketCount - 1 ? kBucketBounds[n] : -1, counts_[n]});
+    return buckets;
+}
+
+MainLoopMonitor::Ptr MainLoopMonitor::Instance() {
+    static const auto instance = []() {
+        Config config;
+
+        const auto threshold = ac::Utils::GetEnvValue("AETHERCAST_MAINLOOP_THRESHOLD");
+        if (threshold.length() > 0)
+            config.threshold = std::chrono::milliseconds{std::strtoul(threshold.c_str(), nullptr, 10)};
+
+        config.debug = ac::Utils::GetEnvValue("AETHERCAST_MAINLOOP_DEBUG") == "1";
+
+        return Create(g_main_context_default(), config);
+    }();
+    return instance;
+}
+
+MainLoopMonitor::Ptr MainLoopMonitor::Create(GMainContext *context, const Config &config) {
+    return std::shared_ptr<MainLoopMonitor>(new MainLoopMonitor(context, config));
+}
+
+MainLoopMonitor::MainLoopMonitor(GMainContext *context, const Config &config) :
+    context_(g_main_context_ref(context)),
+    config_(config),
+    poll_func_(nullptr),
+    probe_source_(nullptr),
+    publish_source_(nullptr),
+    running_(false),
+    dispatch_started_(0),
+    dispatching_(0),
+    iteration_(0),
+    sampled_iteration_(0),
+    published_iterations_(0),
+    probe_expected_(0) {
+
+    sample_.iteration = 0;
+    sample_.source = nullptr;
+    sample_.depth = 0;
+}
+
+MainLoopMonitor::~MainLoopMonitor() {
+    Stop();
+    g_main_context_unref(context_);
+}
+
+void MainLoopMonitor::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    delegate_ = delegate;
+}
+
+void MainLoopMonitor::ResetDelegate() {
+    delegate_.reset();
+}
+
+GSource* MainLoopMonitor::AttachTimeout(guint interval, gint priority, GSourceFunc callback, const char *name) {
+    auto source = g_timeout_source_new(interval);
+    g_source_set_priority(source, priority);
+    g_source_set_name(source, name);
+    g_source_set_callback(source, callback,
+                          new WeakKeepAlive<MainLoopMonitor>(shared_from_this()),
+                          [](gpointer data) { delete static_cast<WeakKeepAlive<MainLoopMonitor>*>(data); });
+    g_source_attach(source, context_);
+    return source;
+}
+
+void MainLoopMonitor::DetachSource(GSource **source) {
+    if (!*source)
+        return;
+
+    g_source_destroy(*source);
+    g_source_unref(*source);
+    *source = nullptr;
+}
+
+bool MainLoopMonitor::Start() {
+    if (running_)
+        return false;
+
+    MainLoopMonitor *expected = nullptr;
+    if (!active_.compare_exchange_strong(expected, this)) {
+        AC_WARNING("Another main loop monitor is running already");
+        return false;
+    }
+
+    static std::once_flag handler_installed;
+    std::call_once(handler_installed, []() {
+        struct sigaction action;
+        ::memset(&action, 0, sizeof(action));
+        action.sa_handler = &MainLoopMonitor::OnSampleSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (::sigaction(SampleSignal(), &action, nullptr) < 0)
+            AC_WARNING("Failed to install sample signal handler: %s", ::strerror(errno));
+
+        // The first call might load libgcc which isn't safe to do
+        // from within the signal handler.
+        void *frame = nullptr;
+        ::backtrace(&frame, 1);
+    });
+
+    main_thread_ = ::pthread_self();
+
+    poll_func_ = g_main_context_get_poll_func(context_);
+    g_main_context_set_poll_func(context_, &MainLoopMonitor::OnPoll);
+
+    probe_expected_ = ac::Utils::GetNowUs() + ToUs(kProbeInterval);
+    probe_source_ = AttachTimeout(kProbeInterval.count(), G_PRIORITY_HIGH,
+                                  &MainLoopMonitor::OnProbe, "aethercast-mainloop-probe");
+    publish_source_ = AttachTimeout(std::chrono::duration_cast<std::chrono::milliseconds>(kPublishInterval).count(),
+                                    G_PRIORITY_DEFAULT, &MainLoopMonitor::OnPublish,
+                                    "aethercast-mainloop-publish");
+
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        running_ = true;
+    }
+
+    watcher_ = std::thread(&MainLoopMonitor::WatchIterations, this);
+
+    return true;
+}
+
+void MainLoopMonitor::Stop() {
+    if (!running_)
+        return;
+
+    g_main_context_set_poll_func(context_, poll_func_);
+
+    {
+        std::lock_guard<std::mutex> l(lock_);
+        running_ = false;
+    }
+    iteration_changed_.notify_all();
+    watcher_.join();
+
+    DetachSource(&probe_source_);
+    DetachSource(&publish_source_);
+
+    dispatching_ = 0;
+    if (sample_.source) {
+        g_source_unref(sample_.source);
+        sample_.source = nullptr;
+    }
+
+    active_ = nullptr;
+}
+
+bool MainLoopMonitor::Running() const {
+    return running_;
+}
+
+MainLoopMonitor::Statistics MainLoopMonitor::CurrentStatistics() const {
+    std::lock_guard<std::mutex> l(statistics_lock_);
+    return statistics_;
+}
+
+gint MainLoopMonitor::OnPoll(GPollFD *fds, guint nfds, gint timeout) {
+    auto thiz = active_.load();
+    if (!thiz)
+        return g_poll(fds, nfds, timeout);
+
+    thiz->FinishIteration(ac::Utils::GetNowUs());
+
+    const auto result = thiz->poll_func_(fds, nfds, timeout);
+
+    {
+        std::lock_guard<std::mutex> l(thiz->lock_);
+        thiz->dispatch_started_ = ac::Utils::GetNowUs();
+        thiz->dispatching_ = ++thiz->iteration_;
+    }
+    thiz->iteration_changed_.notify_one();
+
+    return result;
+}
+
+void MainLoopMonitor::FinishIteration(ac::TimestampUs now) {
+    // From here on the signal handler leaves the sample alone
+    const auto iteration = dispatching_.exchange(0);
+    if (iteration == 0)
+        return;
+
+    const auto duration = now - dispatch_started_;
+    const auto slow = duration >= ToUs(config_.threshold);
+
+    std::string source;
+    if (slow) {
+        source = "unknown";
+        if (sample_.iteration == iteration) {
+            source = Attribute(sample_);
+            if (config_.debug)
+                LogStack(sample_);
+        }
+
+        AC_WARNING("Main loop was blocked for %d ms by %s", duration / 1000, source);
+    }
+
+    if (sample_.source) {
+        g_source_unref(sample_.source);
+        sample_.source = nullptr;
+    }
+
+    std::lock_guard<std::mutex> l(statistics_lock_);
+    statistics_.dispatch.Add(duration);
+
+    if (!slow)
+        return;
+
+    statistics_.slow_dispatches++;
+    statistics_.longest_dispatch = std::max(statistics_.longest_dispatch, duration);
+
+    auto &source_statistics = statistics_.slow_sources[source];
+    source_statistics.count++;
+    source_statistics.total += duration;
+    source_statistics.longest = std::max(source_statistics.longest, duration);
+}
+
+std::string MainLoopMonitor::Attribute(const Sample &sample) const {
+    // Recent GLib versions name their own sources after their type
+    // which doesn't tell much, so the callback is always added.
+    std::string name;
+    if (sample.source && g_source_get_name(sample.source))
+        name = g_source_get_name(sample.source);
+
+    const auto callback = FindCallback(sample);
+    if (name.empty())
+        return callback.empty() ? "unknown" : callback;
+
+    return callback.empty() ? name : (boost::format("%s (%s)") % name % callback).str();
+}
+
+std::string MainLoopMonitor::FindCallback(const Sample &sample) const {
+    Dl_info self;
+    if (!::dladdr(reinterpret_cast<void*>(&MainLoopMonitor::OnPoll), &self))
+        return "";
+
+    // The dispatched callback is the first frame of ours below the
+    // innermost dispatch of GLib. If that can't be found we take the
+    // outermost of the innermost frames of ours instead.
+    int dispatch = sample.depth;
+    for (int n = kSignalFrames; n < sample.depth; n++) {
+        Dl_info info;
+        if (::dladdr(sample.frames[n], &info) && info.dli_sname &&
+                ::strcmp(info.dli_sname, "g_main_context_dispatch") == 0) {
+            dispatch = n;
+            break;
+        }
+    }
+
+    if (dispatch < sample.depth) {
+        for (int n = dispatch - 1; n >= kSignalFrames; n--) {
+            Dl_info info;
+            if (::dladdr(sample.frames[n], &info) && info.dli_fbase == self.dli_fbase)
+                return Symbolize(sample.frames[n], info);
+        }
+    }
+
+    int candidate = -1;
+    for (int n = kSignalFrames; n < sample.depth; n++) {
+        Dl_info info;
+        const auto ours = ::dladdr(sample.frames[n], &info) && info.dli_fbase == self.dli_fbase;
+        if (ours)
+            candidate = n;
+        else if (candidate >= 0)
+            break;
+    }
+
+    Dl_info info;
+    if (candidate < 0 || !::dladdr(sample.frames[candidate], &info))
+        return "";
+
+    return Symbolize(sample.frames[candidate], info);
+}
+
+void MainLoopMonitor::LogStack(const Sample &sample) const {
+    const auto depth = sample.depth - kSignalFrames;
+    if (depth <= 0)
+        return;
+
+    auto symbols = ::backtrace_symbols(sample.frames + kSignalFrames, depth);
+    if (!symbols)
+        return;
+
+    for (int n = 0; n < depth; n++)
+        AC_INFO("  #%d %s", n, symbols[n]);
+
+    std::free(symbols);
+}
+
+void MainLoopMonitor::WatchIterations() {
+    ac::Utils::SetThreadName("MainLoopWatcher");
+
+    const auto threshold = ToUs(config_.threshold);
+
+    std::unique_lock<std::mutex> l(lock_);
+    while (running_) {
+        const std::uint64_t iteration = dispatching_;
+        if (iteration == 0 || iteration == sampled_iteration_) {
+            iteration_changed_.wait(l, [&]() {
+                return !running_ || (dispatching_ != 0 && dispatching_ != sampled_iteration_);
+            });
+            continue;
+        }
+
+        const ac::TimestampUs now = ac::Utils::GetNowUs();
+        const auto deadline = dispatch_started_ + threshold;
+        if (now < deadline) {
+            iteration_changed_.wait_for(l, std::chrono::microseconds{deadline - now}, [&]() {
+                return !running_ || dispatching_ != iteration;
+            });
+            continue;
+        }
+
+        // Still in the same dispatch after the threshold; have a look
+        // at what the main thread is doing.
+        sampled_iteration_ = iteration;
+        ::pthread_kill(main_thread_, SampleSignal());
+    }
+}
+
+void MainLoopMonitor::OnSampleSignal(int signal) {
+    boost::ignore_unused_variable_warning(signal);
+
+    const auto saved_errno = errno;
+
+    auto thiz = active_.load();
+    const std::uint64_t iteration = thiz ? thiz->dispatching_.load() : 0;
+    if (iteration != 0 && thiz->sample_.iteration != iteration && !thiz->sample_.source) {
+        auto &sample = thiz->sample_;
+        sample.source = g_main_current_source();
+        if (sample.source)
+            g_source_ref(sample.source);
+        sample.depth = ::backtrace(sample.frames, Sample::kMaxFrames);
+        sample.iteration = iteration;
+    }
+
+    errno = saved_errno;
+}
+
+gboolean MainLoopMonitor::OnProbe(gpointer user_data) {
+    auto thiz = static_cast<WeakKeepAlive<MainLoopMonitor>*>(user_data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    const ac::TimestampUs now = ac::Utils::GetNowUs();
+    const auto delay = std::max<ac::TimestampUs>(0, now - thiz->probe_expected_);
+    thiz->probe_expected_ = now + ToUs(kProbeInterval);
+
+    std::lock_guard<std::mutex> l(thiz->statistics_lock_);
+    thiz->statistics_.probe_delay.Add(delay);
+
+    return TRUE;
+}
+
+gboolean MainLoopMonitor::OnPublish(gpointer user_data) {
+    auto thiz = static_cast<WeakKeepAlive<MainLoopMonitor>*>(user_data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    const auto statistics = thiz->CurrentStatistics();
+    if (statistics.dispatch.Count() == thiz->published_iterations_)
+        return TRUE;
+
+    thiz->published_iterations_ = statistics.dispatch.Count();
+
+    AC_DEBUG("Main loop: %d iterations, dispatch p99 %d us, probe delay p99 %d us, %d slow dispatches",
+             statistics.dispatch.Count(), statistics.dispatch.Percentile(99),
+             statistics.probe_delay.Percentile(99), statistics.slow_dispatches);
+
+    if (auto sp = thiz->delegate_.lock())
+        sp->OnMainLoopStatisticsChanged(statistics);
+
+    return TRUE;
+}
+
+} // namespace ac
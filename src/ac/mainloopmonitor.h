@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_MAINLOOPMONITOR_H_
+#define AC_MAINLOOPMONITOR_H_
+
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ac/glib_wrapper.h"
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+
+/**
+ * @brief Measures how responsive a GLib main context is.
+ *
+ * RTSP, D-Bus and the supplicant all share the default main context
+ * and a single synchronous call in one of their callbacks delays all
+ * others. The monitor times every iteration of the context from the
+ * poll function on and attaches a high priority probe source whose
+ * dispatch delay shows how long a ready event had to wait.
+ *
+ * Dispatches taking longer than the threshold are attributed to the
+ * source being dispatched, by its name or otherwise by the outermost
+ * callback of ours on the stack. For that a watcher thread interrupts
+ * the main thread with a signal once the threshold is hit and takes a
+ * sample of its stack. In debug mode that stack is logged as well.
+ *
+ * Only a single monitor can run at a time.
+ */
+class MainLoopMonitor : public ac::NonCopyable,
+                        public std::enable_shared_from_this<MainLoopMonitor> {
+public:
+    typedef std::shared_ptr<MainLoopMonitor> Ptr;
+
+    static constexpr std::chrono::milliseconds kDefaultThreshold{50};
+    static constexpr std::chrono::milliseconds kProbeInterval{1000};
+    static constexpr std::chrono::seconds kPublishInterval{10};
+
+    class Config {
+    public:
+        Config() :
+            threshold(kDefaultThreshold),
+            debug(false) {
+        }
+
+        // Dispatches taking longer are attributed and logged
+        std::chrono::milliseconds threshold;
+        // Logs the stack of the main thread for every slow dispatch
+        bool debug;
+    };
+
+    // Counts durations in buckets with fixed upper bounds from 1 ms to
+    // 2 s. Everything above goes into a last bucket without bound.
+    class Histogram {
+    public:
+        struct Bucket {
+            // Inclusive upper bound in microseconds, -1 for the last one
+            ac::TimestampUs upper_bound;
+            std::uint64_t count;
+        };
+
+        Histogram();
+
+        void Add(ac::TimestampUs duration);
+
+        std::uint64_t Count() const;
+        // Upper bound of the bucket the given percentile falls into
+        ac::TimestampUs Percentile(double percentile) const;
+        std::vector<Bucket> Buckets() const;
+
+    private:
+        std::vector<std::uint64_t> counts_;
+        std::uint64_t total_;
+    };
+
+    class SourceStatistics {
+    public:
+        SourceStatistics() :
+            count(0),
+            total(0),
+            longest(0) {
+        }
+
+        std::uint64_t count;
+        ac::TimestampUs total;
+        ac::TimestampUs longest;
+    };
+
+    class Statistics {
+    public:
+        Statistics() :
+            slow_dispatches(0),
+            longest_dispatch(0) {
+        }
+
+        // Time spent dispatching per main loop iteration
+        Histogram dispatch;
+        // Delay of the probe source behind its schedule
+        Histogram probe_delay;
+        std::uint64_t slow_dispatches;
+        ac::TimestampUs longest_dispatch;
+        // Slow dispatches by the source or callback they were
+        // attributed to
+        std::map<std::string, SourceStatistics> slow_sources;
+    };
+
+    class Delegate : private ac::NonCopyable {
+    public:
+        virtual void OnMainLoopStatisticsChanged(const Statistics &statistics) = 0;
+
+    protected:
+        Delegate() = default;
+    };
+
+    // Monitor for the default main context. The threshold is taken
+    // from AETHERCAST_MAINLOOP_THRESHOLD (in milliseconds) and debug
+    // mode is turned on by setting AETHERCAST_MAINLOOP_DEBUG to 1.
+    static Ptr Instance();
+
+    static Ptr Create(GMainContext *context, const Config &config = Config{});
+
+    ~MainLoopMonitor();
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+    void ResetDelegate();
+
+    // Has to be called from the thread iterating the context
+    bool Start();
+    void Stop();
+
+    bool Running() const;
+
+    Statistics CurrentStatistics() const;
+
+private:
+    // Stack of the main thread taken from within the signal handler
+    struct Sample {
+        static constexpr int kMaxFrames{32};
+
+        std::atomic<std::uint64_t> iteration;
+        GSource *source;
+        void *frames[kMaxFrames];
+        int depth;
+    };
+
+    static gint OnPoll(GPollFD *fds, guint nfds, gint timeout);
+    static gboolean OnProbe(gpointer user_data);
+    static gboolean OnPublish(gpointer user_data);
+    static void OnSampleSignal(int signal);
+
+    MainLoopMonitor(GMainContext *context, const Config &config);
+
+    GSource* AttachTimeout(guint interval, gint priority, GSourceFunc callback, const char *name);
+    void DetachSource(GSource **source);
+
+    void FinishIteration(ac::TimestampUs now);
+    std::string Attribute(const Sample &sample) const;
+    std::string FindCallback(const Sample &sample) const;
+    void LogStack(const Sample &sample) const;
+    void WatchIterations();
+
+private:
+    static std::atomic<MainLoopMonitor*> active_;
+
+    GMainContext *context_;
+    Config config_;
+    GPollFunc poll_func_;
+    GSource *probe_source_;
+    GSource *publish_source_;
+    pthread_t main_thread_;
+    std::weak_ptr<Delegate> delegate_;
+
+    // Guards the iteration state shared with the watcher
+    std::mutex lock_;
+    std::condition_variable iteration_changed_;
+    std::atomic<bool> running_;
+    ac::TimestampUs dispatch_started_;
+    // Iteration currently dispatching, zero while polling
+    std::atomic<std::uint64_t> dispatching_;
+    std::uint64_t iteration_;
+    std::uint64_t sampled_iteration_;
+    std::thread watcher_;
+
+    Sample sample_;
+
+    mutable std::mutex statistics_lock_;
+    Statistics statistics_;
+    std::uint64_t published_iterations_;
+    ac::TimestampUs probe_expected_;
+};
+
+} // namespace ac
+
+#endif
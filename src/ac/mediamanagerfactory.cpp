@@ -17,11 +17,15 @@
 
 #include <string.h>
 
+#include <boost/filesystem.hpp>
+
 #include "ac/logger.h"
 #include "ac/mediamanagerfactory.h"
 #include "ac/utils.h"
 #include "ac/logger.h"
+#include "ac/config.h"
 
+#include "ac/mir/resourcemanager.h"
 #include "ac/mir/sourcemediamanager.h"
 
 #include "ac/common/threadedexecutorfactory.h"
@@ -32,6 +36,36 @@
 
 #include "ac/android/h264encoder.h"
 
+namespace {
+ac::video::EncoderRegistry::Ptr Encoders() {
+    static const auto registry = []() {
+        const auto cache_path = boost::filesystem::path(ac::kStateDir) / "encoders";
+        auto registry = ac::video::EncoderRegistry::Create(cache_path.string());
+        ac::android::H264Encoder::Register(registry);
+        return registry;
+    }();
+    return registry;
+}
+
+ac::mir::ResourceManager::Ptr Resources() {
+    static const auto resources = ac::mir::ResourceManager::Create(
+                Encoders(), ac::report::ReportFactory::Create());
+    return resources;
+}
+
+ac::SystemController::Ptr& SystemControllerForSources() {
+    static ac::SystemController::Ptr system_controller;
+    return system_controller;
+}
+
+std::string SourceType() {
+    std::string type = ac::Utils::GetEnvValue("MIRACAST_SOURCE_TYPE");
+    if (type.length() == 0)
+        type = "mir";
+    return type;
+}
+}
+
 namespace ac {
 
 void NullSourceMediaManager::Play() {
@@ -58,27 +92,44 @@ bool NullSourceMediaManager::Configure() {
 
 std::shared_ptr<BaseSourceMediaManager> MediaManagerFactory::CreateSource(const std::string &remote_address,
                                                                           const ac::network::Stream::Ptr &output_stream) {
-    std::string type = Utils::GetEnvValue("MIRACAST_SOURCE_TYPE");
-    if (type.length() == 0)
-        type = "mir";
+    const auto type = SourceType();
 
     AC_DEBUG("Creating source media manager of type %s", type.c_str());
 
     if (type == "mir") {
-        const auto executor_factory = std::make_shared<common::ThreadedExecutorFactory>();
         const auto report_factory = report::ReportFactory::Create();
-        const auto screencast = std::make_shared<ac::mir::Screencast>();
-        const auto encoder = ac::android::H264Encoder::Create(report_factory->CreateEncoderReport());
+        const auto executor_factory = std::make_shared<common::ThreadedExecutorFactory>(
+                    report_factory->CreatePerfCounterReport());
+        const auto system_controller = SystemControllerForSources();
 
+        // The screencast and the encoder are set up off the main loop
+        // once the format is negotiated.
         return std::make_shared<ac::mir::SourceMediaManager>(
                     remote_address,
                     executor_factory,
-                    screencast,
-                    encoder,
+                    nullptr,
+                    nullptr,
                     output_stream,
-                    report_factory);
+                    report_factory,
+                    Encoders(),
+                    Resources(),
+                    system_controller ? system_controller->CpuLatencyLock() : nullptr);
     }
 
     return std::make_shared<NullSourceMediaManager>();
 }
+
+void MediaManagerFactory::PrewarmSource() {
+    if (SourceType() == "mir")
+        Resources()->Prewarm();
+}
+
+void MediaManagerFactory::ReleaseSourceResources() {
+    if (SourceType() == "mir")
+        Resources()->Release();
+}
+
+void MediaManagerFactory::SetSystemController(const SystemController::Ptr &system_controller) {
+    SystemControllerForSources() = system_controller;
+}
 } // namespace ac
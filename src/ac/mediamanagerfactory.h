@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "ac/basesourcemediamanager.h"
+#include "ac/systemcontroller.h"
 
 #include "ac/network/types.h"
 #include "ac/network/stream.h"
@@ -43,6 +44,15 @@ class MediaManagerFactory {
 public:
     static std::shared_ptr<BaseSourceMediaManager> CreateSource(const std::string &remote_address,
                                                                 const ac::network::Stream::Ptr &output_stream);
+
+    // Starts setting up the resources a source needs in the background
+    // so they are ready once a session needs them.
+    static void PrewarmSource();
+    // Releases the resources kept around for future sessions.
+    static void ReleaseSourceResources();
+    // Sources created afterwards request low CPU wakeup latency from
+    // the given controller while they are playing.
+    static void SetSystemController(const SystemController::Ptr &system_controller);
 };
 } // namespace ac
 #endif
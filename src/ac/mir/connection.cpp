@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/mir/connection.h"
+
+namespace {
+static constexpr const char *kMirSocket{"/run/mir_socket"};
+static constexpr const char *kMirConnectionName{"aethercast screencast client"};
+}
+
+namespace ac {
+namespace mir {
+
+Connection::Ptr Connection::Create() {
+    auto handle = mir_connect_sync(kMirSocket, kMirConnectionName);
+    if (!mir_connection_is_valid(handle)) {
+        AC_ERROR("Failed to connect to Mir server: %s",
+                  mir_connection_get_error_message(handle));
+        if (handle)
+            mir_connection_release(handle);
+        return nullptr;
+    }
+
+    return std::shared_ptr<Connection>(new Connection(handle));
+}
+
+Connection::Connection(MirConnection *handle) :
+    handle_(handle) {
+}
+
+Connection::~Connection() {
+    mir_connection_release(handle_);
+}
+
+bool Connection::IsValid() const {
+    return mir_connection_is_valid(handle_);
+}
+
+MirConnection* Connection::Handle() const {
+    return handle_;
+}
+
+} // namespace mir
+} // namespace ac
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_MIR_CONNECTION_H_
+#define AC_MIR_CONNECTION_H_
+
+#include <memory>
+
+#include <mir_toolkit/mir_client_library.h>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace mir {
+
+/**
+ * @brief Connection to the Mir server which can be shared by several
+ * screencasts one after the other.
+ */
+class Connection : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<Connection> Ptr;
+
+    // Returns nullptr if the connection to the server failed.
+    static Ptr Create();
+
+    ~Connection();
+
+    // Whether the server is still there.
+    bool IsValid() const;
+
+    MirConnection* Handle() const;
+
+private:
+    Connection(MirConnection *handle);
+
+private:
+    MirConnection *handle_;
+};
+
+} // namespace mir
+} // namespace ac
+
+#endif
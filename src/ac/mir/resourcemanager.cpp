@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/keep_alive.h"
+#include "ac/logger.h"
+
+#include "ac/mir/resourcemanager.h"
+
+namespace {
+static constexpr std::chrono::seconds kCheckInterval{5};
+
+bool Matches(const ac::video::BaseEncoder::Config &config, const ac::video::BaseEncoder::Config &wanted) {
+    return config.width == wanted.width &&
+            config.height == wanted.height &&
+            config.framerate == wanted.framerate &&
+            config.profile_idc == wanted.profile_idc &&
+            config.level_idc == wanted.level_idc &&
+            config.constraint_set == wanted.constraint_set;
+}
+
+bool IsRunning(const std::shared_future<void> &warmup) {
+    return warmup.valid() && warmup.wait_for(std::chrono::seconds{0}) != std::future_status::ready;
+}
+}
+
+namespace ac {
+namespace mir {
+
+constexpr std::chrono::seconds ResourceManager::kDefaultIdleTimeout;
+
+ResourceManager::Ptr ResourceManager::Create(const ac::video::EncoderRegistry::Ptr &encoders,
+                                             const ac::report::ReportFactory::Ptr &report_factory,
+                                             const std::chrono::seconds &idle_timeout,
+                                             const ac::video::MemoryBudget::Ptr &budget) {
+    return std::shared_ptr<ResourceManager>(new ResourceManager(encoders, report_factory, idle_timeout, budget));
+}
+
+ResourceManager::ResourceManager(const ac::video::EncoderRegistry::Ptr &encoders,
+                                 const ac::report::ReportFactory::Ptr &report_factory,
+                                 const std::chrono::seconds &idle_timeout,
+                                 const ac::video::MemoryBudget::Ptr &budget) :
+    encoders_(encoders),
+    report_factory_(report_factory),
+    idle_timeout_(idle_timeout),
+    budget_(budget),
+    have_last_wanted_(false),
+    last_used_(0),
+    check_timeout_(0) {
+}
+
+ResourceManager::~ResourceManager() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    StopCheckTimer();
+    lock.unlock();
+
+    WaitForWarmup();
+}
+
+void ResourceManager::Prewarm() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (IsRunning(connection_warmup_) || IsRunning(encoder_warmup_))
+        return;
+    lock.unlock();
+
+    if (budget_->CurrentPressure() != ac::video::MemoryBudget::Pressure::kNone) {
+        AC_DEBUG("Not pre-warming resources while under memory pressure");
+        return;
+    }
+
+    lock.lock();
+    last_used_ = ac::Utils::GetNowUs();
+    const auto have_wanted = have_last_wanted_;
+    const auto wanted = last_wanted_;
+
+    StartCheckTimer();
+
+    if (!connection_) {
+        connection_warmup_ = std::async(std::launch::async, [this]() {
+            auto connection = Connection::Create();
+
+            std::lock_guard<std::mutex> l(mutex_);
+            if (!connection_)
+                connection_ = connection;
+
+            AC_DEBUG("Pre-warmed connection %d", static_cast<bool>(connection_));
+        }).share();
+    }
+
+    if (!encoder_) {
+        encoder_warmup_ = std::async(std::launch::async, [=]() {
+            ac::video::BaseEncoder::Ptr encoder;
+            if (have_wanted) {
+                encoder = CreateEncoder(wanted, report_factory_->CreateEncoderReport());
+            } else {
+                // Without a format to expect the best we can do is to get
+                // the backends probed if that hasn't happened yet.
+                ac::video::EncoderRegistry::Capabilities capabilities;
+                for (const auto &name : encoders_->Backends())
+                    encoders_->CapabilitiesOf(name, &capabilities);
+            }
+
+            std::lock_guard<std::mutex> l(mutex_);
+            if (!encoder_)
+                encoder_ = encoder;
+
+            AC_DEBUG("Pre-warmed encoder %d", static_cast<bool>(encoder_));
+        }).share();
+    }
+}
+
+void ResourceManager::Release() {
+    WaitForWarmup();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    StopCheckTimer();
+    connection_.reset();
+    encoder_.reset();
+}
+
+Connection::Ptr ResourceManager::TakeConnection() {
+    // Called on the main loop; an encoder being warmed up meanwhile
+    // mustn't hold us up.
+    WaitForConnectionWarmup();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_used_ = ac::Utils::GetNowUs();
+
+    // The server might have gone away since we connected
+    if (connection_ && !connection_->IsValid())
+        connection_.reset();
+
+    if (!connection_)
+        connection_ = Connection::Create();
+
+    if (connection_)
+        StartCheckTimer();
+
+    return connection_;
+}
+
+ac::video::BaseEncoder::Ptr ResourceManager::TakeEncoder(const ac::video::BaseEncoder::Config &wanted,
+                                                         const ac::video::EncoderReport::Ptr &report) {
+    WaitForEncoderWarmup();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    last_used_ = ac::Utils::GetNowUs();
+    last_wanted_ = wanted;
+    have_last_wanted_ = true;
+
+    auto encoder = encoder_;
+    encoder_.reset();
+    lock.unlock();
+
+    if (encoder && Matches(encoder->Configuration(), wanted)) {
+        AC_DEBUG("Using pre-warmed encoder");
+        return encoder;
+    }
+
+    return CreateEncoder(wanted, report);
+}
+
+bool ResourceManager::HasWarmConnection() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<bool>(connection_);
+}
+
+bool ResourceManager::HasWarmEncoder() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<bool>(encoder_);
+}
+
+ac::video::BaseEncoder::Ptr ResourceManager::CreateEncoder(const ac::video::BaseEncoder::Config &wanted,
+                                                           const ac::video::EncoderReport::Ptr &report) {
+    auto encoder = encoders_->CreateBest(wanted, report);
+    if (!encoder)
+        return nullptr;
+
+    auto config = encoder->DefaultConfiguration();
+    config.width = wanted.width;
+    config.height = wanted.height;
+    config.framerate = wanted.framerate;
+    config.profile_idc = wanted.profile_idc;
+    config.level_idc = wanted.level_idc;
+    config.constraint_set = wanted.constraint_set;
+
+    if (!encoder->Configure(config)) {
+        AC_ERROR("Failed to configure encoder");
+        return nullptr;
+    }
+
+    return encoder;
+}
+
+void ResourceManager::WaitForConnectionWarmup() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto warmup = connection_warmup_;
+    lock.unlock();
+
+    if (warmup.valid())
+        warmup.get();
+}
+
+void ResourceManager::WaitForEncoderWarmup() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto warmup = encoder_warmup_;
+    lock.unlock();
+
+    if (warmup.valid())
+        warmup.get();
+}
+
+void ResourceManager::WaitForWarmup() {
+    WaitForConnectionWarmup();
+    WaitForEncoderWarmup();
+}
+
+void ResourceManager::StartCheckTimer() {
+    if (check_timeout_ > 0)
+        return;
+
+    check_timeout_ = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT,
+           kCheckInterval.count(),
+           &OnCheckResources,
+           new WeakKeepAlive<ResourceManager>(shared_from_this()),
+           [](gpointer data) { delete static_cast<WeakKeepAlive<ResourceManager>*>(data); });
+}
+
+void ResourceManager::StopCheckTimer() {
+    if (check_timeout_ == 0)
+        return;
+
+    g_source_remove(check_timeout_);
+    check_timeout_ = 0;
+}
+
+gboolean ResourceManager::OnCheckResources(gpointer user_data) {
+    auto thiz = static_cast<WeakKeepAlive<ResourceManager>*>(user_data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    const ac::TimestampUs now = ac::Utils::GetNowUs();
+
+    std::lock_guard<std::mutex> lock(thiz->mutex_);
+
+    // Resources are only handed over once the warmup is done
+    if (IsRunning(thiz->connection_warmup_) || IsRunning(thiz->encoder_warmup_))
+        return TRUE;
+
+    // A connection shared with a session is in use and not idle
+    if (thiz->connection_.use_count() > 1)
+        thiz->last_used_ = now;
+
+    const ac::TimestampUs idle_timeout = std::chrono::duration_cast<std::chrono::microseconds>(
+                thiz->idle_timeout_).count();
+    const auto idle = now - thiz->last_used_ >= idle_timeout;
+    const auto pressure = thiz->budget_->CurrentPressure() != ac::video::MemoryBudget::Pressure::kNone;
+
+    if (!idle && !pressure)
+        return TRUE;
+
+    AC_DEBUG("Releasing warm resources (%s)", pressure ? "memory pressure" : "idle");
+
+    thiz->connection_.reset();
+    thiz->encoder_.reset();
+    thiz->check_timeout_ = 0;
+
+    return FALSE;
+}
+
+} // namespace mir
+} // namespace ac
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_MIR_RESOURCEMANAGER_H_
+#define AC_MIR_RESOURCEMANAGER_H_
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+
+#include "ac/glib_wrapper.h"
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/report/reportfactory.h"
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/encoderregistry.h"
+#include "ac/video/memorybudget.h"
+
+#include "ac/mir/connection.h"
+
+namespace ac {
+namespace mir {
+
+/**
+ * @brief Holds on to the resources of a session which are expensive to
+ * set up so that a session doesn't have to wait for them.
+ *
+ * Resources are created when first asked for or ahead of time through
+ * Prewarm(). The connection to Mir is reused by all sessions. Encoders
+ * can't be reused and are created ahead of time for the format the last
+ * session negotiated. Warm resources nobody asked for within the idle
+ * timeout or while the memory budget is under pressure are released.
+ */
+class ResourceManager : public std::enable_shared_from_this<ResourceManager>,
+                        public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<ResourceManager> Ptr;
+
+    static constexpr std::chrono::seconds kDefaultIdleTimeout{60};
+
+    static Ptr Create(const ac::video::EncoderRegistry::Ptr &encoders,
+                      const ac::report::ReportFactory::Ptr &report_factory,
+                      const std::chrono::seconds &idle_timeout = kDefaultIdleTimeout,
+                      const ac::video::MemoryBudget::Ptr &budget = ac::video::MemoryBudget::Instance());
+
+    ~ResourceManager();
+
+    // Creates whatever isn't warm yet in the background.
+    void Prewarm();
+
+    // Drops all warm resources. Resources in use by a session stay alive
+    // until the session is done with them.
+    void Release();
+
+    // Returns nullptr if there is no connection to Mir.
+    Connection::Ptr TakeConnection();
+
+    // Returns an encoder configured for the wanted format or nullptr if
+    // none of the encoder backends supports it.
+    ac::video::BaseEncoder::Ptr TakeEncoder(const ac::video::BaseEncoder::Config &wanted,
+                                            const ac::video::EncoderReport::Ptr &report);
+
+    bool HasWarmConnection() const;
+    bool HasWarmEncoder() const;
+
+private:
+    ResourceManager(const ac::video::EncoderRegistry::Ptr &encoders,
+                    const ac::report::ReportFactory::Ptr &report_factory,
+                    const std::chrono::seconds &idle_timeout,
+                    const ac::video::MemoryBudget::Ptr &budget);
+
+    static gboolean OnCheckResources(gpointer user_data);
+
+    ac::video::BaseEncoder::Ptr CreateEncoder(const ac::video::BaseEncoder::Config &wanted,
+                                              const ac::video::EncoderReport::Ptr &report);
+    void WaitForConnectionWarmup();
+    void WaitForEncoderWarmup();
+    void WaitForWarmup();
+    // Need to be called with mutex_ held
+    void StartCheckTimer();
+    void StopCheckTimer();
+
+private:
+    ac::video::EncoderRegistry::Ptr encoders_;
+    ac::report::ReportFactory::Ptr report_factory_;
+    std::chrono::seconds idle_timeout_;
+    ac::video::MemoryBudget::Ptr budget_;
+    mutable std::mutex mutex_;
+    Connection::Ptr connection_;
+    ac::video::BaseEncoder::Ptr encoder_;
+    ac::video::BaseEncoder::Config last_wanted_;
+    bool have_last_wanted_;
+    ac::TimestampUs last_used_;
+    guint check_timeout_;
+    // Connection and encoder are warmed up independently so that taking
+    // the connection doesn't have to wait for an encoder being probed.
+    // Waiters take a copy under the lock and wait without holding it.
+    std::shared_future<void> connection_warmup_;
+    std::shared_future<void> encoder_warmup_;
+};
+
+} // namespace mir
+} // namespace ac
+
+#endif
@@ -15,23 +15,22 @@
  *
  */
 
+#include <ratio>
+
 #include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
 #include "ac/mir/screencast.h"
 
-namespace {
-static constexpr const char *kMirSocket{"/run/mir_socket"};
-static constexpr const char *kMirConnectionName{"aethercast screencast client"};
-}
-
 namespace ac {
 namespace mir {
 
-Screencast::Screencast() :
-    connection_(nullptr),
+Screencast::Screencast(const Connection::Ptr &connection) :
+    connection_(connection),
     screencast_(nullptr),
-    buffer_stream_(nullptr) {
+    buffer_stream_(nullptr),
+    timestamp_(0),
+    refresh_interval_(0) {
 }
 
 Screencast::~Screencast() {
@@ -39,13 +38,10 @@ Screencast::~Screencast() {
 
     if (screencast_)
         mir_screencast_release_sync(screencast_);
-
-    if (connection_)
-        mir_connection_release(connection_);
 }
 
 bool Screencast::Setup(const video::DisplayOutput &output) {
-    if (screencast_ || connection_ || buffer_stream_)
+    if (screencast_ || buffer_stream_)
         return false;
 
     if (output.mode != video::DisplayOutput::Mode::kExtend) {
@@ -56,17 +52,18 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
     AC_DEBUG("Setting up screencast [%s %dx%d]", output.mode,
               output.width, output.height);
 
-    connection_ = mir_connect_sync(kMirSocket, kMirConnectionName);
-    if (!mir_connection_is_valid(connection_)) {
-        AC_ERROR("Failed to connect to Mir server: %s",
-                  mir_connection_get_error_message(connection_));
+    if (!connection_)
+        connection_ = Connection::Create();
+
+    if (!connection_)
         return false;
-    }
 
-    const auto config = mir_connection_create_display_config(connection_);
+    const auto connection = connection_->Handle();
+
+    const auto config = mir_connection_create_display_config(connection);
     if (!config) {
         AC_ERROR("Failed to create display configuration: %s",
-                  mir_connection_get_error_message(connection_));
+                  mir_connection_get_error_message(connection));
         return false;
     }
 
@@ -91,7 +88,7 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
 
     const MirDisplayMode *display_mode = &active_output->modes[active_output->current_mode];
 
-    auto spec = mir_create_screencast_spec(connection_);
+    auto spec = mir_create_screencast_spec(connection);
     if (!spec) {
         AC_ERROR("Failed to create Mir screencast specification: %s",
               mir_screencast_get_error_message(screencast_));
@@ -112,7 +109,8 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
 
     mir_screencast_spec_set_capture_region(spec, &region);
 
-    output_.refresh_rate = display_mode->refresh_rate;
+    if (display_mode->refresh_rate > 0)
+        refresh_interval_ = static_cast<ac::TimestampUs>(std::micro::den / display_mode->refresh_rate);
 
     AC_INFO("Selected output ID %i [(%ix%i)+(%ix%i)] orientation %d",
              output_index,
@@ -123,11 +121,11 @@ bool Screencast::Setup(const video::DisplayOutput &output) {
 
     unsigned int num_pixel_formats = 0;
     MirPixelFormat pixel_format;
-    mir_connection_get_available_surface_formats(connection_, &pixel_format,
+    mir_connection_get_available_surface_formats(connection, &pixel_format,
                                                  1, &num_pixel_formats);
     if (num_pixel_formats == 0) {
         AC_ERROR("Failed to find suitable pixel format: %s",
-                  mir_connection_get_error_message(connection_));
+                  mir_connection_get_error_message(connection));
         return false;
     }
 
@@ -158,6 +156,11 @@ void Screencast::SwapBuffers() {
     if (!buffer_stream_)
         return;
 
+    // Mir composites into the screencast buffer when we ask for it so
+    // it shows the screen as it was when we did and not when the call
+    // returned, which can be a lot later depending on the compositor.
+    timestamp_ = ac::Utils::GetNowUs();
+
     mir_buffer_stream_swap_buffers_sync(buffer_stream_);
 }
 
@@ -165,6 +168,14 @@ video::DisplayOutput Screencast::OutputMode() const {
     return output_;
 }
 
+ac::TimestampUs Screencast::CurrentTimestamp() const {
+    return timestamp_;
+}
+
+ac::TimestampUs Screencast::RefreshInterval() const {
+    return refresh_interval_;
+}
+
 void* Screencast::CurrentBuffer() const {
     if (!buffer_stream_)
         return nullptr;
@@ -28,12 +28,16 @@
 
 #include "ac/video/bufferproducer.h"
 
+#include "ac/mir/connection.h"
+
 namespace ac {
 namespace mir {
 
 class Screencast : public ac::video::BufferProducer {
 public:
-    explicit Screencast();
+    // Without a connection the screencast connects to Mir itself
+    // when set up.
+    explicit Screencast(const Connection::Ptr &connection = nullptr);
     ~Screencast();
 
     bool Setup(const video::DisplayOutput &output) override;
@@ -42,12 +46,16 @@ public:
     void SwapBuffers() override;
     void* CurrentBuffer() const override;
     video::DisplayOutput OutputMode() const override;
+    ac::TimestampUs CurrentTimestamp() const override;
+    ac::TimestampUs RefreshInterval() const override;
 
 private:
-    MirConnection *connection_;
+    Connection::Ptr connection_;
     MirScreencast *screencast_;
     MirBufferStream *buffer_stream_;
     video::DisplayOutput output_;
+    ac::TimestampUs timestamp_;
+    ac::TimestampUs refresh_interval_;
 };
 
 } // namespace mir
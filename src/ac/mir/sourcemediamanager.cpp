@@ -15,18 +15,27 @@
  *
  */
 
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
 #include "ac/logger.h"
 #include "ac/keep_alive.h"
 
+#include "ac/common/lockprofiler.h"
 #include "ac/common/threadedexecutor.h"
 #include "ac/common/threadedexecutorfactory.h"
 
 #include "ac/network/udpstream.h"
 
 #include "ac/report/reportfactory.h"
+#include "ac/report/quality/qualityreportfactory.h"
 
 #include "ac/video/videoformat.h"
 #include "ac/video/displayoutput.h"
+#include "ac/video/errorrecovery.h"
+#include "ac/video/memorybudget.h"
+#include "ac/video/qualityhistory.h"
 
 #include "ac/streaming/mpegtspacketizer.h"
 #include "ac/streaming/rtpsender.h"
@@ -38,6 +47,31 @@
 namespace {
 // Number of milliseconds was choosen by measurement
 static constexpr std::chrono::milliseconds kStreamDelayOnPlay{300};
+
+// How often the pipeline is checked for stalled stages
+static constexpr std::chrono::milliseconds kWatchdogInterval{250};
+
+// Headroom on top of the encoder bitrate for the transport stream
+// overhead when the multiplex rate is selected automatically.
+static constexpr unsigned int kMuxRateOverheadPercent{125};
+
+std::uint32_t MuxRateFor(const ac::video::BaseEncoder::Config &config) {
+    const auto value = ac::Utils::GetEnvValue("AETHERCAST_MPEGTS_MUX_RATE");
+    if (value.length() == 0)
+        return 0;
+
+    if (value == "auto")
+        return static_cast<std::uint64_t>(config.bitrate) * kMuxRateOverheadPercent / 100;
+
+    return std::strtoul(value.c_str(), nullptr, 10);
+}
+
+ac::video::ErrorRecovery::Config ErrorRecoveryConfig() {
+    ac::video::ErrorRecovery::Config config;
+    if (ac::Utils::GetEnvValue("AETHERCAST_ERROR_RECOVERY") == "idr")
+        config.strategy = ac::video::ErrorRecovery::Strategy::kIDR;
+    return config;
+}
 }
 
 namespace ac {
@@ -48,22 +82,56 @@ SourceMediaManager::SourceMediaManager(const std::string &remote_address,
                                        const ac::video::BufferProducer::Ptr &producer,
                                        const ac::video::BaseEncoder::Ptr &encoder,
                                        const ac::network::Stream::Ptr &output_stream,
-                                       const ac::report::ReportFactory::Ptr &report_factory) :
+                                       const ac::report::ReportFactory::Ptr &report_factory,
+                                       const ac::video::EncoderRegistry::Ptr &encoders,
+                                       const ResourceManager::Ptr &resources,
+                                       const ac::SystemController::Lock<ac::CpuLatencyState>::Ptr &latency_lock) :
     state_(State::Stopped),
     remote_address_(remote_address),
     producer_(producer),
     encoder_(encoder),
+    encoders_(encoders),
+    resources_(resources),
     output_stream_(output_stream),
     report_factory_(report_factory),
+    session_started_(0),
     pipeline_(executor_factory, 4),
-    delay_timeout_(0) {
+    latency_lock_(latency_lock),
+    latency_requested_(false),
+    delay_timeout_(0),
+    watchdog_timeout_(0),
+    setup_state_(SetupState::Idle),
+    setup_lock_(std::make_shared<std::mutex>()) {
 }
 
 SourceMediaManager::~SourceMediaManager() {
-    if (state_ != State::Stopped)
-        pipeline_.Stop();
+    CancelSetup();
+
+    if (state_ == State::Stopped)
+        return;
+
+    StopWatchdog();
+    pipeline_.Stop();
+    ReleaseLowLatency();
+    FinishSession();
 }
 
+struct SourceMediaManager::Setup {
+    std::weak_ptr<SourceMediaManager> manager;
+    std::shared_ptr<std::mutex> lock;
+    std::atomic<bool> cancelled;
+    video::DisplayOutput output;
+    ac::video::BufferProducer::Ptr producer;
+    ac::video::EncoderRegistry::Ptr encoders;
+    ResourceManager::Ptr resources;
+    ac::video::EncoderReport::Ptr encoder_report;
+    ac::video::BaseEncoder::Config wanted;
+    // Picked by the worker if the session wasn't given one
+    ac::video::BaseEncoder::Ptr encoder;
+    ac::video::BaseEncoder::Config config;
+    bool success;
+};
+
 bool SourceMediaManager::Configure() {
     auto rr = ac::video::ExtractRateAndResolution(format_);
 
@@ -72,52 +140,201 @@ bool SourceMediaManager::Configure() {
 
     AC_DEBUG("dimensions: %dx%d@%d", rr.width, rr.height, rr.framerate);
 
-    video::DisplayOutput output{video::DisplayOutput::Mode::kExtend, rr.width, rr.height, rr.framerate};
+    int profile = 0, level = 0, constraint = 0;
+    ac::video::ExtractProfileLevel(format_, &profile, &level, &constraint);
+
+    // A renegotiation supersedes whatever setup is still running
+    CancelSetup();
+
+    auto setup = std::make_shared<Setup>();
+    setup->manager = shared_from_this();
+    setup->lock = setup_lock_;
+    setup->cancelled = false;
+    setup->output = video::DisplayOutput{video::DisplayOutput::Mode::kExtend, rr.width, rr.height, rr.framerate};
+    setup->producer = producer_;
+    setup->encoders = encoders_;
+    setup->resources = resources_;
+    setup->encoder = encoder_;
+    setup->wanted.width = rr.width;
+    setup->wanted.height = rr.height;
+    setup->wanted.framerate = rr.framerate;
+    setup->wanted.profile_idc = profile;
+    setup->wanted.level_idc = level;
+    setup->wanted.constraint_set = constraint;
+    setup->success = false;
+
+    if (!encoder_ && (resources_ || encoders_))
+        setup->encoder_report = report_factory_->CreateEncoderReport();
+
+    setup_ = setup;
+    setup_state_ = SetupState::Pending;
+
+    // The worker only holds on to what the setup carries so it doesn't
+    // matter if we're gone before it is done; nobody waits for it.
+    std::thread(&SourceMediaManager::RunSetup, setup).detach();
+
+    return true;
+}
+
+bool SourceMediaManager::SetupProducerAndEncoder(Setup &setup) {
+    if (setup.cancelled)
+        return false;
+
+    // Taking the connection might have to wait for the pre-warmed one
+    // or connect to Mir synchronously so it has to happen here.
+    if (!setup.producer)
+        setup.producer = std::make_shared<Screencast>(
+                    setup.resources ? setup.resources->TakeConnection() : nullptr);
 
-    if (!producer_->Setup(output)) {
+    if (!setup.producer->Setup(setup.output)) {
         AC_ERROR("Failed to setup buffer producer");
         return false;
     }
 
-    int profile = 0, level = 0, constraint = 0;
-    ac::video::ExtractProfileLevel(format_, &profile, &level, &constraint);
+    if (setup.cancelled)
+        return false;
+
+    // Encoders from the resource manager come configured already
+    bool configured = false;
+
+    if (!setup.encoder && setup.resources) {
+        setup.encoder = setup.resources->TakeEncoder(setup.wanted, setup.encoder_report);
+        configured = true;
+    } else if (!setup.encoder && setup.encoders) {
+        setup.encoder = setup.encoders->CreateBest(setup.wanted, setup.encoder_report);
+    }
+
+    if (!setup.encoder) {
+        AC_ERROR("No encoder available");
+        return false;
+    }
 
-    auto config = encoder_->DefaultConfiguration();
-    config.width = rr.width;
-    config.height = rr.height;
-    config.framerate = rr.framerate;
-    config.profile_idc = profile;
-    config.level_idc = level;
-    config.constraint_set = constraint;
+    auto config = setup.encoder->DefaultConfiguration();
+    config.width = setup.wanted.width;
+    config.height = setup.wanted.height;
+    config.framerate = setup.wanted.framerate;
+    config.profile_idc = setup.wanted.profile_idc;
+    config.level_idc = setup.wanted.level_idc;
+    config.constraint_set = setup.wanted.constraint_set;
 
-    if (!encoder_->Configure(config)) {
+    if (!configured && !setup.encoder->Configure(config)) {
         AC_ERROR("Failed to configure encoder");
         return false;
     }
 
+    setup.config = config;
+
+    return true;
+}
+
+void SourceMediaManager::RunSetup(const std::shared_ptr<Setup> &setup) {
+    std::unique_lock<std::mutex> lock(*setup->lock);
+    setup->success = SetupProducerAndEncoder(*setup);
+    lock.unlock();
+
+    g_idle_add_full(G_PRIORITY_DEFAULT,
+           &OnSetupFinished,
+           new SharedKeepAlive<Setup>(setup),
+           [](gpointer data) { delete static_cast<SharedKeepAlive<Setup>*>(data); });
+}
+
+gboolean SourceMediaManager::OnSetupFinished(gpointer user_data) {
+    const auto setup = static_cast<ac::SharedKeepAlive<Setup>*>(user_data)->GetInstance();
+    auto thiz = setup->manager.lock();
+
+    // Torn down or renegotiated while the worker was busy
+    if (!thiz || thiz->setup_ != setup)
+        return FALSE;
+
+    thiz->setup_.reset();
+    thiz->FinishSetup(*setup);
+
+    return FALSE;
+}
+
+void SourceMediaManager::FinishSetup(const Setup &setup) {
+    if (!setup.success) {
+        AC_ERROR("Failed to setup session");
+        setup_state_ = SetupState::Failed;
+        // The sink is waiting for a stream we can't deliver
+        OnTransportNetworkError();
+        return;
+    }
+
+    producer_ = setup.producer;
+    encoder_ = setup.encoder;
+    const auto &config = setup.config;
+
+    // Everything the pipeline reports is also fed into the estimator
+    // for the quality score of this session.
+    quality_ = ac::video::QualityEstimator::Create(config.framerate);
+    session_started_ = ac::Utils::GetNowUs();
+
+    const auto reports = std::make_shared<ac::report::QualityReportFactory>(report_factory_, quality_);
+
+    ac::video::MemoryBudget::Instance()->SetReport(reports->CreateMemoryReport());
+    ac::common::LockProfiler::Instance()->SetReport(reports->CreateLockReport());
+
     renderer_ = std::make_shared<ac::mir::StreamRenderer>(
-                producer_, encoder_, report_factory_->CreateRendererReport());
+                producer_, encoder_, reports->CreateRendererReport());
 
     auto rtp_sender = std::make_shared<ac::streaming::RTPSender>(
-                output_stream_, report_factory_->CreateSenderReport());
+                output_stream_, reports->CreateSenderReport());
     rtp_sender->SetDelegate(shared_from_this());
 
+    ac::streaming::MPEGTSPacketizer::Config packetizer_config;
+    packetizer_config.mux_rate = MuxRateFor(config);
+    if (packetizer_config.mux_rate > 0) {
+        AC_DEBUG("Using constant bitrate multiplexing with %d bit/s", packetizer_config.mux_rate);
+        rtp_sender->SetPacingRate(packetizer_config.mux_rate);
+    }
+
+    const auto packetizer_report = reports->CreatePacketizerReport();
     const auto mpegts_packetizer = ac::streaming::MPEGTSPacketizer::Create(
-                report_factory_->CreatePacketizerReport());
+                packetizer_report, packetizer_config);
 
     sender_ = std::make_shared<ac::streaming::MediaSender>(
                 mpegts_packetizer,
                 rtp_sender,
-                config);
+                config,
+                packetizer_report);
+
+    // Recovery requests of the sink are answered with intra refresh
+    // rather than IDR frames if the encoder supports it.
+    recovery_ = ac::video::ErrorRecovery::Create(encoder_, ErrorRecoveryConfig());
+    recovery_->SetDelegate(sender_);
 
-    encoder_->SetDelegate(sender_);
+    encoder_->SetDelegate(recovery_);
 
     pipeline_.Add(encoder_);
     pipeline_.Add(renderer_);
     pipeline_.Add(rtp_sender);
     pipeline_.Add(sender_);
 
-    return true;
+    watchdog_ = ac::common::StallWatchdog::Create();
+    watchdog_->SetDelegate(shared_from_this());
+
+    setup_state_ = SetupState::Done;
+
+    // The sink asked us to play while we were still busy and the
+    // delayed start already passed.
+    if (state_ == State::Playing && delay_timeout_ == 0)
+        StartPipeline();
+}
+
+void SourceMediaManager::CancelSetup() {
+    if (!setup_)
+        return;
+
+    AC_DEBUG("Cancelling pending setup");
+
+    setup_->cancelled = true;
+    setup_.reset();
+    setup_state_ = SetupState::Idle;
+}
+
+SourceMediaManager::SetupState SourceMediaManager::CurrentSetupState() const {
+    return setup_state_;
 }
 
 void SourceMediaManager::OnTransportNetworkError() {
@@ -125,6 +342,44 @@ void SourceMediaManager::OnTransportNetworkError() {
         sp->OnSourceNetworkError();
 }
 
+void SourceMediaManager::OnStallAction(ac::common::StallWatchdog::Action action) {
+    switch (action) {
+    case ac::common::StallWatchdog::Action::kRequestIDR:
+        // Bypasses error recovery on purpose; a decoder which got out
+        // of sync won't come back with intra refresh.
+        if (encoder_)
+            encoder_->SendIDRFrame();
+        break;
+    case ac::common::StallWatchdog::Action::kFlushQueues:
+        if (sender_)
+            sender_->Flush();
+        break;
+    case ac::common::StallWatchdog::Action::kRestartEncoder:
+        // A stage which didn't return in time is left behind still
+        // running in its executable. Starting the pipeline again would
+        // put a second thread on it so the session is torn down instead.
+        if (!pipeline_.Stop()) {
+            AC_ERROR("Pipeline didn't stop in time; tearing down instead of restarting it");
+            OnTransportNetworkError();
+            break;
+        }
+        // Starting the encoder again gets us an IDR frame with codec
+        // config.
+        if (sender_)
+            sender_->Flush();
+        if (!pipeline_.Start()) {
+            AC_ERROR("Failed to restart pipeline");
+            OnTransportNetworkError();
+        }
+        break;
+    case ac::common::StallWatchdog::Action::kTeardown:
+        OnTransportNetworkError();
+        break;
+    default:
+        break;
+    }
+}
+
 void SourceMediaManager::CancelDelayTimeout() {
     if (delay_timeout_ == 0)
         return;
@@ -133,17 +388,88 @@ void SourceMediaManager::CancelDelayTimeout() {
     delay_timeout_ = 0;
 }
 
+void SourceMediaManager::RequestLowLatency() {
+    if (!latency_lock_ || latency_requested_)
+        return;
+
+    // Between two frames our threads sleep long enough for the CPUs to
+    // enter deep idle states. Waking up from those adds jitter to every
+    // stage of the pipeline.
+    latency_lock_->Acquire(ac::CpuLatencyState::Low);
+    latency_requested_ = true;
+}
+
+void SourceMediaManager::ReleaseLowLatency() {
+    if (!latency_lock_ || !latency_requested_)
+        return;
+
+    latency_lock_->Release(ac::CpuLatencyState::Low);
+    latency_requested_ = false;
+}
+
+void SourceMediaManager::StartWatchdog() {
+    if (!watchdog_ || watchdog_timeout_ > 0)
+        return;
+
+    watchdog_->Reset();
+
+    watchdog_timeout_ = g_timeout_add_full(G_PRIORITY_DEFAULT,
+           kWatchdogInterval.count(),
+           &OnWatchdogTimer,
+           new WeakKeepAlive<SourceMediaManager>(shared_from_this()),
+           [](gpointer data) { delete static_cast<WeakKeepAlive<SourceMediaManager>*>(data); });
+}
+
+void SourceMediaManager::StopWatchdog() {
+    if (watchdog_timeout_ == 0)
+        return;
+
+    g_source_remove(watchdog_timeout_);
+    watchdog_timeout_ = 0;
+}
+
+gboolean SourceMediaManager::OnWatchdogTimer(gpointer user_data) {
+    auto thiz = static_cast<ac::WeakKeepAlive<SourceMediaManager>*>(user_data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    const auto action = thiz->watchdog_->Check(thiz->pipeline_, ac::Utils::GetNowUs());
+    if (action == ac::common::StallWatchdog::Action::kTeardown) {
+        thiz->watchdog_timeout_ = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 gboolean SourceMediaManager::OnStartPipeline(gpointer user_data) {
     auto thiz = static_cast<ac::WeakKeepAlive<SourceMediaManager>*>(user_data)->GetInstance().lock();
     if (!thiz)
         return FALSE;
 
-    thiz->pipeline_.Start();
     thiz->delay_timeout_ = 0;
 
+    // Otherwise started once the setup is done
+    if (thiz->setup_state_ == SetupState::Done)
+        thiz->StartPipeline();
+
     return FALSE;
 }
 
+void SourceMediaManager::StartPipeline() {
+    // Fails as well after a stage had to be left behind when stopping
+    if (!pipeline_.Start()) {
+        AC_ERROR("Failed to start pipeline");
+        OnTransportNetworkError();
+        return;
+    }
+
+    if (quality_)
+        quality_->Start();
+
+    StartWatchdog();
+}
+
 void SourceMediaManager::Play() {
     if (!IsPaused())
         return;
@@ -163,6 +489,8 @@ void SourceMediaManager::Play() {
            new WeakKeepAlive<SourceMediaManager>(shared_from_this()),
            [](gpointer data) { delete static_cast<WeakKeepAlive<SourceMediaManager>*>(data); });
 
+    RequestLowLatency();
+
     // We defer the actual start of the pipeline a bit here but
     // stay in state 'Playing' as even if the pipeline start
     // fails we don't have any direct way yet to switch the
@@ -175,33 +503,87 @@ void SourceMediaManager::Pause() {
         return;
 
     CancelDelayTimeout();
+    StopWatchdog();
 
     AC_DEBUG("");
 
     pipeline_.Stop();
+    if (quality_)
+        quality_->Stop();
+
+    ReleaseLowLatency();
 
     state_ = State::Paused;
 }
 
 void SourceMediaManager::Teardown() {
+    // Also before the sink asked us to play, which is where a
+    // negotiation gets torn down while the setup is still running.
+    CancelSetup();
+
     if (state_ == State::Stopped)
         return;
 
     AC_DEBUG("");
 
     CancelDelayTimeout();
+    StopWatchdog();
 
     pipeline_.Stop();
 
+    ReleaseLowLatency();
+
+    FinishSession();
+
     state_ = State::Stopped;
 }
 
+void SourceMediaManager::FinishSession() {
+    if (!quality_)
+        return;
+
+    quality_->Stop();
+
+    const auto rr = ac::video::ExtractRateAndResolution(format_);
+
+    ac::video::QualityHistory::Session session;
+    session.remote_address = remote_address_;
+    session.width = rr.width;
+    session.height = rr.height;
+    session.framerate = rr.framerate;
+    session.started = session_started_;
+    session.idr_frames = recovery_ ? recovery_->Stats().idr_frames : 0;
+    session.quality = quality_->Estimate();
+
+    const auto &q = session.quality;
+    AC_INFO("Session with %s (%dx%d@%d) ran for %d ms: quality %.1f, %.1f fps, "
+            "latency p50/p95/p99 %d/%d/%d ms, %d freezes (%d ms), %d recoveries, "
+            "%d idr frames, %d bit/s (variation %.2f), loss rate %.3f",
+            session.remote_address, session.width, session.height, session.framerate,
+            q.duration / 1000, q.score, q.framerate,
+            q.latency_p50 / 1000, q.latency_p95 / 1000, q.latency_p99 / 1000,
+            q.freezes, q.frozen_time / 1000, q.recoveries,
+            session.idr_frames, q.bitrate, q.bitrate_variation, q.loss_rate);
+
+    ac::video::QualityHistory::Instance()->Add(session);
+
+    quality_.reset();
+}
+
 bool SourceMediaManager::IsPaused() const {
     return state_ == State::Paused ||
            state_ == State::Stopped;
 }
 
 void SourceMediaManager::SendIDRPicture() {
+    if (quality_)
+        quality_->RecoveryRequested();
+
+    if (recovery_) {
+        recovery_->RequestRecovery();
+        return;
+    }
+
     if (!encoder_)
         return;
 
@@ -209,7 +591,9 @@ void SourceMediaManager::SendIDRPicture() {
 }
 
 int SourceMediaManager::GetLocalRtpPort() const {
-    return sender_->LocalRTPPort();
+    // Known as soon as the stream is connected, which is before the
+    // sender exists.
+    return output_stream_->LocalPort();
 }
 
 } // namespace mir
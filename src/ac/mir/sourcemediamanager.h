@@ -19,23 +19,30 @@
 #define AC_MIR_SOURCEMEDIAMANAGERNEXT_H_
 
 #include <memory>
+#include <mutex>
 
 #include "ac/glib_wrapper.h"
 
 #include "ac/basesourcemediamanager.h"
+#include "ac/systemcontroller.h"
 
 #include "ac/common/executor.h"
 #include "ac/common/threadedexecutor.h"
 #include "ac/common/executorpool.h"
+#include "ac/common/stallwatchdog.h"
 
 #include "ac/report/reportfactory.h"
 
 #include "ac/network/stream.h"
 
 #include "ac/video/baseencoder.h"
+#include "ac/video/encoderregistry.h"
+#include "ac/video/errorrecovery.h"
+#include "ac/video/qualityestimator.h"
 
 #include "ac/streaming/mediasender.h"
 
+#include "ac/mir/resourcemanager.h"
 #include "ac/mir/screencast.h"
 #include "ac/mir/streamrenderer.h"
 
@@ -44,7 +51,8 @@ namespace mir {
 
 class SourceMediaManager : public std::enable_shared_from_this<SourceMediaManager>,
                            public ac::BaseSourceMediaManager,
-                           public ac::streaming::TransportSender::Delegate {
+                           public ac::streaming::TransportSender::Delegate,
+                           public ac::common::StallWatchdog::Delegate {
 public:
     typedef std::shared_ptr<SourceMediaManager> Ptr;
 
@@ -54,12 +62,33 @@ public:
         Stopped
     };
 
+    // Setting up the producer and the encoder blocks for up to several
+    // hundred milliseconds and is therefore done on a worker thread
+    // once the format is negotiated. The pipeline is put together and,
+    // if the sink asked to play already, started once that's done.
+    enum class SetupState {
+        Idle,
+        Pending,
+        Done,
+        Failed
+    };
+
+    // Without an encoder the backend best suited for the negotiated
+    // format is picked from encoders when the session is configured.
+    // With resources given the encoder is taken from there instead and
+    // might be a pre-warmed one. Without a producer a screencast is
+    // created on the same occasion, using the Mir connection from
+    // resources if given. The CPU latency lock, if given, is held
+    // whenever the session is playing.
     SourceMediaManager(const std::string &remote_address,
                        const ac::common::ExecutorFactory::Ptr &executor_factory,
                        const ac::video::BufferProducer::Ptr &producer,
                        const ac::video::BaseEncoder::Ptr &encoder,
                        const ac::network::Stream::Ptr &output_stream,
-                       const ac::report::ReportFactory::Ptr &report_factory);
+                       const ac::report::ReportFactory::Ptr &report_factory,
+                       const ac::video::EncoderRegistry::Ptr &encoders = nullptr,
+                       const ResourceManager::Ptr &resources = nullptr,
+                       const ac::SystemController::Lock<ac::CpuLatencyState>::Ptr &latency_lock = nullptr);
 
     ~SourceMediaManager();
 
@@ -68,16 +97,34 @@ public:
     void Teardown() override;
     bool IsPaused() const override;
 
+    SetupState CurrentSetupState() const;
+
     void SendIDRPicture() override;
 
     int GetLocalRtpPort() const override;
 
     void OnTransportNetworkError() override;
 
+    void OnStallAction(ac::common::StallWatchdog::Action action) override;
+
 private:
+    struct Setup;
+
+    static bool SetupProducerAndEncoder(Setup &setup);
+    static void RunSetup(const std::shared_ptr<Setup> &setup);
+    static gboolean OnSetupFinished(gpointer user_data);
     static gboolean OnStartPipeline(gpointer user_data);
+    static gboolean OnWatchdogTimer(gpointer user_data);
 
+    void FinishSetup(const Setup &setup);
+    void CancelSetup();
+    void StartPipeline();
     void CancelDelayTimeout();
+    void StartWatchdog();
+    void StopWatchdog();
+    void RequestLowLatency();
+    void ReleaseLowLatency();
+    void FinishSession();
 
 protected:
     bool Configure() override;
@@ -87,12 +134,26 @@ private:
     std::string remote_address_;
     ac::video::BufferProducer::Ptr producer_;
     ac::video::BaseEncoder::Ptr encoder_;
+    ac::video::EncoderRegistry::Ptr encoders_;
+    ResourceManager::Ptr resources_;
     ac::network::Stream::Ptr output_stream_;
     ac::report::ReportFactory::Ptr report_factory_;
     ac::mir::StreamRenderer::Ptr renderer_;
     ac::streaming::MediaSender::Ptr sender_;
+    ac::video::ErrorRecovery::Ptr recovery_;
+    ac::video::QualityEstimator::Ptr quality_;
+    ac::TimestampUs session_started_;
     ac::common::ExecutorPool pipeline_;
+    ac::common::StallWatchdog::Ptr watchdog_;
+    ac::SystemController::Lock<ac::CpuLatencyState>::Ptr latency_lock_;
+    bool latency_requested_;
     guint delay_timeout_;
+    guint watchdog_timeout_;
+    SetupState setup_state_;
+    std::shared_ptr<Setup> setup_;
+    // Serializes setups of consecutive negotiations; a cancelled one
+    // might still be running when the next one starts.
+    std::shared_ptr<std::mutex> setup_lock_;
 };
 
 } // namespace mir
@@ -15,19 +15,42 @@
  *
  */
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <ratio>
 #include <thread>
 
 #include <boost/concept_check.hpp>
 
 #include "ac/logger.h"
 
+#include "ac/video/memorybudget.h"
+
 #include "ac/mir/screencast.h"
 #include "ac/mir/streamrenderer.h"
 
 namespace {
 static constexpr const char *kStreamRendererThreadName{"StreamRenderer"};
 static constexpr unsigned int kNumBufferSlots{2};
+// Bitrate is lowered by this percentage when running out of memory
+static constexpr unsigned int kBitrateReductionPercent{25};
+static constexpr unsigned int kMinBitrate{1000000};
+// Bitrate is lowered by this percentage while the device runs hot
+static constexpr unsigned int kThermalBitrateReductionPercent{30};
+
+// Picks the multiple of the display refresh interval closest to the
+// encoder frame rate. A 60 Hz display streamed with 30 fps is then
+// captured on every second refresh instead of alternating between one
+// and two refreshes which shows as judder on the sink.
+double FrameIntervalFor(ac::TimestampUs refresh_interval, int framerate) {
+    const double target = static_cast<double>(std::micro::den) / framerate;
+    if (refresh_interval <= 0)
+        return target;
+
+    const auto refreshes = std::max(1.0, std::round(target / refresh_interval));
+    return refreshes * refresh_interval;
+}
 }
 
 namespace ac {
@@ -35,14 +58,25 @@ namespace mir {
 
 StreamRenderer::StreamRenderer(const video::BufferProducer::Ptr &buffer_producer,
                                const video::BaseEncoder::Ptr &encoder,
-                               const video::RendererReport::Ptr &report) :
+                               const video::RendererReport::Ptr &report,
+                               const video::ThermalGovernor::Ptr &thermal) :
     report_(report),
     buffer_producer_(buffer_producer),
     encoder_(encoder),
+    thermal_(thermal),
     width_(buffer_producer->OutputMode().width),
     height_(buffer_producer->OutputMode().height),
-    input_buffers_(ac::video::BufferQueue::Create(BufferSlots())),
-    target_iteration_time_((1. / encoder_->Configuration().framerate) * std::micro::den) {
+    input_buffers_(ac::video::BufferQueue::Create(BufferSlots(), "StreamRenderer")),
+    frame_interval_(FrameIntervalFor(buffer_producer->RefreshInterval(), encoder_->Configuration().framerate)),
+    first_frame_time_(0),
+    last_timestamp_(0),
+    dropping_frames_(false),
+    bitrate_reduced_(false),
+    thermal_level_(video::ThermalGovernor::Level::kNone),
+    thermal_skip_frame_(false),
+    thermal_bitrate_reduced_(false),
+    thermal_saved_bitrate_(0),
+    last_progress_(0) {
 }
 
 StreamRenderer::~StreamRenderer() {
@@ -50,28 +84,27 @@ StreamRenderer::~StreamRenderer() {
 }
 
 bool StreamRenderer::Execute() {
-    ac::TimestampUs iteration_start_time = ac::Utils::GetNowUs();
-
     // Wait until we have free slots again and all buffers we produced
     // went through the pipeline.
     if (!input_buffers_->WaitForSlots())
         return true;
 
+    if (ShouldDropFrame()) {
+        last_progress_ = ac::Utils::GetNowUs();
+        WaitForNextFrame();
+        return true;
+    }
+
     report_->BeganFrame();
 
     // This will trigger the rendering/compositing process inside mir
     // and will block until that is done and we received a new buffer
     buffer_producer_->SwapBuffers();
 
-    const auto native_buffer = buffer_producer_->CurrentBuffer();
-
-    auto buffer = ac::video::Buffer::Create(native_buffer);
+    auto buffer = buffer_producer_->CreateBuffer();
     buffer->SetDelegate(shared_from_this());
 
-    // FIXME: at optimum we would get the timestamp directly supplied
-    // from our producer but as long as that isn't available we don't
-    // have any other chance and need to do it here.
-    buffer->SetTimestamp(ac::Utils::GetNowUs());
+    buffer->SetTimestamp(FrameTimestamp());
 
     input_buffers_->Push(buffer);
 
@@ -79,16 +112,134 @@ bool StreamRenderer::Execute() {
 
     report_->FinishedFrame(buffer->Timestamp());
 
-    // Calculate how long we have to wait until we can render the next
-    // frame to keep our framerate constant.
-    ac::TimestampUs iteration_time = ac::Utils::GetNowUs() - iteration_start_time;
-    ac::TimestampUs sleep_time = target_iteration_time_ - iteration_time;
-    if (sleep_time > 0)
-        std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
+    last_progress_ = ac::Utils::GetNowUs();
+
+    WaitForNextFrame();
+
+    return true;
+}
+
+ac::TimestampUs StreamRenderer::FrameTimestamp() {
+    // Not all producers know when their buffer was captured. Taking the
+    // time here instead includes however long compositing blocked us.
+    auto timestamp = buffer_producer_->CurrentTimestamp();
+    if (timestamp <= 0)
+        timestamp = ac::Utils::GetNowUs();
+
+    if (first_frame_time_ == 0)
+        first_frame_time_ = timestamp;
+
+    // Moving the timestamp onto the closest grid point removes jitter
+    // caused by our own scheduling from the PTS.
+    const auto frames = std::round((timestamp - first_frame_time_) / frame_interval_);
+    timestamp = first_frame_time_ + static_cast<ac::TimestampUs>(frames * frame_interval_);
+
+    if (last_timestamp_ > 0 && timestamp <= last_timestamp_)
+        timestamp = last_timestamp_ + static_cast<ac::TimestampUs>(frame_interval_);
+
+    last_timestamp_ = timestamp;
+
+    return timestamp;
+}
+
+void StreamRenderer::WaitForNextFrame() {
+    const ac::TimestampUs now = ac::Utils::GetNowUs();
+
+    if (first_frame_time_ == 0)
+        first_frame_time_ = now;
+
+    // Sleep until the next grid point rather than for a fixed time so
+    // that the time spent in the current iteration doesn't add up. If we
+    // fell behind by more than a frame the missed ones are skipped.
+    const auto frames = std::floor((now - first_frame_time_) / frame_interval_) + 1;
+    const auto next_frame_time = first_frame_time_ + static_cast<ac::TimestampUs>(frames * frame_interval_);
+
+    std::this_thread::sleep_for(std::chrono::microseconds(next_frame_time - now));
+}
+
+bool StreamRenderer::ShouldDropFrame() {
+    // Both need to be evaluated for every frame to track their state
+    const auto memory = ShouldDropForMemoryPressure();
+    const auto thermal = ShouldDropForThermalLevel();
+    return memory || thermal;
+}
+
+bool StreamRenderer::ShouldDropForMemoryPressure() {
+    const auto pressure = ac::video::MemoryBudget::Instance()->CurrentPressure();
+
+    if (pressure == ac::video::MemoryBudget::Pressure::kNone) {
+        if (dropping_frames_)
+            AC_DEBUG("Memory pressure is gone; not dropping frames anymore");
+
+        dropping_frames_ = false;
+        bitrate_reduced_ = false;
+        return false;
+    }
+
+    if (!dropping_frames_)
+        AC_WARNING("Dropping frames until memory pressure is gone");
+
+    dropping_frames_ = true;
+
+    // Dropping frames wasn't enough so ask the encoder to produce
+    // less data. We only do this once for every period of high memory
+    // pressure and don't raise the bitrate again afterwards.
+    if (pressure == ac::video::MemoryBudget::Pressure::kReduceBitrate && !bitrate_reduced_) {
+        bitrate_reduced_ = true;
+
+        auto bitrate = encoder_->Configuration().bitrate * (100 - kBitrateReductionPercent) / 100;
+        if (bitrate < kMinBitrate)
+            bitrate = kMinBitrate;
+
+        if (!encoder_->SetBitrate(bitrate))
+            AC_WARNING("Encoder can't change its bitrate; only dropping frames");
+    }
 
     return true;
 }
 
+bool StreamRenderer::ShouldDropForThermalLevel() {
+    if (!thermal_)
+        return false;
+
+    const auto level = thermal_->CurrentLevel();
+    if (level != thermal_level_) {
+        AC_DEBUG("Adapting to thermal level %s", video::ThermalGovernor::LevelToString(level));
+        thermal_level_ = level;
+    }
+
+    // Other than under memory pressure the bitrate is raised again once
+    // the device cooled down. Lowering the resolution needs the format
+    // to be negotiated again and is up to the next session.
+    const auto reduce_bitrate = level >= video::ThermalGovernor::Level::kReduceBitrate;
+    if (reduce_bitrate != thermal_bitrate_reduced_) {
+        thermal_bitrate_reduced_ = reduce_bitrate;
+
+        // The configuration reflects the lowered bitrate once the encoder
+        // took it so we have to remember what to go back to.
+        auto bitrate = thermal_saved_bitrate_;
+        if (reduce_bitrate) {
+            thermal_saved_bitrate_ = encoder_->Configuration().bitrate;
+            bitrate = std::max(kMinBitrate, thermal_saved_bitrate_ * (100 - kThermalBitrateReductionPercent) / 100);
+        }
+
+        // Memory pressure might have asked for a lower bitrate meanwhile
+        // which we don't override.
+        if ((reduce_bitrate || !bitrate_reduced_) && !encoder_->SetBitrate(bitrate))
+            AC_WARNING("Encoder can't change its bitrate; only lowering frame rate");
+    }
+
+    if (level < video::ThermalGovernor::Level::kReduceFramerate) {
+        thermal_skip_frame_ = false;
+        return false;
+    }
+
+    // Capture only every second frame. Timestamps stay on the same grid
+    // so the sink sees a steady half rate rather than judder.
+    thermal_skip_frame_ = !thermal_skip_frame_;
+    return !thermal_skip_frame_;
+}
+
 void StreamRenderer::OnBufferFinished(const video::Buffer::Ptr &buffer) {
     boost::ignore_unused_variable_warning(buffer);
 
@@ -114,6 +265,10 @@ std::string StreamRenderer::Name() const {
     return kStreamRendererThreadName;
 }
 
+ac::TimestampUs StreamRenderer::LastProgress() const {
+    return last_progress_;
+}
+
 std::uint32_t StreamRenderer::BufferSlots() const {
     return kNumBufferSlots;
 }
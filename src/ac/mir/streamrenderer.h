@@ -18,6 +18,7 @@
 #ifndef AC_MIR_STREAMRENDERER_H_
 #define AC_MIR_STREAMRENDERER_H_
 
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -32,6 +33,7 @@
 #include "ac/video/bufferqueue.h"
 #include "ac/video/bufferproducer.h"
 #include "ac/video/rendererreport.h"
+#include "ac/video/thermalgovernor.h"
 
 namespace ac {
 namespace mir {
@@ -45,7 +47,8 @@ public:
 
     StreamRenderer(const video::BufferProducer::Ptr &buffer_producer,
                    const video::BaseEncoder::Ptr &encoder,
-                   const video::RendererReport::Ptr  &report);
+                   const video::RendererReport::Ptr  &report,
+                   const video::ThermalGovernor::Ptr &thermal = video::ThermalGovernor::Instance());
     ~StreamRenderer();
 
     std::uint32_t BufferSlots() const;
@@ -58,15 +61,36 @@ public:
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    ac::TimestampUs LastProgress() const override;
 
 private:
+    bool ShouldDropFrame();
+    bool ShouldDropForMemoryPressure();
+    bool ShouldDropForThermalLevel();
+
+    ac::TimestampUs FrameTimestamp();
+    void WaitForNextFrame();
+
     video::RendererReport::Ptr report_;
     video::BufferProducer::Ptr buffer_producer_;
     video::BaseEncoder::Ptr encoder_;
+    video::ThermalGovernor::Ptr thermal_;
     unsigned int width_;
     unsigned int height_;
     ac::video::BufferQueue::Ptr input_buffers_;
-    ac::TimestampUs target_iteration_time_;
+    // Time between two frames as multiple of the display refresh
+    // interval if known. Frames are captured and stamped on a grid with
+    // this spacing starting at the first frame.
+    double frame_interval_;
+    ac::TimestampUs first_frame_time_;
+    ac::TimestampUs last_timestamp_;
+    bool dropping_frames_;
+    bool bitrate_reduced_;
+    video::ThermalGovernor::Level thermal_level_;
+    bool thermal_skip_frame_;
+    bool thermal_bitrate_reduced_;
+    unsigned int thermal_saved_bitrate_;
+    std::atomic<ac::TimestampUs> last_progress_;
 };
 } // namespace mir
 } // namespace ac
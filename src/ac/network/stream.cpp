@@ -16,3 +16,27 @@
  */
 
 #include "ac/network/stream.h"
+
+namespace ac {
+namespace network {
+
+std::string Stream::TransmitPointToString(TransmitPoint point) {
+    switch (point) {
+    case TransmitPoint::kScheduled:
+        return "scheduled";
+    case TransmitPoint::kSoftware:
+        return "software";
+    case TransmitPoint::kHardware:
+        return "hardware";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+std::vector<Stream::TransmitTimestamp> Stream::ReadTransmitTimestamps() {
+    return std::vector<TransmitTimestamp>{};
+}
+
+} // namespace network
+} // namespace ac
@@ -19,6 +19,8 @@
 #define AC_NETWORK_STREAM_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "ac/non_copyable.h"
 #include "ac/utils.h"
@@ -36,8 +38,32 @@ public:
         kNone,
         kFailed,
         kRemoteClosedConnection,
+        // The data couldn't be sent in time and was dropped. The stream
+        // stays usable.
+        kTimedOut,
     };
 
+    // Points on the way out of the device the kernel can timestamp a
+    // written packet at.
+    enum class TransmitPoint {
+        // Entered the packet scheduler (qdisc)
+        kScheduled,
+        // Handed to the driver
+        kSoftware,
+        // Left the network interface
+        kHardware,
+    };
+
+    struct TransmitTimestamp {
+        // As passed to Write; identifies the frame the packet belongs to
+        ac::TimestampUs timestamp;
+        TransmitPoint point;
+        // Time between the packet being written and reaching the point
+        ac::TimestampUs delay;
+    };
+
+    static std::string TransmitPointToString(TransmitPoint point);
+
     virtual bool Connect(const std::string &address, const Port &port) = 0;
 
     virtual Error Write(const uint8_t *data, unsigned int size,
@@ -51,6 +77,13 @@ public:
      */
     virtual std::uint32_t MaxUnitSize() const = 0;
 
+    /**
+     * @brief Returns the transmit timestamps collected since the last call.
+     * Has to be called from the thread writing to the stream. Streams
+     * without support for them never return any.
+     */
+    virtual std::vector<TransmitTimestamp> ReadTransmitTimestamps();
+
 protected:
     Stream() = default;
 };
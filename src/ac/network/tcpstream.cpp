@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <memory.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/network/tcpstream.h"
+
+namespace {
+// Input events are tiny and a burst of them fits easily. If the remote
+// doesn't take them within this time the connection is stalled and
+// holding up the writer any longer doesn't help.
+static constexpr std::chrono::milliseconds kSendTimeout{200};
+static constexpr unsigned int kMaxUnitSize{65535};
+}
+
+namespace ac {
+namespace network {
+
+TcpStream::TcpStream() :
+    socket_(-1),
+    local_port_(0) {
+}
+
+TcpStream::~TcpStream() {
+    if (socket_ >= 0)
+        ::close(socket_);
+}
+
+bool TcpStream::Connect(const std::string &address, const Port &port) {
+    // Connecting again after a failed attempt
+    if (socket_ >= 0)
+        ::close(socket_);
+
+    socket_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ < 0) {
+        AC_ERROR("Failed to create socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    int value = 1;
+    if (::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) < 0) {
+        AC_ERROR("Failed to disable Nagle's algorithm: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(kSendTimeout).count();
+    if (::setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+        AC_ERROR("Failed to set socket send timeout: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    struct sockaddr_in remote_addr;
+    memset(&remote_addr, 0, sizeof(remote_addr));
+    remote_addr.sin_family = AF_INET;
+    remote_addr.sin_port = htons(port);
+
+    struct hostent *ent = gethostbyname(address.c_str());
+    if (!ent) {
+        AC_ERROR("Failed to resolve remote address");
+        return false;
+    }
+
+    remote_addr.sin_addr.s_addr = *reinterpret_cast<in_addr_t*>(ent->h_addr);
+
+    // Bound by the send timeout as well
+    if (::connect(socket_, reinterpret_cast<const struct sockaddr*>(&remote_addr), sizeof(remote_addr)) < 0) {
+        AC_ERROR("Failed to connect to remote: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    struct sockaddr_in local_addr;
+    socklen_t length = sizeof(local_addr);
+    if (::getsockname(socket_, reinterpret_cast<struct sockaddr*>(&local_addr), &length) == 0)
+        local_port_ = ntohs(local_addr.sin_port);
+
+    AC_DEBUG("Connected with remote on %s:%d", address, port);
+
+    return true;
+}
+
+Stream::Error TcpStream::Write(const uint8_t *data, unsigned int size,
+                               const ac::TimestampUs &timestamp) {
+
+    boost::ignore_unused_variable_warning(timestamp);
+
+    unsigned int offset = 0;
+    while (offset < size) {
+        const auto bytes_sent = ::send(socket_, data + offset, size - offset, MSG_NOSIGNAL);
+        if (bytes_sent < 0 && errno == EINTR)
+            continue;
+
+        if (bytes_sent < 0) {
+            AC_ERROR("Failed to send data to remote: %s (%d)", ::strerror(errno), errno);
+            return errno == EPIPE || errno == ECONNRESET ?
+                        Error::kRemoteClosedConnection : Error::kFailed;
+        }
+
+        offset += bytes_sent;
+    }
+
+    return Error::kNone;
+}
+
+Port TcpStream::LocalPort() const {
+    return local_port_;
+}
+
+std::uint32_t TcpStream::MaxUnitSize() const {
+    return kMaxUnitSize;
+}
+
+} // namespace network
+} // namespace ac
@@ -17,20 +17,24 @@
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
 #include <memory.h>
 #include <errno.h>
 #include <error.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <chrono>
 #include <random>
 
-#include <boost/concept_check.hpp>
-
 #include "ac/logger.h"
 #include "ac/networkutils.h"
 
@@ -38,16 +42,49 @@
 
 namespace {
 static constexpr unsigned int kUdpTxBufferSize = 256 * 1024;
+// A send blocked for longer than this means the link is stalled. We'd
+// rather lose the packet than hold up the sender thread, not least when
+// it has to be stopped.
+static constexpr std::chrono::milliseconds kSendTimeout{100};
 /* Value below configured MTU so that we don't require any further splits */
 static constexpr unsigned int kMaxUDPPacketSize = 1472;
+// A stalled link times out every packet; don't warn about each of them.
+static constexpr ac::TimestampUs kDropWarningIntervalUs{1000000};
+// Datagrams written but not yet matched with all of their timestamps.
+// Timestamps show up within milliseconds normally; this covers more than
+// a second at the highest bitrates we stream with.
+static constexpr std::size_t kMaxPendingTimestamps{2048};
+// Bounds the time a single call spends draining the error queue
+static constexpr std::size_t kMaxTimestampsPerRead{256};
+
+ac::TimestampUs GetRealtimeUs() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+ac::TimestampUs ToUs(const struct timespec &ts) {
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+// Datagram ids wrap around
+bool IdBefore(std::uint32_t id, std::uint32_t other) {
+    return static_cast<std::int32_t>(id - other) < 0;
+}
 }
 
 namespace ac {
 namespace network {
 
-UdpStream::UdpStream() :
+UdpStream::UdpStream(const Config &config) :
+    config_(config),
     socket_(0),
-    local_port_(NetworkUtils::PickRandomPort()) {
+    local_port_(NetworkUtils::PickRandomPort()),
+    dropped_(0),
+    last_drop_warning_(0),
+    timestamping_(false),
+    hardware_timestamps_(false),
+    next_id_(0) {
 }
 
 UdpStream::~UdpStream() {
@@ -70,6 +107,17 @@ bool UdpStream::Connect(const std::string &address, const Port &port) {
         return false;
     }
 
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(kSendTimeout).count();
+    if (::setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+        AC_ERROR("Failed to set socket send timeout: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    if (config_.transmit_timestamps)
+        timestamping_ = EnableTransmitTimestamps();
+
     struct sockaddr_in addr;
     memset(addr.sin_zero, 0, sizeof(addr.sin_zero));
     addr.sin_family = AF_INET;
@@ -105,13 +153,20 @@ bool UdpStream::Connect(const std::string &address, const Port &port) {
 Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
                                const ac::TimestampUs &timestamp) {
 
-    boost::ignore_unused_variable_warning(timestamp);
-
     // Note this is a blocking socket. However, this is a datagram socket and
     // any blocking due to a full sending buffer will be very short. Also, we
-    // have a dedicated thread to call Write().
+    // have a dedicated thread to call Write(). Should the link stall the
+    // send timeout set on the socket keeps us from blocking forever.
+
+    // The kernel might timestamp the datagram before send returns
+    auto written = timestamping_ ? GetRealtimeUs() : 0;
     auto bytes_sent = ::send(socket_, data, size, 0);
 
+    if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        WarnDropped();
+        return Error::kTimedOut;
+    }
+
     // If we get an error back which relates to a possible congested
     // socket we try to resend one time and then fall into our actual
     // error handling.
@@ -124,6 +179,8 @@ Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
         case ENETUNREACH:
         case ENETDOWN:
             AC_DEBUG("Trying to resend due to a possible congested socket (errno %d)", errno);
+            if (timestamping_)
+                written = GetRealtimeUs();
             bytes_sent = ::send(socket_, data, size, 0);
            break;
         default:
@@ -140,9 +197,170 @@ Stream::Error UdpStream::Write(const uint8_t *data, unsigned int size,
         return Error::kRemoteClosedConnection;
     }
 
+    if (timestamping_)
+        AddPending(timestamp, written);
+
     return Error::kNone;
 }
 
+void UdpStream::WarnDropped() {
+    dropped_++;
+
+    const auto now = ac::Utils::GetNowUs();
+    if (now - last_drop_warning_ < kDropWarningIntervalUs)
+        return;
+
+    AC_WARNING("Sending timed out; dropped %d packets", dropped_);
+    dropped_ = 0;
+    last_drop_warning_ = now;
+}
+
+bool UdpStream::EnableTransmitTimestamps() {
+    // Only the timestamps are looped back, not the datagrams, and every
+    // one carries the number of the datagram it belongs to.
+    int flags = SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+                SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_OPT_ID |
+                SOF_TIMESTAMPING_OPT_TSONLY;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        AC_WARNING("Transmit timestamps are not available: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    AC_DEBUG("Enabled transmit timestamps");
+    return true;
+}
+
+void UdpStream::AddPending(const ac::TimestampUs &timestamp, const ac::TimestampUs &written) {
+    if (pending_.size() >= kMaxPendingTimestamps)
+        pending_.pop_front();
+
+    pending_.push_back(Pending{next_id_++, timestamp, written, GetRealtimeUs()});
+}
+
+UdpStream::PendingIterator UdpStream::FindPending(std::uint32_t id) {
+    const auto pending = std::lower_bound(pending_.begin(), pending_.end(), id,
+                                          [](const Pending &p, std::uint32_t id) { return IdBefore(p.id, id); });
+    if (pending == pending_.end() || pending->id != id)
+        return pending_.end();
+
+    return pending;
+}
+
+UdpStream::PendingIterator UdpStream::Resynchronize(std::uint32_t id, const ac::TimestampUs &scheduled) {
+    // The packet scheduler timestamps a datagram before send returns so
+    // its time alone tells which datagram it is.
+    auto pending = std::upper_bound(pending_.begin(), pending_.end(), scheduled,
+                                    [](const ac::TimestampUs &time, const Pending &p) { return time < p.written; });
+    if (pending == pending_.begin())
+        return pending_.end();
+
+    --pending;
+    if (scheduled > pending->returned)
+        return pending_.end();
+
+    // Failed writes used up ids. Everything written since is off by the
+    // same amount.
+    const auto skipped = id - pending->id;
+    AC_DEBUG("Transmit timestamp ids are off by %d; resynchronizing", skipped);
+
+    for (auto p = pending; p != pending_.end(); ++p)
+        p->id += skipped;
+    next_id_ += skipped;
+
+    return pending;
+}
+
+bool UdpStream::ParseTransmitTimestamp(struct msghdr *msg, TransmitTimestamp *timestamp) {
+    const struct scm_timestamping *times = nullptr;
+    const struct sock_extended_err *error = nullptr;
+
+    for (auto cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+            times = reinterpret_cast<const struct scm_timestamping*>(CMSG_DATA(cmsg));
+        else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+            error = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+    }
+
+    if (!times || !error || error->ee_errno != ENOMSG || error->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+        return false;
+
+    // Hardware timestamps are taken with the clock of the network
+    // interface. They only compare to ours if that one is synchronized
+    // with the system clock.
+    ac::TimestampUs time = 0;
+    if (error->ee_info == SCM_TSTAMP_SCHED) {
+        timestamp->point = TransmitPoint::kScheduled;
+        time = ToUs(times->ts[0]);
+    }
+    else if (error->ee_info == SCM_TSTAMP_SND && (times->ts[2].tv_sec != 0 || times->ts[2].tv_nsec != 0)) {
+        timestamp->point = TransmitPoint::kHardware;
+        time = ToUs(times->ts[2]);
+    }
+    else if (error->ee_info == SCM_TSTAMP_SND) {
+        timestamp->point = TransmitPoint::kSoftware;
+        time = ToUs(times->ts[0]);
+    }
+    else
+        return false;
+
+    const auto id = error->ee_data;
+    auto pending = FindPending(id);
+
+    if (timestamp->point == TransmitPoint::kScheduled &&
+            (pending == pending_.end() || time < pending->written || time > pending->returned))
+        pending = Resynchronize(id, time);
+    else if (pending != pending_.end() && time < pending->written)
+        pending = pending_.end();
+
+    if (pending == pending_.end())
+        return false;
+
+    timestamp->timestamp = pending->timestamp;
+    timestamp->delay = time - pending->written;
+
+    if (timestamp->point == TransmitPoint::kHardware)
+        hardware_timestamps_ = true;
+
+    // Timestamps of one kind come in the order the datagrams were sent.
+    // Once the last one we expect for a datagram is in nothing more will
+    // come for it or any datagram before it.
+    if (timestamp->point == TransmitPoint::kHardware ||
+            (timestamp->point == TransmitPoint::kSoftware && !hardware_timestamps_))
+        pending_.erase(pending_.begin(), pending + 1);
+
+    return true;
+}
+
+std::vector<Stream::TransmitTimestamp> UdpStream::ReadTransmitTimestamps() {
+    std::vector<TransmitTimestamp> timestamps;
+    if (!timestamping_)
+        return timestamps;
+
+    for (std::size_t n = 0; n < kMaxTimestampsPerRead; n++) {
+        char control[256];
+
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                AC_WARNING("Failed to read transmit timestamps: %s (%d)", ::strerror(errno), errno);
+            break;
+        }
+
+        // Anything else on the error queue isn't for us but still had
+        // to be taken out of the way.
+        TransmitTimestamp timestamp;
+        if (ParseTransmitTimestamp(&msg, &timestamp))
+            timestamps.push_back(timestamp);
+    }
+
+    return timestamps;
+}
+
 Port UdpStream::LocalPort() const {
     return local_port_;
 }
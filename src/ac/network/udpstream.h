@@ -18,6 +18,10 @@
 #ifndef AC_NETWORK_UDPSTREAM_H_
 #define AC_NETWORK_UDPSTREAM_H_
 
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <deque>
 #include <memory>
 
 #include "ac/non_copyable.h"
@@ -29,7 +33,20 @@ namespace network {
 
 class UdpStream : public Stream {
 public:
-    UdpStream();
+    class Config {
+    public:
+        Config() :
+            transmit_timestamps(false) {
+        }
+
+        // Asks the kernel to timestamp every written datagram when it
+        // enters the packet scheduler, is handed to the driver and, if
+        // the network interface has hardware timestamping enabled, when
+        // it leaves the device.
+        bool transmit_timestamps;
+    };
+
+    UdpStream(const Config &config = Config{});
     ~UdpStream();
 
     bool Connect(const std::string &address, const Port &port) override;
@@ -41,9 +58,42 @@ public:
 
     std::uint32_t MaxUnitSize() const override;
 
+    std::vector<TransmitTimestamp> ReadTransmitTimestamps() override;
+
+private:
+    // A written datagram we still expect timestamps for
+    struct Pending {
+        std::uint32_t id;
+        ac::TimestampUs timestamp;
+        // CLOCK_REALTIME like the timestamps from the kernel. The
+        // datagram was handed to the packet scheduler in between.
+        ac::TimestampUs written;
+        ac::TimestampUs returned;
+    };
+    typedef std::deque<Pending>::iterator PendingIterator;
+
+    void WarnDropped();
+    bool EnableTransmitTimestamps();
+    void AddPending(const ac::TimestampUs &timestamp, const ac::TimestampUs &written);
+    PendingIterator FindPending(std::uint32_t id);
+    PendingIterator Resynchronize(std::uint32_t id, const ac::TimestampUs &scheduled);
+    bool ParseTransmitTimestamp(struct msghdr *msg, TransmitTimestamp *timestamp);
+
 private:
+    Config config_;
     int socket_;
     Port local_port_;
+    // Packets dropped since the last warning about it
+    std::uint32_t dropped_;
+    ac::TimestampUs last_drop_warning_;
+    bool timestamping_;
+    bool hardware_timestamps_;
+    // The kernel numbers datagrams in the order they are written. Failed
+    // writes might use up numbers too, so this is only our best guess
+    // until the kernel tells us otherwise.
+    std::uint32_t next_id_;
+    // Ordered by id
+    std::deque<Pending> pending_;
 };
 
 } // namespace network
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/report/logging/jitterbufferreport.h"
+
+namespace ac {
+namespace report {
+namespace logging {
+
+void JitterBufferReport::DeliveredPacket(const uint16_t &sequence_number, const int64_t &playout_delay) {
+    AC_TRACE("sequence_number %d playout_delay %d", sequence_number, playout_delay);
+}
+
+void JitterBufferReport::LatePacket(const uint16_t &sequence_number) {
+    AC_TRACE("sequence_number %d", sequence_number);
+}
+
+void JitterBufferReport::DuplicatePacket(const uint16_t &sequence_number) {
+    AC_TRACE("sequence_number %d", sequence_number);
+}
+
+void JitterBufferReport::LostPackets(const uint16_t &first_sequence_number, const size_t &count) {
+    AC_TRACE("first_sequence_number %d count %d", first_sequence_number, count);
+}
+
+void JitterBufferReport::TargetDelayChanged(const int64_t &delay) {
+    AC_TRACE("delay %d", delay);
+}
+
+} // namespace logging
+} // namespace report
+} // namespace ac
@@ -20,6 +20,11 @@
 #include "ac/report/logging/rendererreport.h"
 #include "ac/report/logging/packetizerreport.h"
 #include "ac/report/logging/senderreport.h"
+#include "ac/report/logging/memoryreport.h"
+#include "ac/report/logging/jitterbufferreport.h"
+#include "ac/report/logging/thermalreport.h"
+#include "ac/report/logging/perfcounterreport.h"
+#include "ac/report/logging/lockreport.h"
 
 namespace ac {
 namespace report {
@@ -40,5 +45,28 @@ std::shared_ptr<video::SenderReport> LoggingReportFactory::CreateSenderReport()
     return std::make_shared<logging::SenderReport>();
 }
 
+std::shared_ptr<video::MemoryReport> LoggingReportFactory::CreateMemoryReport() {
+    return std::make_shared<logging::MemoryReport>();
+}
+
+std::shared_ptr<video::JitterBufferReport> LoggingReportFactory::CreateJitterBufferReport() {
+    return std::make_shared<logging::JitterBufferReport>();
+}
+
+std::shared_ptr<video::ThermalReport> LoggingReportFactory::CreateThermalReport() {
+    return std::make_shared<logging::ThermalReport>();
+}
+
+std::shared_ptr<video::PerfCounterReport> LoggingReportFactory::CreatePerfCounterReport() {
+    if (!PerfCountersEnabled())
+        return nullptr;
+
+    return std::make_shared<logging::PerfCounterReport>();
+}
+
+std::shared_ptr<video::LockReport> LoggingReportFactory::CreateLockReport() {
+    return std::make_shared<logging::LockReport>();
+}
+
 } // namespace report
 } // namespace ac
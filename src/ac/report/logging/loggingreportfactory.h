@@ -33,6 +33,11 @@ public:
     std::shared_ptr<video::RendererReport> CreateRendererReport();
     std::shared_ptr<video::PacketizerReport> CreatePacketizerReport();
     std::shared_ptr<video::SenderReport> CreateSenderReport();
+    std::shared_ptr<video::MemoryReport> CreateMemoryReport();
+    std::shared_ptr<video::JitterBufferReport> CreateJitterBufferReport();
+    std::shared_ptr<video::ThermalReport> CreateThermalReport();
+    std::shared_ptr<video::PerfCounterReport> CreatePerfCounterReport();
+    std::shared_ptr<video::LockReport> CreateLockReport();
 };
 
 } // namespace report
@@ -27,6 +27,18 @@ void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
     AC_TRACE("timestamp %lld", timestamp);
 }
 
+void PacketizerReport::PaddedFrame(const TimestampUs &timestamp, const size_t &padding, const size_t &total) {
+    AC_TRACE("timestamp %lld padding %d total %d", timestamp, padding, total);
+}
+
+void PacketizerReport::DroppedFrame(const TimestampUs &timestamp, const int &layer) {
+    AC_TRACE("timestamp %lld layer %d", timestamp, layer);
+}
+
+void PacketizerReport::FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level) {
+    AC_DEBUG("framerate %d drop level %d", framerate, drop_level);
+}
+
 } // namespace logging
 } // namespace report
 } // namespace ac
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/report/logging/perfcounterreport.h"
+
+namespace {
+std::int64_t PerIteration(const std::int64_t &count, const std::uint64_t &iterations) {
+    if (count < 0 || iterations == 0)
+        return -1;
+    return count / static_cast<std::int64_t>(iterations);
+}
+}
+
+namespace ac {
+namespace report {
+namespace logging {
+
+void PerfCounterReport::CountersSampled(const std::string &stage, const std::uint64_t &iterations,
+                                        const std::int64_t &cycles, const std::int64_t &instructions,
+                                        const std::int64_t &cache_misses, const std::int64_t &branch_misses) {
+    const auto ipc = cycles > 0 && instructions >= 0 ?
+                static_cast<double>(instructions) / cycles : 0.0;
+
+    AC_TRACE("stage %s iterations %d per iteration: cycles %d instructions %d (ipc %.2f) "
+             "cache misses %d branch misses %d",
+             stage, iterations,
+             PerIteration(cycles, iterations), PerIteration(instructions, iterations), ipc,
+             PerIteration(cache_misses, iterations), PerIteration(branch_misses, iterations));
+}
+
+} // namespace logging
+} // namespace report
+} // namespace ac
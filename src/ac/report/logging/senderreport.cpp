@@ -27,6 +27,15 @@ void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size)
     AC_TRACE("timestamp %lld size %d", timestamp, size);
 }
 
+void SenderReport::DroppedPacket(const TimestampUs &timestamp, const size_t &size) {
+    AC_TRACE("dropped timestamp %lld size %d", timestamp, size);
+}
+
+void SenderReport::TransmittedPacket(const TimestampUs &timestamp, const std::string &point,
+                                     const TimestampUs &delay) {
+    AC_TRACE("timestamp %lld point %s delay %lld us", timestamp, point, delay);
+}
+
 } // namespace logging
 } // namespace report
 } // namespace ac
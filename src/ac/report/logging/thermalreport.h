@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_LOGGING_THERMALREPORT_H_
+#define AC_REPORT_LOGGING_THERMALREPORT_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/thermalreport.h"
+
+namespace ac {
+namespace report {
+namespace logging {
+
+class ThermalReport : public video::ThermalReport {
+public:
+     void TemperatureSampled(const std::string &zone, const int &temperature, const int &headroom);
+     void LevelChanged(const int &level, const std::string &zone, const int &temperature);
+};
+
+} // namespace logging
+} // namespace report
+} // namespace ac
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/jitterbufferreport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/jitterbufferreport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void JitterBufferReport::DeliveredPacket(const uint16_t &sequence_number, const int64_t &playout_delay) {
+    ac_tracepoint(aethercast_jitterbuffer, delivered_packet, sequence_number, playout_delay);
+}
+
+void JitterBufferReport::LatePacket(const uint16_t &sequence_number) {
+    ac_tracepoint(aethercast_jitterbuffer, late_packet, sequence_number);
+}
+
+void JitterBufferReport::DuplicatePacket(const uint16_t &sequence_number) {
+    ac_tracepoint(aethercast_jitterbuffer, duplicate_packet, sequence_number);
+}
+
+void JitterBufferReport::LostPackets(const uint16_t &first_sequence_number, const size_t &count) {
+    ac_tracepoint(aethercast_jitterbuffer, lost_packets, first_sequence_number, count);
+}
+
+void JitterBufferReport::TargetDelayChanged(const int64_t &delay) {
+    ac_tracepoint(aethercast_jitterbuffer, target_delay_changed, delay);
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
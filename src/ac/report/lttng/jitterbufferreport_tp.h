@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_jitterbuffer
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/jitterbufferreport_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_JITTERBUFFERREPORT_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_JITTERBUFFERREPORT_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
+
+#define ENCODER_TRACE_POINT(name) AC_LTTNG_VOID_TRACE_POINT(TRACEPOINT_PROVIDER, name)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    delivered_packet,
+    TP_ARGS(uint16_t, sequence_number, int64_t, playout_delay),
+    TP_FIELDS(
+        ctf_integer(uint16_t, sequence_number, sequence_number)
+        ctf_integer(int64_t, playout_delay, playout_delay)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    late_packet,
+    TP_ARGS(uint16_t, sequence_number),
+    TP_FIELDS(
+        ctf_integer(uint16_t, sequence_number, sequence_number)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    duplicate_packet,
+    TP_ARGS(uint16_t, sequence_number),
+    TP_FIELDS(
+        ctf_integer(uint16_t, sequence_number, sequence_number)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    lost_packets,
+    TP_ARGS(uint16_t, first_sequence_number, size_t, count),
+    TP_FIELDS(
+        ctf_integer(uint16_t, first_sequence_number, first_sequence_number)
+        ctf_integer(size_t, count, count)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    target_delay_changed,
+    TP_ARGS(int64_t, delay),
+    TP_FIELDS(
+        ctf_integer(int64_t, delay, delay)
+    )
+)
+
+#undef ENCODER_TRACE_POINT
+
+#endif
+
+#include <lttng/tracepoint-event.h>
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/lockreport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/lockreport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void LockReport::LockSampled(const std::string &site, const std::uint64_t &acquisitions,
+                             const std::uint64_t &contentions, const std::uint64_t &wait,
+                             const std::uint64_t &hold) {
+    ac_tracepoint(aethercast_lock, lock_sampled, site.c_str(), acquisitions, contentions, wait, hold);
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
@@ -20,6 +20,11 @@
 #include "ac/report/lttng/rendererreport.h"
 #include "ac/report/lttng/packetizerreport.h"
 #include "ac/report/lttng/senderreport.h"
+#include "ac/report/lttng/memoryreport.h"
+#include "ac/report/lttng/jitterbufferreport.h"
+#include "ac/report/lttng/thermalreport.h"
+#include "ac/report/lttng/perfcounterreport.h"
+#include "ac/report/lttng/lockreport.h"
 
 namespace ac {
 namespace report {
@@ -40,5 +45,28 @@ std::shared_ptr<video::SenderReport> LttngReportFactory::CreateSenderReport() {
     return std::make_shared<lttng::SenderReport>();
 }
 
+std::shared_ptr<video::MemoryReport> LttngReportFactory::CreateMemoryReport() {
+    return std::make_shared<lttng::MemoryReport>();
+}
+
+std::shared_ptr<video::JitterBufferReport> LttngReportFactory::CreateJitterBufferReport() {
+    return std::make_shared<lttng::JitterBufferReport>();
+}
+
+std::shared_ptr<video::ThermalReport> LttngReportFactory::CreateThermalReport() {
+    return std::make_shared<lttng::ThermalReport>();
+}
+
+std::shared_ptr<video::PerfCounterReport> LttngReportFactory::CreatePerfCounterReport() {
+    if (!PerfCountersEnabled())
+        return nullptr;
+
+    return std::make_shared<lttng::PerfCounterReport>();
+}
+
+std::shared_ptr<video::LockReport> LttngReportFactory::CreateLockReport() {
+    return std::make_shared<lttng::LockReport>();
+}
+
 } // namespace report
 } // namespace ac
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/memoryreport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/memoryreport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void MemoryReport::StageUsage(const std::string &stage, const size_t &bytes) {
+    ac_tracepoint(aethercast_memory, stage_usage, stage.c_str(), bytes);
+}
+
+void MemoryReport::PressureChanged(const int &level, const size_t &total, const size_t &limit) {
+    ac_tracepoint(aethercast_memory, pressure_changed, level, total, limit);
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_LTTNG_MEMORYREPORT_H_
+#define AC_REPORT_LTTNG_MEMORYREPORT_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/memoryreport.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+class MemoryReport : public video::MemoryReport {
+public:
+     void StageUsage(const std::string &stage, const size_t &bytes);
+     void PressureChanged(const int &level, const size_t &total, const size_t &limit);
+};
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
+
+#endif
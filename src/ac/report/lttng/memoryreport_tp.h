@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_memory
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/memoryreport_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_MEMORYREPORT_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_MEMORYREPORT_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
+
+#define ENCODER_TRACE_POINT(name) AC_LTTNG_VOID_TRACE_POINT(TRACEPOINT_PROVIDER, name)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    stage_usage,
+    TP_ARGS(const char*, stage, size_t, bytes),
+    TP_FIELDS(
+        ctf_string(stage, stage)
+        ctf_integer(size_t, bytes, bytes)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    pressure_changed,
+    TP_ARGS(int, level, size_t, total, size_t, limit),
+    TP_FIELDS(
+        ctf_integer(int, level, level)
+        ctf_integer(size_t, total, total)
+        ctf_integer(size_t, limit, limit)
+    )
+)
+
+#undef ENCODER_TRACE_POINT
+
+#endif
+
+#include <lttng/tracepoint-event.h>
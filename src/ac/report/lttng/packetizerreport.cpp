@@ -29,6 +29,18 @@ void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
     ac_tracepoint(aethercast_packetizer, packetized_frame, timestamp);
 }
 
+void PacketizerReport::PaddedFrame(const TimestampUs &timestamp, const size_t &padding, const size_t &total) {
+    ac_tracepoint(aethercast_packetizer, padded_frame, timestamp, padding, total);
+}
+
+void PacketizerReport::DroppedFrame(const TimestampUs &timestamp, const int &layer) {
+    ac_tracepoint(aethercast_packetizer, dropped_frame, timestamp, layer);
+}
+
+void PacketizerReport::FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level) {
+    ac_tracepoint(aethercast_packetizer, framerate_changed, framerate, drop_level);
+}
+
 } // namespace lttng
 } // namespace report
 } // namespace ac
@@ -32,6 +32,9 @@ namespace lttng {
 class PacketizerReport : public video::PacketizerReport {
 public:
      void PacketizedFrame(const ac::TimestampUs &timestamp);
+     void PaddedFrame(const ac::TimestampUs &timestamp, const size_t &padding, const size_t &total);
+    void DroppedFrame(const ac::TimestampUs &timestamp, const int &layer);
+    void FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level);
 };
 
 } // namespace lttng
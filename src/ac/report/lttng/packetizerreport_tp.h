@@ -39,6 +39,37 @@ TRACEPOINT_EVENT(
     )
 )
 
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    padded_frame,
+    TP_ARGS(int, timestamp, size_t, padding, size_t, total),
+    TP_FIELDS(
+        ctf_integer(int, timestamp, timestamp)
+        ctf_integer(size_t, padding, padding)
+        ctf_integer(size_t, total, total)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    dropped_frame,
+    TP_ARGS(int, timestamp, int, layer),
+    TP_FIELDS(
+        ctf_integer(int, timestamp, timestamp)
+        ctf_integer(int, layer, layer)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    framerate_changed,
+    TP_ARGS(unsigned int, framerate, unsigned int, drop_level),
+    TP_FIELDS(
+        ctf_integer(unsigned int, framerate, framerate)
+        ctf_integer(unsigned int, drop_level, drop_level)
+    )
+)
+
 #undef ENCODER_TRACE_POINT
 
 #endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/perfcounterreport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/perfcounterreport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void PerfCounterReport::CountersSampled(const std::string &stage, const std::uint64_t &iterations,
+                                        const std::int64_t &cycles, const std::int64_t &instructions,
+                                        const std::int64_t &cache_misses, const std::int64_t &branch_misses) {
+    ac_tracepoint(aethercast_perf_counter, counters_sampled, stage.c_str(), iterations,
+                  cycles, instructions, cache_misses, branch_misses);
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
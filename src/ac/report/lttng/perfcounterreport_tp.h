@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER aethercast_perf_counter
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ac/report/lttng/perfcounterreport_tp.h"
+
+#if !defined(AC_REPORT_LTTNG_PERFCOUNTERREPORT_TP_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define AC_REPORT_LTTNG_PERFCOUNTERREPORT_TP_H_
+
+#include "ac/report/lttng/utils.h"
+
+AC_LTTNG_VOID_TRACE_CLASS(TRACEPOINT_PROVIDER)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    counters_sampled,
+    TP_ARGS(const char*, stage, uint64_t, iterations, int64_t, cycles, int64_t, instructions,
+            int64_t, cache_misses, int64_t, branch_misses),
+    TP_FIELDS(
+        ctf_string(stage, stage)
+        ctf_integer(uint64_t, iterations, iterations)
+        ctf_integer(int64_t, cycles, cycles)
+        ctf_integer(int64_t, instructions, instructions)
+        ctf_integer(int64_t, cache_misses, cache_misses)
+        ctf_integer(int64_t, branch_misses, branch_misses)
+    )
+)
+
+#endif
+
+#include <lttng/tracepoint-event.h>
@@ -29,6 +29,15 @@ void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size)
     ac_tracepoint(aethercast_sender, sent_packet, timestamp, size);
 }
 
+void SenderReport::DroppedPacket(const TimestampUs &timestamp, const size_t &size) {
+    ac_tracepoint(aethercast_sender, dropped_packet, timestamp, size);
+}
+
+void SenderReport::TransmittedPacket(const TimestampUs &timestamp, const std::string &point,
+                                     const TimestampUs &delay) {
+    ac_tracepoint(aethercast_sender, transmitted_packet, timestamp, point.c_str(), delay);
+}
+
 } // namespace lttng
 } // namespace report
 } // namespace ac
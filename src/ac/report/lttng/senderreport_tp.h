@@ -40,6 +40,27 @@ TRACEPOINT_EVENT(
     )
 )
 
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    dropped_packet,
+    TP_ARGS(int64_t, timestamp, int, size),
+    TP_FIELDS(
+        ctf_integer(int64_t, timestamp, timestamp)
+        ctf_integer(int, size, size)
+    )
+)
+
+TRACEPOINT_EVENT(
+    TRACEPOINT_PROVIDER,
+    transmitted_packet,
+    TP_ARGS(int64_t, timestamp, const char*, point, int64_t, delay),
+    TP_FIELDS(
+        ctf_integer(int64_t, timestamp, timestamp)
+        ctf_string(point, point)
+        ctf_integer(int64_t, delay, delay)
+    )
+)
+
 #undef ENCODER_TRACE_POINT
 
 #endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/lttng/thermalreport.h"
+
+#define TRACEPOINT_DEFINE
+#define TRACEPOINT_PROBE_DYNAMIC_LINKAGE
+#include "ac/report/lttng/thermalreport_tp.h"
+
+namespace ac {
+namespace report {
+namespace lttng {
+
+void ThermalReport::TemperatureSampled(const std::string &zone, const int &temperature, const int &headroom) {
+    ac_tracepoint(aethercast_thermal, temperature_sampled, zone.c_str(), temperature, headroom);
+}
+
+void ThermalReport::LevelChanged(const int &level, const std::string &zone, const int &temperature) {
+    ac_tracepoint(aethercast_thermal, level_changed, level, zone.c_str(), temperature);
+}
+
+} // namespace lttng
+} // namespace report
+} // namespace ac
@@ -21,3 +21,8 @@
 #include "rendererreport_tp.h"
 #include "packetizerreport_tp.h"
 #include "senderreport_tp.h"
+#include "memoryreport_tp.h"
+#include "jitterbufferreport_tp.h"
+#include "thermalreport_tp.h"
+#include "perfcounterreport_tp.h"
+#include "lockreport_tp.h"
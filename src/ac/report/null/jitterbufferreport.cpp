@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/report/null/jitterbufferreport.h"
+
+namespace ac {
+namespace report {
+namespace null {
+
+void JitterBufferReport::DeliveredPacket(const uint16_t &sequence_number, const int64_t &playout_delay) {
+    boost::ignore_unused_variable_warning(sequence_number);
+    boost::ignore_unused_variable_warning(playout_delay);
+}
+
+void JitterBufferReport::LatePacket(const uint16_t &sequence_number) {
+    boost::ignore_unused_variable_warning(sequence_number);
+}
+
+void JitterBufferReport::DuplicatePacket(const uint16_t &sequence_number) {
+    boost::ignore_unused_variable_warning(sequence_number);
+}
+
+void JitterBufferReport::LostPackets(const uint16_t &first_sequence_number, const size_t &count) {
+    boost::ignore_unused_variable_warning(first_sequence_number);
+    boost::ignore_unused_variable_warning(count);
+}
+
+void JitterBufferReport::TargetDelayChanged(const int64_t &delay) {
+    boost::ignore_unused_variable_warning(delay);
+}
+
+} // namespace null
+} // namespace report
+} // namespace ac
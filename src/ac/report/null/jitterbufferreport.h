@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_NULL_JITTERBUFFERREPORT_H_
+#define AC_REPORT_NULL_JITTERBUFFERREPORT_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/jitterbufferreport.h"
+
+namespace ac {
+namespace report {
+namespace null {
+
+class JitterBufferReport : public video::JitterBufferReport {
+public:
+     void DeliveredPacket(const uint16_t &sequence_number, const int64_t &playout_delay);
+     void LatePacket(const uint16_t &sequence_number);
+     void DuplicatePacket(const uint16_t &sequence_number);
+     void LostPackets(const uint16_t &first_sequence_number, const size_t &count);
+     void TargetDelayChanged(const int64_t &delay);
+};
+
+} // namespace null
+} // namespace report
+} // namespace ac
+
+#endif
@@ -20,6 +20,10 @@
 #include "ac/report/null/rendererreport.h"
 #include "ac/report/null/packetizerreport.h"
 #include "ac/report/null/senderreport.h"
+#include "ac/report/null/memoryreport.h"
+#include "ac/report/null/jitterbufferreport.h"
+#include "ac/report/null/thermalreport.h"
+#include "ac/report/null/lockreport.h"
 
 namespace ac {
 namespace report {
@@ -40,5 +44,26 @@ std::shared_ptr<video::SenderReport> NullReportFactory::CreateSenderReport() {
     return std::make_shared<null::SenderReport>();
 }
 
+std::shared_ptr<video::MemoryReport> NullReportFactory::CreateMemoryReport() {
+    return std::make_shared<null::MemoryReport>();
+}
+
+std::shared_ptr<video::JitterBufferReport> NullReportFactory::CreateJitterBufferReport() {
+    return std::make_shared<null::JitterBufferReport>();
+}
+
+std::shared_ptr<video::ThermalReport> NullReportFactory::CreateThermalReport() {
+    return std::make_shared<null::ThermalReport>();
+}
+
+std::shared_ptr<video::PerfCounterReport> NullReportFactory::CreatePerfCounterReport() {
+    // Not worth the cost of reading the counters
+    return nullptr;
+}
+
+std::shared_ptr<video::LockReport> NullReportFactory::CreateLockReport() {
+    return std::make_shared<null::LockReport>();
+}
+
 } // namespace report
 } // namespace ac
@@ -27,6 +27,22 @@ void PacketizerReport::PacketizedFrame(const TimestampUs &timestamp) {
     boost::ignore_unused_variable_warning(timestamp);
 }
 
+void PacketizerReport::PaddedFrame(const TimestampUs &timestamp, const size_t &padding, const size_t &total) {
+    boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(padding);
+    boost::ignore_unused_variable_warning(total);
+}
+
+void PacketizerReport::DroppedFrame(const TimestampUs &timestamp, const int &layer) {
+    boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(layer);
+}
+
+void PacketizerReport::FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level) {
+    boost::ignore_unused_variable_warning(framerate);
+    boost::ignore_unused_variable_warning(drop_level);
+}
+
 } // namespace null
 } // namespace report
 } // namespace ac
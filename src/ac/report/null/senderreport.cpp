@@ -30,6 +30,18 @@ void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size)
     boost::ignore_unused_variable_warning(size);
 }
 
+void SenderReport::DroppedPacket(const TimestampUs &timestamp, const size_t &size) {
+    boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(size);
+}
+
+void SenderReport::TransmittedPacket(const TimestampUs &timestamp, const std::string &point,
+                                     const TimestampUs &delay) {
+    boost::ignore_unused_variable_warning(timestamp);
+    boost::ignore_unused_variable_warning(point);
+    boost::ignore_unused_variable_warning(delay);
+}
+
 } // namespace null
 } // namespace report
 } // namespace ac
@@ -32,6 +32,9 @@ namespace null {
 class SenderReport : public video::SenderReport {
 public:
     void SentPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    void DroppedPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    void TransmittedPacket(const ac::TimestampUs &timestamp, const std::string &point,
+                           const ac::TimestampUs &delay);
 };
 
 } // namespace null
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <boost/concept_check.hpp>
+
+#include "ac/report/null/thermalreport.h"
+
+namespace ac {
+namespace report {
+namespace null {
+
+void ThermalReport::TemperatureSampled(const std::string &zone, const int &temperature, const int &headroom) {
+    boost::ignore_unused_variable_warning(zone);
+    boost::ignore_unused_variable_warning(temperature);
+    boost::ignore_unused_variable_warning(headroom);
+}
+
+void ThermalReport::LevelChanged(const int &level, const std::string &zone, const int &temperature) {
+    boost::ignore_unused_variable_warning(level);
+    boost::ignore_unused_variable_warning(zone);
+    boost::ignore_unused_variable_warning(temperature);
+}
+
+} // namespace null
+} // namespace report
+} // namespace ac
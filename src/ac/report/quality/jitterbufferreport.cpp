@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/quality/jitterbufferreport.h"
+
+namespace ac {
+namespace report {
+namespace quality {
+
+JitterBufferReport::JitterBufferReport(const video::JitterBufferReport::Ptr &next,
+                                       const video::QualityEstimator::Ptr &estimator) :
+    next_(next),
+    estimator_(estimator) {
+}
+
+void JitterBufferReport::DeliveredPacket(const uint16_t &sequence_number, const int64_t &playout_delay) {
+    estimator_->PacketsDelivered(1);
+    next_->DeliveredPacket(sequence_number, playout_delay);
+}
+
+void JitterBufferReport::LatePacket(const uint16_t &sequence_number) {
+    // Already accounted as lost when its slot was skipped
+    next_->LatePacket(sequence_number);
+}
+
+void JitterBufferReport::DuplicatePacket(const uint16_t &sequence_number) {
+    next_->DuplicatePacket(sequence_number);
+}
+
+void JitterBufferReport::LostPackets(const uint16_t &first_sequence_number, const size_t &count) {
+    estimator_->PacketsLost(count);
+    next_->LostPackets(first_sequence_number, count);
+}
+
+void JitterBufferReport::TargetDelayChanged(const int64_t &delay) {
+    next_->TargetDelayChanged(delay);
+}
+
+} // namespace quality
+} // namespace report
+} // namespace ac
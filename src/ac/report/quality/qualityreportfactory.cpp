@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/quality/qualityreportfactory.h"
+#include "ac/report/quality/senderreport.h"
+#include "ac/report/quality/jitterbufferreport.h"
+
+namespace ac {
+namespace report {
+
+QualityReportFactory::QualityReportFactory(const ReportFactory::Ptr &next,
+                                           const video::QualityEstimator::Ptr &estimator) :
+    next_(next),
+    estimator_(estimator) {
+}
+
+std::shared_ptr<video::EncoderReport> QualityReportFactory::CreateEncoderReport() {
+    return next_->CreateEncoderReport();
+}
+
+std::shared_ptr<video::RendererReport> QualityReportFactory::CreateRendererReport() {
+    return next_->CreateRendererReport();
+}
+
+std::shared_ptr<video::PacketizerReport> QualityReportFactory::CreatePacketizerReport() {
+    return next_->CreatePacketizerReport();
+}
+
+std::shared_ptr<video::SenderReport> QualityReportFactory::CreateSenderReport() {
+    return std::make_shared<quality::SenderReport>(next_->CreateSenderReport(), estimator_);
+}
+
+std::shared_ptr<video::MemoryReport> QualityReportFactory::CreateMemoryReport() {
+    return next_->CreateMemoryReport();
+}
+
+std::shared_ptr<video::JitterBufferReport> QualityReportFactory::CreateJitterBufferReport() {
+    return std::make_shared<quality::JitterBufferReport>(next_->CreateJitterBufferReport(), estimator_);
+}
+
+std::shared_ptr<video::ThermalReport> QualityReportFactory::CreateThermalReport() {
+    return next_->CreateThermalReport();
+}
+
+std::shared_ptr<video::PerfCounterReport> QualityReportFactory::CreatePerfCounterReport() {
+    return next_->CreatePerfCounterReport();
+}
+
+std::shared_ptr<video::LockReport> QualityReportFactory::CreateLockReport() {
+    return next_->CreateLockReport();
+}
+
+} // namespace report
+} // namespace ac
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_QUALITYREPORTFACTORY_H_
+#define AC_REPORT_QUALITYREPORTFACTORY_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+
+#include "ac/report/reportfactory.h"
+
+#include "ac/video/qualityestimator.h"
+
+namespace ac {
+namespace report {
+
+// Hands out the reports of another factory with those events the
+// quality estimator is interested in also forwarded to it.
+class QualityReportFactory : public ReportFactory {
+public:
+    QualityReportFactory(const ReportFactory::Ptr &next,
+                         const video::QualityEstimator::Ptr &estimator);
+
+    std::shared_ptr<video::EncoderReport> CreateEncoderReport();
+    std::shared_ptr<video::RendererReport> CreateRendererReport();
+    std::shared_ptr<video::PacketizerReport> CreatePacketizerReport();
+    std::shared_ptr<video::SenderReport> CreateSenderReport();
+    std::shared_ptr<video::MemoryReport> CreateMemoryReport();
+    std::shared_ptr<video::JitterBufferReport> CreateJitterBufferReport();
+    std::shared_ptr<video::ThermalReport> CreateThermalReport();
+    std::shared_ptr<video::PerfCounterReport> CreatePerfCounterReport();
+    std::shared_ptr<video::LockReport> CreateLockReport();
+
+private:
+    ReportFactory::Ptr next_;
+    video::QualityEstimator::Ptr estimator_;
+};
+
+} // namespace report
+} // namespace ac
+
+#endif
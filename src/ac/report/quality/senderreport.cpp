@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/report/quality/senderreport.h"
+
+namespace ac {
+namespace report {
+namespace quality {
+
+SenderReport::SenderReport(const video::SenderReport::Ptr &next,
+                           const video::QualityEstimator::Ptr &estimator) :
+    next_(next),
+    estimator_(estimator) {
+}
+
+void SenderReport::SentPacket(const TimestampUs &timestamp, const size_t &size) {
+    estimator_->PacketSent(timestamp, size);
+    // Packets dropped on send timeouts only make up a loss rate together
+    // with the ones which got out.
+    estimator_->PacketsDelivered(1);
+    next_->SentPacket(timestamp, size);
+}
+
+void SenderReport::DroppedPacket(const TimestampUs &timestamp, const size_t &size) {
+    estimator_->PacketsLost(1);
+    next_->DroppedPacket(timestamp, size);
+}
+
+void SenderReport::TransmittedPacket(const TimestampUs &timestamp, const std::string &point,
+                                     const TimestampUs &delay) {
+    next_->TransmittedPacket(timestamp, point, delay);
+}
+
+} // namespace quality
+} // namespace report
+} // namespace ac
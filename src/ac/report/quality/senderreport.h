@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_REPORT_QUALITY_SENDERREPORT_H_
+#define AC_REPORT_QUALITY_SENDERREPORT_H_
+
+#include <memory>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/qualityestimator.h"
+#include "ac/video/senderreport.h"
+
+namespace ac {
+namespace report {
+namespace quality {
+
+class SenderReport : public video::SenderReport {
+public:
+    SenderReport(const video::SenderReport::Ptr &next,
+                 const video::QualityEstimator::Ptr &estimator);
+
+    void SentPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    void DroppedPacket(const ac::TimestampUs &timestamp, const size_t &size);
+    void TransmittedPacket(const ac::TimestampUs &timestamp, const std::string &point,
+                           const ac::TimestampUs &delay);
+
+private:
+    video::SenderReport::Ptr next_;
+    video::QualityEstimator::Ptr estimator_;
+};
+
+} // namespace quality
+} // namespace report
+} // namespace ac
+
+#endif
@@ -36,5 +36,9 @@ ReportFactory::Ptr ReportFactory::Create() {
     return std::make_shared<NullReportFactory>();
 }
 
+bool ReportFactory::PerfCountersEnabled() {
+    return ac::Utils::GetEnvValue("AETHERCAST_REPORT_PERF_COUNTERS") == "1";
+}
+
 } // namespace report
 } // namespace ac
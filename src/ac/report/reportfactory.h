@@ -26,6 +26,11 @@
 #include "ac/video/rendererreport.h"
 #include "ac/video/packetizerreport.h"
 #include "ac/video/senderreport.h"
+#include "ac/video/memoryreport.h"
+#include "ac/video/jitterbufferreport.h"
+#include "ac/video/thermalreport.h"
+#include "ac/video/perfcounterreport.h"
+#include "ac/video/lockreport.h"
 
 namespace ac {
 namespace report {
@@ -36,10 +41,21 @@ public:
 
     static Ptr Create();
 
+    // Reading hardware performance counters costs two system calls per
+    // iteration of every pipeline stage so they are only sampled with
+    // AETHERCAST_REPORT_PERF_COUNTERS=1 set.
+    static bool PerfCountersEnabled();
+
     virtual video::EncoderReport::Ptr CreateEncoderReport() = 0;
     virtual video::RendererReport::Ptr CreateRendererReport() = 0;
     virtual video::PacketizerReport::Ptr CreatePacketizerReport() = 0;
     virtual video::SenderReport::Ptr CreateSenderReport() = 0;
+    virtual video::MemoryReport::Ptr CreateMemoryReport() = 0;
+    virtual video::JitterBufferReport::Ptr CreateJitterBufferReport() = 0;
+    virtual video::ThermalReport::Ptr CreateThermalReport() = 0;
+    // Returns nullptr if performance counters should not be sampled
+    virtual video::PerfCounterReport::Ptr CreatePerfCounterReport() = 0;
+    virtual video::LockReport::Ptr CreateLockReport() = 0;
 };
 
 } // namespace report
@@ -18,9 +18,12 @@
 #include <csignal>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
 
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <signal.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -33,17 +36,35 @@
 #include "ac/config.h"
 #include "ac/keep_alive.h"
 #include "ac/logger.h"
+#include "ac/mainloopmonitor.h"
+#include "ac/mediamanagerfactory.h"
 #include "ac/service.h"
 #include "ac/networkmanagerfactory.h"
 #include "ac/types.h"
 #include "ac/logger.h"
 
+#include "ac/common/threadedexecutor.h"
+
+#include "ac/network/tcpstream.h"
+
+#include "ac/report/reportfactory.h"
+
+#include "ac/uibc/inputchannel.h"
+
+#include "ac/video/thermalgovernor.h"
+
 #include "ac/dbus/controllerskeleton.h"
 
 namespace {
 // TODO(morphis, tvoss): Expose the port as a construction-time parameter.
 const std::uint16_t kMiracastDefaultRtspCtrlPort{7236};
+// The RTSP implementation doesn't negotiate the UIBC port (yet) so the
+// remote is expected to listen on this one.
+const std::uint16_t kMiracastDefaultUibcPort{7239};
 const std::chrono::milliseconds kStateIdleTimeout{5000};
+// Temperatures change slowly; reading a handful of sysfs files every
+// few seconds is plenty to react before the kernel throttles us.
+const std::chrono::seconds kThermalPollInterval{2};
 const std::chrono::seconds kShutdownGracePreriod{1};
 const std::int16_t kProcessPriorityUrgentDisplay{-8};
 
@@ -165,9 +186,14 @@ int Service::Main(const Service::MainOptions &options) {
 
             service = ac::Service::Create();
             controller_skeleton = ac::dbus::ControllerSkeleton::Create(service);
+
+            // Everything from here on runs from the main loop; keep an
+            // eye on callbacks blocking it.
+            ac::MainLoopMonitor::Instance()->Start();
         }
 
         ~Runtime() {
+            ac::MainLoopMonitor::Instance()->Stop();
             g_main_loop_unref(ml);
         }
 
@@ -194,18 +220,23 @@ Service::Service() :
     current_state_(kIdle),
     scan_timeout_source_(0),
     supported_roles_({kSource}),
-    enabled_(false) {
+    enabled_(false),
+    thermal_timeout_source_(0) {
 
     CreateRuntimeDirectory();
 }
 
 std::shared_ptr<Service> Service::FinalizeConstruction() {
     system_controller_ = ac::SystemController::CreatePlatformDefault();
+    MediaManagerFactory::SetSystemController(system_controller_);
 
     network_manager_ = ac::NetworkManagerFactory::Create();
     network_manager_->SetDelegate(this);
     network_manager_->SetCapabilities({NetworkManager::Capability::kSource});
 
+    ac::video::ThermalGovernor::Instance()->SetReport(
+                ac::report::ReportFactory::Create()->CreateThermalReport());
+
     LoadState();
 
     return shared_from_this();
@@ -214,6 +245,8 @@ std::shared_ptr<Service> Service::FinalizeConstruction() {
 Service::~Service() {
     if (scan_timeout_source_ > 0)
         g_source_remove(scan_timeout_source_);
+
+    StopThermalMonitoring();
 }
 
 void Service::CreateRuntimeDirectory() {
@@ -309,6 +342,11 @@ Error Service::SetEnabledInternal(bool enabled, bool no_save) {
     else if (!enabled && !ReleaseNetworkManager())
         return Error::kFailed;
 
+    // Resources kept around for the next session are only worth
+    // having while we can get connected at all.
+    if (!enabled)
+        MediaManagerFactory::ReleaseSourceResources();
+
     enabled_ = enabled;
 
     if (!no_save)
@@ -320,6 +358,73 @@ Error Service::SetEnabledInternal(bool enabled, bool no_save) {
     return Error::kNone;
 }
 
+Error Service::RegisterInputProvider(const InputProvider::Ptr &provider) {
+    if (!provider)
+        return Error::kParamInvalid;
+
+    if (input_provider_)
+        return Error::kAlready;
+
+    input_provider_ = provider;
+
+    if (current_state_ == kConnected)
+        StartInput();
+
+    return Error::kNone;
+}
+
+Error Service::UnregisterInputProvider(const InputProvider::Ptr &provider) {
+    if (!provider || provider != input_provider_)
+        return Error::kParamInvalid;
+
+    StopInput();
+
+    input_provider_->Release();
+    input_provider_.reset();
+
+    return Error::kNone;
+}
+
+void Service::StartInput() {
+    if (!input_provider_ || !current_device_ || input_executor_)
+        return;
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        AC_ERROR("Failed to create input socket: %s (%d)", ::strerror(errno), errno);
+        return;
+    }
+
+    // Reading the events and talking to the remote happens on a thread
+    // of its own; the channel connects once it runs.
+    const auto channel = ac::uibc::InputChannel::Create(fds[0],
+                std::make_shared<ac::network::TcpStream>(),
+                current_device_->IPv4Address().to_string(), kMiracastDefaultUibcPort);
+
+    input_executor_ = std::make_shared<ac::common::ThreadedExecutor>(channel);
+    input_executor_->Start();
+
+    const auto device = current_device_;
+    input_provider_->NewConnection(device, fds[1], [device](const Error &error) {
+        if (error != Error::kNone)
+            AC_WARNING("Input provider rejected connection with %s: %s",
+                       device->Address(), ac::ErrorToString(error));
+    });
+
+    ::close(fds[1]);
+}
+
+void Service::StopInput() {
+    if (!input_executor_)
+        return;
+
+    if (input_provider_ && current_device_)
+        input_provider_->RequestDisconnection(current_device_);
+
+    input_executor_->Stop();
+    input_executor_.reset();
+}
+
 void Service::OnClientDisconnected() {
     g_timeout_add(0, [](gpointer user_data) {
         auto thiz = static_cast<WeakKeepAlive<Service>*>(user_data)->GetInstance().lock();
@@ -340,6 +445,12 @@ void Service::AdvanceState(NetworkDeviceState new_state) {
 
     switch (new_state) {
     case kAssociation:
+        // Get the expensive parts of a session ready while the group
+        // is formed rather than during the RTSP negotiation.
+        MediaManagerFactory::PrewarmSource();
+        // The formats we offer depend on the thermal level so it has to
+        // be current before the negotiation starts.
+        StartThermalMonitoring();
         break;
 
     case kConfiguration:
@@ -348,6 +459,7 @@ void Service::AdvanceState(NetworkDeviceState new_state) {
     case kConnected:
         source_ = SourceManager::Create(network_manager_->LocalAddress(), kMiracastDefaultRtspCtrlPort);
         source_->SetDelegate(shared_from_this());
+        StartInput();
         FinishConnectAttempt();
         break;
 
@@ -355,6 +467,8 @@ void Service::AdvanceState(NetworkDeviceState new_state) {
         FinishConnectAttempt(Error::kFailed);
 
     case kDisconnected:
+        StopInput();
+        StopThermalMonitoring();
         source_.reset();
         current_device_.reset();
 
@@ -440,6 +554,39 @@ void Service::StartIdleTimer() {
                   new SharedKeepAlive<Service>{shared_from_this()});
 }
 
+gboolean Service::OnThermalTimer(gpointer user_data) {
+    auto thiz = static_cast<WeakKeepAlive<Service>*>(user_data)->GetInstance().lock();
+    if (!thiz)
+        return FALSE;
+
+    ac::video::ThermalGovernor::Instance()->Update();
+    return TRUE;
+}
+
+void Service::StartThermalMonitoring() {
+    if (thermal_timeout_source_ > 0)
+        return;
+
+    if (!ac::video::ThermalGovernor::Instance()->Update()) {
+        AC_DEBUG("No thermal zones available; not monitoring temperatures");
+        return;
+    }
+
+    thermal_timeout_source_ = g_timeout_add_seconds_full(G_PRIORITY_DEFAULT,
+           kThermalPollInterval.count(),
+           &Service::OnThermalTimer,
+           new WeakKeepAlive<Service>(shared_from_this()),
+           [](gpointer data) { delete static_cast<WeakKeepAlive<Service>*>(data); });
+}
+
+void Service::StopThermalMonitoring() {
+    if (thermal_timeout_source_ == 0)
+        return;
+
+    g_source_remove(thermal_timeout_source_);
+    thermal_timeout_source_ = 0;
+}
+
 void Service::FinishConnectAttempt(ac::Error error) {
     if (connect_callback_)
         connect_callback_(error);
@@ -26,6 +26,7 @@
 
 #include "ac/glib_wrapper.h"
 #include "ac/controller.h"
+#include "ac/inputprovider.h"
 #include "ac/sourcemanager.h"
 #include "ac/networkmanager.h"
 #include "ac/networkdevice.h"
@@ -33,6 +34,8 @@
 #include "ac/types.h"
 #include "ac/systemcontroller.h"
 
+#include "ac/common/executor.h"
+
 namespace ac {
 class Service : public Controller,
                 public std::enable_shared_from_this<Service>,
@@ -74,6 +77,9 @@ public:
 
     Error SetEnabled(bool enabled) override;
 
+    Error RegisterInputProvider(const InputProvider::Ptr &provider) override;
+    Error UnregisterInputProvider(const InputProvider::Ptr &provider) override;
+
     void OnClientDisconnected();
 
     bool SetupNetworkManager();
@@ -89,6 +95,7 @@ public:
 
 private:
     static gboolean OnIdleTimer(gpointer user_data);
+    static gboolean OnThermalTimer(gpointer user_data);
 
 private:
     Service();
@@ -109,6 +116,12 @@ private:
 
     bool IsConnecting() const;
 
+    void StartInput();
+    void StopInput();
+
+    void StartThermalMonitoring();
+    void StopThermalMonitoring();
+
 private:
     std::weak_ptr<Controller::Delegate> delegate_;
     std::shared_ptr<NetworkManager> network_manager_;
@@ -121,6 +134,9 @@ private:
     std::vector<NetworkDeviceRole> supported_roles_;
     ac::SystemController::Ptr system_controller_;
     bool enabled_;
+    InputProvider::Ptr input_provider_;
+    ac::common::Executor::Ptr input_executor_;
+    guint thermal_timeout_source_;
 };
 } // namespace ac
 #endif
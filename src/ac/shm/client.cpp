@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "ac/logger.h"
+
+#include "ac/shm/client.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_LINUX_SPECIFIC_BASE 1024
+#define F_ADD_SEALS (F_LINUX_SPECIFIC_BASE + 9)
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+namespace {
+static constexpr int kWelcomeTimeoutMs{5000};
+static constexpr unsigned int kBytesPerPixel{4};
+
+// Older C libraries don't come with a wrapper for memfd_create
+int CreateMemFd(const char *name, unsigned int flags) {
+    return ::syscall(__NR_memfd_create, name, flags);
+}
+}
+
+namespace ac {
+namespace shm {
+
+Client::Ptr Client::Connect(const std::string &socket_path, unsigned int width, unsigned int height,
+                            unsigned int slot_count) {
+    if (slot_count == 0 || slot_count > protocol::kMaxSlots)
+        return nullptr;
+
+    auto client = std::shared_ptr<Client>(new Client(width, height, slot_count));
+    if (!client->AllocateMemory() || !client->Handshake(socket_path))
+        return nullptr;
+
+    return client;
+}
+
+Client::Client(unsigned int width, unsigned int height, unsigned int slot_count) :
+    width_(width),
+    height_(height),
+    stride_(width * kBytesPerPixel),
+    slot_count_(slot_count),
+    slot_size_(stride_ * height),
+    socket_(-1),
+    memory_fd_(-1),
+    memory_(nullptr),
+    slot_in_use_(slot_count, false) {
+}
+
+Client::~Client() {
+    if (socket_ >= 0)
+        ::close(socket_);
+
+    if (memory_)
+        ::munmap(memory_, slot_size_ * slot_count_);
+
+    if (memory_fd_ >= 0)
+        ::close(memory_fd_);
+}
+
+bool Client::AllocateMemory() {
+    const auto size = slot_size_ * slot_count_;
+
+    memory_fd_ = CreateMemFd("aethercast-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memory_fd_ < 0) {
+        AC_ERROR("Failed to create memfd: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    if (::ftruncate(memory_fd_, size) < 0) {
+        AC_ERROR("Failed to resize memfd: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    if (::fcntl(memory_fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        AC_ERROR("Failed to seal memfd: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    auto memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd_, 0);
+    if (memory == MAP_FAILED) {
+        AC_ERROR("Failed to map memfd: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    memory_ = reinterpret_cast<std::uint8_t*>(memory);
+
+    return true;
+}
+
+bool Client::Handshake(const std::string &socket_path) {
+    struct sockaddr_un addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (socket_path.length() >= sizeof(addr.sun_path))
+        return false;
+
+    ::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    socket_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (socket_ < 0) {
+        AC_ERROR("Failed to create socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    if (::connect(socket_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_ERROR("Failed to connect to %s: %s (%d)", socket_path, ::strerror(errno), errno);
+        return false;
+    }
+
+    protocol::Hello hello;
+    hello.type = protocol::MessageType::kHello;
+    hello.magic = protocol::kMagic;
+    hello.version = protocol::kVersion;
+    hello.memory = protocol::MemoryType::kMemFd;
+    hello.format = protocol::PixelFormat::kRGBA8888;
+    hello.width = width_;
+    hello.height = height_;
+    hello.stride = stride_;
+    hello.slot_count = slot_count_;
+    hello.slot_size = slot_size_;
+
+    if (!protocol::Send(socket_, &hello, sizeof(hello), memory_fd_))
+        return false;
+
+    protocol::Welcome welcome;
+    if (protocol::Receive(socket_, &welcome, sizeof(welcome), kWelcomeTimeoutMs) != sizeof(welcome) ||
+            welcome.type != protocol::MessageType::kWelcome || !welcome.accepted) {
+        AC_ERROR("Producer didn't accept our buffers");
+        return false;
+    }
+
+    return true;
+}
+
+int Client::DequeueSlot(int timeout_ms) {
+    while (true) {
+        for (unsigned int n = 0; n < slot_count_; n++) {
+            if (!slot_in_use_[n])
+                return n;
+        }
+
+        protocol::Frame message;
+        const auto size = protocol::Receive(socket_, &message, sizeof(message), timeout_ms);
+        if (size <= 0)
+            return -1;
+
+        if (size == sizeof(message) && message.type == protocol::MessageType::kFrameReleased &&
+                message.slot < slot_count_)
+            slot_in_use_[message.slot] = false;
+    }
+}
+
+bool Client::QueueSlot(int slot, ac::TimestampUs timestamp) {
+    if (slot < 0 || static_cast<unsigned int>(slot) >= slot_count_ || slot_in_use_[slot])
+        return false;
+
+    protocol::Frame message;
+    message.type = protocol::MessageType::kFrameReady;
+    message.slot = slot;
+    message.timestamp = timestamp;
+
+    if (!protocol::Send(socket_, &message, sizeof(message)))
+        return false;
+
+    slot_in_use_[slot] = true;
+
+    return true;
+}
+
+std::uint8_t* Client::SlotData(int slot) const {
+    if (slot < 0 || static_cast<unsigned int>(slot) >= slot_count_)
+        return nullptr;
+
+    return memory_ + slot * slot_size_;
+}
+
+unsigned int Client::Stride() const {
+    return stride_;
+}
+
+} // namespace shm
+} // namespace ac
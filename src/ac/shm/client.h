@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_SHM_CLIENT_H_
+#define AC_SHM_CLIENT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/shm/protocol.h"
+
+namespace ac {
+namespace shm {
+
+/**
+ * @brief Reference implementation of the client side of the shared
+ * memory protocol.
+ *
+ * Allocates a sealed memfd with the requested number of RGBA slots and
+ * passes it to the producer on connect. Frames are rendered straight
+ * into the slot memory and then handed over with QueueSlot().
+ */
+class Client : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<Client> Ptr;
+
+    static constexpr unsigned int kDefaultSlotCount{3};
+
+    static Ptr Connect(const std::string &socket_path, unsigned int width, unsigned int height,
+                       unsigned int slot_count = kDefaultSlotCount);
+
+    ~Client();
+
+    // Returns a slot which isn't used by the producer anymore waiting
+    // at most timeout_ms for one to be released. Returns -1 if there is
+    // none or the connection is gone.
+    int DequeueSlot(int timeout_ms);
+    bool QueueSlot(int slot, ac::TimestampUs timestamp);
+
+    std::uint8_t* SlotData(int slot) const;
+    unsigned int Stride() const;
+
+private:
+    Client(unsigned int width, unsigned int height, unsigned int slot_count);
+
+    bool AllocateMemory();
+    bool Handshake(const std::string &socket_path);
+
+private:
+    unsigned int width_;
+    unsigned int height_;
+    unsigned int stride_;
+    unsigned int slot_count_;
+    std::size_t slot_size_;
+    int socket_;
+    int memory_fd_;
+    std::uint8_t *memory_;
+    std::vector<bool> slot_in_use_;
+};
+
+} // namespace shm
+} // namespace ac
+
+#endif
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <ratio>
+
+#include "ac/logger.h"
+
+#include "ac/shm/producer.h"
+
+#ifndef F_GET_SEALS
+#define F_LINUX_SPECIFIC_BASE 1024
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#define F_SEAL_SHRINK 0x0002
+#endif
+
+#ifndef DMA_BUF_MAGIC
+#define DMA_BUF_MAGIC 0x444d4142
+#endif
+
+namespace {
+static constexpr int kClientTimeoutMs{10000};
+// If the client doesn't deliver a new frame in time we just continue
+// with the one we already have like a compositor without any damage.
+static constexpr int kFrameTimeoutMs{50};
+static constexpr unsigned int kBytesPerPixel{4};
+}
+
+namespace ac {
+namespace shm {
+
+Producer::Ptr Producer::Create(const std::string &socket_path) {
+    return std::shared_ptr<Producer>(new Producer(socket_path));
+}
+
+Producer::Producer(const std::string &socket_path) :
+    socket_path_(socket_path),
+    listen_socket_(-1),
+    client_socket_(-1),
+    memory_(nullptr),
+    memory_size_(0),
+    current_slot_(-1) {
+}
+
+Producer::~Producer() {
+    Disconnect();
+    StopListening();
+
+    if (memory_)
+        ::munmap(memory_, memory_size_);
+}
+
+bool Producer::Setup(const video::DisplayOutput &output) {
+    if (client_socket_ >= 0 || memory_)
+        return false;
+
+    const auto accepted = Listen() && AcceptClient();
+
+    // We only ever serve a single client
+    StopListening();
+
+    if (!accepted)
+        return false;
+
+    if (!Handshake(output)) {
+        Disconnect();
+        return false;
+    }
+
+    output_ = output;
+
+    AC_DEBUG("Client connected with %d buffer slots [%dx%d]",
+             slots_.size(), output_.width, output_.height);
+
+    return true;
+}
+
+bool Producer::Listen() {
+    struct sockaddr_un addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (socket_path_.length() >= sizeof(addr.sun_path)) {
+        AC_ERROR("Socket path %s is too long", socket_path_);
+        return false;
+    }
+
+    ::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_socket_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_socket_ < 0) {
+        AC_ERROR("Failed to create socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    // Remove any leftover from a previous instance
+    ::unlink(socket_path_.c_str());
+
+    if (::bind(listen_socket_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_ERROR("Failed to bind socket to %s: %s (%d)", socket_path_, ::strerror(errno), errno);
+        return false;
+    }
+
+    if (::listen(listen_socket_, 1) < 0) {
+        AC_ERROR("Failed to listen on socket: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    return true;
+}
+
+bool Producer::AcceptClient() {
+    struct pollfd pfd;
+    pfd.fd = listen_socket_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (::poll(&pfd, 1, kClientTimeoutMs) <= 0) {
+        AC_ERROR("No client connected to %s", socket_path_);
+        return false;
+    }
+
+    client_socket_ = ::accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client_socket_ < 0) {
+        AC_ERROR("Failed to accept client: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    // Only processes running as the same user (or root) are allowed
+    // to feed us with frames.
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(client_socket_, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0 ||
+            (credentials.uid != ::getuid() && credentials.uid != 0)) {
+        AC_ERROR("Rejecting client without sufficient permissions");
+        Disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+bool Producer::Handshake(const video::DisplayOutput &output) {
+    protocol::Hello hello;
+    int fd = -1;
+
+    if (protocol::Receive(client_socket_, &hello, sizeof(hello), kClientTimeoutMs, &fd) != sizeof(hello) ||
+            hello.type != protocol::MessageType::kHello ||
+            hello.magic != protocol::kMagic) {
+        AC_ERROR("Client didn't introduce itself");
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    bool accepted = false;
+
+    if (hello.version != protocol::kVersion)
+        AC_ERROR("Unsupported protocol version %d", hello.version);
+    else if (fd < 0)
+        AC_ERROR("Client didn't pass any memory");
+    else if (hello.format != protocol::PixelFormat::kRGBA8888)
+        AC_ERROR("Unsupported pixel format %d", static_cast<int>(hello.format));
+    else if (hello.width != output.width || hello.height != output.height)
+        AC_ERROR("Client frame size %dx%d doesn't match output %dx%d",
+                 hello.width, hello.height, output.width, output.height);
+    else if (hello.slot_count == 0 || hello.slot_count > protocol::kMaxSlots)
+        AC_ERROR("Invalid number of buffer slots %d", hello.slot_count);
+    else if (hello.stride < hello.width * kBytesPerPixel ||
+             static_cast<std::uint64_t>(hello.stride) * hello.height > hello.slot_size)
+        AC_ERROR("Invalid buffer layout (stride %d slot size %d)", hello.stride, hello.slot_size);
+    else
+        accepted = MapMemory(fd, hello);
+
+    if (fd >= 0)
+        ::close(fd);
+
+    protocol::Welcome welcome;
+    welcome.type = protocol::MessageType::kWelcome;
+    welcome.accepted = accepted ? 1 : 0;
+
+    if (!protocol::Send(client_socket_, &welcome, sizeof(welcome)))
+        return false;
+
+    return accepted;
+}
+
+bool Producer::MapMemory(int fd, const protocol::Hello &hello) {
+    const std::uint64_t required_size = static_cast<std::uint64_t>(hello.slot_count) * hello.slot_size;
+    std::uint64_t size = 0;
+
+    switch (hello.memory) {
+    case protocol::MemoryType::kMemFd: {
+        // Without a seal the client could shrink the file any time and
+        // we would get a SIGBUS when touching the truncated pages.
+        const auto seals = ::fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+            AC_ERROR("Client memory isn't sealed against shrinking");
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) < 0)
+            return false;
+
+        size = st.st_size;
+        break;
+    }
+    case protocol::MemoryType::kDmaBuf: {
+        // The size of a dmabuf is fixed by the exporter.
+        struct statfs fs;
+        if (::fstatfs(fd, &fs) < 0 || static_cast<unsigned long>(fs.f_type) != DMA_BUF_MAGIC) {
+            AC_ERROR("Client memory isn't a dmabuf");
+            return false;
+        }
+
+        const auto end = ::lseek(fd, 0, SEEK_END);
+        if (end < 0)
+            return false;
+
+        size = end;
+        break;
+    }
+    default:
+        AC_ERROR("Unsupported memory type %d", static_cast<int>(hello.memory));
+        return false;
+    }
+
+    if (size < required_size) {
+        AC_ERROR("Client memory is too small (%d < %d)", size, required_size);
+        return false;
+    }
+
+    auto memory = ::mmap(nullptr, required_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        AC_ERROR("Failed to map client memory: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    memory_ = reinterpret_cast<std::uint8_t*>(memory);
+    memory_size_ = required_size;
+
+    for (unsigned int n = 0; n < hello.slot_count; n++) {
+        Frame frame;
+        frame.slot = n;
+        frame.data = memory_ + n * hello.slot_size;
+        frame.width = hello.width;
+        frame.height = hello.height;
+        frame.stride = hello.stride;
+        frame.format = hello.format;
+        frame.timestamp = 0;
+        slots_.push_back(frame);
+    }
+
+    return true;
+}
+
+void Producer::SwapBuffers() {
+    if (client_socket_ < 0)
+        return;
+
+    int next_slot = -1;
+    int timeout = kFrameTimeoutMs;
+
+    // Only the most recent frame is of interest to us. Everything the
+    // client queued before is handed back right away.
+    while (true) {
+        protocol::Frame message;
+        const auto size = protocol::Receive(client_socket_, &message, sizeof(message), timeout);
+        if (size == 0)
+            break;
+        else if (size < 0) {
+            AC_WARNING("Client disconnected");
+            Disconnect();
+            break;
+        }
+
+        timeout = 0;
+
+        if (size != sizeof(message) || message.type != protocol::MessageType::kFrameReady ||
+                message.slot >= slots_.size() ||
+                static_cast<int>(message.slot) == current_slot_ ||
+                static_cast<int>(message.slot) == next_slot) {
+            AC_WARNING("Ignoring invalid message from client");
+            continue;
+        }
+
+        if (next_slot >= 0)
+            ReleaseSlot(next_slot);
+
+        next_slot = message.slot;
+        slots_[next_slot].timestamp = message.timestamp;
+    }
+
+    if (next_slot < 0)
+        return;
+
+    if (current_slot_ >= 0)
+        ReleaseSlot(current_slot_);
+
+    current_slot_ = next_slot;
+}
+
+void Producer::ReleaseSlot(unsigned int slot) {
+    if (client_socket_ < 0)
+        return;
+
+    protocol::Frame message;
+    message.type = protocol::MessageType::kFrameReleased;
+    message.slot = slot;
+    message.timestamp = slots_[slot].timestamp;
+
+    protocol::Send(client_socket_, &message, sizeof(message));
+}
+
+void Producer::StopListening() {
+    if (listen_socket_ < 0)
+        return;
+
+    ::close(listen_socket_);
+    listen_socket_ = -1;
+
+    ::unlink(socket_path_.c_str());
+}
+
+void Producer::Disconnect() {
+    if (client_socket_ < 0)
+        return;
+
+    ::close(client_socket_);
+    client_socket_ = -1;
+}
+
+void* Producer::CurrentBuffer() const {
+    if (current_slot_ < 0)
+        return nullptr;
+
+    return const_cast<Frame*>(&slots_[current_slot_]);
+}
+
+video::Buffer::Ptr Producer::CreateBuffer() const {
+    if (current_slot_ < 0)
+        return video::Buffer::Create(nullptr);
+
+    // The slot is only given back to the client once the frame after it
+    // became current and stays mapped for as long as we are around.
+    const auto &frame = slots_[current_slot_];
+    return video::Buffer::Create(const_cast<Frame*>(&frame), frame.data, frame.stride * frame.height);
+}
+
+video::DisplayOutput Producer::OutputMode() const {
+    return output_;
+}
+
+ac::TimestampUs Producer::CurrentTimestamp() const {
+    if (current_slot_ < 0)
+        return 0;
+
+    // Clients capture in the CLOCK_MONOTONIC domain as we do
+    return slots_[current_slot_].timestamp;
+}
+
+ac::TimestampUs Producer::RefreshInterval() const {
+    if (output_.refresh_rate <= 0)
+        return 0;
+
+    return static_cast<ac::TimestampUs>(std::micro::den / output_.refresh_rate);
+}
+
+} // namespace shm
+} // namespace ac
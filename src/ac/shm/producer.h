@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_SHM_PRODUCER_H_
+#define AC_SHM_PRODUCER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ac/utils.h"
+
+#include "ac/video/bufferproducer.h"
+
+#include "ac/shm/protocol.h"
+
+namespace ac {
+namespace shm {
+
+/**
+ * @brief Buffer producer fed by a process outside of aethercast through
+ * shared memory.
+ *
+ * Frames are never copied: the memory the client renders into is mapped
+ * read-only and CurrentBuffer() hands out a Frame pointing right into it.
+ * A slot is given back to the client with the next SwapBuffers() call
+ * once the frame after it became current.
+ */
+class Producer : public ac::video::BufferProducer {
+public:
+    typedef std::shared_ptr<Producer> Ptr;
+
+    // What CurrentBuffer() points to.
+    struct Frame {
+        unsigned int slot;
+        std::uint8_t *data;
+        unsigned int width;
+        unsigned int height;
+        unsigned int stride;
+        protocol::PixelFormat format;
+        ac::TimestampUs timestamp;
+    };
+
+    static Ptr Create(const std::string &socket_path);
+
+    ~Producer();
+
+    // Blocks until a client connected and announced its buffers.
+    bool Setup(const video::DisplayOutput &output) override;
+
+    // From ac::video::BufferProducer
+    void SwapBuffers() override;
+    void* CurrentBuffer() const override;
+    // Hands out the current frame with its memory mapped
+    video::Buffer::Ptr CreateBuffer() const override;
+    video::DisplayOutput OutputMode() const override;
+    ac::TimestampUs CurrentTimestamp() const override;
+    ac::TimestampUs RefreshInterval() const override;
+
+private:
+    Producer(const std::string &socket_path);
+
+    bool Listen();
+    bool AcceptClient();
+    void StopListening();
+    bool Handshake(const video::DisplayOutput &output);
+    bool MapMemory(int fd, const protocol::Hello &hello);
+    void ReleaseSlot(unsigned int slot);
+    void Disconnect();
+
+private:
+    std::string socket_path_;
+    int listen_socket_;
+    int client_socket_;
+    std::uint8_t *memory_;
+    std::size_t memory_size_;
+    std::vector<Frame> slots_;
+    int current_slot_;
+    video::DisplayOutput output_;
+};
+
+} // namespace shm
+} // namespace ac
+
+#endif
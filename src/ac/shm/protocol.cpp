@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "ac/logger.h"
+
+#include "ac/shm/protocol.h"
+
+namespace ac {
+namespace shm {
+namespace protocol {
+
+bool Send(int socket, const void *message, std::size_t size, int fd) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(message);
+    iov.iov_len = size;
+
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    ::memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (fd >= 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        ::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    auto bytes_sent = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+    if (bytes_sent != static_cast<ssize_t>(size)) {
+        AC_ERROR("Failed to send message: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    return true;
+}
+
+int Receive(int socket, void *message, std::size_t size, int timeout_ms, int *fd) {
+    if (fd)
+        *fd = -1;
+
+    struct pollfd pfd;
+    pfd.fd = socket;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ret = 0;
+    do {
+        ret = ::poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        AC_ERROR("Failed to wait for message: %s (%d)", ::strerror(errno), errno);
+        return -1;
+    }
+    else if (ret == 0)
+        return 0;
+
+    struct iovec iov;
+    iov.iov_base = message;
+    iov.iov_len = size;
+
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    auto bytes_read = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    if (bytes_read <= 0)
+        return -1;
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        int received_fd = -1;
+        ::memcpy(&received_fd, CMSG_DATA(cmsg), sizeof(int));
+
+        if (fd && *fd < 0)
+            *fd = received_fd;
+        else
+            ::close(received_fd);
+    }
+
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        AC_WARNING("Dropping truncated message");
+        if (fd && *fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+        return -1;
+    }
+
+    return bytes_read;
+}
+
+} // namespace protocol
+} // namespace shm
+} // namespace ac
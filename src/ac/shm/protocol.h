@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_SHM_PROTOCOL_H_
+#define AC_SHM_PROTOCOL_H_
+
+#include <cstdint>
+#include <cstddef>
+
+#include "ac/utils.h"
+
+namespace ac {
+namespace shm {
+
+/**
+ * Wire protocol between aethercast and local processes feeding it with
+ * frames.
+ *
+ * The client connects to a SOCK_SEQPACKET unix socket and sends a single
+ * Hello message with a memfd or dmabuf attached as ancillary data. The
+ * memory behind it is split into slot_count slots of slot_size bytes
+ * each which the client renders into. A memfd has to be sealed against
+ * resizing so the client can't truncate it while we're reading from it.
+ *
+ * After a successful Welcome the client announces finished frames with
+ * FrameReady and must not touch the slot again until it gets the slot
+ * back with FrameReleased.
+ */
+namespace protocol {
+
+static constexpr std::uint32_t kMagic{0x61636d66};
+static constexpr std::uint32_t kVersion{1};
+static constexpr unsigned int kMaxSlots{8};
+
+enum class MessageType : std::uint32_t {
+    kHello = 1,
+    kWelcome,
+    kFrameReady,
+    kFrameReleased
+};
+
+enum class PixelFormat : std::uint32_t {
+    kRGBA8888 = 1
+};
+
+enum class MemoryType : std::uint32_t {
+    kMemFd = 1,
+    kDmaBuf
+};
+
+struct Hello {
+    MessageType type;
+    std::uint32_t magic;
+    std::uint32_t version;
+    MemoryType memory;
+    PixelFormat format;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t stride;
+    std::uint32_t slot_count;
+    std::uint32_t slot_size;
+};
+
+struct Welcome {
+    MessageType type;
+    std::uint32_t accepted;
+};
+
+struct Frame {
+    MessageType type;
+    std::uint32_t slot;
+    // Time the frame was captured at in the CLOCK_MONOTONIC domain
+    ac::TimestampUs timestamp;
+};
+
+// Sends a single message and optionally passes fd along with it.
+bool Send(int socket, const void *message, std::size_t size, int fd = -1);
+
+// Waits at most timeout_ms (or forever with a negative timeout) for the
+// next message and returns its size, 0 if there wasn't any or -1 on
+// errors and if the peer hung up. An attached file descriptor is stored
+// in fd if given and closed otherwise.
+int Receive(int socket, void *message, std::size_t size, int timeout_ms, int *fd = nullptr);
+
+} // namespace protocol
+} // namespace shm
+} // namespace ac
+
+#endif
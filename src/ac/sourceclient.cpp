@@ -214,7 +214,10 @@ std::shared_ptr<SourceClient> SourceClient::FinalizeConstruction() {
         return sp;
     }
 
-    auto udp_stream = std::make_shared<ac::network::UdpStream>();
+    ac::network::UdpStream::Config stream_config;
+    stream_config.transmit_timestamps = ac::Utils::GetEnvValue("AETHERCAST_TX_TIMESTAMPS") == "1";
+
+    auto udp_stream = std::make_shared<ac::network::UdpStream>(stream_config);
 
     media_manager_ = MediaManagerFactory::CreateSource(peer_address, udp_stream);
     media_manager_->SetDelegate(shared_from_this());
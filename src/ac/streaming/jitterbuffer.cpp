@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/jitterbuffer.h"
+
+namespace {
+// RTP clock rate for MPEG-TS payloads
+static constexpr std::int64_t kRTPClockRate{90000};
+// Resolution of the jitter histogram
+static constexpr std::int64_t kBucketWidthUs{250};
+// The target delay is derived from the histogram again after this many
+// new samples which keeps the cost per packet constant.
+static constexpr std::size_t kUpdateInterval{16};
+// A packet this far behind what we already handed out means the sender
+// started over with a new sequence number rather than reordering.
+static constexpr std::int64_t kMaxMisorder{100};
+
+std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+}
+
+namespace ac {
+namespace streaming {
+
+JitterBuffer::Ptr JitterBuffer::Create(const video::JitterBufferReport::Ptr &report, const Config &config) {
+    return std::shared_ptr<JitterBuffer>(new JitterBuffer(report, config));
+}
+
+JitterBuffer::JitterBuffer(const video::JitterBufferReport::Ptr &report, const Config &config) :
+    report_(report),
+    config_(config),
+    slots_(RoundUpToPowerOfTwo(std::max<std::size_t>(config.capacity, 2))),
+    mask_(slots_.size() - 1),
+    started_(false),
+    highest_(0),
+    next_(0),
+    gap_sequence_number_(-1),
+    gap_since_(0),
+    last_rtp_timestamp_(0),
+    last_arrival_(0),
+    jitter_(0),
+    samples_(std::max<std::size_t>(config.jitter_window, 1)),
+    sample_count_(0),
+    histogram_(config.max_delay.count() / kBucketWidthUs + 1),
+    target_delay_(config.min_delay),
+    total_playout_delay_(0) {
+
+    for (auto &slot : slots_)
+        slot.sequence_number = -1;
+}
+
+void JitterBuffer::Reset() {
+    for (auto &slot : slots_) {
+        slot.payload.reset();
+        slot.sequence_number = -1;
+    }
+
+    started_ = false;
+    gap_sequence_number_ = -1;
+}
+
+void JitterBuffer::Overflow(std::int64_t first) {
+    // Make room by giving up on everything before first. Each slot is
+    // passed only once so this stays constant time per packet.
+    std::int64_t lost_since = -1;
+
+    for (; next_ < first; next_++) {
+        auto &slot = slots_[next_ & mask_];
+        if (slot.payload && slot.sequence_number == next_) {
+            slot.payload.reset();
+            stats_.overflows++;
+            continue;
+        }
+
+        stats_.lost++;
+        if (lost_since < 0)
+            lost_since = next_;
+    }
+
+    if (lost_since >= 0)
+        report_->LostPackets(lost_since & 0xffff, first - lost_since);
+}
+
+void JitterBuffer::Insert(std::uint16_t sequence_number, std::uint32_t rtp_timestamp,
+                          const video::Buffer::Ptr &payload) {
+    const ac::TimestampUs arrival = payload->Timestamp();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        stats_.received++;
+
+        std::int64_t extended = sequence_number;
+        if (started_) {
+            // Pick the extended number closest to what we've seen so far
+            const std::int16_t delta = sequence_number - static_cast<std::uint16_t>(highest_);
+            extended = highest_ + delta;
+
+            if (extended < next_ - kMaxMisorder) {
+                AC_WARNING("Sequence number jumped back to %d, restarting", sequence_number);
+                Reset();
+                extended = sequence_number;
+            }
+        }
+
+        if (!started_) {
+            started_ = true;
+            highest_ = extended;
+            next_ = extended;
+            last_rtp_timestamp_ = rtp_timestamp;
+            last_arrival_ = arrival;
+        }
+
+        auto &slot = slots_[extended & mask_];
+
+        if (extended < next_) {
+            if (slot.sequence_number == extended) {
+                stats_.duplicates++;
+                report_->DuplicatePacket(sequence_number);
+            }
+            else {
+                stats_.late++;
+                report_->LatePacket(sequence_number);
+            }
+            return;
+        }
+
+        if (slot.sequence_number == extended) {
+            stats_.duplicates++;
+            report_->DuplicatePacket(sequence_number);
+            return;
+        }
+
+        if (extended > next_ + mask_)
+            Overflow(extended - mask_);
+
+        if (extended > highest_) {
+            UpdateJitter(rtp_timestamp, arrival);
+            highest_ = extended;
+        }
+
+        slot.payload = payload;
+        slot.arrival = arrival;
+        slot.sequence_number = extended;
+    }
+
+    inserted_.notify_one();
+}
+
+void JitterBuffer::UpdateJitter(std::uint32_t rtp_timestamp, ac::TimestampUs arrival) {
+    const std::int32_t rtp_delta = rtp_timestamp - last_rtp_timestamp_;
+    const std::int64_t transit_delta = std::abs((arrival - last_arrival_) - rtp_delta * 1000000ll / kRTPClockRate);
+
+    jitter_ += transit_delta - ((jitter_ + 8) >> 4);
+
+    last_rtp_timestamp_ = rtp_timestamp;
+    last_arrival_ = arrival;
+
+    AddJitterSample(transit_delta);
+}
+
+void JitterBuffer::AddJitterSample(std::int64_t sample) {
+    const auto bucket = static_cast<std::uint16_t>(std::min<std::int64_t>(sample / kBucketWidthUs,
+                                                                           histogram_.size() - 1));
+    auto &oldest = samples_[sample_count_ % samples_.size()];
+    if (sample_count_ >= samples_.size())
+        histogram_[oldest]--;
+
+    oldest = bucket;
+    histogram_[bucket]++;
+    sample_count_++;
+
+    if (sample_count_ % kUpdateInterval != 0)
+        return;
+
+    const auto count = std::min(sample_count_, samples_.size());
+    const std::size_t wanted = (count * config_.jitter_percentile + 99) / 100;
+
+    std::size_t seen = 0;
+    std::size_t n = 0;
+    for (; n < histogram_.size() - 1; n++) {
+        seen += histogram_[n];
+        if (seen >= wanted)
+            break;
+    }
+
+    const auto delay = std::min(std::max(std::chrono::microseconds{(n + 1) * kBucketWidthUs},
+                                         config_.min_delay), config_.max_delay);
+    if (delay == target_delay_)
+        return;
+
+    target_delay_ = delay;
+    report_->TargetDelayChanged(delay.count());
+}
+
+std::chrono::microseconds JitterBuffer::Delay() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return target_delay_;
+}
+
+JitterBuffer::Statistics JitterBuffer::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto stats = stats_;
+    stats.jitter = std::chrono::microseconds{jitter_ / 16};
+    stats.target_delay = target_delay_;
+    if (stats.delivered > 0)
+        stats.average_playout_delay = std::chrono::microseconds{total_playout_delay_ / static_cast<std::int64_t>(stats.delivered)};
+
+    return stats;
+}
+
+video::Buffer::Ptr JitterBuffer::PopUnlocked(ac::TimestampUs now, ac::TimestampUs *wakeup) {
+    if (!started_)
+        return nullptr;
+
+    auto *slot = &slots_[next_ & mask_];
+
+    if (!slot->payload || slot->sequence_number != next_) {
+        // Nothing after the missing packet arrived yet so there is
+        // nothing we could hand out anyway.
+        if (next_ >= highest_)
+            return nullptr;
+
+        if (gap_sequence_number_ != next_) {
+            gap_sequence_number_ = next_;
+            gap_since_ = now;
+            for (auto n = next_ + 1; n <= highest_; n++) {
+                const auto &candidate = slots_[n & mask_];
+                if (candidate.payload && candidate.sequence_number == n) {
+                    gap_since_ = candidate.arrival;
+                    break;
+                }
+            }
+        }
+
+        const auto deadline = gap_since_ + target_delay_.count();
+        if (now < deadline) {
+            *wakeup = deadline;
+            return nullptr;
+        }
+
+        // Give up on all packets missing in a row at once
+        const auto lost_since = next_;
+        while (!slot->payload || slot->sequence_number != next_) {
+            next_++;
+            slot = &slots_[next_ & mask_];
+        }
+
+        stats_.lost += next_ - lost_since;
+        report_->LostPackets(lost_since & 0xffff, next_ - lost_since);
+    }
+
+    const auto playout_delay = now - slot->arrival;
+    stats_.delivered++;
+    total_playout_delay_ += playout_delay;
+    report_->DeliveredPacket(next_ & 0xffff, playout_delay);
+
+    video::Buffer::Ptr payload;
+    payload.swap(slot->payload);
+    next_++;
+
+    return payload;
+}
+
+video::Buffer::Ptr JitterBuffer::Pop(ac::TimestampUs now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ac::TimestampUs wakeup = 0;
+    return PopUnlocked(now, &wakeup);
+}
+
+video::Buffer::Ptr JitterBuffer::Next(const std::chrono::milliseconds &timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const ac::TimestampUs deadline = ac::Utils::GetNowUs() + std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
+
+    while (true) {
+        const ac::TimestampUs now = ac::Utils::GetNowUs();
+
+        auto wakeup = deadline;
+        if (auto payload = PopUnlocked(now, &wakeup))
+            return payload;
+
+        if (now >= deadline)
+            return nullptr;
+
+        inserted_.wait_for(lock, std::chrono::microseconds{std::min(wakeup, deadline) - now});
+    }
+}
+
+} // namespace streaming
+} // namespace ac
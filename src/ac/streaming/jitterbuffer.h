@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_JITTERBUFFER_H_
+#define AC_STREAMING_JITTERBUFFER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/buffer.h"
+#include "ac/video/jitterbufferreport.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Brings received RTP packets back into sequence order.
+ *
+ * Packets arriving in order are handed out right away. Only when a
+ * packet is missing the following ones are held back to give it a
+ * chance to still arrive. How long we wait for it is the configured
+ * percentile of the recently measured interarrival jitter (RFC 3550
+ * section 6.4.1) so that it follows the network conditions.
+ *
+ * Packets are kept in a ring indexed by their sequence number which
+ * bounds the memory used and makes inserting and taking out a packet
+ * constant time operations.
+ */
+class JitterBuffer : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<JitterBuffer> Ptr;
+
+    class Config {
+    public:
+        Config() :
+            min_delay(std::chrono::milliseconds{2}),
+            max_delay(std::chrono::milliseconds{100}),
+            capacity(1024),
+            jitter_percentile(98),
+            jitter_window(1000) {
+        }
+
+        std::chrono::microseconds min_delay;
+        std::chrono::microseconds max_delay;
+        // Maximum number of packets held back, rounded up to the next
+        // power of two.
+        std::size_t capacity;
+        // Share of the jitter samples (in percent) the delay has to cover
+        unsigned int jitter_percentile;
+        // Number of most recent jitter samples taken into account
+        std::size_t jitter_window;
+    };
+
+    class Statistics {
+    public:
+        Statistics() :
+            received(0),
+            delivered(0),
+            late(0),
+            lost(0),
+            duplicates(0),
+            overflows(0),
+            jitter(0),
+            target_delay(0),
+            average_playout_delay(0) {
+        }
+
+        std::uint64_t received;
+        std::uint64_t delivered;
+        // Arrived after we already gave up on them
+        std::uint64_t late;
+        std::uint64_t lost;
+        std::uint64_t duplicates;
+        // Dropped because the consumer didn't keep up
+        std::uint64_t overflows;
+        // Smoothed interarrival jitter as defined by RFC 3550
+        std::chrono::microseconds jitter;
+        std::chrono::microseconds target_delay;
+        // Average time between arrival and delivery of a packet
+        std::chrono::microseconds average_playout_delay;
+    };
+
+    static Ptr Create(const video::JitterBufferReport::Ptr &report, const Config &config = Config{});
+
+    // The timestamp of payload is taken as its arrival time.
+    void Insert(std::uint16_t sequence_number, std::uint32_t rtp_timestamp,
+                const video::Buffer::Ptr &payload);
+
+    // Waits up to timeout for the next packet in sequence order to
+    // become available. Returns nullptr if there is none.
+    video::Buffer::Ptr Next(const std::chrono::milliseconds &timeout);
+
+    // Returns the next packet in sequence order if it's ready by now
+    // without waiting.
+    video::Buffer::Ptr Pop(ac::TimestampUs now);
+
+    // Time we currently wait for a missing packet
+    std::chrono::microseconds Delay() const;
+
+    Statistics Stats() const;
+
+private:
+    JitterBuffer(const video::JitterBufferReport::Ptr &report, const Config &config);
+
+    void Reset();
+    void Overflow(std::int64_t first);
+    void UpdateJitter(std::uint32_t rtp_timestamp, ac::TimestampUs arrival);
+    void AddJitterSample(std::int64_t sample);
+    video::Buffer::Ptr PopUnlocked(ac::TimestampUs now, ac::TimestampUs *wakeup);
+
+private:
+    struct Slot {
+        video::Buffer::Ptr payload;
+        ac::TimestampUs arrival;
+        // Extended sequence number the slot was last used for which
+        // stays set after delivery to detect duplicates.
+        std::int64_t sequence_number;
+    };
+
+    video::JitterBufferReport::Ptr report_;
+    Config config_;
+    mutable std::mutex mutex_;
+    std::condition_variable inserted_;
+
+    std::vector<Slot> slots_;
+    std::int64_t mask_;
+    bool started_;
+    // Extended sequence numbers which don't wrap
+    std::int64_t highest_;
+    std::int64_t next_;
+    // Arrival of the first packet after the one we're missing
+    std::int64_t gap_sequence_number_;
+    ac::TimestampUs gap_since_;
+
+    std::uint32_t last_rtp_timestamp_;
+    ac::TimestampUs last_arrival_;
+    // RFC 3550 estimate in micro-seconds scaled by 16
+    std::int64_t jitter_;
+    // Recent jitter samples as histogram bucket indices
+    std::vector<std::uint16_t> samples_;
+    std::size_t sample_count_;
+    std::vector<std::uint32_t> histogram_;
+    std::chrono::microseconds target_delay_;
+
+    Statistics stats_;
+    std::int64_t total_playout_delay_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
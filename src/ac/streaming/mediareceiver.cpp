@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/streaming/mediareceiver.h"
+
+namespace {
+static constexpr const char *kMediaReceiverThreadName{"MediaReceiver"};
+// Upper bound for how long Execute blocks so the executor can stop us
+static constexpr std::chrono::milliseconds kWaitTimeout{10};
+}
+
+namespace ac {
+namespace streaming {
+
+MediaReceiver::MediaReceiver(const JitterBuffer::Ptr &jitter_buffer, const MPEGTSDemuxer::Ptr &demuxer,
+                             const ac::video::BaseDecoder::Ptr &decoder) :
+    jitter_buffer_(jitter_buffer),
+    demuxer_(demuxer),
+    decoder_(decoder) {
+}
+
+MediaReceiver::~MediaReceiver() {
+    Stop();
+}
+
+bool MediaReceiver::Start() {
+    return decoder_->Start();
+}
+
+bool MediaReceiver::Stop() {
+    return decoder_->Stop();
+}
+
+bool MediaReceiver::Execute() {
+    const auto packet = jitter_buffer_->Next(kWaitTimeout);
+    if (!packet)
+        return true;
+
+    demuxer_->Demux(packet, &units_);
+
+    for (const auto &unit : units_) {
+        if (!decoder_->Decode(unit))
+            AC_WARNING("Decoder %s failed to take access unit", decoder_->Name());
+    }
+
+    units_.clear();
+
+    return true;
+}
+
+std::string MediaReceiver::Name() const {
+    return kMediaReceiverThreadName;
+}
+
+} // namespace streaming
+} // namespace ac
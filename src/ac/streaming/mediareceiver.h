@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_MEDIARECEIVER_H_
+#define AC_STREAMING_MEDIARECEIVER_H_
+
+#include <memory>
+#include <vector>
+
+#include "ac/common/executable.h"
+
+#include "ac/video/basedecoder.h"
+
+#include "ac/streaming/jitterbuffer.h"
+#include "ac/streaming/mpegtsdemuxer.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Sink side counterpart of the MediaSender which takes packets
+ * in order from the jitter buffer, demultiplexes them and hands the
+ * resulting access units to a decoder.
+ */
+class MediaReceiver : public ac::common::Executable {
+public:
+    typedef std::shared_ptr<MediaReceiver> Ptr;
+
+    MediaReceiver(const JitterBuffer::Ptr &jitter_buffer, const MPEGTSDemuxer::Ptr &demuxer,
+                  const ac::video::BaseDecoder::Ptr &decoder);
+    ~MediaReceiver();
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    JitterBuffer::Ptr jitter_buffer_;
+    MPEGTSDemuxer::Ptr demuxer_;
+    ac::video::BaseDecoder::Ptr decoder_;
+    std::vector<ac::video::AccessUnit> units_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
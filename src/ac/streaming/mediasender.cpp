@@ -17,6 +17,8 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
 #include "ac/logger.h"
 
 #include "ac/streaming/mediasender.h"
@@ -25,17 +27,80 @@
 
 namespace {
 static constexpr const char *kMediaSenderThreadName{"MediaSender"};
+
+// Temporal layer ids take three bits in H.264 so this ranks frames
+// without any reference above everything an encoder can report.
+static constexpr int kNonReferenceRank{8};
+// Delimiters, parameter sets and SEI messages preceding the first slice
+// fit in here; frames whose slice header isn't found are always kept.
+static constexpr std::size_t kMaxHeaderScanSize{512};
+
+static constexpr unsigned int kMaxDropLevel{3};
+// Data waiting in the transport sender, as time needed to send it with
+// the configured bitrate, above which one more level of frames is shed
+// and below which one level less is.
+static constexpr ac::TimestampUs kCongestedBacklogUs{100000};
+static constexpr ac::TimestampUs kClearedBacklogUs{30000};
+// Frames between two changes of the drop level so that the effect of
+// the last change is visible in the backlog.
+static constexpr unsigned int kLevelHoldFrames{15};
+// Frames the effective frame rate is calculated over.
+static constexpr unsigned int kRateWindowFrames{30};
+
+// Ranks an access unit by how much other frames depend on it: frames
+// ranked zero are never dropped and higher ranks are dropped first.
+int RankOf(const ac::video::Buffer::Ptr &buffer) {
+    if (buffer->TemporalLayer() >= 0)
+        return buffer->TemporalLayer();
+
+    const auto data = buffer->Data();
+    if (!data)
+        return 0;
+
+    // Only the NAL unit headers up to the first slice are looked at
+    // and not the whole access unit.
+    const auto size = std::min<std::size_t>(buffer->Length(), kMaxHeaderScanSize);
+    for (std::size_t n = 0; n + 3 < size; n++) {
+        if (data[n] != 0x00 || data[n + 1] != 0x00 || data[n + 2] != 0x01)
+            continue;
+
+        const auto header = data[n + 3];
+        const auto type = header & 0x1f;
+        // Coded slices of non-IDR (1-4) and IDR (5) pictures
+        if (type >= 1 && type <= 4)
+            return (header & 0x60) == 0 ? kNonReferenceRank : 0;
+        else if (type == 5)
+            return 0;
+
+        n += 3;
+    }
+
+    return 0;
+}
 }
 
 namespace ac {
 namespace streaming {
 
 MediaSender::MediaSender(const Packetizer::Ptr &packetizer, const TransportSender::Ptr &sender,
-                         const ac::video::BaseEncoder::Config &config) :
+                         const ac::video::BaseEncoder::Config &config,
+                         const ac::video::PacketizerReport::Ptr &report,
+                         const ac::video::MemoryBudget::Ptr &budget) :
     packetizer_(packetizer),
     sender_(sender),
     prev_time_us_(-1ll),
-    queue_(video::BufferQueue::Create()) {
+    queue_(video::BufferQueue::Create(0, "MediaSender")),
+    report_(report),
+    budget_(budget),
+    bitrate_(config.bitrate),
+    framerate_(config.framerate > 0 ? config.framerate : 0),
+    drop_level_(0),
+    frames_since_level_change_(0),
+    highest_rank_(0),
+    window_frames_(0),
+    window_dropped_(0),
+    reported_framerate_(framerate_),
+    last_progress_(0) {
 
     if (!packetizer_ || !sender_) {
         AC_WARNING("Sender not correct initialized. Missing packetizer or sender.");
@@ -95,15 +160,105 @@ bool MediaSender::Execute() {
     // This will wait for a short time and then return back
     // so we can loop again and check if we have to exit or
     // not.
-    if (!queue_->WaitToBeFilled())
+    if (!queue_->WaitToBeFilled()) {
+        last_progress_ = ac::Utils::GetNowUs();
         return true;
+    }
 
     const auto buffer = queue_->Pop();
-    ProcessBuffer(buffer);
+
+    UpdateDropLevel();
+
+    const auto drop = ShouldDropFrame(buffer);
+    CountFrame(drop);
+
+    if (!drop)
+        ProcessBuffer(buffer);
+    else if (report_)
+        report_->DroppedFrame(buffer->Timestamp(), buffer->TemporalLayer());
+
+    last_progress_ = ac::Utils::GetNowUs();
 
     return true;
 }
 
+void MediaSender::UpdateDropLevel() {
+    if (frames_since_level_change_ < kLevelHoldFrames) {
+        frames_since_level_change_++;
+        return;
+    }
+
+    bool congested = false;
+    bool cleared = true;
+
+    if (budget_ && budget_->CurrentPressure() != ac::video::MemoryBudget::Pressure::kNone) {
+        congested = true;
+        cleared = false;
+    }
+
+    if (budget_ && bitrate_ > 0) {
+        const auto backlog = budget_->Usage(ac::video::MemoryBudget::Stage::kSender);
+        const auto backlog_us = static_cast<ac::TimestampUs>(backlog * 8 * 1000000ull / bitrate_);
+        if (backlog_us > kCongestedBacklogUs)
+            congested = true;
+        if (backlog_us >= kClearedBacklogUs)
+            cleared = false;
+    }
+
+    auto level = drop_level_;
+    if (congested && level < kMaxDropLevel)
+        level++;
+    else if (cleared && level > 0)
+        level--;
+
+    if (level == drop_level_)
+        return;
+
+    AC_DEBUG("Changing frame drop level from %d to %d", drop_level_, level);
+
+    drop_level_ = level;
+    frames_since_level_change_ = 0;
+}
+
+bool MediaSender::ShouldDropFrame(const ac::video::Buffer::Ptr &buffer) {
+    const auto rank = RankOf(buffer);
+    highest_rank_ = std::max(highest_rank_, rank);
+
+    if (drop_level_ == 0 || rank == 0)
+        return false;
+
+    // Each level sheds one more rank starting with the highest one seen
+    // so far. As frames only reference frames of the same or a lower
+    // rank the remaining ones stay decodable.
+    const auto cutoff = std::max(1, highest_rank_ - static_cast<int>(drop_level_) + 1);
+    return rank >= cutoff;
+}
+
+void MediaSender::CountFrame(bool dropped) {
+    if (framerate_ == 0)
+        return;
+
+    window_frames_++;
+    if (dropped)
+        window_dropped_++;
+
+    if (window_frames_ < kRateWindowFrames)
+        return;
+
+    const auto framerate = framerate_ * (window_frames_ - window_dropped_) / window_frames_;
+
+    window_frames_ = 0;
+    window_dropped_ = 0;
+
+    if (framerate == reported_framerate_)
+        return;
+
+    reported_framerate_ = framerate;
+
+    if (report_)
+        report_->FrameRateChanged(framerate, drop_level_);
+}
+
 void MediaSender::OnBufferAvailable(const video::Buffer::Ptr &buffer) {
     queue_->Push(buffer);
 }
@@ -122,9 +277,20 @@ uint16_t MediaSender::LocalRTPPort() const {
     return sender_->LocalPort();
 }
 
+void MediaSender::Flush() {
+    queue_->Clear();
+
+    if (sender_)
+        sender_->Flush();
+}
+
 std::string MediaSender::Name() const {
     return kMediaSenderThreadName;
 }
 
+ac::TimestampUs MediaSender::LastProgress() const {
+    return last_progress_;
+}
+
 } // namespace streaming
 } // namespace ac
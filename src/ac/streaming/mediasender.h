@@ -18,12 +18,15 @@
 #ifndef AC_STREAMING_MEDIASENDER_H_
 #define AC_STREAMING_MEDIASENDER_H_
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <thread>
 
 #include "ac/video/baseencoder.h"
 #include "ac/video/bufferqueue.h"
+#include "ac/video/memorybudget.h"
+#include "ac/video/packetizerreport.h"
 
 #include "ac/streaming/packetizer.h"
 #include "ac/streaming/transportsender.h"
@@ -36,17 +39,27 @@ class MediaSender : public ac::common::Executable,
 public:
     typedef std::shared_ptr<MediaSender> Ptr;
 
+    // Under congestion, measured as the data waiting in the transport
+    // sender, frames no other frame depends on are dropped before they
+    // get packetized. Frame rate changes resulting from that are reported
+    // through report.
     MediaSender(const Packetizer::Ptr &packetizer, const TransportSender::Ptr &sender,
-                const ac::video::BaseEncoder::Config &config);
+                const ac::video::BaseEncoder::Config &config,
+                const ac::video::PacketizerReport::Ptr &report = nullptr,
+                const ac::video::MemoryBudget::Ptr &budget = ac::video::MemoryBudget::Instance());
     ~MediaSender();
 
     uint16_t LocalRTPPort() const;
 
+    // Drops all buffers not sent yet, ours and the transport's
+    void Flush();
+
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    ac::TimestampUs LastProgress() const override;
 
     // From ac::video::BaseEncoder::Delegate
     void OnBufferAvailable(const ac::video::Buffer::Ptr &buffer) override;
@@ -57,12 +70,27 @@ private:
 
     void ProcessBuffer(const ac::video::Buffer::Ptr &buffer);
 
+    void UpdateDropLevel();
+    bool ShouldDropFrame(const ac::video::Buffer::Ptr &buffer);
+    void CountFrame(bool dropped);
+
 private:
     Packetizer::Ptr packetizer_;
     TransportSender::Ptr sender_;
     Packetizer::TrackId video_track_;
     int64_t prev_time_us_;
     ac::video::BufferQueue::Ptr queue_;
+    ac::video::PacketizerReport::Ptr report_;
+    ac::video::MemoryBudget::Ptr budget_;
+    unsigned int bitrate_;
+    unsigned int framerate_;
+    unsigned int drop_level_;
+    unsigned int frames_since_level_change_;
+    int highest_rank_;
+    unsigned int window_frames_;
+    unsigned int window_dropped_;
+    unsigned int reported_framerate_;
+    std::atomic<ac::TimestampUs> last_progress_;
 };
 
 } // namespace streaming
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "ac/logger.h"
+
+#include "ac/streaming/mpegtsdemuxer.h"
+
+namespace {
+static constexpr std::uint32_t kTSPacketSize{188};
+static constexpr std::uint8_t kSyncByte{0x47};
+static constexpr int kPIDofPAT{0x0000};
+static constexpr int kPIDofNullPacket{0x1fff};
+static constexpr std::size_t kPIDCount{0x2000};
+static constexpr std::uint8_t kTableIdPAT{0x00};
+static constexpr std::uint8_t kTableIdPMT{0x02};
+static constexpr std::uint8_t kStreamTypeH264{0x1b};
+static constexpr std::uint32_t kPESHeaderSize{9};
+static constexpr std::uint32_t kCRCSize{4};
+
+// Returns the position of the first sync byte in data between offset
+// and size or size if there is none.
+std::uint32_t FindSyncByte(const std::uint8_t *data, std::uint32_t offset, std::uint32_t size) {
+#if defined(__SSE2__)
+    const __m128i sync = _mm_set1_epi8(static_cast<char>(kSyncByte));
+    for (; offset + 16 <= size; offset += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, sync));
+        if (mask != 0)
+            return offset + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t sync = vdupq_n_u8(kSyncByte);
+    for (; offset + 16 <= size; offset += 16) {
+        const uint64x2_t mask = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(data + offset), sync));
+        if ((vgetq_lane_u64(mask, 0) | vgetq_lane_u64(mask, 1)) != 0)
+            break;
+    }
+#endif
+    for (; offset < size; offset++) {
+        if (data[offset] == kSyncByte)
+            return offset;
+    }
+    return size;
+}
+
+// MPEG-2 variant of the CRC32 (ISO/IEC 13818-1 annex A). Tables are
+// rare enough to not need a lookup table. Running it over a section
+// including its CRC yields zero for an intact section.
+std::uint32_t CalcCrc32(const std::uint8_t *data, std::uint32_t size) {
+    std::uint32_t crc = 0xffffffff;
+    for (std::uint32_t n = 0; n < size; n++) {
+        crc ^= static_cast<std::uint32_t>(data[n]) << 24;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+}
+
+// Reads a 33 bit PTS or DTS field and converts it to micro-seconds
+ac::TimestampUs ReadTimestamp(const std::uint8_t *data) {
+    const std::uint64_t value = (static_cast<std::uint64_t>(data[0] & 0x0e) << 29) |
+            (data[1] << 22) | ((data[2] & 0xfe) << 14) |
+            (data[3] << 7) | (data[4] >> 1);
+    return value * 100 / 9;
+}
+}
+
+namespace ac {
+namespace streaming {
+
+MPEGTSDemuxer::Ptr MPEGTSDemuxer::Create() {
+    return std::shared_ptr<MPEGTSDemuxer>(new MPEGTSDemuxer);
+}
+
+MPEGTSDemuxer::MPEGTSDemuxer() :
+    pids_(kPIDCount, PIDState{PIDType::kUnknown, -1}),
+    pmt_pid_(-1),
+    pcr_pid_(-1),
+    video_pid_(-1),
+    have_unit_(false),
+    expected_size_(0) {
+    SetPIDType(kPIDofPAT, PIDType::kPAT);
+}
+
+MPEGTSDemuxer::Statistics MPEGTSDemuxer::Stats() const {
+    return stats_;
+}
+
+void MPEGTSDemuxer::SetPIDType(int pid, PIDType type) {
+    pids_[pid].type = type;
+    pids_[pid].continuity_counter = -1;
+}
+
+void MPEGTSDemuxer::Demux(const video::Buffer::Ptr &packets, std::vector<video::AccessUnit> *units) {
+    const std::uint8_t *data = packets->Data();
+    const auto length = packets->Length();
+
+    std::uint32_t offset = 0;
+    while (offset + kTSPacketSize <= length) {
+        if (data[offset] != kSyncByte) {
+            offset = Resync(data, offset, length);
+            continue;
+        }
+
+        ParsePacket(packets, offset, units);
+        offset += kTSPacketSize;
+    }
+}
+
+std::uint32_t MPEGTSDemuxer::Resync(const std::uint8_t *data, std::uint32_t offset, std::uint32_t length) {
+    stats_.sync_losses++;
+
+    // A single sync byte is easily found in payload data as well so we
+    // only trust it if the following packet starts with one too.
+    while (true) {
+        offset = FindSyncByte(data, offset + 1, length);
+        if (offset + kTSPacketSize >= length || data[offset + kTSPacketSize] == kSyncByte)
+            break;
+    }
+
+    AC_DEBUG("Lost sync, continuing at offset %d", offset);
+
+    return offset;
+}
+
+void MPEGTSDemuxer::ParsePacket(const video::Buffer::Ptr &packets, std::uint32_t offset,
+                                std::vector<video::AccessUnit> *units) {
+    const std::uint8_t *data = packets->Data() + offset;
+
+    stats_.packets++;
+
+    const bool unit_start = data[1] & 0x40;
+    const int pid = ((data[1] & 0x1f) << 8) | data[2];
+    const unsigned int adaptation_field_control = (data[3] >> 4) & 0x3;
+
+    if (pid == kPIDofNullPacket)
+        return;
+
+    std::uint32_t header_size = 4;
+    bool discontinuity = false;
+    if (adaptation_field_control & 0x2) {
+        const std::uint32_t adaptation_field_length = data[4];
+        header_size += 1 + adaptation_field_length;
+        if (header_size > kTSPacketSize)
+            return;
+
+        if (adaptation_field_length > 0) {
+            discontinuity = data[5] & 0x80;
+            if (pid == pcr_pid_)
+                ParsePCR(data + 5, adaptation_field_length);
+        }
+    }
+
+    if (!(adaptation_field_control & 0x1) || header_size >= kTSPacketSize)
+        return;
+
+    const auto type = pids_[pid].type;
+    if (type == PIDType::kUnknown)
+        return;
+
+    if (!CheckContinuity(pid, data, discontinuity))
+        return;
+
+    const auto payload = data + header_size;
+    const auto payload_size = kTSPacketSize - header_size;
+
+    switch (type) {
+    case PIDType::kPAT:
+        if (unit_start)
+            ParsePAT(payload, payload_size);
+        break;
+    case PIDType::kPMT:
+        if (unit_start)
+            ParsePMT(payload, payload_size);
+        break;
+    case PIDType::kVideo:
+        ParsePES(packets, offset + header_size, payload_size, unit_start, units);
+        break;
+    default:
+        break;
+    }
+}
+
+void MPEGTSDemuxer::ParsePCR(const std::uint8_t *adaptation_field, std::uint32_t size) {
+    // PCR_flag and 33 bit base, 6 reserved bits and 9 bit extension
+    if (!(adaptation_field[0] & 0x10) || size < 7)
+        return;
+
+    const std::uint8_t *pcr = adaptation_field + 1;
+    const std::uint64_t base = (static_cast<std::uint64_t>(pcr[0]) << 25) | (pcr[1] << 17) |
+            (pcr[2] << 9) | (pcr[3] << 1) | (pcr[4] >> 7);
+    const std::uint64_t extension = ((pcr[4] & 0x01) << 8) | pcr[5];
+
+    // The PCR runs with 27 MHz
+    stats_.pcr = (base * 300 + extension) / 27;
+}
+
+bool MPEGTSDemuxer::CheckContinuity(int pid, const std::uint8_t *data, bool discontinuity) {
+    auto &state = pids_[pid];
+    const int continuity_counter = data[3] & 0x0f;
+    const int last = state.continuity_counter;
+
+    state.continuity_counter = continuity_counter;
+
+    if (last < 0 || discontinuity)
+        return true;
+
+    // A packet may be sent twice in a row, the copy has to be ignored
+    if (continuity_counter == last) {
+        stats_.duplicates++;
+        return false;
+    }
+
+    if (continuity_counter != ((last + 1) & 0x0f)) {
+        stats_.continuity_errors++;
+        AC_DEBUG("Continuity error on PID %d (expected %d, got %d)", pid, (last + 1) & 0x0f, continuity_counter);
+        if (pid == video_pid_)
+            DropUnit();
+    }
+
+    return true;
+}
+
+const std::uint8_t* MPEGTSDemuxer::FindSection(const std::uint8_t *payload, std::uint32_t size,
+                                               std::uint32_t *section_size) const {
+    // We only handle sections which fit into a single packet which is
+    // always the case for the few programs and streams we deal with.
+    const std::uint32_t pointer_field = payload[0];
+    if (1 + pointer_field + 3 > size)
+        return nullptr;
+
+    const auto section = payload + 1 + pointer_field;
+    const std::uint32_t length = 3 + (((section[1] & 0x0f) << 8) | section[2]);
+    if (length > size - 1 - pointer_field || length < kCRCSize)
+        return nullptr;
+
+    if (CalcCrc32(section, length) != 0) {
+        AC_DEBUG("Ignoring section with invalid CRC");
+        return nullptr;
+    }
+
+    *section_size = length;
+    return section;
+}
+
+void MPEGTSDemuxer::ParsePAT(const std::uint8_t *payload, std::uint32_t size) {
+    std::uint32_t section_size = 0;
+    const auto section = FindSection(payload, size, &section_size);
+    if (!section || section[0] != kTableIdPAT || section_size < 8 + kCRCSize)
+        return;
+
+    for (std::uint32_t n = 8; n + 4 <= section_size - kCRCSize; n += 4) {
+        const unsigned int program_number = (section[n] << 8) | section[n + 1];
+        // Program zero points to the network information table
+        if (program_number == 0)
+            continue;
+
+        const int pid = ((section[n + 2] & 0x1f) << 8) | section[n + 3];
+        if (pid != pmt_pid_ && pid != kPIDofPAT && pid != kPIDofNullPacket) {
+            AC_DEBUG("Found program %d with PMT on PID %d", program_number, pid);
+            if (pmt_pid_ >= 0)
+                SetPIDType(pmt_pid_, PIDType::kUnknown);
+            pmt_pid_ = pid;
+            SetPIDType(pid, PIDType::kPMT);
+        }
+        break;
+    }
+}
+
+void MPEGTSDemuxer::ParsePMT(const std::uint8_t *payload, std::uint32_t size) {
+    std::uint32_t section_size = 0;
+    const auto section = FindSection(payload, size, &section_size);
+    if (!section || section[0] != kTableIdPMT || section_size < 12 + kCRCSize)
+        return;
+
+    pcr_pid_ = ((section[8] & 0x1f) << 8) | section[9];
+
+    const std::uint32_t program_info_length = ((section[10] & 0x0f) << 8) | section[11];
+
+    int video_pid = -1;
+    std::uint32_t n = 12 + program_info_length;
+    while (n + 5 <= section_size - kCRCSize) {
+        const auto stream_type = section[n];
+        const int pid = ((section[n + 1] & 0x1f) << 8) | section[n + 2];
+        const std::uint32_t es_info_length = ((section[n + 3] & 0x0f) << 8) | section[n + 4];
+
+        n += 5 + es_info_length;
+
+        if (pid == kPIDofPAT || pid == pmt_pid_ || pid == kPIDofNullPacket)
+            continue;
+
+        if (stream_type == kStreamTypeH264 && video_pid < 0) {
+            video_pid = pid;
+            continue;
+        }
+
+        // Other streams are only followed for their continuity
+        if (pids_[pid].type == PIDType::kUnknown)
+            SetPIDType(pid, PIDType::kOther);
+    }
+
+    if (video_pid == video_pid_)
+        return;
+
+    if (video_pid_ >= 0)
+        SetPIDType(video_pid_, PIDType::kUnknown);
+
+    if (video_pid >= 0) {
+        AC_DEBUG("Found H.264 stream on PID %d", video_pid);
+        SetPIDType(video_pid, PIDType::kVideo);
+    }
+
+    video_pid_ = video_pid;
+    have_unit_ = false;
+}
+
+void MPEGTSDemuxer::ParsePES(const video::Buffer::Ptr &packets, std::uint32_t offset, std::uint32_t size,
+                             bool unit_start, std::vector<video::AccessUnit> *units) {
+    if (unit_start) {
+        FinishUnit(units);
+
+        const std::uint8_t *header = packets->Data() + offset;
+        if (size < kPESHeaderSize || header[0] != 0x00 || header[1] != 0x00 || header[2] != 0x01)
+            return;
+
+        const std::uint32_t packet_length = (header[4] << 8) | header[5];
+        const std::uint32_t header_size = kPESHeaderSize + header[8];
+        if (header_size > size || (packet_length > 0 && packet_length + 6 < header_size))
+            return;
+
+        unit_ = video::AccessUnit{};
+        have_unit_ = true;
+        expected_size_ = packet_length > 0 ? packet_length + 6 - header_size : 0;
+
+        const unsigned int pts_dts_flags = header[7] >> 6;
+        if (pts_dts_flags & 0x2 && header_size >= kPESHeaderSize + 5) {
+            unit_.timestamp = ReadTimestamp(header + kPESHeaderSize);
+            unit_.decode_timestamp = unit_.timestamp;
+        }
+        if (pts_dts_flags == 0x3 && header_size >= kPESHeaderSize + 10)
+            unit_.decode_timestamp = ReadTimestamp(header + kPESHeaderSize + 5);
+
+        offset += header_size;
+        size -= header_size;
+    }
+    else if (!have_unit_) {
+        return;
+    }
+
+    if (size > 0)
+        unit_.Append(video::Buffer::Create(packets, offset, size));
+
+    if (expected_size_ > 0 && unit_.size >= expected_size_)
+        FinishUnit(units);
+}
+
+void MPEGTSDemuxer::DropUnit() {
+    if (!have_unit_)
+        return;
+
+    have_unit_ = false;
+    unit_ = video::AccessUnit{};
+    stats_.dropped_units++;
+}
+
+void MPEGTSDemuxer::FinishUnit(std::vector<video::AccessUnit> *units) {
+    if (!have_unit_)
+        return;
+
+    if (expected_size_ > 0 && unit_.size < expected_size_) {
+        AC_WARNING("Dropping incomplete access unit (%d of %d bytes)", unit_.size, expected_size_);
+        DropUnit();
+        return;
+    }
+
+    have_unit_ = false;
+
+    if (unit_.size == 0)
+        return;
+
+    stats_.units++;
+    units->push_back(std::move(unit_));
+}
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_MPEGTSDEMUXER_H_
+#define AC_STREAMING_MPEGTSDEMUXER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/accessunit.h"
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Extracts the H.264 access units from an MPEG transport stream.
+ *
+ * The video stream is located through the PAT and PMT. Its PES packets
+ * are reassembled without copying any data: every access unit only
+ * references the payload parts of the transport stream packets it was
+ * carried in.
+ *
+ * All PIDs announced by the program tables are tracked for continuity
+ * and the program clock reference is taken from the PCR PID. Packets are
+ * dispatched through a table indexed by PID and buffers which don't
+ * start on a packet boundary or lost sync in between are resynchronized
+ * by scanning for the sync byte with SIMD instructions where available.
+ */
+class MPEGTSDemuxer : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<MPEGTSDemuxer> Ptr;
+
+    class Statistics {
+    public:
+        Statistics() :
+            packets(0),
+            sync_losses(0),
+            continuity_errors(0),
+            duplicates(0),
+            units(0),
+            dropped_units(0),
+            pcr(-1) {
+        }
+
+        std::uint64_t packets;
+        // Number of times we had to search for the next sync byte
+        std::uint64_t sync_losses;
+        std::uint64_t continuity_errors;
+        std::uint64_t duplicates;
+        std::uint64_t units;
+        // Access units given up on because parts of them were missing
+        std::uint64_t dropped_units;
+        // Most recent program clock reference in micro-seconds or -1 if
+        // we didn't see any yet
+        ac::TimestampUs pcr;
+    };
+
+    static Ptr Create();
+
+    // Parses all transport stream packets in packets and appends every
+    // access unit completed by them to units. A unit is complete once
+    // all bytes announced in its PES header arrived or, if the header
+    // doesn't say, when the next unit starts.
+    void Demux(const video::Buffer::Ptr &packets, std::vector<video::AccessUnit> *units);
+
+    Statistics Stats() const;
+
+private:
+    enum class PIDType : std::uint8_t {
+        kUnknown = 0,
+        kPAT,
+        kPMT,
+        kVideo,
+        kOther
+    };
+
+    struct PIDState {
+        PIDType type;
+        // Continuity counter of the last packet with payload, -1 if none
+        std::int8_t continuity_counter;
+    };
+
+    MPEGTSDemuxer();
+
+    std::uint32_t Resync(const std::uint8_t *data, std::uint32_t offset, std::uint32_t length);
+    void ParsePacket(const video::Buffer::Ptr &packets, std::uint32_t offset,
+                     std::vector<video::AccessUnit> *units);
+    void ParsePCR(const std::uint8_t *adaptation_field, std::uint32_t size);
+    bool CheckContinuity(int pid, const std::uint8_t *data, bool discontinuity);
+    const std::uint8_t* FindSection(const std::uint8_t *payload, std::uint32_t size,
+                                    std::uint32_t *section_size) const;
+    void ParsePAT(const std::uint8_t *payload, std::uint32_t size);
+    void ParsePMT(const std::uint8_t *payload, std::uint32_t size);
+    void ParsePES(const video::Buffer::Ptr &packets, std::uint32_t offset, std::uint32_t size,
+                  bool unit_start, std::vector<video::AccessUnit> *units);
+    void FinishUnit(std::vector<video::AccessUnit> *units);
+    void DropUnit();
+    void SetPIDType(int pid, PIDType type);
+
+private:
+    std::vector<PIDState> pids_;
+    int pmt_pid_;
+    int pcr_pid_;
+    int video_pid_;
+    bool have_unit_;
+    video::AccessUnit unit_;
+    // Payload size announced in the PES header, zero if unbounded
+    std::size_t expected_size_;
+    Statistics stats_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
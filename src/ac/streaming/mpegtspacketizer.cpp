@@ -24,6 +24,9 @@
 #include <arpa/inet.h>
 #include <memory.h>
 
+#include <algorithm>
+#include <deque>
+
 #include "ac/utils.h"
 #include "ac/logger.h"
 
@@ -47,6 +50,122 @@ static constexpr unsigned int kVideoStreamIdStart{0xe0};
 static constexpr unsigned int kVideoStreamIdStop{0xef};
 static constexpr unsigned int kAVCVideoDescriptorTag{40};
 static constexpr unsigned int kAVCTimingAndHRDDescriptor{42};
+
+static constexpr unsigned int kPIDofNullPacket{0x1fff};
+static constexpr size_t kTSPacketSize{188};
+
+// 27 MHz system clock ticks
+static constexpr std::uint64_t kSystemClockRate{27000000};
+static constexpr std::uint64_t kSystemClockTicksPerUs{27};
+
+// If the multiplexer clock drifts away from the frame timestamps by
+// more than this we resynchronize it and signal a discontinuity to
+// the receiver instead of producing a huge amount of padding or
+// sending out frames way too late.
+static constexpr std::uint64_t kMaxClockDriftTicks{kSystemClockRate / 2};
+
+// Bounds for the estimated frame interval which decides how much
+// padding is added after a frame.
+static constexpr std::int64_t kMinFrameIntervalUs{8333};
+static constexpr std::int64_t kMaxFrameIntervalUs{100000};
+static constexpr std::int64_t kDefaultFrameIntervalUs{33333};
+
+// See ISO/IEC 13818-1 2.4.2.3: transport buffer TB of the T-STD
+static constexpr double kTransportBufferSize{512.0};
+
+// Maximum video bitrate and CPB size per H.264 level in units of
+// 1000 bits, see ITU-T H.264 Table A-1.
+struct H264LevelLimits {
+    unsigned int level_idc;
+    std::uint32_t max_br;
+    std::uint32_t max_cpb;
+};
+
+static constexpr H264LevelLimits kH264LevelLimits[] = {
+    { 10, 64, 175 },
+    { 11, 192, 500 },
+    { 12, 384, 1000 },
+    { 13, 768, 2000 },
+    { 20, 2000, 2000 },
+    { 21, 4000, 4000 },
+    { 22, 4000, 4000 },
+    { 30, 10000, 10000 },
+    { 31, 14000, 14000 },
+    { 32, 20000, 20000 },
+    { 40, 20000, 25000 },
+    { 41, 50000, 62500 },
+    { 42, 50000, 62500 },
+    { 50, 135000, 135000 },
+    { 51, 240000, 240000 },
+};
+
+H264LevelLimits LookupLevelLimits(unsigned int level_idc) {
+    for (const auto &limits : kH264LevelLimits) {
+        if (limits.level_idc == level_idc)
+            return limits;
+    }
+    // Level 3.1 is what most of the WiFi Display sinks out there
+    // support so it is the most sensible fallback.
+    return { 31, 14000, 14000 };
+}
+
+void WritePCRPacket(uint8_t *ptr, std::uint64_t pcr, bool discontinuity) {
+    // PCR stream
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = kPCR_PID (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b10 (adaptation field only, no payload)
+    // continuity_counter = b0000 (does not increment)
+    // adaptation_field_length = 183
+    // discontinuity_indicator = b?
+    // random_access_indicator = b0
+    // elementary_stream_priority_indicator = b0
+    // PCR_flag = b1
+    // OPCR_flag = b0
+    // splicing_point_flag = b0
+    // transport_private_data_flag = b0
+    // adaptation_field_extension_flag = b0
+    // program_clock_reference_base = b?????????????????????????????????
+    // reserved = b111111
+    // program_clock_reference_extension = b?????????
+
+    const uint8_t *start = ptr;
+
+    std::uint64_t PCR_base = pcr / 300;
+    std::uint32_t PCR_ext = pcr % 300;
+
+    *ptr++ = 0x47;
+    *ptr++ = 0x40 | (kPIDofPCR >> 8);
+    *ptr++ = kPIDofPCR & 0xff;
+    *ptr++ = 0x20;
+    *ptr++ = 0xb7;  // adaptation_field_length
+    *ptr++ = discontinuity ? 0x90 : 0x10;
+    *ptr++ = (PCR_base >> 25) & 0xff;
+    *ptr++ = (PCR_base >> 17) & 0xff;
+    *ptr++ = (PCR_base >> 9) & 0xff;
+    *ptr++ = (PCR_base >> 1) & 0xff;
+    *ptr++ = ((PCR_base & 1) << 7) | 0x7e | ((PCR_ext >> 8) & 1);
+    *ptr++ = (PCR_ext & 0xff);
+
+    ::memset(ptr, 0xff, start + kTSPacketSize - ptr);
+}
+
+void WriteNullPacket(uint8_t *ptr) {
+    // See ISO/IEC 13818-1 2.4.3.3: null packets have PID 0x1fff, carry
+    // payload only and their content is ignored by the receiver.
+    *ptr++ = 0x47;
+    *ptr++ = kPIDofNullPacket >> 8;
+    *ptr++ = kPIDofNullPacket & 0xff;
+    *ptr++ = 0x10;
+    ::memset(ptr, 0xff, kTSPacketSize - 4);
+}
+
+unsigned int PIDOfPacket(const uint8_t *packet) {
+    return ((packet[1] & 0x1f) << 8) | packet[2];
+}
 }
 
 namespace ac {
@@ -60,10 +179,10 @@ struct MPEGTSPacketizer::Track {
 
     unsigned int NextContinuityCounter();
 
-    bool IsAudio() const { return ac::Utils::StringStartsWith(format.mime, "audio/"); }
-    bool IsVideo() const { return ac::Utils::StringStartsWith(format.mime, "video/"); }
+    bool IsAudio() const { return is_audio; }
+    bool IsVideo() const { return is_video; }
 
-    bool IsH264() const { return format.mime == "video/avc"; }
+    bool IsH264() const { return is_h264; }
 
     void SubmitCSD(const ac::video::Buffer::Ptr &buffer);
 
@@ -80,6 +199,10 @@ struct MPEGTSPacketizer::Track {
     unsigned int stream_id;
     unsigned int continuity_counter;
     bool finalized;
+    // Cached to avoid string comparisons for every frame
+    bool is_audio;
+    bool is_video;
+    bool is_h264;
     std::vector<ac::video::Buffer::Ptr> csd;
     std::vector<ac::video::Buffer::Ptr> descriptors;
 };
@@ -96,7 +219,10 @@ MPEGTSPacketizer::Track::Track(const TrackFormat &format, unsigned int pid,
     stream_type(stream_type),
     stream_id(stream_id),
     continuity_counter(0),
-    finalized(false) {
+    finalized(false),
+    is_audio(ac::Utils::StringStartsWith(format.mime, "audio/")),
+    is_video(ac::Utils::StringStartsWith(format.mime, "video/")),
+    is_h264(format.mime == "video/avc") {
 }
 
 unsigned int MPEGTSPacketizer::Track::NextContinuityCounter() {
@@ -117,7 +243,8 @@ void MPEGTSPacketizer::Track::SubmitCSD(const video::Buffer::Ptr &buffer) {
     size_t nal_size;
 
     while (ac::video::GetNextNALUnit(&data, &size, &nal_start, &nal_size, true)) {
-        auto current = ac::video::Buffer::Create(nal_size + sizeof(kH264NALPrefix));
+        auto current = ac::video::Buffer::Create(nal_size + sizeof(kH264NALPrefix),
+                                                 ac::video::MemoryBudget::Stage::kCodecConfig);
 
         ::memcpy(current->Data(), kH264NALPrefix, sizeof(kH264NALPrefix));
         ::memcpy(current->Data() + sizeof(kH264NALPrefix), nal_start, nal_size);
@@ -131,7 +258,8 @@ ac::video::Buffer::Ptr MPEGTSPacketizer::Track::PrependCSD(const ac::video::Buff
     for (auto current : csd)
         size += current->Length();
 
-    auto new_buffer = ac::video::Buffer::Create(buffer->Length() + size);
+    auto new_buffer = ac::video::Buffer::Create(buffer->Length() + size,
+                                                ac::video::MemoryBudget::Stage::kEncoder);
     size_t offset = 0;
     for (auto current : csd) {
         ::memcpy(new_buffer->Data() + offset, current->Data(), current->Length());
@@ -205,12 +333,186 @@ void MPEGTSPacketizer::Track::Finalize() {
     finalized = true;
 }
 
-Packetizer::Ptr MPEGTSPacketizer::Create(const ac::video::PacketizerReport::Ptr &report) {
-    return std::shared_ptr<Packetizer>(new MPEGTSPacketizer(report));
+// Schedules the packets of a constant bitrate stream. Every packet
+// leaving the multiplexer advances its clock by the time it takes to
+// transmit it at the configured rate so that the PCR we write into
+// the stream always matches the position of the packet in it. Video
+// packets are only released when they fit into the buffers of the
+// transport stream system target decoder (T-STD) model. This is a
+// simplified model of ISO/IEC 13818-1 2.4.2 which combines the
+// multiplexing and elementary stream buffers into a single one sized
+// after the CPB of the H.264 level in use.
+struct MPEGTSPacketizer::Multiplexer {
+    Multiplexer(const Config &config);
+
+    std::uint64_t Clock() const { return clock; }
+
+    // Synchronizes the multiplexer clock with the timestamp of the
+    // next frame and returns the number of padding packets needed
+    // before the frame can be sent out.
+    size_t Synchronize(const TimestampUs &timestamp);
+
+    // Returns the number of packets which have to be sent after the
+    // current frame until the next one is expected.
+    size_t PaddingAfter(const TimestampUs &timestamp) const;
+
+    void UpdateFrameInterval(const TimestampUs &timestamp);
+
+    void ConfigureTrack(const TrackFormat &format);
+
+    bool IsPCRDue() const;
+    bool CanAcceptVideoPacket();
+
+    void AdvanceClock();
+    void AdvanceDecoderModel();
+
+    std::uint32_t mux_rate;
+    std::uint64_t pcr_interval;
+    std::uint64_t decode_delay;
+
+    bool synchronized;
+    bool discontinuity;
+    bool force_pcr;
+    std::uint64_t clock;
+    std::uint64_t clock_remainder;
+    std::uint64_t last_pcr;
+    TimestampUs last_timestamp;
+    std::int64_t frame_interval;
+
+    // T-STD model state
+    double leak_rate;
+    double elementary_buffer_size;
+    double transport_buffer;
+    double elementary_buffer;
+    std::uint64_t decoder_clock;
+    std::deque<std::pair<std::uint64_t, size_t>> pending_removals;
+};
+
+MPEGTSPacketizer::Multiplexer::Multiplexer(const Config &config) :
+    mux_rate(config.mux_rate),
+    pcr_interval(std::chrono::duration_cast<std::chrono::microseconds>(config.pcr_interval).count() * kSystemClockTicksPerUs),
+    decode_delay(std::chrono::duration_cast<std::chrono::microseconds>(config.decode_delay).count() * kSystemClockTicksPerUs),
+    synchronized(false),
+    discontinuity(false),
+    force_pcr(true),
+    clock(0),
+    clock_remainder(0),
+    last_pcr(0),
+    last_timestamp(-1),
+    frame_interval(kDefaultFrameIntervalUs),
+    leak_rate(0.0),
+    elementary_buffer_size(0.0),
+    transport_buffer(0.0),
+    elementary_buffer(0.0),
+    decoder_clock(0) {
+    ConfigureTrack(TrackFormat{});
+}
+
+void MPEGTSPacketizer::Multiplexer::ConfigureTrack(const TrackFormat &format) {
+    const auto limits = LookupLevelLimits(format.level_idc);
+    // See ISO/IEC 13818-1 2.14.3.1: TB is emptied with 1.2 times the
+    // maximum bitrate of the level (cpbBrNalFactor is 1200 for the
+    // baseline, main and extended profiles). Leak rate is in bytes
+    // per system clock tick.
+    leak_rate = (1.2 * 1200.0 * limits.max_br) / 8.0 / kSystemClockRate;
+    elementary_buffer_size = 1200.0 * limits.max_cpb / 8.0;
+}
+
+size_t MPEGTSPacketizer::Multiplexer::Synchronize(const TimestampUs &timestamp) {
+    const std::uint64_t target = timestamp * kSystemClockTicksPerUs;
+
+    if (!synchronized || target > clock + kMaxClockDriftTicks || clock > target + kMaxClockDriftTicks) {
+        if (synchronized)
+            AC_WARNING("Multiplexer clock drifted too far (clock %lld target %lld); resyncing",
+                       clock, target);
+
+        clock = target;
+        clock_remainder = 0;
+        // Make sure we start with a PCR
+        force_pcr = true;
+        discontinuity = synchronized;
+        synchronized = true;
+
+        transport_buffer = 0.0;
+        elementary_buffer = 0.0;
+        decoder_clock = clock;
+        pending_removals.clear();
+        return 0;
+    }
+
+    if (clock >= target)
+        return 0;
+
+    const auto bits = (target - clock) * mux_rate / kSystemClockRate;
+    return bits / (kTSPacketSize * 8);
+}
+
+size_t MPEGTSPacketizer::Multiplexer::PaddingAfter(const TimestampUs &timestamp) const {
+    const std::uint64_t target = (timestamp + frame_interval) * kSystemClockTicksPerUs;
+    if (clock >= target)
+        return 0;
+
+    const auto bits = (target - clock) * mux_rate / kSystemClockRate;
+    return bits / (kTSPacketSize * 8);
+}
+
+void MPEGTSPacketizer::Multiplexer::UpdateFrameInterval(const TimestampUs &timestamp) {
+    if (last_timestamp >= 0 && timestamp > last_timestamp) {
+        const auto interval = timestamp - last_timestamp;
+        frame_interval = (frame_interval * 7 + interval) / 8;
+        frame_interval = std::min(std::max(frame_interval, kMinFrameIntervalUs), kMaxFrameIntervalUs);
+    }
+    last_timestamp = timestamp;
+}
+
+bool MPEGTSPacketizer::Multiplexer::IsPCRDue() const {
+    return force_pcr || clock >= last_pcr + pcr_interval;
+}
+
+bool MPEGTSPacketizer::Multiplexer::CanAcceptVideoPacket() {
+    AdvanceDecoderModel();
+
+    if (transport_buffer + kTSPacketSize > kTransportBufferSize)
+        return false;
+
+    if (elementary_buffer + transport_buffer + kTSPacketSize > elementary_buffer_size)
+        return false;
+
+    return true;
+}
+
+void MPEGTSPacketizer::Multiplexer::AdvanceClock() {
+    // Accumulate exactly to not let the PCR drift away from the byte
+    // position within the stream.
+    const std::uint64_t ticks = kTSPacketSize * 8 * kSystemClockRate + clock_remainder;
+    clock += ticks / mux_rate;
+    clock_remainder = ticks % mux_rate;
+}
+
+void MPEGTSPacketizer::Multiplexer::AdvanceDecoderModel() {
+    if (clock <= decoder_clock)
+        return;
+
+    const auto leaked = std::min(transport_buffer, (clock - decoder_clock) * leak_rate);
+    transport_buffer -= leaked;
+    elementary_buffer += leaked;
+    decoder_clock = clock;
+
+    while (!pending_removals.empty() && pending_removals.front().first <= clock) {
+        elementary_buffer = std::max(0.0, elementary_buffer - pending_removals.front().second);
+        pending_removals.pop_front();
+    }
+}
+
+Packetizer::Ptr MPEGTSPacketizer::Create(const ac::video::PacketizerReport::Ptr &report,
+                                         const Config &config) {
+    return std::shared_ptr<Packetizer>(new MPEGTSPacketizer(report, config));
 }
 
-MPEGTSPacketizer::MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report) :
+MPEGTSPacketizer::MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report, const Config &config) :
     report_(report),
+    config_(config),
+    multiplexer_(config.mux_rate > 0 ? std::make_shared<Multiplexer>(config) : nullptr),
     pat_continuity_counter_(0),
     pmt_continuity_counter_(0) {
     InitCrcTable();
@@ -258,6 +560,14 @@ MPEGTSPacketizer::TrackId MPEGTSPacketizer::AddTrack(const TrackFormat &format)
     auto track = Track::Create(format, pid, stream_type, stream_id);
     tracks_.push_back(track);
 
+    if (multiplexer_)
+        multiplexer_->ConfigureTrack(format);
+
+    if (config_.single_track_fast_path && tracks_.size() == 1 && track->IsH264())
+        h264_writer_.reset(new PESPacketWriter<H264StreamTraits>(track->pid));
+    else
+        h264_writer_.reset();
+
     return tracks_.size() - 1;
 }
 
@@ -286,12 +596,34 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
 
     auto track = tracks_.at(track_index);
 
+    if (multiplexer_) {
+        // PCR packets are placed by the multiplexer when running with
+        // a constant bitrate.
+        flags &= ~Flags::kEmitPCR;
+        // The PTS has to be ahead of the PCR by the time the receiver
+        // needs to buffer the frame before decoding it.
+        timeUs += std::chrono::duration_cast<std::chrono::microseconds>(config_.decode_delay).count();
+    }
+
     if (track->IsH264() && (flags & Flags::kPrependSPSandPPStoIDRFrames)
             && ac::video::DoesBufferContainIDRFrame(access_unit)) {
         // prepend codec specific data, i.e. SPS and PPS.
         access_unit = track->PrependCSD(access_unit);
     }
 
+    if (h264_writer_) {
+        auto buffer = PacketizeSingleTrack(access_unit, timeUs, flags);
+
+        if (multiplexer_)
+            buffer = Multiplex(track->pid, buffer);
+
+        *packets = buffer;
+
+        report_->PacketizedFrame(buffer->Timestamp());
+
+        return true;
+    }
+
     // 0x47
     // transport_error_indicator = b0
     // payload_unit_start_indicator = b1
@@ -419,234 +751,19 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     if (flags & Flags::kEmitPCR)
         ++numTSPackets;
 
-    auto buffer = ac::video::Buffer::Create(numTSPackets * 188);
+    auto buffer = ac::video::Buffer::Create(numTSPackets * 188, ac::video::MemoryBudget::Stage::kPacketizer);
     buffer->SetTimestamp(access_unit->Timestamp());
 
     uint8_t *packetDataStart = buffer->Data();
 
     if (flags & Flags::kEmitPATandPMT) {
-        // Program Association Table (PAT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = b0000000000000 (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // --- payload follows
-        // table_id = 0x00
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x00d
-        // transport_stream_id = 0x0000
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        //   one program follows:
-        //   program_number = 0x0001
-        //   reserved = b111
-        //   program_map_PID = kPID_PMT (13 bits!)
-        // CRC = 0x????????
-
-        if (++pat_continuity_counter_ == 16)
-            pat_continuity_counter_ = 0;
-
-        uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40;
-        *ptr++ = 0x00;
-        *ptr++ = 0x10 | pat_continuity_counter_;
-        *ptr++ = 0x00;
-
-        uint8_t *crcDataStart = ptr;
-        *ptr++ = 0x00;
-        *ptr++ = 0xb0;
-        *ptr++ = 0x0d;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xe0 | (kPIDofPMT >> 8);
-        *ptr++ = kPIDofPMT & 0xff;
-
-        if (ptr - crcDataStart != 12)
-            AC_FATAL("Invalid position for ptr");
-
-        uint32_t crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
-        ::memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        size_t sizeLeft = packetDataStart + 188 - ptr;
-        ::memset(ptr, 0xff, sizeLeft);
-
-        packetDataStart += 188;
-
-        // Program Map (PMT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = kPID_PMT (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // -- payload follows
-        // table_id = 0x02
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x???
-        // program_number = 0x0001
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        // reserved = b111
-        // PCR_PID = kPCR_PID (13 bits)
-        // reserved = b1111
-        // program_info_length = 0x???
-        //   program_info_descriptors follow
-        // one or more elementary stream descriptions follow:
-        //   stream_type = 0x??
-        //   reserved = b111
-        //   elementary_PID = b? ???? ???? ???? (13 bits)
-        //   reserved = b1111
-        //   ES_info_length = 0x000
-        // CRC = 0x????????
-
-        if (++pmt_continuity_counter_ == 16)
-            pmt_continuity_counter_ = 0;
-
-        ptr = packetDataStart;
-
-        *ptr++ = 0x47;
-        *ptr++ = 0x40 | (kPIDofPMT >> 8);
-        *ptr++ = kPIDofPMT & 0xff;
-        *ptr++ = 0x10 | pmt_continuity_counter_;
-        *ptr++ = 0x00;
-
-        crcDataStart = ptr;
-        *ptr++ = 0x02;
-
-        *ptr++ = 0x00;  // section_length to be filled in below.
-        *ptr++ = 0x00;
-
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xe0 | (kPIDofPCR >> 8);
-        *ptr++ = kPIDofPCR & 0xff;
-
-        size_t program_info_length = 0;
-        for (auto descriptor : program_info_descriptors_)
-            program_info_length += descriptor->Length();
-
-        if(program_info_length >= 0x400)
-            AC_FATAL("Invalid length for program info");
-
-        *ptr++ = 0xf0 | (program_info_length >> 8);
-        *ptr++ = (program_info_length & 0xff);
-
-        for (auto descriptor : program_info_descriptors_) {
-            ::memcpy(ptr, descriptor->Data(), descriptor->Length());
-            ptr += descriptor->Length();
-        }
-
-        for (auto track : tracks_) {
-            // Make sure all the decriptors have been added.
-            track->Finalize();
-
-            *ptr++ = track->stream_type;
-            *ptr++ = 0xe0 | (track->pid >> 8);
-            *ptr++ = track->pid & 0xff;
-
-            size_t ES_info_length = 0;
-            for (auto descriptor : track->descriptors)
-                ES_info_length += descriptor->Length();
-
-            if (ES_info_length > 0xfff)
-                AC_FATAL("Invalid ES length %d", ES_info_length);
-
-            *ptr++ = 0xf0 | (ES_info_length >> 8);
-            *ptr++ = (ES_info_length & 0xff);
-
-            for (auto descriptor : track->descriptors) {
-                memcpy(ptr, descriptor->Data(), descriptor->Length());
-                ptr += descriptor->Length();
-            }
-        }
-
-        size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
-
-        crcDataStart[1] = 0xb0 | (section_length >> 8);
-        crcDataStart[2] = section_length & 0xff;
-
-        crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
-        memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        sizeLeft = packetDataStart + 188 - ptr;
-        memset(ptr, 0xff, sizeLeft);
-
-        packetDataStart += 188;
+        WriteProgramTables(packetDataStart);
+        packetDataStart += 2 * 188;
     }
 
     if (flags & Flags::kEmitPCR) {
-        // PCR stream
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = kPCR_PID (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b10 (adaptation field only, no payload)
-        // continuity_counter = b0000 (does not increment)
-        // adaptation_field_length = 183
-        // discontinuity_indicator = b0
-        // random_access_indicator = b0
-        // elementary_stream_priority_indicator = b0
-        // PCR_flag = b1
-        // OPCR_flag = b0
-        // splicing_point_flag = b0
-        // transport_private_data_flag = b0
-        // adaptation_field_extension_flag = b0
-        // program_clock_reference_base = b?????????????????????????????????
-        // reserved = b111111
-        // program_clock_reference_extension = b?????????
-
-        int64_t nowUs = ac::Utils::GetNowUs();
-        uint64_t PCR = nowUs * 27;  // PCR based on a 27MHz clock
-        uint64_t PCR_base = PCR / 300;
-        uint32_t PCR_ext = PCR % 300;
-
-        uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40 | (kPIDofPCR >> 8);
-        *ptr++ = kPIDofPCR & 0xff;
-        *ptr++ = 0x20;
-        *ptr++ = 0xb7;  // adaptation_field_length
-        *ptr++ = 0x10;
-        *ptr++ = (PCR_base >> 25) & 0xff;
-        *ptr++ = (PCR_base >> 17) & 0xff;
-        *ptr++ = (PCR_base >> 9) & 0xff;
-        *ptr++ = ((PCR_base & 1) << 7) | 0x7e | ((PCR_ext >> 8) & 1);
-        *ptr++ = (PCR_ext & 0xff);
-
-        size_t sizeLeft = packetDataStart + 188 - ptr;
-        ::memset(ptr, 0xff, sizeLeft);
-
+        // PCR based on a 27MHz clock
+        WritePCRPacket(packetDataStart, ac::Utils::GetNowUs() * kSystemClockTicksPerUs, false);
         packetDataStart += 188;
     }
 
@@ -795,6 +912,9 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     if (packetDataStart != buffer->Data() + buffer->Length())
         AC_FATAL("Invalid packet start position");
 
+    if (multiplexer_)
+        buffer = Multiplex(track->pid, buffer);
+
     *packets = buffer;
 
     report_->PacketizedFrame(buffer->Timestamp());
@@ -802,6 +922,312 @@ bool MPEGTSPacketizer::Packetize(TrackId track_index, const video::Buffer::Ptr &
     return true;
 }
 
+ac::video::Buffer::Ptr MPEGTSPacketizer::PacketizeSingleTrack(const ac::video::Buffer::Ptr &access_unit,
+                                                              int64_t timestamp, int flags) {
+    size_t num_ts_packets = h264_writer_->PacketCount(access_unit->Length());
+
+    if (flags & Flags::kEmitPATandPMT)
+        num_ts_packets += 2;
+
+    if (flags & Flags::kEmitPCR)
+        ++num_ts_packets;
+
+    auto buffer = ac::video::Buffer::Create(num_ts_packets * kTSPacketSize,
+                                            ac::video::MemoryBudget::Stage::kPacketizer);
+    buffer->SetTimestamp(access_unit->Timestamp());
+
+    uint8_t *ptr = buffer->Data();
+
+    if (flags & Flags::kEmitPATandPMT) {
+        WriteProgramTables(ptr);
+        ptr += 2 * kTSPacketSize;
+    }
+
+    if (flags & Flags::kEmitPCR) {
+        WritePCRPacket(ptr, ac::Utils::GetNowUs() * kSystemClockTicksPerUs, false);
+        ptr += kTSPacketSize;
+    }
+
+    // Adjust time to 90kHz
+    const uint64_t pts = (timestamp * 9ll) / 100ll;
+
+    auto track = tracks_.front();
+    ptr = h264_writer_->Write(ptr, access_unit->Data(), access_unit->Length(),
+                              pts, track->continuity_counter);
+
+    if (ptr != buffer->Data() + buffer->Length())
+        AC_FATAL("Invalid packet start position");
+
+    return buffer;
+}
+
+void MPEGTSPacketizer::WriteProgramTables(uint8_t *data) {
+    // Program Association Table (PAT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = b0000000000000 (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b????
+    // skip = 0x00
+    // --- payload follows
+    // table_id = 0x00
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x00d
+    // transport_stream_id = 0x0000
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    //   one program follows:
+    //   program_number = 0x0001
+    //   reserved = b111
+    //   program_map_PID = kPID_PMT (13 bits!)
+    // CRC = 0x????????
+
+    if (++pat_continuity_counter_ == 16)
+        pat_continuity_counter_ = 0;
+
+    uint8_t *packetDataStart = data;
+    uint8_t *ptr = packetDataStart;
+    *ptr++ = 0x47;
+    *ptr++ = 0x40;
+    *ptr++ = 0x00;
+    *ptr++ = 0x10 | pat_continuity_counter_;
+    *ptr++ = 0x00;
+
+    uint8_t *crcDataStart = ptr;
+    *ptr++ = 0x00;
+    *ptr++ = 0xb0;
+    *ptr++ = 0x0d;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xe0 | (kPIDofPMT >> 8);
+    *ptr++ = kPIDofPMT & 0xff;
+
+    if (ptr - crcDataStart != 12)
+        AC_FATAL("Invalid position for ptr");
+
+    uint32_t crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
+    ::memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    size_t sizeLeft = packetDataStart + 188 - ptr;
+    ::memset(ptr, 0xff, sizeLeft);
+
+    packetDataStart += 188;
+
+    // Program Map (PMT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = kPID_PMT (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b????
+    // skip = 0x00
+    // -- payload follows
+    // table_id = 0x02
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x???
+    // program_number = 0x0001
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    // reserved = b111
+    // PCR_PID = kPCR_PID (13 bits)
+    // reserved = b1111
+    // program_info_length = 0x???
+    //   program_info_descriptors follow
+    // one or more elementary stream descriptions follow:
+    //   stream_type = 0x??
+    //   reserved = b111
+    //   elementary_PID = b? ???? ???? ???? (13 bits)
+    //   reserved = b1111
+    //   ES_info_length = 0x000
+    // CRC = 0x????????
+
+    if (++pmt_continuity_counter_ == 16)
+        pmt_continuity_counter_ = 0;
+
+    ptr = packetDataStart;
+
+    *ptr++ = 0x47;
+    *ptr++ = 0x40 | (kPIDofPMT >> 8);
+    *ptr++ = kPIDofPMT & 0xff;
+    *ptr++ = 0x10 | pmt_continuity_counter_;
+    *ptr++ = 0x00;
+
+    crcDataStart = ptr;
+    *ptr++ = 0x02;
+
+    *ptr++ = 0x00;  // section_length to be filled in below.
+    *ptr++ = 0x00;
+
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xe0 | (kPIDofPCR >> 8);
+    *ptr++ = kPIDofPCR & 0xff;
+
+    size_t program_info_length = 0;
+    for (auto descriptor : program_info_descriptors_)
+        program_info_length += descriptor->Length();
+
+    if(program_info_length >= 0x400)
+        AC_FATAL("Invalid length for program info");
+
+    *ptr++ = 0xf0 | (program_info_length >> 8);
+    *ptr++ = (program_info_length & 0xff);
+
+    for (auto descriptor : program_info_descriptors_) {
+        ::memcpy(ptr, descriptor->Data(), descriptor->Length());
+        ptr += descriptor->Length();
+    }
+
+    for (auto track : tracks_) {
+        // Make sure all the decriptors have been added.
+        track->Finalize();
+
+        *ptr++ = track->stream_type;
+        *ptr++ = 0xe0 | (track->pid >> 8);
+        *ptr++ = track->pid & 0xff;
+
+        size_t ES_info_length = 0;
+        for (auto descriptor : track->descriptors)
+            ES_info_length += descriptor->Length();
+
+        if (ES_info_length > 0xfff)
+            AC_FATAL("Invalid ES length %d", ES_info_length);
+
+        *ptr++ = 0xf0 | (ES_info_length >> 8);
+        *ptr++ = (ES_info_length & 0xff);
+
+        for (auto descriptor : track->descriptors) {
+            memcpy(ptr, descriptor->Data(), descriptor->Length());
+            ptr += descriptor->Length();
+        }
+    }
+
+    size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
+
+    crcDataStart[1] = 0xb0 | (section_length >> 8);
+    crcDataStart[2] = section_length & 0xff;
+
+    crc = ::htonl(CalcCrc32(crcDataStart, ptr - crcDataStart));
+    memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    sizeLeft = packetDataStart + 188 - ptr;
+    memset(ptr, 0xff, sizeLeft);
+}
+
+ac::video::Buffer::Ptr MPEGTSPacketizer::Multiplex(unsigned int pid, const ac::video::Buffer::Ptr &payload) {
+    const auto timestamp = payload->Timestamp();
+    const size_t num_payload_packets = payload->Length() / kTSPacketSize;
+
+    size_t padding = multiplexer_->Synchronize(timestamp);
+    multiplexer_->UpdateFrameInterval(timestamp);
+
+    // The exact number of packets we end up with depends on the
+    // decoder model so we collect them first and copy them over
+    // into a single buffer afterwards.
+    std::vector<uint8_t> output;
+    output.reserve((padding + num_payload_packets * 2) * kTSPacketSize);
+
+    size_t num_null_packets = 0;
+
+    auto emit_filler = [&]() {
+        const auto offset = output.size();
+        output.resize(offset + kTSPacketSize);
+
+        if (multiplexer_->IsPCRDue()) {
+            WritePCRPacket(&output[offset], multiplexer_->Clock(), multiplexer_->discontinuity);
+            multiplexer_->last_pcr = multiplexer_->Clock();
+            multiplexer_->discontinuity = false;
+            multiplexer_->force_pcr = false;
+        } else {
+            WriteNullPacket(&output[offset]);
+            num_null_packets++;
+        }
+
+        multiplexer_->AdvanceClock();
+    };
+
+    for (size_t n = 0; n < padding; n++)
+        emit_filler();
+
+    // Upper limit of packets we're going to wait for the decoder
+    // model to accept the next one; one second at the mux rate.
+    const size_t max_stalled_packets = multiplexer_->mux_rate / (kTSPacketSize * 8) + 1;
+
+    size_t num_video_bytes = 0;
+
+    for (size_t n = 0; n < num_payload_packets; n++) {
+        const uint8_t *packet = payload->Data() + n * kTSPacketSize;
+        const bool is_video = PIDOfPacket(packet) == pid;
+
+        while (multiplexer_->IsPCRDue())
+            emit_filler();
+
+        if (is_video) {
+            size_t stalled = 0;
+            while (!multiplexer_->CanAcceptVideoPacket() && stalled < max_stalled_packets) {
+                emit_filler();
+                stalled++;
+            }
+
+            if (stalled == max_stalled_packets)
+                AC_WARNING("Decoder buffer model did not drain; sending packet anyway");
+
+            multiplexer_->transport_buffer += kTSPacketSize;
+            num_video_bytes += kTSPacketSize;
+        }
+
+        const auto offset = output.size();
+        output.resize(offset + kTSPacketSize);
+        ::memcpy(&output[offset], packet, kTSPacketSize);
+
+        multiplexer_->AdvanceClock();
+    }
+
+    const std::uint64_t decoding_time = timestamp * kSystemClockTicksPerUs + multiplexer_->decode_delay;
+    if (multiplexer_->Clock() > decoding_time)
+        AC_WARNING("Frame %lld arrives after its decoding time; receiver buffer will underflow",
+                   timestamp);
+
+    multiplexer_->pending_removals.push_back(std::make_pair(decoding_time, num_video_bytes));
+
+    padding = multiplexer_->PaddingAfter(timestamp);
+    for (size_t n = 0; n < padding; n++)
+        emit_filler();
+
+    auto buffer = ac::video::Buffer::Create(output.size(), ac::video::MemoryBudget::Stage::kPacketizer);
+    ::memcpy(buffer->Data(), output.data(), output.size());
+    buffer->SetTimestamp(timestamp);
+
+    report_->PaddedFrame(timestamp, num_null_packets, output.size() / kTSPacketSize);
+
+    return buffer;
+}
+
 void MPEGTSPacketizer::InitCrcTable() {
     uint32_t poly = 0x04C11DB7;
 
@@ -18,19 +18,50 @@
 #ifndef AC_STREAMING_MPEGTSPACKETIZER_H_
 #define AC_STREAMING_MPEGTSPACKETIZER_H_
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
 #include "ac/video/packetizerreport.h"
 
 #include "ac/streaming/packetizer.h"
+#include "ac/streaming/pespacketwriter.h"
 
 namespace ac {
 namespace streaming {
 
 class MPEGTSPacketizer : public Packetizer {
 public:
-    static Packetizer::Ptr Create(const ac::video::PacketizerReport::Ptr &report);
+    class Config {
+    public:
+        Config() :
+            mux_rate(0),
+            pcr_interval(std::chrono::milliseconds{40}),
+            decode_delay(std::chrono::milliseconds{100}),
+            single_track_fast_path(true) {
+        }
+
+        // Target multiplex rate in bits per second. With a rate of zero
+        // the packetizer produces a variable bitrate stream and emits
+        // PCR packets only when asked to through kEmitPCR. With a rate
+        // set the output is a constant bitrate stream: the gaps between
+        // frames are filled with null packets and PCR packets are
+        // inserted by the packetizer itself every pcr_interval. TS packet
+        // n of the stream is then meant to leave the sender exactly
+        // n * 188 * 8 / mux_rate seconds after the first one.
+        std::uint32_t mux_rate;
+        std::chrono::milliseconds pcr_interval;
+        // Time between a frame entering the multiplexer and its decoding
+        // at the receiver. Only used in constant bitrate mode where the
+        // PTS needs to be ahead of the PCR for the T-STD to be satisfied.
+        std::chrono::milliseconds decode_delay;
+        // Use a packetizer specialized for streams with just a single
+        // H.264 track (the WiFi Display default) whenever possible.
+        bool single_track_fast_path;
+    };
+
+    static Packetizer::Ptr Create(const ac::video::PacketizerReport::Ptr &report,
+                                  const Config &config = Config{});
 
     ~MPEGTSPacketizer();
 
@@ -42,22 +73,31 @@ public:
                    video::Buffer::Ptr *packets, int flags = 0) override;
 
 private:
-    MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report);
+    MPEGTSPacketizer(const ac::video::PacketizerReport::Ptr &report, const Config &config);
 
 private:
     void InitCrcTable();
     uint32_t CalcCrc32(const uint8_t *start, size_t size) const;
 
+    void WriteProgramTables(uint8_t *data);
+    video::Buffer::Ptr PacketizeSingleTrack(const video::Buffer::Ptr &access_unit,
+                                            int64_t timestamp, int flags);
+    video::Buffer::Ptr Multiplex(unsigned int pid, const video::Buffer::Ptr &payload);
+
 private:
     struct Track;
+    struct Multiplexer;
 
 private:
     ac::video::PacketizerReport::Ptr report_;
+    Config config_;
+    std::shared_ptr<Multiplexer> multiplexer_;
     unsigned int pat_continuity_counter_;
     unsigned int pmt_continuity_counter_;
     uint32_t crc_table_[256];
     std::vector<std::shared_ptr<Track>> tracks_;
     std::vector<video::Buffer::Ptr> program_info_descriptors_;
+    std::unique_ptr<PESPacketWriter<H264StreamTraits>> h264_writer_;
 };
 
 } // namespace streaming
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_PESPACKETWRITER_H_
+#define AC_STREAMING_PESPACKETWRITER_H_
+
+#include <memory.h>
+
+#include <cstdint>
+#include <cstddef>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace streaming {
+
+struct H264StreamTraits {
+    static constexpr unsigned int kStreamType{0x1b};
+    static constexpr unsigned int kStreamId{0xe0};
+};
+
+/**
+ * @brief Writes a single access unit as PES packet split over transport
+ * stream packets for a stream known at compile time.
+ *
+ * Compared to the generic path in MPEGTSPacketizer it doesn't support
+ * PES private data, stuffing or HDCP payload alignment and works with
+ * headers which are prepared once and only get patched per frame.
+ */
+template<typename StreamTraits>
+class PESPacketWriter : public ac::NonCopyable {
+public:
+    static constexpr std::size_t kTSPacketSize{188};
+    static constexpr std::size_t kTSHeaderSize{4};
+    static constexpr std::size_t kPESHeaderSize{14};
+    static constexpr std::size_t kFirstPayloadSize{kTSPacketSize - kTSHeaderSize - kPESHeaderSize};
+    static constexpr std::size_t kPayloadSize{kTSPacketSize - kTSHeaderSize};
+
+    explicit PESPacketWriter(unsigned int pid) {
+        first_ts_header_[0] = 0x47;
+        first_ts_header_[1] = 0x40 | (pid >> 8);
+        first_ts_header_[2] = pid & 0xff;
+        first_ts_header_[3] = 0x00;
+
+        ts_header_[0] = 0x47;
+        ts_header_[1] = pid >> 8;
+        ts_header_[2] = pid & 0xff;
+        ts_header_[3] = 0x00;
+
+        uint8_t *ptr = pes_header_;
+        *ptr++ = 0x00;
+        *ptr++ = 0x00;
+        *ptr++ = 0x01;
+        *ptr++ = StreamTraits::kStreamId;
+        *ptr++ = 0x00;  // PES_packet_length, filled in per frame
+        *ptr++ = 0x00;
+        *ptr++ = 0x84;  // data_alignment_indicator
+        *ptr++ = 0x80;  // PTS only
+        *ptr++ = 0x05;  // PES_header_data_length
+    }
+
+    static std::size_t PacketCount(std::size_t size) {
+        if (size <= kFirstPayloadSize)
+            return 1;
+
+        return 1 + (size - kFirstPayloadSize + kPayloadSize - 1) / kPayloadSize;
+    }
+
+    // Writes PacketCount(size) transport stream packets to data and
+    // returns the position right after the last one. The continuity
+    // counter is owned by the caller so that it stays consistent with
+    // packets written for the same PID through other paths.
+    uint8_t* Write(uint8_t *data, const uint8_t *payload, std::size_t size,
+                   std::uint64_t pts, unsigned int &continuity_counter) {
+        std::size_t pes_packet_length = size + 8;
+        // It's valid to set this to 0 for video according to the specs.
+        if (pes_packet_length >= 65536)
+            pes_packet_length = 0;
+
+        pes_header_[4] = pes_packet_length >> 8;
+        pes_header_[5] = pes_packet_length & 0xff;
+        pes_header_[9] = 0x20 | (((pts >> 30) & 7) << 1) | 1;
+        pes_header_[10] = (pts >> 22) & 0xff;
+        pes_header_[11] = (((pts >> 15) & 0x7f) << 1) | 1;
+        pes_header_[12] = (pts >> 7) & 0xff;
+        pes_header_[13] = ((pts & 0x7f) << 1) | 1;
+
+        std::size_t copy = size < kFirstPayloadSize ? size : kFirstPayloadSize;
+        uint8_t *ptr = WriteHeader(data, first_ts_header_, kFirstPayloadSize - copy, continuity_counter);
+
+        ::memcpy(ptr, pes_header_, kPESHeaderSize);
+        ptr += kPESHeaderSize;
+        ::memcpy(ptr, payload, copy);
+        ptr += copy;
+
+        std::size_t offset = copy;
+        while (offset < size) {
+            copy = size - offset;
+            if (copy > kPayloadSize)
+                copy = kPayloadSize;
+
+            ptr = WriteHeader(ptr, ts_header_, kPayloadSize - copy, continuity_counter);
+            ::memcpy(ptr, payload + offset, copy);
+            ptr += copy;
+            offset += copy;
+        }
+
+        return ptr;
+    }
+
+private:
+    uint8_t* WriteHeader(uint8_t *ptr, const uint8_t *header, std::size_t padding,
+                         unsigned int &continuity_counter) {
+        ::memcpy(ptr, header, kTSHeaderSize);
+        ptr[3] = (padding > 0 ? 0x30 : 0x10) | continuity_counter;
+        continuity_counter = (continuity_counter + 1) & 0x0f;
+        ptr += kTSHeaderSize;
+
+        if (padding > 0) {
+            *ptr++ = padding - 1;
+            if (padding >= 2) {
+                *ptr++ = 0x00;
+                ::memset(ptr, 0xff, padding - 2);
+                ptr += padding - 2;
+            }
+        }
+
+        return ptr;
+    }
+
+private:
+    uint8_t first_ts_header_[kTSHeaderSize];
+    uint8_t ts_header_[kTSHeaderSize];
+    uint8_t pes_header_[kPESHeaderSize];
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/rtpreceiver.h"
+
+namespace {
+static constexpr const char *kRTPReceiverThreadName{"RTPReceiver"};
+static constexpr unsigned int kUdpRxBufferSize = 512 * 1024;
+static constexpr unsigned int kMaxPacketSize{1500};
+static constexpr unsigned int kRTPHeaderSize{12};
+static constexpr unsigned int kRTPVersion{2};
+static constexpr unsigned int kRTPPayloadTypeMP2T{33};
+// Datagrams read with a single recvmmsg call. A 1080p IDR frame comes
+// in a few hundred packets so this keeps the syscall rate low.
+static constexpr unsigned int kBatchSize{32};
+// Makes sure we return to the executor from time to time
+static constexpr int kPollTimeoutMs{100};
+}
+
+namespace ac {
+namespace streaming {
+
+RTPReceiver::Ptr RTPReceiver::Create(const JitterBuffer::Ptr &jitter_buffer, network::Port port) {
+    const auto socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (socket < 0) {
+        AC_ERROR("Failed to create socket: %s (%d)", ::strerror(errno), errno);
+        return nullptr;
+    }
+
+    int value = kUdpRxBufferSize;
+    if (::setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value)) < 0)
+        AC_WARNING("Failed to set socket receive buffer size: %s (%d)", ::strerror(errno), errno);
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (::bind(socket, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        AC_ERROR("Failed to bind socket to port %d: %s (%d)", port, ::strerror(errno), errno);
+        ::close(socket);
+        return nullptr;
+    }
+
+    socklen_t length = sizeof(addr);
+    if (::getsockname(socket, reinterpret_cast<struct sockaddr*>(&addr), &length) < 0) {
+        AC_ERROR("Failed to query local address: %s (%d)", ::strerror(errno), errno);
+        ::close(socket);
+        return nullptr;
+    }
+
+    return std::shared_ptr<RTPReceiver>(new RTPReceiver(jitter_buffer, socket, ntohs(addr.sin_port)));
+}
+
+RTPReceiver::RTPReceiver(const JitterBuffer::Ptr &jitter_buffer, int socket, network::Port port) :
+    jitter_buffer_(jitter_buffer),
+    socket_(socket),
+    local_port_(port),
+    slots_(kBatchSize) {
+}
+
+RTPReceiver::~RTPReceiver() {
+    ::close(socket_);
+}
+
+network::Port RTPReceiver::LocalPort() const {
+    return local_port_;
+}
+
+bool RTPReceiver::Start() {
+    return true;
+}
+
+bool RTPReceiver::Stop() {
+    return true;
+}
+
+bool RTPReceiver::Execute() {
+    struct pollfd fds = { socket_, POLLIN, 0 };
+    const auto ret = ::poll(&fds, 1, kPollTimeoutMs);
+    if (ret < 0 && errno != EINTR) {
+        AC_ERROR("Failed to wait for packets: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+    else if (ret <= 0)
+        return true;
+
+    struct mmsghdr messages[kBatchSize];
+    struct iovec vectors[kBatchSize];
+
+    for (unsigned int n = 0; n < kBatchSize; n++) {
+        // Buffers handed out keep being referenced by the access units
+        // so every slot which got used needs a fresh one.
+        if (!slots_[n])
+            slots_[n] = video::Buffer::Create(kMaxPacketSize, video::MemoryBudget::Stage::kReceiver);
+
+        vectors[n].iov_base = slots_[n]->Data();
+        vectors[n].iov_len = kMaxPacketSize;
+
+        ::memset(&messages[n], 0, sizeof(messages[n]));
+        messages[n].msg_hdr.msg_iov = &vectors[n];
+        messages[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    const auto count = ::recvmmsg(socket_, messages, kBatchSize, MSG_DONTWAIT, nullptr);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return true;
+
+        AC_ERROR("Failed to receive packets: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    const auto now = ac::Utils::GetNowUs();
+
+    for (int n = 0; n < count; n++) {
+        auto packet = slots_[n];
+        slots_[n].reset();
+
+        packet->SetRange(0, messages[n].msg_len);
+        packet->SetTimestamp(now);
+        ProcessPacket(packet);
+    }
+
+    return true;
+}
+
+void RTPReceiver::ProcessPacket(const video::Buffer::Ptr &packet) {
+    const std::uint8_t *data = packet->Data();
+    std::uint32_t size = packet->Length();
+
+    if (size < kRTPHeaderSize || (data[0] >> 6) != kRTPVersion)
+        return;
+
+    if ((data[1] & 0x7f) != kRTPPayloadTypeMP2T)
+        return;
+
+    std::uint32_t header_size = kRTPHeaderSize + (data[0] & 0x0f) * 4;
+
+    // Header extension, we don't care about its content
+    if (data[0] & 0x10) {
+        if (size < header_size + 4)
+            return;
+
+        header_size += 4 + ((data[header_size + 2] << 8) | data[header_size + 3]) * 4;
+    }
+
+    // Padding, the last byte tells how much
+    if (data[0] & 0x20) {
+        if (size == 0 || data[size - 1] > size)
+            return;
+
+        size -= data[size - 1];
+    }
+
+    if (header_size >= size)
+        return;
+
+    const std::uint16_t sequence_number = (data[2] << 8) | data[3];
+    const std::uint32_t rtp_timestamp = (static_cast<std::uint32_t>(data[4]) << 24) |
+            (data[5] << 16) | (data[6] << 8) | data[7];
+
+    packet->SetRange(packet->Offset() + header_size, size - header_size);
+
+    jitter_buffer_->Insert(sequence_number, rtp_timestamp, packet);
+}
+
+std::string RTPReceiver::Name() const {
+    return kRTPReceiverThreadName;
+}
+
+} // namespace streaming
+} // namespace ac
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_STREAMING_RTPRECEIVER_H_
+#define AC_STREAMING_RTPRECEIVER_H_
+
+#include <memory>
+#include <vector>
+
+#include "ac/common/executable.h"
+
+#include "ac/network/types.h"
+
+#include "ac/video/buffer.h"
+
+#include "ac/streaming/jitterbuffer.h"
+
+namespace ac {
+namespace streaming {
+
+/**
+ * @brief Receives an MPEG-TS over RTP stream on a UDP port and feeds
+ * the payloads into a jitter buffer.
+ *
+ * Datagrams are read in batches with recvmmsg straight into the buffers
+ * which are later referenced by the demultiplexed access units.
+ */
+class RTPReceiver : public common::Executable {
+public:
+    typedef std::shared_ptr<RTPReceiver> Ptr;
+
+    // Binds to the given port or a random one if port is zero. Returns
+    // nullptr if the socket can't be set up.
+    static Ptr Create(const JitterBuffer::Ptr &jitter_buffer, network::Port port = 0);
+
+    ~RTPReceiver();
+
+    network::Port LocalPort() const;
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    RTPReceiver(const JitterBuffer::Ptr &jitter_buffer, int socket, network::Port port);
+
+    void ProcessPacket(const video::Buffer::Ptr &packet);
+
+private:
+    JitterBuffer::Ptr jitter_buffer_;
+    int socket_;
+    network::Port local_port_;
+    std::vector<video::Buffer::Ptr> slots_;
+};
+
+} // namespace streaming
+} // namespace ac
+
+#endif
@@ -28,6 +28,11 @@
 #include <error.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <vector>
+
 #include "ac/logger.h"
 
 #include "ac/streaming/rtpsender.h"
@@ -39,6 +44,9 @@ static constexpr unsigned int kMPEGTSPacketSize{188};
 static constexpr unsigned int kSourceID = 0xdeadbeef;
 // See http://www.iana.org/assignments/rtp-parameters/rtp-parameters.xhtml
 static constexpr unsigned int kRTPPayloadTypeMP2T = 33;
+// When pacing and we fall behind the schedule by more than this we
+// don't try to catch up by bursting but start a new schedule.
+static constexpr std::int64_t kMaxPacingLagNs{20000000};
 }
 
 namespace ac {
@@ -49,46 +57,146 @@ RTPSender::RTPSender(const network::Stream::Ptr &stream, const video::SenderRepo
     max_ts_packets_((stream->MaxUnitSize() - kRTPHeaderSize) / kMPEGTSPacketSize),
     report_(report),
     rtp_sequence_number_(0),
-    queue_(video::BufferQueue::Create()),
-    network_error_(false) {
+    queue_(video::BufferQueue::Create(0, "RTPSender")),
+    network_error_(false),
+    stopping_(false),
+    flush_requested_(false),
+    pacing_rate_(0),
+    next_send_time_ns_(0),
+    last_progress_(0) {
 }
 
 RTPSender::~RTPSender() {
 }
 
 bool RTPSender::Start() {
+    stopping_ = false;
     return true;
 }
 
 bool RTPSender::Stop() {
+    // Stops draining the queue after the packet currently being sent
+    // so we don't keep writing out a backlog to a peer which is gone.
+    stopping_ = true;
+    queue_->WakeUp();
     return true;
 }
 
-bool RTPSender::Execute() {
-    if (!queue_->WaitToBeFilled())
+void RTPSender::SetPacingRate(std::uint32_t bits_per_second) {
+    pacing_rate_ = bits_per_second;
+    next_send_time_ns_ = 0;
+}
+
+bool RTPSender::Send(const ac::video::Buffer::Ptr &packet) {
+    const auto error = stream_->Write(packet->Data(), packet->Length(), packet->Timestamp());
+
+    // The link is congested. The packet is late already and sending it
+    // again would only add to the congestion, so we go on with the next
+    // one. Not counting this as progress lets the watchdog catch a link
+    // which stays stalled.
+    if (error == network::Stream::Error::kTimedOut) {
+        report_->DroppedPacket(packet->Timestamp(), packet->Length());
         return true;
+    }
 
-    queue_->Lock();
+    if (error != network::Stream::Error::kNone) {
+        network_error_.exchange(true);
+        return false;
+    }
 
-    while(true) {
-        const auto packet = queue_->PopUnlocked();
-        if (!packet)
-            break;
+    report_->SentPacket(packet->Timestamp(), packet->Length());
+    last_progress_ = ac::Utils::GetNowUs();
 
-        if (stream_->Write(packet->Data(), packet->Length(), packet->Timestamp())
-                != network::Stream::Error::kNone) {
-            network_error_.exchange(true);
-            break;
+    return true;
+}
+
+bool RTPSender::SendPaced() {
+    const auto interrupted = [this]() { return stopping_ || flush_requested_; };
+
+    // The packet stays queued until it is sent; a flush drops it along
+    // with everything else.
+    if (interrupted())
+        return true;
+
+    const std::int64_t now = ac::Utils::GetNowUs() * 1000;
+    if (next_send_time_ns_ < now - kMaxPacingLagNs)
+        next_send_time_ns_ = now;
+
+    // Sleeping on the queue lets a stop or flush wake us up early
+    if (next_send_time_ns_ > now) {
+        const auto deadline = std::chrono::steady_clock::now() +
+                std::chrono::nanoseconds{next_send_time_ns_ - now};
+        if (queue_->WaitUntil(deadline, interrupted))
+            return true;
+    }
+
+    const auto packet = pending_.front();
+    pending_.pop();
+
+    if (!Send(packet))
+        return false;
+
+    const std::int64_t payload_bits = (packet->Length() - kRTPHeaderSize) * 8;
+    next_send_time_ns_ += payload_bits * 1000000000ll / pacing_rate_;
+
+    return true;
+}
+
+bool RTPSender::Execute() {
+    if (flush_requested_.exchange(false)) {
+        queue_->Clear();
+        std::queue<ac::video::Buffer::Ptr>().swap(pending_);
+    }
+
+    if (pending_.empty()) {
+        // Nothing to send counts as progress as well; only a write not
+        // getting through means we're stuck.
+        if (!queue_->WaitToBeFilled()) {
+            last_progress_ = ac::Utils::GetNowUs();
+            ReportTransmitTimestamps();
+            return true;
         }
 
-        report_->SentPacket(packet->Timestamp(), packet->Length());
+        queue_->Swap(pending_);
     }
 
-    queue_->Unlock();
+    if (pacing_rate_ > 0) {
+        const auto result = SendPaced();
+        ReportTransmitTimestamps();
+        return result;
+    }
+
+    while (!stopping_ && !flush_requested_ && !pending_.empty()) {
+        const auto packet = pending_.front();
+        pending_.pop();
+
+        if (!Send(packet))
+            break;
+    }
+
+    ReportTransmitTimestamps();
 
     return !network_error_;
 }
 
+void RTPSender::ReportDropped(const video::Buffer::Ptr &packets, uint32_t offset) {
+    // Accounted per RTP packet we would have sent, like drops of the stream
+    while (offset < packets->Length()) {
+        const auto size = std::min<uint32_t>(packets->Length() - offset, max_ts_packets_ * kMPEGTSPacketSize);
+        report_->DroppedPacket(packets->Timestamp(), kRTPHeaderSize + size);
+        offset += size;
+    }
+}
+
+void RTPSender::ReportTransmitTimestamps() {
+    // Timestamps are queued up by the kernel for the socket we write to
+    // and are read back on the same thread.
+    for (const auto &timestamp : stream_->ReadTransmitTimestamps())
+        report_->TransmittedPacket(timestamp.timestamp,
+                                   network::Stream::TransmitPointToString(timestamp.point),
+                                   timestamp.delay);
+}
+
 bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
     if (packets->Length() % kMPEGTSPacketSize != 0) {
         AC_WARNING("Packet buffer has an invalid length %d", packets->Length());
@@ -104,14 +212,25 @@ bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
         return false;
     }
 
-    queue_->Lock();
+    // Packets are built up front so the queue is only locked for
+    // handing them over.
+    std::vector<ac::video::Buffer::Ptr> rtp_packets;
+    rtp_packets.reserve(packets->Length() / (max_ts_packets_ * kMPEGTSPacketSize) + 1);
 
     uint32_t offset = 0;
     while (offset < packets->Length()) {
-        const auto packet = ac::video::Buffer::Create(kRTPHeaderSize + max_ts_packets_ * kMPEGTSPacketSize);
-
-        if (!packet->Data())
-            continue;
+        ac::video::Buffer::Ptr packet;
+        try {
+            packet = ac::video::Buffer::Create(kRTPHeaderSize + max_ts_packets_ * kMPEGTSPacketSize,
+                                               ac::video::MemoryBudget::Stage::kSender);
+        }
+        catch (const std::bad_alloc&) {
+            // Out of memory. The rest of the frame is lost; the receiver
+            // copes with that as with packets lost on the way.
+            AC_WARNING("Failed to allocate RTP packet; dropping rest of frame");
+            ReportDropped(packets, offset);
+            break;
+        }
 
         uint8_t *ptr = packet->Data();
 
@@ -151,12 +270,23 @@ bool RTPSender::Queue(const video::Buffer::Ptr &packets) {
 
         offset += num_ts_packets * kMPEGTSPacketSize;
 
-        queue_->PushUnlocked(packet);
+        rtp_packets.push_back(packet);
     }
 
+    queue_->Lock();
+    for (const auto &packet : rtp_packets)
+        queue_->PushUnlocked(packet);
     queue_->Unlock();
 
-    return true;
+    return offset == packets->Length();
+}
+
+void RTPSender::Flush() {
+    // Packets already taken over by the sender thread are only touched
+    // from there and a write might be what is stuck; leave the actual
+    // flush to the sender thread.
+    flush_requested_ = true;
+    queue_->WakeUp();
 }
 
 int32_t RTPSender::LocalPort() const {
@@ -167,5 +297,9 @@ std::string RTPSender::Name() const {
     return kRTPSenderThreadName;
 }
 
+ac::TimestampUs RTPSender::LastProgress() const {
+    return last_progress_;
+}
+
 } // namespace streaming
 } // namespace ac
@@ -44,15 +44,30 @@ public:
     RTPSender(const network::Stream::Ptr &stream, const video::SenderReport::Ptr &report);
     ~RTPSender();
 
+    // Spreads the queued packets evenly over time so that the stream
+    // leaves the device with the given rate in bits per second. This
+    // is meant for constant bitrate streams which have to arrive at
+    // the receiver with the timing they were multiplexed with. A rate
+    // of zero sends out queued packets as fast as possible.
+    void SetPacingRate(std::uint32_t bits_per_second);
+
     // From ac::streaming::TransportSender
     bool Queue(const ac::video::Buffer::Ptr &packets) override;
     int32_t LocalPort() const override;
+    void Flush() override;
 
     // From ac::common::Executable
     bool Start() override;
     bool Stop() override;
     bool Execute() override;
     std::string Name() const override;
+    ac::TimestampUs LastProgress() const override;
+
+private:
+    bool SendPaced();
+    bool Send(const ac::video::Buffer::Ptr &packet);
+    void ReportDropped(const video::Buffer::Ptr &packets, uint32_t offset);
+    void ReportTransmitTimestamps();
 
 private:
     network::Stream::Ptr stream_;
@@ -60,7 +75,15 @@ private:
     video::SenderReport::Ptr report_;
     uint16_t rtp_sequence_number_;
     ac::video::BufferQueue::Ptr queue_;
+    // Packets taken over from queue_ in one go. Only touched by the
+    // sender thread so the producer never waits for our writes.
+    std::queue<ac::video::Buffer::Ptr> pending_;
     std::atomic<bool> network_error_;
+    std::atomic<bool> stopping_;
+    std::atomic<bool> flush_requested_;
+    std::uint32_t pacing_rate_;
+    std::int64_t next_send_time_ns_;
+    std::atomic<ac::TimestampUs> last_progress_;
 };
 
 } // namespace streaming
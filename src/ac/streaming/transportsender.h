@@ -40,6 +40,9 @@ public:
     virtual bool Queue(const ac::video::Buffer::Ptr &packets) = 0;
     virtual int32_t LocalPort() const = 0;
 
+    // Drops everything queued but not sent yet
+    virtual void Flush() { }
+
 protected:
     std::weak_ptr<Delegate> delegate_;
 };
@@ -29,6 +29,14 @@ enum class DisplayState {
     On = 1,
 };
 
+enum class CpuLatencyState {
+    // The CPU may enter any idle state between our work items.
+    Unconstrained = 0,
+    // Idle states with a wakeup latency above a platform specific
+    // target are avoided.
+    Low = 1,
+};
+
 class SystemController {
 public:
     typedef std::shared_ptr<SystemController> Ptr;
@@ -61,6 +69,7 @@ public:
     virtual ~SystemController() = default;
 
     virtual Lock<DisplayState>::Ptr DisplayStateLock() = 0;
+    virtual Lock<CpuLatencyState>::Ptr CpuLatencyLock() = 0;
 };
 
 } // namespace ac
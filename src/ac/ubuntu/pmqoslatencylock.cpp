@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/concept_check.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/ubuntu/pmqoslatencylock.h"
+
+namespace ac {
+namespace ubuntu {
+
+constexpr const char *PmQosLatencyLock::kDefaultDevice;
+
+PmQosLatencyLock::Ptr PmQosLatencyLock::Create(const std::chrono::microseconds &target,
+                                               const std::string &device) {
+    return std::shared_ptr<PmQosLatencyLock>(new PmQosLatencyLock(target, device));
+}
+
+PmQosLatencyLock::PmQosLatencyLock(const std::chrono::microseconds &target, const std::string &device) :
+    target_(target),
+    device_(device),
+    ref_count_(0),
+    fd_(-1) {
+}
+
+PmQosLatencyLock::~PmQosLatencyLock() {
+    ReleaseInternal();
+}
+
+void PmQosLatencyLock::Acquire(CpuLatencyState state) {
+    boost::ignore_unused_variable_warning(state);
+
+    if (ref_count_++ > 0)
+        return;
+
+    fd_ = ::open(device_.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        AC_WARNING("Failed to open %s: %s; not limiting CPU wakeup latency",
+                   device_, ::strerror(errno));
+        return;
+    }
+
+    // The kernel takes the target as binary 32 bit value in microseconds
+    const std::int32_t value = target_.count();
+    if (::write(fd_, &value, sizeof(value)) != sizeof(value)) {
+        AC_WARNING("Failed to request CPU wakeup latency: %s", ::strerror(errno));
+        ReleaseInternal();
+        return;
+    }
+
+    AC_DEBUG("Limiting CPU wakeup latency to %d us", value);
+}
+
+void PmQosLatencyLock::Release(CpuLatencyState state) {
+    boost::ignore_unused_variable_warning(state);
+
+    if (ref_count_ == 0 || --ref_count_ > 0 || fd_ < 0)
+        return;
+
+    ReleaseInternal();
+
+    AC_DEBUG("Released CPU wakeup latency request");
+}
+
+void PmQosLatencyLock::ReleaseInternal() {
+    if (fd_ < 0)
+        return;
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool PmQosLatencyLock::Held() const {
+    return fd_ >= 0;
+}
+
+} // namespace ubuntu
+} // namespace ac
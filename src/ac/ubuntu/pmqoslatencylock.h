@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_UBUNTU_PMQOSLATENCYLOCK_H_
+#define AC_UBUNTU_PMQOSLATENCYLOCK_H_
+
+#include <chrono>
+#include <string>
+
+#include "ac/systemcontroller.h"
+
+namespace ac {
+namespace ubuntu {
+
+// Holds a CPU wakeup latency request through the kernel's PM QoS
+// interface. The request stays in place for as long as the device node
+// is kept open, so it goes away with us should we crash.
+class PmQosLatencyLock : public SystemController::Lock<CpuLatencyState> {
+public:
+    typedef std::shared_ptr<PmQosLatencyLock> Ptr;
+
+    static constexpr const char *kDefaultDevice{"/dev/cpu_dma_latency"};
+
+    static Ptr Create(const std::chrono::microseconds &target,
+                      const std::string &device = kDefaultDevice);
+
+    ~PmQosLatencyLock();
+
+    void Acquire(CpuLatencyState state);
+    void Release(CpuLatencyState state);
+
+    bool Held() const;
+
+private:
+    PmQosLatencyLock(const std::chrono::microseconds &target, const std::string &device);
+
+    void ReleaseInternal();
+
+private:
+    std::chrono::microseconds target_;
+    std::string device_;
+    unsigned int ref_count_;
+    int fd_;
+};
+
+} // namespace ubuntu
+} // namespace ac
+
+#endif
@@ -15,14 +15,34 @@
  *
  */
 
+#include <cstdlib>
+
+#include "ac/utils.h"
+
 #include "ac/ubuntu/systemcontroller.h"
+#include "ac/ubuntu/pmqoslatencylock.h"
 #include "ac/ubuntu/unitydisplaylock.h"
 
+namespace {
+// Keeps the CPUs in shallow idle states only which they leave within a
+// few microseconds while still allowing clock gating.
+static constexpr std::chrono::microseconds kDefaultCpuLatencyTarget{50};
+
+std::chrono::microseconds CpuLatencyTarget() {
+    const auto value = ac::Utils::GetEnvValue("AETHERCAST_CPU_LATENCY_TARGET");
+    if (value.length() == 0)
+        return kDefaultCpuLatencyTarget;
+
+    return std::chrono::microseconds{std::strtol(value.c_str(), nullptr, 10)};
+}
+}
+
 namespace ac {
 namespace ubuntu {
 
 SystemController::SystemController() :
-    display_lock_(UnityDisplayLock::Create()) {
+    display_lock_(UnityDisplayLock::Create()),
+    cpu_latency_lock_(PmQosLatencyLock::Create(CpuLatencyTarget())) {
 }
 
 SystemController::~SystemController() {
@@ -32,5 +52,9 @@ SystemController::Lock<DisplayState>::Ptr SystemController::DisplayStateLock() {
     return display_lock_;
 }
 
+SystemController::Lock<CpuLatencyState>::Ptr SystemController::CpuLatencyLock() {
+    return cpu_latency_lock_;
+}
+
 } // namespace ubuntu
 } // namespace ac
@@ -29,9 +29,11 @@ public:
     ~SystemController();
 
     Lock<DisplayState>::Ptr DisplayStateLock();
+    Lock<CpuLatencyState>::Ptr CpuLatencyLock();
 
 private:
     Lock<ac::DisplayState>::Ptr display_lock_;
+    Lock<ac::CpuLatencyState>::Ptr cpu_latency_lock_;
 };
 
 } // namespace ubuntu
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ac/uibc/genericinputencoder.h"
+
+namespace {
+// Input category of the UIBC header
+static constexpr std::uint8_t kCategoryGeneric{0x00};
+
+// Describe field of vertical and horizontal scroll messages: two bits
+// scroll unit, one bit direction and thirteen bits amount.
+static constexpr std::uint16_t kScrollUnitNotches{0x4000};
+static constexpr std::uint16_t kScrollDownOrRight{0x2000};
+static constexpr std::int32_t kMaxScrollAmount{0x1fff};
+
+static constexpr std::int32_t kMaxCoordinate{0xffff};
+
+struct KeyMapping {
+    std::uint16_t code;
+    std::uint16_t key_code;
+};
+
+static constexpr KeyMapping kKeyMappings[] = {
+    { KEY_BACKSPACE, 0x08 }, { KEY_TAB, 0x09 }, { KEY_ENTER, 0x0d }, { KEY_ESC, 0x1b },
+    { KEY_SPACE, ' ' }, { KEY_APOSTROPHE, '\'' }, { KEY_COMMA, ',' }, { KEY_MINUS, '-' },
+    { KEY_DOT, '.' }, { KEY_SLASH, '/' }, { KEY_SEMICOLON, ';' }, { KEY_EQUAL, '=' },
+    { KEY_LEFTBRACE, '[' }, { KEY_BACKSLASH, '\\' }, { KEY_RIGHTBRACE, ']' }, { KEY_GRAVE, '`' },
+    { KEY_DELETE, 0x7f },
+    { KEY_0, '0' }, { KEY_1, '1' }, { KEY_2, '2' }, { KEY_3, '3' }, { KEY_4, '4' },
+    { KEY_5, '5' }, { KEY_6, '6' }, { KEY_7, '7' }, { KEY_8, '8' }, { KEY_9, '9' },
+    { KEY_A, 'a' }, { KEY_B, 'b' }, { KEY_C, 'c' }, { KEY_D, 'd' }, { KEY_E, 'e' },
+    { KEY_F, 'f' }, { KEY_G, 'g' }, { KEY_H, 'h' }, { KEY_I, 'i' }, { KEY_J, 'j' },
+    { KEY_K, 'k' }, { KEY_L, 'l' }, { KEY_M, 'm' }, { KEY_N, 'n' }, { KEY_O, 'o' },
+    { KEY_P, 'p' }, { KEY_Q, 'q' }, { KEY_R, 'r' }, { KEY_S, 's' }, { KEY_T, 't' },
+    { KEY_U, 'u' }, { KEY_V, 'v' }, { KEY_W, 'w' }, { KEY_X, 'x' }, { KEY_Y, 'y' },
+    { KEY_Z, 'z' },
+};
+
+void WriteUint16(std::vector<std::uint8_t> &out, std::uint16_t value) {
+    out.push_back(value >> 8);
+    out.push_back(value & 0xff);
+}
+}
+
+namespace ac {
+namespace uibc {
+
+constexpr std::size_t GenericInputEncoder::kHeaderSize;
+constexpr std::size_t GenericInputEncoder::kInputHeaderSize;
+
+GenericInputEncoder::GenericInputEncoder(unsigned int width, unsigned int height) :
+    width_(width),
+    height_(height),
+    x_(width / 2),
+    y_(height / 2),
+    motion_pending_(false),
+    report_dx_(0),
+    report_dy_(0),
+    report_x_(-1),
+    report_y_(-1),
+    report_moved_(false),
+    report_wheel_(0),
+    report_hwheel_(0) {
+}
+
+std::uint16_t GenericInputEncoder::KeyCodeFor(std::uint16_t code) {
+    for (const auto &mapping : kKeyMappings) {
+        if (mapping.code == code)
+            return mapping.key_code;
+    }
+    return 0;
+}
+
+void GenericInputEncoder::Process(const struct input_event &event, std::vector<std::uint8_t> &out) {
+    switch (event.type) {
+    case EV_REL:
+        if (event.code == REL_X)
+            report_dx_ += event.value;
+        else if (event.code == REL_Y)
+            report_dy_ += event.value;
+        else if (event.code == REL_WHEEL)
+            report_wheel_ += event.value;
+        else if (event.code == REL_HWHEEL)
+            report_hwheel_ += event.value;
+        else
+            break;
+
+        report_moved_ = report_moved_ || event.code == REL_X || event.code == REL_Y;
+        break;
+    case EV_ABS:
+        if (event.code == ABS_X)
+            report_x_ = event.value;
+        else if (event.code == ABS_Y)
+            report_y_ = event.value;
+        else
+            break;
+
+        report_moved_ = true;
+        break;
+    case EV_KEY:
+        // Auto repeat is up to the remote
+        if (event.value == 2)
+            break;
+
+        report_keys_.push_back(Change{event.code, event.value});
+        break;
+    case EV_SYN:
+        if (event.code == SYN_REPORT) {
+            FinishReport(out);
+        }
+        else if (event.code == SYN_DROPPED) {
+            // The rest of the report is lost; start over with the next one
+            report_dx_ = report_dy_ = 0;
+            report_x_ = report_y_ = -1;
+            report_moved_ = false;
+            report_wheel_ = report_hwheel_ = 0;
+            report_keys_.clear();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void GenericInputEncoder::FinishReport(std::vector<std::uint8_t> &out) {
+    if (report_moved_) {
+        x_ = report_x_ >= 0 ? report_x_ : x_ + report_dx_;
+        y_ = report_y_ >= 0 ? report_y_ : y_ + report_dy_;
+
+        const std::int32_t max_x = width_ > 0 ? width_ - 1 : kMaxCoordinate;
+        const std::int32_t max_y = height_ > 0 ? height_ - 1 : kMaxCoordinate;
+        x_ = std::min(std::max(x_, 0), max_x);
+        y_ = std::min(std::max(y_, 0), max_y);
+
+        motion_pending_ = true;
+    }
+
+    const bool has_other = !report_keys_.empty() || report_wheel_ != 0 || report_hwheel_ != 0;
+
+    // Anything but motion is position dependent on the remote side and
+    // has to come after the move bringing the pointer there.
+    if (has_other)
+        Flush(out);
+
+    for (const auto &key : report_keys_) {
+        if (key.code == BTN_LEFT || key.code == BTN_TOUCH) {
+            WritePointer(out, key.value ? InputId::kLeftMouseDown : InputId::kLeftMouseUp);
+            continue;
+        }
+
+        const auto key_code = KeyCodeFor(key.code);
+        if (key_code == 0)
+            continue;
+
+        WriteKey(out, key.value ? InputId::kKeyDown : InputId::kKeyUp, key_code);
+    }
+
+    // evdev reports wheel movement away from the user (up) as positive
+    if (report_wheel_ != 0)
+        WriteScroll(out, InputId::kVerticalScroll, -report_wheel_);
+    if (report_hwheel_ != 0)
+        WriteScroll(out, InputId::kHorizontalScroll, report_hwheel_);
+
+    report_dx_ = report_dy_ = 0;
+    report_x_ = report_y_ = -1;
+    report_moved_ = false;
+    report_wheel_ = report_hwheel_ = 0;
+    report_keys_.clear();
+}
+
+bool GenericInputEncoder::HasPendingMotion() const {
+    return motion_pending_;
+}
+
+void GenericInputEncoder::Flush(std::vector<std::uint8_t> &out) {
+    if (!motion_pending_)
+        return;
+
+    WritePointer(out, InputId::kMouseMove);
+    motion_pending_ = false;
+}
+
+void GenericInputEncoder::WriteHeader(std::vector<std::uint8_t> &out, InputId id, std::size_t describe_size) {
+    const auto length = kHeaderSize + kInputHeaderSize + describe_size;
+
+    // Version 0 and no timestamp
+    out.push_back(0x00);
+    out.push_back(kCategoryGeneric);
+    WriteUint16(out, length);
+
+    out.push_back(static_cast<std::uint8_t>(id));
+    WriteUint16(out, describe_size);
+}
+
+void GenericInputEncoder::WritePointer(std::vector<std::uint8_t> &out, InputId id) {
+    WriteHeader(out, id, 6);
+    // A single pointer with id 0
+    out.push_back(1);
+    out.push_back(0);
+    WriteUint16(out, x_);
+    WriteUint16(out, y_);
+}
+
+void GenericInputEncoder::WriteKey(std::vector<std::uint8_t> &out, InputId id, std::uint16_t key_code) {
+    WriteHeader(out, id, 5);
+    out.push_back(0);
+    WriteUint16(out, key_code);
+    WriteUint16(out, 0);
+}
+
+void GenericInputEncoder::WriteScroll(std::vector<std::uint8_t> &out, InputId id, std::int32_t amount) {
+    std::uint16_t describe = kScrollUnitNotches;
+    if (amount > 0)
+        describe |= kScrollDownOrRight;
+    describe |= std::min(std::abs(amount), kMaxScrollAmount);
+
+    WriteHeader(out, id, 2);
+    WriteUint16(out, describe);
+}
+
+} // namespace uibc
+} // namespace ac
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_UIBC_GENERICINPUTENCODER_H_
+#define AC_UIBC_GENERICINPUTENCODER_H_
+
+#include <linux/input.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+namespace ac {
+namespace uibc {
+
+/**
+ * @brief Translates evdev input events into WiFi Display UIBC messages
+ * of the generic input category.
+ *
+ * Events are collected until the SYN_REPORT closing a report arrives and
+ * only then turned into messages. Pointer motion is held back so that a
+ * high rate pointing device doesn't flood the channel: consecutive
+ * reports with nothing but motion in them collapse into a single move
+ * which is only written out by Flush() or before the next button, key
+ * or scroll message.
+ */
+class GenericInputEncoder : public ac::NonCopyable {
+public:
+    static constexpr std::size_t kHeaderSize{4};
+    static constexpr std::size_t kInputHeaderSize{3};
+
+    enum class InputId : std::uint8_t {
+        kLeftMouseDown = 0,
+        kLeftMouseUp = 1,
+        kMouseMove = 2,
+        kKeyDown = 3,
+        kKeyUp = 4,
+        kZoom = 5,
+        kVerticalScroll = 6,
+        kHorizontalScroll = 7,
+        kRotate = 8
+    };
+
+    // Pointer positions are clamped to width x height if given. Relative
+    // motion starts off from the center then.
+    explicit GenericInputEncoder(unsigned int width = 0, unsigned int height = 0);
+
+    // Appends the messages completed by event to out.
+    void Process(const struct input_event &event, std::vector<std::uint8_t> &out);
+
+    bool HasPendingMotion() const;
+    void Flush(std::vector<std::uint8_t> &out);
+
+    // Maps an evdev key code to the (ASCII) key code used by generic
+    // input messages. Returns 0 for keys which don't have one.
+    static std::uint16_t KeyCodeFor(std::uint16_t code);
+
+private:
+    void FinishReport(std::vector<std::uint8_t> &out);
+
+    void WriteHeader(std::vector<std::uint8_t> &out, InputId id, std::size_t describe_size);
+    void WritePointer(std::vector<std::uint8_t> &out, InputId id);
+    void WriteKey(std::vector<std::uint8_t> &out, InputId id, std::uint16_t key_code);
+    // Positive amounts scroll down or right
+    void WriteScroll(std::vector<std::uint8_t> &out, InputId id, std::int32_t amount);
+
+private:
+    struct Change {
+        std::uint16_t code;
+        std::int32_t value;
+    };
+
+    unsigned int width_;
+    unsigned int height_;
+    std::int32_t x_;
+    std::int32_t y_;
+    bool motion_pending_;
+
+    // State of the report currently being collected
+    std::int32_t report_dx_;
+    std::int32_t report_dy_;
+    std::int32_t report_x_;
+    std::int32_t report_y_;
+    bool report_moved_;
+    std::int32_t report_wheel_;
+    std::int32_t report_hwheel_;
+    std::vector<Change> report_keys_;
+};
+
+} // namespace uibc
+} // namespace ac
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/uibc/inputchannel.h"
+
+namespace {
+// How long to wait for input before checking whether we should stop
+static constexpr std::chrono::milliseconds kPollTimeout{100};
+// Events read at once. A single report of a busy device rarely has
+// more than a handful of them.
+static constexpr std::size_t kMaxEventsPerRead{64};
+static constexpr ac::TimestampUs kConnectRetryIntervalUs{1000000};
+}
+
+namespace ac {
+namespace uibc {
+
+InputChannel::Ptr InputChannel::Create(int fd, const ac::network::Stream::Ptr &output,
+                                       const std::string &address, const ac::network::Port &port,
+                                       const Config &config) {
+    return std::shared_ptr<InputChannel>(new InputChannel(fd, output, address, port, config));
+}
+
+InputChannel::InputChannel(int fd, const ac::network::Stream::Ptr &output,
+                           const std::string &address, const ac::network::Port &port,
+                           const Config &config) :
+    fd_(fd),
+    output_(output),
+    address_(address),
+    port_(port),
+    config_(config),
+    connected_(false),
+    last_connect_attempt_(0),
+    encoder_(config.width, config.height),
+    last_motion_(0) {
+
+    const auto flags = ::fcntl(fd_, F_GETFL);
+    if (flags < 0 || ::fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0)
+        AC_WARNING("Failed to make input descriptor non-blocking: %s (%d)", ::strerror(errno), errno);
+}
+
+InputChannel::~InputChannel() {
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool InputChannel::Start() {
+    return true;
+}
+
+bool InputChannel::Stop() {
+    return true;
+}
+
+bool InputChannel::ConnectOutput() {
+    const auto now = ac::Utils::GetNowUs();
+    if (last_connect_attempt_ > 0 && now - last_connect_attempt_ < kConnectRetryIntervalUs)
+        return false;
+
+    last_connect_attempt_ = now;
+
+    if (!output_->Connect(address_, port_))
+        return false;
+
+    AC_INFO("Sending input to %s:%d", address_, port_);
+    return true;
+}
+
+bool InputChannel::ReadEvents() {
+    const auto offset = input_.size();
+    input_.resize(offset + kMaxEventsPerRead * sizeof(struct input_event));
+
+    const auto bytes_read = ::read(fd_, input_.data() + offset, input_.size() - offset);
+    if (bytes_read <= 0) {
+        input_.resize(offset);
+        if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return true;
+
+        AC_DEBUG("Input provider closed connection");
+        return false;
+    }
+
+    input_.resize(offset + bytes_read);
+
+    // Events might be split over reads on a stream socket; keep the
+    // incomplete one for the next time.
+    const auto complete = input_.size() / sizeof(struct input_event) * sizeof(struct input_event);
+    for (std::size_t n = 0; n < complete; n += sizeof(struct input_event)) {
+        struct input_event event;
+        ::memcpy(&event, input_.data() + n, sizeof(event));
+        encoder_.Process(event, messages_);
+    }
+
+    input_.erase(input_.begin(), input_.begin() + complete);
+
+    return true;
+}
+
+bool InputChannel::Execute() {
+    const auto motion_interval = std::chrono::duration_cast<std::chrono::microseconds>(
+                config_.motion_interval).count();
+
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(kPollTimeout).count();
+    if (encoder_.HasPendingMotion()) {
+        const ac::TimestampUs elapsed = ac::Utils::GetNowUs() - last_motion_;
+        timeout = std::max<ac::TimestampUs>(0, (motion_interval - elapsed + 999) / 1000);
+    }
+
+    struct pollfd fds;
+    fds.fd = fd_;
+    fds.events = POLLIN;
+    fds.revents = 0;
+
+    const auto ret = ::poll(&fds, 1, timeout);
+    if (ret < 0 && errno != EINTR) {
+        AC_ERROR("Failed to wait for input: %s (%d)", ::strerror(errno), errno);
+        return false;
+    }
+
+    if (ret > 0 && (fds.revents & (POLLIN | POLLHUP | POLLERR))) {
+        if (!ReadEvents())
+            return false;
+    }
+
+    if (encoder_.HasPendingMotion()) {
+        const ac::TimestampUs now = ac::Utils::GetNowUs();
+        if (now - last_motion_ >= motion_interval) {
+            encoder_.Flush(messages_);
+            last_motion_ = now;
+        }
+    }
+
+    if (!connected_)
+        connected_ = ConnectOutput();
+
+    if (messages_.empty())
+        return true;
+
+    if (!connected_) {
+        messages_.clear();
+        return true;
+    }
+
+    const auto error = output_->Write(messages_.data(), messages_.size());
+    messages_.clear();
+
+    if (error != ac::network::Stream::Error::kNone) {
+        AC_ERROR("Failed to send input to remote");
+        return false;
+    }
+
+    return true;
+}
+
+std::string InputChannel::Name() const {
+    return "InputChannel";
+}
+
+} // namespace uibc
+} // namespace ac
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_UIBC_INPUTCHANNEL_H_
+#define AC_UIBC_INPUTCHANNEL_H_
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ac/utils.h"
+
+#include "ac/common/executable.h"
+
+#include "ac/network/stream.h"
+
+#include "ac/uibc/genericinputencoder.h"
+
+namespace ac {
+namespace uibc {
+
+/**
+ * @brief Forwards the input events an input provider writes to a file
+ * descriptor as UIBC messages to the remote display.
+ *
+ * Runs on its own executor so that neither reading the events nor a
+ * slow remote ever blocks the main loop. That includes connecting: the
+ * remote might not be listening yet when the channel is started and
+ * until it is, input is read but thrown away. Pointer motion is sent at
+ * most every motion_interval; everything else goes out as soon as the
+ * report it belongs to is complete.
+ */
+class InputChannel : public ac::common::Executable {
+public:
+    typedef std::shared_ptr<InputChannel> Ptr;
+
+    class Config {
+    public:
+        Config() :
+            width(0),
+            height(0),
+            motion_interval(std::chrono::milliseconds{8}) {
+        }
+
+        unsigned int width;
+        unsigned int height;
+        std::chrono::milliseconds motion_interval;
+    };
+
+    // Takes ownership of fd
+    static Ptr Create(int fd, const ac::network::Stream::Ptr &output,
+                      const std::string &address, const ac::network::Port &port,
+                      const Config &config = Config{});
+
+    ~InputChannel();
+
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+
+private:
+    InputChannel(int fd, const ac::network::Stream::Ptr &output,
+                 const std::string &address, const ac::network::Port &port,
+                 const Config &config);
+
+    bool ConnectOutput();
+    bool ReadEvents();
+
+private:
+    int fd_;
+    ac::network::Stream::Ptr output_;
+    std::string address_;
+    ac::network::Port port_;
+    Config config_;
+    bool connected_;
+    ac::TimestampUs last_connect_attempt_;
+    GenericInputEncoder encoder_;
+    std::vector<std::uint8_t> input_;
+    std::vector<std::uint8_t> messages_;
+    ac::TimestampUs last_motion_;
+};
+
+} // namespace uibc
+} // namespace ac
+
+#endif
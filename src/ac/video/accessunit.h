@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_ACCESSUNIT_H_
+#define AC_VIDEO_ACCESSUNIT_H_
+
+#include <vector>
+
+#include "ac/utils.h"
+
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief A single coded frame as it was received from the network.
+ *
+ * The data of the frame isn't stored in one piece but spread over a
+ * number of fragments which reference the received packets directly.
+ */
+class AccessUnit {
+public:
+    AccessUnit() :
+        timestamp(0),
+        decode_timestamp(0),
+        size(0) {
+    }
+
+    void Append(const Buffer::Ptr &fragment) {
+        fragments.push_back(fragment);
+        size += fragment->Length();
+    }
+
+    std::vector<Buffer::Ptr> fragments;
+    // Presentation time of the unit in micro-seconds
+    ac::TimestampUs timestamp;
+    // Decoding time of the unit in micro-seconds which only differs
+    // from the presentation time for streams with B frames.
+    ac::TimestampUs decode_timestamp;
+    // Total number of bytes over all fragments
+    std::size_t size;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_BASEDECODER_H_
+#define AC_VIDEO_BASEDECODER_H_
+
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/accessunit.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Consumer of the access units a sink receives.
+ *
+ * Implementations are free to decode and render the units or to just
+ * store them somewhere. Units are delivered in stream order from a
+ * single thread and their fragments must not be modified.
+ */
+class BaseDecoder : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<BaseDecoder> Ptr;
+
+    virtual bool Start() = 0;
+    virtual bool Stop() = 0;
+
+    virtual bool Decode(const AccessUnit &unit) = 0;
+
+    virtual std::string Name() const = 0;
+
+protected:
+    BaseDecoder() = default;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
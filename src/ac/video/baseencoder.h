@@ -45,7 +45,8 @@ public:
             profile_idc(0),
             level_idc(0),
             constraint_set(0),
-            i_frame_interval(0) {
+            i_frame_interval(0),
+            intra_refresh_mode(0) {
         }
 
         bool operator==(const Config& other) const {
@@ -86,7 +87,7 @@ public:
 
     virtual ~BaseEncoder() { }
 
-    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+    virtual void SetDelegate(const std::weak_ptr<Delegate> &delegate);
 
     virtual BaseEncoder::Config DefaultConfiguration() = 0;
 
@@ -100,6 +101,15 @@ public:
 
     virtual void SendIDRFrame() = 0;
 
+    // Changes the target bitrate of a running encoder. Returns false
+    // if the encoder doesn't support this.
+    virtual bool SetBitrate(unsigned int /* bitrate */) { return false; }
+
+    // Number of frames it takes the encoder to refresh every macroblock
+    // of the picture once through intra refresh or zero if it doesn't
+    // do intra refresh.
+    virtual unsigned int IntraRefreshPeriod() const { return 0; }
+
 protected:
     BaseEncoder() = default;
 
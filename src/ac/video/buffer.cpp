@@ -28,6 +28,12 @@ Buffer::Ptr Buffer::Create(uint32_t capacity, ac::TimestampUs timestamp) {
     return buffer;
 }
 
+Buffer::Ptr Buffer::Create(uint32_t capacity, MemoryBudget::Stage stage) {
+    auto buffer = std::shared_ptr<Buffer>(new Buffer);
+    buffer->Allocate(capacity, stage);
+    return buffer;
+}
+
 Buffer::Ptr Buffer::Create(uint8_t *data, uint32_t length) {
     auto buffer = std::shared_ptr<Buffer>(new Buffer);
     buffer->Allocate(length);
@@ -41,13 +47,36 @@ Buffer::Ptr Buffer::Create(void *native_handle) {
     return buffer;
 }
 
+Buffer::Ptr Buffer::Create(void *native_handle, uint8_t *data, uint32_t length) {
+    auto buffer = std::shared_ptr<Buffer>(new Buffer);
+    buffer->native_handle_ = native_handle;
+    buffer->data_ = data;
+    buffer->capacity_ = length;
+    buffer->length_ = length;
+    return buffer;
+}
+
+Buffer::Ptr Buffer::Create(const Buffer::Ptr &parent, uint32_t offset, uint32_t length) {
+    if (!parent || !parent->Data() || offset > parent->Length() || length > parent->Length() - offset)
+        return nullptr;
+
+    auto buffer = std::shared_ptr<Buffer>(new Buffer(parent->Timestamp()));
+    buffer->parent_ = parent;
+    buffer->data_ = parent->Data() + offset;
+    buffer->capacity_ = length;
+    buffer->length_ = length;
+    return buffer;
+}
+
 Buffer::Buffer() :
     capacity_(0),
     length_(0),
     offset_(0),
     data_(nullptr),
     timestamp_(0),
-    native_handle_(nullptr) {
+    temporal_layer_(-1),
+    native_handle_(nullptr),
+    stage_(MemoryBudget::Stage::kOther) {
 }
 
 Buffer::Buffer(int64_t timestamp) :
@@ -56,12 +85,19 @@ Buffer::Buffer(int64_t timestamp) :
     offset_(0),
     data_(nullptr),
     timestamp_(timestamp),
-    native_handle_(nullptr) {
+    temporal_layer_(-1),
+    native_handle_(nullptr),
+    stage_(MemoryBudget::Stage::kOther) {
 }
 
 Buffer::~Buffer() {
-    if (data_)
-        free(data_);
+    // Memory of views is owned by their parent and that of native
+    // buffers by whoever handed them out
+    if (!data_ || parent_ || native_handle_)
+        return;
+
+    delete[] data_;
+    MemoryBudget::Instance()->Release(stage_, capacity_);
 }
 
 void Buffer::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
@@ -85,7 +121,11 @@ void Buffer::SetTimestamp(int64_t timestamp) {
     timestamp_ = timestamp;
 }
 
-void Buffer::Allocate(uint32_t capacity) {
+void Buffer::SetTemporalLayer(int layer) {
+    temporal_layer_ = layer;
+}
+
+void Buffer::Allocate(uint32_t capacity, MemoryBudget::Stage stage) {
     if (data_)
         return;
 
@@ -94,6 +134,9 @@ void Buffer::Allocate(uint32_t capacity) {
     capacity_ = capacity;
     length_ = capacity;
     offset_ = 0;
+    stage_ = stage;
+
+    MemoryBudget::Instance()->Acquire(stage_, capacity_);
 }
 
 } // namespace video
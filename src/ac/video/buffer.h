@@ -23,6 +23,8 @@
 #include "ac/non_copyable.h"
 #include "ac/utils.h"
 
+#include "ac/video/memorybudget.h"
+
 namespace ac {
 namespace video {
 
@@ -40,11 +42,19 @@ public:
     virtual ~Buffer();
 
     static Buffer::Ptr Create(uint32_t capacity = 0, ac::TimestampUs timestamp = 0ll);
+    static Buffer::Ptr Create(uint32_t capacity, MemoryBudget::Stage stage);
     static Buffer::Ptr Create(uint8_t *data, uint32_t length);
     static Buffer::Ptr Create(void *native_handle);
+    // Creates a buffer for a native one whose memory is mapped at data.
+    // The memory stays owned by whoever handed out the native buffer.
+    static Buffer::Ptr Create(void *native_handle, uint8_t *data, uint32_t length);
+    // Creates a buffer referencing a part of parent without copying it.
+    // The parent is kept alive for as long as the new buffer exists.
+    static Buffer::Ptr Create(const Buffer::Ptr &parent, uint32_t offset, uint32_t length);
 
     void SetRange(uint32_t offset, uint32_t length);
     void SetTimestamp(int64_t timestamp);
+    void SetTemporalLayer(int layer);
 
     virtual uint32_t Capacity() const { return capacity_; }
     virtual uint32_t Offset() const { return offset_; }
@@ -52,6 +62,9 @@ public:
     virtual uint8_t* Data() { return data_ + offset_; }
     // Timestamp of the buffer in micro-seconds
     virtual ac::TimestampUs Timestamp() const { return timestamp_; }
+    // Temporal layer of an encoded frame or -1 if the encoder didn't tell.
+    // Frames are only referenced by frames of the same or a higher layer.
+    virtual int TemporalLayer() const { return temporal_layer_; }
 
     virtual bool IsValid() const { return data_ != nullptr || native_handle_ != nullptr; }
 
@@ -65,7 +78,7 @@ protected:
     Buffer();
     Buffer(ac::TimestampUs timestamp);
 
-    void Allocate(uint32_t size);
+    void Allocate(uint32_t size, MemoryBudget::Stage stage = MemoryBudget::Stage::kOther);
 
 private:
     std::weak_ptr<Delegate> delegate_;
@@ -74,7 +87,10 @@ private:
     uint32_t offset_;
     uint8_t *data_;
     int64_t timestamp_;
+    int temporal_layer_;
     void *native_handle_;
+    MemoryBudget::Stage stage_;
+    Buffer::Ptr parent_;
 
     friend class BufferOutputTarget;
 };
@@ -21,7 +21,9 @@
 #include <memory>
 
 #include "ac/non_copyable.h"
+#include "ac/utils.h"
 
+#include "ac/video/buffer.h"
 #include "ac/video/displayoutput.h"
 
 namespace ac {
@@ -37,6 +39,16 @@ public:
     virtual void SwapBuffers() = 0;
     virtual void* CurrentBuffer() const = 0;
     virtual DisplayOutput OutputMode() const = 0;
+
+    // Wraps the current buffer for the pipeline. Producers whose buffers
+    // can be read by the CPU hand them out mapped.
+    virtual Buffer::Ptr CreateBuffer() const { return Buffer::Create(CurrentBuffer()); }
+
+    // Time the current buffer shows the display content of, in the clock
+    // domain of ac::Utils::GetNowUs(), or 0 if the producer can't tell.
+    virtual ac::TimestampUs CurrentTimestamp() const { return 0; }
+    // Time between two refreshes of the captured display or 0 if unknown.
+    virtual ac::TimestampUs RefreshInterval() const { return 0; }
 };
 
 } // namespace video
@@ -20,12 +20,13 @@
 namespace ac {
 namespace video {
 
-BufferQueue::Ptr BufferQueue::Create(uint32_t max_size) {
-    return std::shared_ptr<BufferQueue>(new BufferQueue(max_size));
+BufferQueue::Ptr BufferQueue::Create(uint32_t max_size, const std::string &name) {
+    return std::shared_ptr<BufferQueue>(new BufferQueue(max_size, name));
 }
 
-BufferQueue::BufferQueue(uint32_t max_size) :
+BufferQueue::BufferQueue(uint32_t max_size, const std::string &name) :
     max_size_(max_size) {
+    ac::common::NameLock(mutex_, name);
 }
 
 BufferQueue::~BufferQueue() {
@@ -45,7 +46,7 @@ void BufferQueue::Unlock() {
 }
 
 ac::video::Buffer::Ptr BufferQueue::Front() {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     return queue_.front();
 }
 
@@ -55,14 +56,14 @@ ac::video::Buffer::Ptr BufferQueue::Next() {
     if (!WaitToBeFilled(std::chrono::milliseconds{-1}))
         return nullptr;
 
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     auto buffer = queue_.front();
     queue_.pop();
     return buffer;
 }
 
 void BufferQueue::Push(const ac::video::Buffer::Ptr &buffer) {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     if (IsLimited() && queue_.size() >= max_size_)
         return;
     queue_.push(buffer);
@@ -70,7 +71,7 @@ void BufferQueue::Push(const ac::video::Buffer::Ptr &buffer) {
 }
 
 ac::video::Buffer::Ptr BufferQueue::Pop() {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     auto buffer = queue_.front();
     queue_.pop();
     lock_.notify_one();
@@ -86,8 +87,20 @@ ac::video::Buffer::Ptr BufferQueue::PopUnlocked() {
     return buffer;
 }
 
+void BufferQueue::Clear() {
+    std::unique_lock<ac::common::Mutex> l(mutex_);
+    std::queue<ac::video::Buffer::Ptr>().swap(queue_);
+    lock_.notify_all();
+}
+
+void BufferQueue::Swap(std::queue<ac::video::Buffer::Ptr> &buffers) {
+    std::unique_lock<ac::common::Mutex> l(mutex_);
+    queue_.swap(buffers);
+    lock_.notify_all();
+}
+
 bool BufferQueue::WaitFor(const std::function<bool()> &pred, const std::chrono::milliseconds &timeout) {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
 
     if (!l.owns_lock())
         return false;
@@ -101,6 +114,19 @@ bool BufferQueue::WaitFor(const std::function<bool()> &pred, const std::chrono::
     return true;
 }
 
+bool BufferQueue::WaitUntil(const std::chrono::steady_clock::time_point &deadline,
+                            const std::function<bool()> &pred) {
+    std::unique_lock<ac::common::Mutex> l(mutex_);
+    return lock_.wait_until(l, deadline, pred);
+}
+
+void BufferQueue::WakeUp() {
+    // Taking the lock makes sure whatever the predicate of a waiter
+    // checks changed before or after its check but not in between.
+    std::unique_lock<ac::common::Mutex> l(mutex_);
+    lock_.notify_all();
+}
+
 bool BufferQueue::WaitToBeFilled(const std::chrono::milliseconds &timeout) {
     if (IsFull())
         return true;
@@ -119,17 +145,17 @@ bool BufferQueue::IsFull() {
     if (!IsLimited())
         return false;
 
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     return queue_.size() == max_size_;
 }
 
 bool BufferQueue::IsEmpty() {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     return queue_.size() == 0;
 }
 
 int BufferQueue::Size() {
-    std::unique_lock<std::mutex> l(mutex_);
+    std::unique_lock<ac::common::Mutex> l(mutex_);
     return queue_.size();
 }
 
@@ -18,11 +18,13 @@
 #ifndef AC_VIDEO_BUFFERQUEUE_H_
 #define AC_VIDEO_BUFFERQUEUE_H_
 
+#include <chrono>
 #include <memory>
 #include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <functional>
+#include <string>
+
+#include "ac/common/mutex.h"
 
 #include "ac/video/buffer.h"
 
@@ -33,7 +35,8 @@ class BufferQueue {
 public:
     typedef std::shared_ptr<BufferQueue> Ptr;
 
-    static Ptr Create(uint32_t max_size = 0);
+    // The name identifies the queue when profiling locks.
+    static Ptr Create(uint32_t max_size = 0, const std::string &name = "BufferQueue");
 
     ~BufferQueue();
 
@@ -49,9 +52,22 @@ public:
     ac::video::Buffer::Ptr Pop();
     ac::video::Buffer::Ptr PopUnlocked();
 
+    // Drops all queued buffers
+    void Clear();
+
+    // Exchanges the queued buffers with the given ones in constant time.
+    // Lets a consumer take everything queued at once and work through it
+    // without holding up producers.
+    void Swap(std::queue<ac::video::Buffer::Ptr> &buffers);
+
     bool WaitForSlots(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
     bool WaitToBeFilled(const std::chrono::milliseconds &timeout = std::chrono::milliseconds{1});
 
+    // Lets a consumer sleep on the queue until the deadline passed or,
+    // after a WakeUp(), the predicate holds. Returns the predicate.
+    bool WaitUntil(const std::chrono::steady_clock::time_point &deadline, const std::function<bool()> &pred);
+    void WakeUp();
+
     bool IsLimited() const { return max_size_ != 0; }
     bool IsFull();
     bool IsEmpty();
@@ -59,15 +75,15 @@ public:
     int Size();
 
 private:
-    BufferQueue(uint32_t max_size);
+    BufferQueue(uint32_t max_size, const std::string &name);
 
     bool WaitFor(const std::function<bool()> &pred, const std::chrono::milliseconds &timeout);
 
 private:
     uint32_t max_size_;
     std::queue<ac::video::Buffer::Ptr> queue_;
-    std::mutex mutex_;
-    std::condition_variable lock_;
+    ac::common::Mutex mutex_;
+    ac::common::ConditionVariable lock_;
 };
 
 } // namespace video
@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#endif
+
+#include <memory.h>
+
+#include <algorithm>
+
+#include "ac/logger.h"
+
+#include "ac/video/colorconverter.h"
+
+#if defined(__arm__) && !defined(HWCAP_ARM_NEON)
+#define HWCAP_ARM_NEON (1 << 12)
+#endif
+
+namespace {
+static constexpr unsigned int kBytesPerPixel{4};
+
+// Limited range coefficients, see kernels::Coefficients
+static constexpr ac::video::kernels::Coefficients kBT601{66, 129, 25, -38, -74, 112, 112, -94, -18};
+static constexpr ac::video::kernels::Coefficients kBT709{47, 157, 16, -26, -86, 112, 112, -102, -10};
+
+static constexpr unsigned int kMaxThreads{8};
+
+inline std::uint8_t Clamp(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline std::uint32_t LoadPixel(const std::uint8_t *data) {
+    std::uint32_t pixel;
+    ::memcpy(&pixel, data, sizeof(pixel));
+    return pixel;
+}
+
+inline void StorePixel(std::uint8_t *data, std::uint32_t pixel) {
+    ::memcpy(data, &pixel, sizeof(pixel));
+}
+
+// Rounded (a * (256 - weight) + b * weight) / 256 for all four channels.
+// Two channels are processed at once in the 16 bit halves of a 32 bit
+// integer which can't overflow as both weights always add up to 256.
+inline std::uint32_t Interpolate(std::uint32_t a, std::uint32_t b, unsigned int weight) {
+    static constexpr std::uint32_t kMask{0x00ff00ff};
+    static constexpr std::uint32_t kRounding{0x00800080};
+
+    const auto inverse = 256 - weight;
+    const auto even = (((a & kMask) * inverse + (b & kMask) * weight + kRounding) >> 8) & kMask;
+    const auto odd = ((((a >> 8) & kMask) * inverse + ((b >> 8) & kMask) * weight + kRounding)) & ~kMask;
+    return even | odd;
+}
+}
+
+namespace ac {
+namespace video {
+namespace kernels {
+
+void ConvertRowsScalar(const std::uint8_t *src0, const std::uint8_t *src1,
+                       unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                       std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                       const Coefficients &c) {
+    for (unsigned int x = 0; x < width; x += 2) {
+        const std::uint8_t *p[] = { src0 + x * 4, src0 + x * 4 + 4, src1 + x * 4, src1 + x * 4 + 4 };
+
+        y0[x] = ((c.y_r * p[0][0] + c.y_g * p[0][1] + c.y_b * p[0][2] + 128) >> 8) + 16;
+        y0[x + 1] = ((c.y_r * p[1][0] + c.y_g * p[1][1] + c.y_b * p[1][2] + 128) >> 8) + 16;
+        y1[x] = ((c.y_r * p[2][0] + c.y_g * p[2][1] + c.y_b * p[2][2] + 128) >> 8) + 16;
+        y1[x + 1] = ((c.y_r * p[3][0] + c.y_g * p[3][1] + c.y_b * p[3][2] + 128) >> 8) + 16;
+
+        const int r = (p[0][0] + p[1][0] + p[2][0] + p[3][0] + 2) >> 2;
+        const int g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) >> 2;
+        const int b = (p[0][2] + p[1][2] + p[2][2] + p[3][2] + 2) >> 2;
+
+        u[(x / 2) * uv_step] = Clamp(((c.u_r * r + c.u_g * g + c.u_b * b + 128) >> 8) + 128);
+        v[(x / 2) * uv_step] = Clamp(((c.v_r * r + c.v_g * g + c.v_b * b + 128) >> 8) + 128);
+    }
+}
+
+void BlendRowsScalar(const std::uint8_t *top, const std::uint8_t *bottom,
+                     unsigned int size, unsigned int weight, std::uint8_t *out) {
+    unsigned int n = 0;
+    for (; n + kBytesPerPixel <= size; n += kBytesPerPixel)
+        StorePixel(out + n, Interpolate(LoadPixel(top + n), LoadPixel(bottom + n), weight));
+
+    for (; n < size; n++)
+        out[n] = (top[n] * (256 - weight) + bottom[n] * weight + 128) >> 8;
+}
+
+void ScaleRowScalar(const std::uint8_t *row, const std::int32_t *first,
+                    const std::int32_t *second, const std::int32_t *weight,
+                    unsigned int count, std::uint8_t *out) {
+    for (unsigned int n = 0; n < count; n++)
+        StorePixel(out + n * kBytesPerPixel, Interpolate(LoadPixel(row + first[n] * kBytesPerPixel),
+                                                         LoadPixel(row + second[n] * kBytesPerPixel),
+                                                         weight[n]));
+}
+
+} // namespace kernels
+
+std::string ColorConverter::KernelToString(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::kAuto:
+        return "auto";
+    case Kernel::kScalar:
+        return "scalar";
+    case Kernel::kSSE41:
+        return "sse4.1";
+    case Kernel::kAVX2:
+        return "avx2";
+    case Kernel::kNEON:
+        return "neon";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+bool ColorConverter::IsKernelSupported(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::kScalar:
+        return true;
+#ifdef AC_VIDEO_HAVE_X86_KERNELS
+    case Kernel::kSSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case Kernel::kAVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef AC_VIDEO_HAVE_NEON_KERNELS
+    case Kernel::kNEON:
+#if defined(__aarch64__)
+        return true;
+#else
+        return (::getauxval(AT_HWCAP) & HWCAP_ARM_NEON) != 0;
+#endif
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+ColorConverter::Ptr ColorConverter::Create(const Config &config) {
+    if (config.source_width == 0 || config.source_height == 0 ||
+            config.width == 0 || config.height == 0 ||
+            config.width % 2 != 0 || config.height % 2 != 0) {
+        AC_ERROR("Can't convert %dx%d into %dx%d", config.source_width, config.source_height,
+                 config.width, config.height);
+        return nullptr;
+    }
+
+    if (config.source_stride != 0 && config.source_stride < config.source_width * kBytesPerPixel) {
+        AC_ERROR("Invalid source stride %d", config.source_stride);
+        return nullptr;
+    }
+
+    auto kernel = config.kernel;
+    if (kernel == Kernel::kAuto) {
+        static const Kernel preferred[] = { Kernel::kAVX2, Kernel::kSSE41, Kernel::kNEON };
+        kernel = Kernel::kScalar;
+        for (const auto candidate : preferred) {
+            if (IsKernelSupported(candidate)) {
+                kernel = candidate;
+                break;
+            }
+        }
+    }
+    else if (!IsKernelSupported(kernel)) {
+        AC_ERROR("Conversion kernel %s isn't supported on this CPU", KernelToString(kernel));
+        return nullptr;
+    }
+
+    return std::shared_ptr<ColorConverter>(new ColorConverter(config, kernel));
+}
+
+ColorConverter::ColorConverter(const Config &config, Kernel kernel) :
+    config_(config),
+    kernel_(kernel),
+    convert_rows_(kernels::ConvertRowsScalar),
+    blend_rows_(kernels::BlendRowsScalar),
+    scale_row_(kernels::ScaleRowScalar),
+    coefficients_(config.matrix == Matrix::kBT601 ? kBT601 : kBT709),
+    scaling_(config.source_width != config.width || config.source_height != config.height),
+    generation_(0),
+    pending_(0),
+    stopping_(false),
+    job_source_(nullptr),
+    job_target_(nullptr) {
+
+    if (config_.source_stride == 0)
+        config_.source_stride = config_.source_width * kBytesPerPixel;
+
+    switch (kernel_) {
+#ifdef AC_VIDEO_HAVE_X86_KERNELS
+    case Kernel::kSSE41:
+        convert_rows_ = kernels::ConvertRowsSSE41;
+        blend_rows_ = kernels::BlendRowsSSE41;
+        scale_row_ = kernels::ScaleRowSSE41;
+        break;
+    case Kernel::kAVX2:
+        convert_rows_ = kernels::ConvertRowsAVX2;
+        blend_rows_ = kernels::BlendRowsAVX2;
+        scale_row_ = kernels::ScaleRowAVX2;
+        break;
+#endif
+#ifdef AC_VIDEO_HAVE_NEON_KERNELS
+    case Kernel::kNEON:
+        convert_rows_ = kernels::ConvertRowsNEON;
+        blend_rows_ = kernels::BlendRowsNEON;
+        scale_row_ = kernels::ScaleRowNEON;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    // There is no point in more bands than line pairs
+    config_.threads = std::max(1u, std::min({config_.threads, kMaxThreads, config_.height / 2}));
+
+    if (scaling_)
+        SetupScaling();
+
+    for (unsigned int band = 1; band < config_.threads; band++)
+        workers_.push_back(std::thread(&ColorConverter::WorkerMain, this, band));
+
+    AC_DEBUG("Converting %dx%d into %dx%d using the %s kernel with %d threads",
+             config_.source_width, config_.source_height, config_.width, config_.height,
+             KernelToString(kernel_), config_.threads);
+}
+
+ColorConverter::~ColorConverter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+
+    for (auto &worker : workers_)
+        worker.join();
+}
+
+ColorConverter::Kernel ColorConverter::ActiveKernel() const {
+    return kernel_;
+}
+
+std::size_t ColorConverter::OutputSize() const {
+    return config_.width * config_.height * 3 / 2;
+}
+
+void ColorConverter::SetupScaling() {
+    // Bilinear filter with the sample positions centered like most
+    // scalers do it: output sample n sits at (n + 0.5) * in / out - 0.5
+    const auto taps_for = [](unsigned int in, unsigned int out, unsigned int step,
+                             std::vector<std::int32_t> &first, std::vector<std::int32_t> &second,
+                             std::vector<std::int32_t> &weight) {
+        first.resize(out);
+        second.resize(out);
+        weight.resize(out);
+
+        for (unsigned int n = 0; n < out; n++) {
+            std::int64_t position = ((2ll * n + 1) * in * 256) / (2ll * out) - 128;
+            if (position < 0)
+                position = 0;
+
+            unsigned int index = position >> 8;
+            unsigned int fraction = position & 0xff;
+            if (index >= in - 1) {
+                index = in - 1;
+                fraction = 0;
+            }
+
+            first[n] = index * step;
+            second[n] = std::min(index + 1, in - 1) * step;
+            weight[n] = fraction;
+        }
+    };
+
+    // Horizontal taps index whole pixels, vertical ones lines in bytes.
+    // The horizontal ones are kept as separate arrays so the kernels can
+    // load them straight into vector registers.
+    taps_for(config_.source_width, config_.width, 1,
+             horizontal_first_, horizontal_second_, horizontal_weight_);
+    taps_for(config_.source_height, config_.height, config_.source_stride,
+             vertical_first_, vertical_second_, vertical_weight_);
+
+    // Two scaled lines per band which are then handed to the kernel
+    // plus room for a vertically blended source line.
+    scratch_.resize(config_.threads);
+    for (auto &scratch : scratch_)
+        scratch.resize((2 * config_.width + config_.source_width) * kBytesPerPixel);
+}
+
+void ColorConverter::ScaleLine(const std::uint8_t *source, unsigned int line, std::uint8_t *target,
+                               std::uint8_t *blended) const {
+    // Separable filter: first blend the two source lines vertically,
+    // then interpolate horizontally within the blended line.
+    const std::uint8_t *row = source + vertical_first_[line];
+
+    if (vertical_weight_[line] > 0) {
+        blend_rows_(row, source + vertical_second_[line], config_.source_width * kBytesPerPixel,
+                    vertical_weight_[line], blended);
+        row = blended;
+    }
+
+    scale_row_(row, horizontal_first_.data(), horizontal_second_.data(),
+               horizontal_weight_.data(), config_.width, target);
+}
+
+void ColorConverter::ConvertBand(unsigned int band, const std::uint8_t *source, std::uint8_t *target) {
+    const auto line_pairs = config_.height / 2;
+    const auto first = line_pairs * band / config_.threads;
+    const auto last = line_pairs * (band + 1) / config_.threads;
+
+    const auto width = config_.width;
+    const auto luma_size = width * config_.height;
+
+    for (auto pair = first; pair < last; pair++) {
+        const auto line = pair * 2;
+
+        const std::uint8_t *src0 = source + line * config_.source_stride;
+        const std::uint8_t *src1 = src0 + config_.source_stride;
+
+        if (scaling_) {
+            auto &scratch = scratch_[band];
+            auto blended = scratch.data() + 2 * width * kBytesPerPixel;
+            ScaleLine(source, line, scratch.data(), blended);
+            ScaleLine(source, line + 1, scratch.data() + width * kBytesPerPixel, blended);
+            src0 = scratch.data();
+            src1 = src0 + width * kBytesPerPixel;
+        }
+
+        std::uint8_t *y0 = target + line * width;
+        std::uint8_t *y1 = y0 + width;
+
+        if (config_.format == Format::kNV12) {
+            std::uint8_t *uv = target + luma_size + pair * width;
+            convert_rows_(src0, src1, width, y0, y1, uv, uv + 1, 2, coefficients_);
+        }
+        else {
+            std::uint8_t *u = target + luma_size + pair * (width / 2);
+            std::uint8_t *v = u + luma_size / 4;
+            convert_rows_(src0, src1, width, y0, y1, u, v, 1, coefficients_);
+        }
+    }
+}
+
+void ColorConverter::Convert(const std::uint8_t *source, std::uint8_t *target) {
+    if (workers_.empty()) {
+        ConvertBand(0, source, target);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_source_ = source;
+        job_target_ = target;
+        pending_ = workers_.size();
+        generation_++;
+    }
+    work_available_.notify_all();
+
+    // The calling thread takes care of the first band itself
+    ConvertBand(0, source, target);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [&]() { return pending_ == 0; });
+}
+
+void ColorConverter::WorkerMain(unsigned int band) {
+    ac::Utils::SetThreadName(ac::Utils::Sprintf("ColorConv%d", band));
+
+    unsigned long generation = 0;
+
+    while (true) {
+        const std::uint8_t *source = nullptr;
+        std::uint8_t *target = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [&]() { return stopping_ || generation_ != generation; });
+            if (stopping_)
+                return;
+
+            generation = generation_;
+            source = job_source_;
+            target = job_target_;
+        }
+
+        ConvertBand(band, source, target);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_--;
+        }
+        work_done_.notify_one();
+    }
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_COLORCONVERTER_H_
+#define AC_VIDEO_COLORCONVERTER_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/colorconverter_kernels.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Converts RGBA frames in CPU memory into NV12 or I420 and
+ * optionally scales them to a different size on the way.
+ *
+ * The actual conversion is done by a SIMD kernel picked at runtime for
+ * the CPU we're running on. All kernels produce exactly the same output
+ * as the scalar one. Frames are processed a pair of lines at a time to
+ * keep the working set in the L1 cache and can be split into horizontal
+ * bands processed by a number of worker threads.
+ */
+class ColorConverter : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<ColorConverter> Ptr;
+
+    enum class Kernel {
+        kAuto,
+        kScalar,
+        kSSE41,
+        kAVX2,
+        kNEON
+    };
+
+    enum class Format {
+        kNV12,
+        kI420
+    };
+
+    enum class Matrix {
+        kBT601,
+        kBT709
+    };
+
+    class Config {
+    public:
+        Config() :
+            source_width(0),
+            source_height(0),
+            source_stride(0),
+            width(0),
+            height(0),
+            format(Format::kNV12),
+            matrix(Matrix::kBT709),
+            kernel(Kernel::kAuto),
+            threads(1) {
+        }
+
+        unsigned int source_width;
+        unsigned int source_height;
+        // Bytes per line of the source, source_width * 4 if left at zero
+        unsigned int source_stride;
+        // Size of the output which has to be even in both directions.
+        // Different from the source size it enables scaling.
+        unsigned int width;
+        unsigned int height;
+        Format format;
+        Matrix matrix;
+        Kernel kernel;
+        unsigned int threads;
+    };
+
+    static std::string KernelToString(Kernel kernel);
+    static bool IsKernelSupported(Kernel kernel);
+
+    // Returns nullptr if the configuration can't be handled
+    static Ptr Create(const Config &config);
+
+    ~ColorConverter();
+
+    Kernel ActiveKernel() const;
+    // Number of bytes Convert() writes to target
+    std::size_t OutputSize() const;
+
+    void Convert(const std::uint8_t *source, std::uint8_t *target);
+
+private:
+    ColorConverter(const Config &config, Kernel kernel);
+
+    void SetupScaling();
+    void ScaleLine(const std::uint8_t *source, unsigned int line, std::uint8_t *target,
+                   std::uint8_t *blended) const;
+    void ConvertBand(unsigned int band, const std::uint8_t *source, std::uint8_t *target);
+    void WorkerMain(unsigned int band);
+
+private:
+    Config config_;
+    Kernel kernel_;
+    kernels::ConvertRowsFunc convert_rows_;
+    kernels::BlendRowsFunc blend_rows_;
+    kernels::ScaleRowFunc scale_row_;
+    kernels::Coefficients coefficients_;
+    bool scaling_;
+    // Position of the two neighbouring source samples (in pixels
+    // horizontally and in bytes vertically) for every output sample and
+    // the weight of the second one in 8 bit fixed point.
+    std::vector<std::int32_t> horizontal_first_;
+    std::vector<std::int32_t> horizontal_second_;
+    std::vector<std::int32_t> horizontal_weight_;
+    std::vector<std::int32_t> vertical_first_;
+    std::vector<std::int32_t> vertical_second_;
+    std::vector<std::int32_t> vertical_weight_;
+    std::vector<std::vector<std::uint8_t>> scratch_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_done_;
+    unsigned long generation_;
+    unsigned int pending_;
+    bool stopping_;
+    const std::uint8_t *job_source_;
+    std::uint8_t *job_target_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_COLORCONVERTER_KERNELS_H_
+#define AC_VIDEO_COLORCONVERTER_KERNELS_H_
+
+#include <cstdint>
+
+namespace ac {
+namespace video {
+namespace kernels {
+
+// RGB to YCbCr coefficients in 8 bit fixed point. All kernels have to
+// use exactly the same integer arithmetic as the scalar one so that
+// their output stays bit identical:
+//
+//   Y = ((y_r * R + y_g * G + y_b * B + 128) >> 8) + 16
+//   U = ((u_r * R' + u_g * G' + u_b * B' + 128) >> 8) + 128
+//   V = ((v_r * R' + v_g * G' + v_b * B' + 128) >> 8) + 128
+//
+// with R', G' and B' the rounded average of each 2x2 block.
+struct Coefficients {
+    std::int16_t y_r, y_g, y_b;
+    std::int16_t u_r, u_g, u_b;
+    std::int16_t v_r, v_g, v_b;
+};
+
+// Converts two lines of width RGBA pixels into two lines of luma and
+// one line of subsampled chroma. The chroma samples are written to u
+// and v with uv_step bytes between two samples which allows writing
+// interleaved (NV12) as well as planar (I420) output. width has to be
+// even.
+typedef void (*ConvertRowsFunc)(const std::uint8_t *src0, const std::uint8_t *src1,
+                                unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                                std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                                const Coefficients &coefficients);
+
+// Blends two lines of size bytes into one: (top * (256 - weight) +
+// bottom * weight + 128) >> 8 with weight in [1, 255].
+typedef void (*BlendRowsFunc)(const std::uint8_t *top, const std::uint8_t *bottom,
+                              unsigned int size, unsigned int weight, std::uint8_t *out);
+
+// Resamples a line of RGBA pixels into count pixels. Output pixel n is
+// interpolated between source pixels first[n] and second[n] with the
+// latter weighted by weight[n] in [0, 255] using the same rounding as
+// BlendRowsFunc.
+typedef void (*ScaleRowFunc)(const std::uint8_t *row, const std::int32_t *first,
+                             const std::int32_t *second, const std::int32_t *weight,
+                             unsigned int count, std::uint8_t *out);
+
+void ConvertRowsScalar(const std::uint8_t *src0, const std::uint8_t *src1,
+                       unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                       std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                       const Coefficients &coefficients);
+void BlendRowsScalar(const std::uint8_t *top, const std::uint8_t *bottom,
+                     unsigned int size, unsigned int weight, std::uint8_t *out);
+void ScaleRowScalar(const std::uint8_t *row, const std::int32_t *first,
+                    const std::int32_t *second, const std::int32_t *weight,
+                    unsigned int count, std::uint8_t *out);
+
+#if defined(__i386__) || defined(__x86_64__)
+#define AC_VIDEO_HAVE_X86_KERNELS 1
+void ConvertRowsSSE41(const std::uint8_t *src0, const std::uint8_t *src1,
+                      unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                      std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                      const Coefficients &coefficients);
+void BlendRowsSSE41(const std::uint8_t *top, const std::uint8_t *bottom,
+                    unsigned int size, unsigned int weight, std::uint8_t *out);
+void ScaleRowSSE41(const std::uint8_t *row, const std::int32_t *first,
+                   const std::int32_t *second, const std::int32_t *weight,
+                   unsigned int count, std::uint8_t *out);
+void ConvertRowsAVX2(const std::uint8_t *src0, const std::uint8_t *src1,
+                     unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                     std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                     const Coefficients &coefficients);
+void BlendRowsAVX2(const std::uint8_t *top, const std::uint8_t *bottom,
+                   unsigned int size, unsigned int weight, std::uint8_t *out);
+void ScaleRowAVX2(const std::uint8_t *row, const std::int32_t *first,
+                  const std::int32_t *second, const std::int32_t *weight,
+                  unsigned int count, std::uint8_t *out);
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+#define AC_VIDEO_HAVE_NEON_KERNELS 1
+void ConvertRowsNEON(const std::uint8_t *src0, const std::uint8_t *src1,
+                     unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                     std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                     const Coefficients &coefficients);
+void BlendRowsNEON(const std::uint8_t *top, const std::uint8_t *bottom,
+                   unsigned int size, unsigned int weight, std::uint8_t *out);
+void ScaleRowNEON(const std::uint8_t *row, const std::int32_t *first,
+                  const std::int32_t *second, const std::int32_t *weight,
+                  unsigned int count, std::uint8_t *out);
+#endif
+
+} // namespace kernels
+} // namespace video
+} // namespace ac
+
+#endif
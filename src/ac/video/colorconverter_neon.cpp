@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/video/colorconverter_kernels.h"
+
+#ifdef AC_VIDEO_HAVE_NEON_KERNELS
+
+#include <memory.h>
+
+#include <arm_neon.h>
+
+// On 32 bit ARM this file needs to be built with -mfpu=neon while the
+// ColorConverter only calls into it when the CPU reports NEON support.
+
+namespace ac {
+namespace video {
+namespace kernels {
+
+void ConvertRowsNEON(const std::uint8_t *src0, const std::uint8_t *src1,
+                     unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                     std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                     const Coefficients &coefficients) {
+    static constexpr unsigned int kPixelsPerIteration{16};
+
+    const auto y_r = vdup_n_u8(coefficients.y_r);
+    const auto y_g = vdup_n_u8(coefficients.y_g);
+    const auto y_b = vdup_n_u8(coefficients.y_b);
+    const auto y_offset = vdupq_n_u8(16);
+    const auto uv_offset = vdupq_n_s16(128);
+
+    unsigned int x = 0;
+    for (; x + kPixelsPerIteration <= width; x += kPixelsPerIteration) {
+        const auto s0 = vld4q_u8(src0 + x * 4);
+        const auto s1 = vld4q_u8(src1 + x * 4);
+
+        // vrshrn computes (sum + 128) >> 8 without the risk of overflowing
+        auto lo = vmull_u8(vget_low_u8(s0.val[0]), y_r);
+        lo = vmlal_u8(lo, vget_low_u8(s0.val[1]), y_g);
+        lo = vmlal_u8(lo, vget_low_u8(s0.val[2]), y_b);
+        auto hi = vmull_u8(vget_high_u8(s0.val[0]), y_r);
+        hi = vmlal_u8(hi, vget_high_u8(s0.val[1]), y_g);
+        hi = vmlal_u8(hi, vget_high_u8(s0.val[2]), y_b);
+        vst1q_u8(y0 + x, vaddq_u8(vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)), y_offset));
+
+        lo = vmull_u8(vget_low_u8(s1.val[0]), y_r);
+        lo = vmlal_u8(lo, vget_low_u8(s1.val[1]), y_g);
+        lo = vmlal_u8(lo, vget_low_u8(s1.val[2]), y_b);
+        hi = vmull_u8(vget_high_u8(s1.val[0]), y_r);
+        hi = vmlal_u8(hi, vget_high_u8(s1.val[1]), y_g);
+        hi = vmlal_u8(hi, vget_high_u8(s1.val[2]), y_b);
+        vst1q_u8(y1 + x, vaddq_u8(vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)), y_offset));
+
+        // Rounded average of each 2x2 block
+        const auto r = vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(s0.val[0]), s1.val[0]), 2));
+        const auto g = vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(s0.val[1]), s1.val[1]), 2));
+        const auto b = vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(s0.val[2]), s1.val[2]), 2));
+
+        auto cb = vmulq_n_s16(r, coefficients.u_r);
+        cb = vmlaq_n_s16(cb, g, coefficients.u_g);
+        cb = vmlaq_n_s16(cb, b, coefficients.u_b);
+        auto cr = vmulq_n_s16(r, coefficients.v_r);
+        cr = vmlaq_n_s16(cr, g, coefficients.v_g);
+        cr = vmlaq_n_s16(cr, b, coefficients.v_b);
+
+        uint8x8x2_t uv;
+        uv.val[0] = vqmovun_s16(vaddq_s16(vrshrq_n_s16(cb, 8), uv_offset));
+        uv.val[1] = vqmovun_s16(vaddq_s16(vrshrq_n_s16(cr, 8), uv_offset));
+
+        const auto offset = (x / 2) * uv_step;
+
+        if (uv_step == 2 && v == u + 1) {
+            vst2_u8(u + offset, uv);
+        } else if (uv_step == 1) {
+            vst1_u8(u + offset, uv.val[0]);
+            vst1_u8(v + offset, uv.val[1]);
+        } else {
+            break;
+        }
+    }
+
+    if (x < width)
+        ConvertRowsScalar(src0 + x * 4, src1 + x * 4, width - x, y0 + x, y1 + x,
+                          u + (x / 2) * uv_step, v + (x / 2) * uv_step, uv_step, coefficients);
+}
+
+void BlendRowsNEON(const std::uint8_t *top, const std::uint8_t *bottom,
+                   unsigned int size, unsigned int weight, std::uint8_t *out) {
+    static constexpr unsigned int kBytesPerIteration{16};
+
+    // Both weights fit into 8 bits as weight is never 0 here
+    const auto first = vdup_n_u8(256 - weight);
+    const auto second = vdup_n_u8(weight);
+
+    unsigned int n = 0;
+    for (; n + kBytesPerIteration <= size; n += kBytesPerIteration) {
+        const auto a = vld1q_u8(top + n);
+        const auto b = vld1q_u8(bottom + n);
+
+        const auto lo = vmlal_u8(vmull_u8(vget_low_u8(a), first), vget_low_u8(b), second);
+        const auto hi = vmlal_u8(vmull_u8(vget_high_u8(a), first), vget_high_u8(b), second);
+
+        vst1q_u8(out + n, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+
+    if (n < size)
+        BlendRowsScalar(top + n, bottom + n, size - n, weight, out + n);
+}
+
+void ScaleRowNEON(const std::uint8_t *row, const std::int32_t *first,
+                  const std::int32_t *second, const std::int32_t *weight,
+                  unsigned int count, std::uint8_t *out) {
+    static constexpr unsigned int kPixelsPerIteration{2};
+
+    const auto full = vdupq_n_u16(256);
+
+    unsigned int n = 0;
+    for (; n + kPixelsPerIteration <= count; n += kPixelsPerIteration) {
+        std::uint32_t pixels[4];
+        ::memcpy(&pixels[0], row + first[n] * 4, 4);
+        ::memcpy(&pixels[1], row + first[n + 1] * 4, 4);
+        ::memcpy(&pixels[2], row + second[n] * 4, 4);
+        ::memcpy(&pixels[3], row + second[n + 1] * 4, 4);
+
+        const auto ab = vreinterpretq_u8_u32(vld1q_u32(pixels));
+        const auto w = vcombine_u16(vdup_n_u16(weight[n]), vdup_n_u16(weight[n + 1]));
+
+        // A weight of 0 makes the first one 256 so this needs 16 bit lanes
+        const auto result = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(ab)), vsubq_u16(full, w)),
+                                      vmovl_u8(vget_high_u8(ab)), w);
+
+        vst1_u8(out + n * 4, vrshrn_n_u16(result, 8));
+    }
+
+    if (n < count)
+        ScaleRowScalar(row, first + n, second + n, weight + n, count - n, out + n * 4);
+}
+
+} // namespace kernels
+} // namespace video
+} // namespace ac
+
+#endif
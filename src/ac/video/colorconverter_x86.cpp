@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/video/colorconverter_kernels.h"
+
+#ifdef AC_VIDEO_HAVE_X86_KERNELS
+
+#include <memory.h>
+
+#include <immintrin.h>
+
+// The kernels are compiled for their instruction set through function
+// attributes so the rest of the binary keeps running on any x86 CPU.
+// Which one is used gets decided at runtime by the ColorConverter.
+#define AC_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define AC_TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace {
+inline int LoadPixel(const std::uint8_t *row, std::int32_t index) {
+    int pixel;
+    ::memcpy(&pixel, row + index * 4, sizeof(pixel));
+    return pixel;
+}
+
+struct SSEConstants {
+    AC_TARGET_SSE41 explicit SSEConstants(const ac::video::kernels::Coefficients &c) :
+        zero(_mm_setzero_si128()),
+        y_coefficients(_mm_setr_epi16(c.y_r, c.y_g, c.y_b, 0, c.y_r, c.y_g, c.y_b, 0)),
+        u_coefficients(_mm_setr_epi16(c.u_r, c.u_g, c.u_b, 0, c.u_r, c.u_g, c.u_b, 0)),
+        v_coefficients(_mm_setr_epi16(c.v_r, c.v_g, c.v_b, 0, c.v_r, c.v_g, c.v_b, 0)),
+        rounding(_mm_set1_epi32(128)),
+        y_offset(_mm_set1_epi32(16)),
+        uv_offset(_mm_set1_epi32(128)),
+        two(_mm_set1_epi16(2)) {
+    }
+
+    __m128i zero;
+    __m128i y_coefficients;
+    __m128i u_coefficients;
+    __m128i v_coefficients;
+    __m128i rounding;
+    __m128i y_offset;
+    __m128i uv_offset;
+    __m128i two;
+};
+
+// Converts 4 pixels of two lines. Returns luma for both lines as 32 bit
+// values and the two chroma samples as [U0 U1 V0 V1].
+AC_TARGET_SSE41 inline void Convert4(__m128i src0, __m128i src1, const SSEConstants &k,
+                                     __m128i &y0, __m128i &y1, __m128i &uv) {
+    const auto lo0 = _mm_unpacklo_epi8(src0, k.zero);
+    const auto hi0 = _mm_unpackhi_epi8(src0, k.zero);
+    const auto lo1 = _mm_unpacklo_epi8(src1, k.zero);
+    const auto hi1 = _mm_unpackhi_epi8(src1, k.zero);
+
+    y0 = _mm_hadd_epi32(_mm_madd_epi16(lo0, k.y_coefficients), _mm_madd_epi16(hi0, k.y_coefficients));
+    y0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y0, k.rounding), 8), k.y_offset);
+
+    y1 = _mm_hadd_epi32(_mm_madd_epi16(lo1, k.y_coefficients), _mm_madd_epi16(hi1, k.y_coefficients));
+    y1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y1, k.rounding), 8), k.y_offset);
+
+    // Sum up each 2x2 block: first vertically and then the two
+    // horizontal neighbours which end up in different 64 bit halves.
+    const auto sum_lo = _mm_add_epi16(lo0, lo1);
+    const auto sum_hi = _mm_add_epi16(hi0, hi1);
+    auto average = _mm_add_epi16(_mm_unpacklo_epi64(sum_lo, sum_hi), _mm_unpackhi_epi64(sum_lo, sum_hi));
+    average = _mm_srli_epi16(_mm_add_epi16(average, k.two), 2);
+
+    uv = _mm_hadd_epi32(_mm_madd_epi16(average, k.u_coefficients), _mm_madd_epi16(average, k.v_coefficients));
+    uv = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(uv, k.rounding), 8), k.uv_offset);
+}
+
+struct AVXConstants {
+    AC_TARGET_AVX2 explicit AVXConstants(const ac::video::kernels::Coefficients &c) :
+        zero(_mm256_setzero_si256()),
+        y_coefficients(_mm256_setr_epi16(c.y_r, c.y_g, c.y_b, 0, c.y_r, c.y_g, c.y_b, 0,
+                                         c.y_r, c.y_g, c.y_b, 0, c.y_r, c.y_g, c.y_b, 0)),
+        u_coefficients(_mm256_setr_epi16(c.u_r, c.u_g, c.u_b, 0, c.u_r, c.u_g, c.u_b, 0,
+                                         c.u_r, c.u_g, c.u_b, 0, c.u_r, c.u_g, c.u_b, 0)),
+        v_coefficients(_mm256_setr_epi16(c.v_r, c.v_g, c.v_b, 0, c.v_r, c.v_g, c.v_b, 0,
+                                         c.v_r, c.v_g, c.v_b, 0, c.v_r, c.v_g, c.v_b, 0)),
+        rounding(_mm256_set1_epi32(128)),
+        y_offset(_mm256_set1_epi32(16)),
+        uv_offset(_mm256_set1_epi32(128)),
+        two(_mm256_set1_epi16(2)),
+        // Undoes the lane interleaving of the 128 bit packs
+        dword_order(_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)) {
+    }
+
+    __m256i zero;
+    __m256i y_coefficients;
+    __m256i u_coefficients;
+    __m256i v_coefficients;
+    __m256i rounding;
+    __m256i y_offset;
+    __m256i uv_offset;
+    __m256i two;
+    __m256i dword_order;
+};
+
+// Same as Convert4 but for 8 pixels where everything happens within
+// the two 128 bit lanes. The low lane ends up with the results for the
+// first four pixels and the high lane with the ones for the last four.
+AC_TARGET_AVX2 inline void Convert8(__m256i src0, __m256i src1, const AVXConstants &k,
+                                    __m256i &y0, __m256i &y1, __m256i &uv) {
+    const auto lo0 = _mm256_unpacklo_epi8(src0, k.zero);
+    const auto hi0 = _mm256_unpackhi_epi8(src0, k.zero);
+    const auto lo1 = _mm256_unpacklo_epi8(src1, k.zero);
+    const auto hi1 = _mm256_unpackhi_epi8(src1, k.zero);
+
+    y0 = _mm256_hadd_epi32(_mm256_madd_epi16(lo0, k.y_coefficients), _mm256_madd_epi16(hi0, k.y_coefficients));
+    y0 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y0, k.rounding), 8), k.y_offset);
+
+    y1 = _mm256_hadd_epi32(_mm256_madd_epi16(lo1, k.y_coefficients), _mm256_madd_epi16(hi1, k.y_coefficients));
+    y1 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y1, k.rounding), 8), k.y_offset);
+
+    const auto sum_lo = _mm256_add_epi16(lo0, lo1);
+    const auto sum_hi = _mm256_add_epi16(hi0, hi1);
+    auto average = _mm256_add_epi16(_mm256_unpacklo_epi64(sum_lo, sum_hi), _mm256_unpackhi_epi64(sum_lo, sum_hi));
+    average = _mm256_srli_epi16(_mm256_add_epi16(average, k.two), 2);
+
+    uv = _mm256_hadd_epi32(_mm256_madd_epi16(average, k.u_coefficients), _mm256_madd_epi16(average, k.v_coefficients));
+    uv = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(uv, k.rounding), 8), k.uv_offset);
+}
+}
+
+namespace ac {
+namespace video {
+namespace kernels {
+
+AC_TARGET_SSE41 void ConvertRowsSSE41(const std::uint8_t *src0, const std::uint8_t *src1,
+                                      unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                                      std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                                      const Coefficients &coefficients) {
+    static constexpr unsigned int kPixelsPerIteration{16};
+
+    const SSEConstants k(coefficients);
+    // Chroma comes out as [U0 U1 V0 V1 U2 U3 V2 V3 ...]
+    const auto interleave = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    const auto planar = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    unsigned int x = 0;
+    for (; x + kPixelsPerIteration <= width; x += kPixelsPerIteration) {
+        __m128i luma0[4], luma1[4], chroma[4];
+
+        for (int n = 0; n < 4; n++) {
+            const auto s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + (x + n * 4) * 4));
+            const auto s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + (x + n * 4) * 4));
+            Convert4(s0, s1, k, luma0[n], luma1[n], chroma[n]);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x),
+                         _mm_packus_epi16(_mm_packs_epi32(luma0[0], luma0[1]), _mm_packs_epi32(luma0[2], luma0[3])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x),
+                         _mm_packus_epi16(_mm_packs_epi32(luma1[0], luma1[1]), _mm_packs_epi32(luma1[2], luma1[3])));
+
+        const auto uv = _mm_packus_epi16(_mm_packs_epi32(chroma[0], chroma[1]), _mm_packs_epi32(chroma[2], chroma[3]));
+        const auto offset = (x / 2) * uv_step;
+
+        if (uv_step == 2 && v == u + 1) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + offset), _mm_shuffle_epi8(uv, interleave));
+        } else if (uv_step == 1) {
+            const auto separated = _mm_shuffle_epi8(uv, planar);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + offset), separated);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(v + offset), _mm_srli_si128(separated, 8));
+        } else {
+            break;
+        }
+    }
+
+    if (x < width)
+        ConvertRowsScalar(src0 + x * 4, src1 + x * 4, width - x, y0 + x, y1 + x,
+                          u + (x / 2) * uv_step, v + (x / 2) * uv_step, uv_step, coefficients);
+}
+
+AC_TARGET_SSE41 void BlendRowsSSE41(const std::uint8_t *top, const std::uint8_t *bottom,
+                                    unsigned int size, unsigned int weight, std::uint8_t *out) {
+    static constexpr unsigned int kBytesPerIteration{16};
+
+    const auto zero = _mm_setzero_si128();
+    const auto rounding = _mm_set1_epi16(128);
+    const auto second = _mm_set1_epi16(weight);
+    const auto first = _mm_set1_epi16(256 - weight);
+
+    unsigned int n = 0;
+    for (; n + kBytesPerIteration <= size; n += kBytesPerIteration) {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + n));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + n));
+
+        const auto lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), first),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), second)), rounding), 8);
+        const auto hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), first),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), second)), rounding), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), _mm_packus_epi16(lo, hi));
+    }
+
+    if (n < size)
+        BlendRowsScalar(top + n, bottom + n, size - n, weight, out + n);
+}
+
+AC_TARGET_SSE41 void ScaleRowSSE41(const std::uint8_t *row, const std::int32_t *first,
+                                   const std::int32_t *second, const std::int32_t *weight,
+                                   unsigned int count, std::uint8_t *out) {
+    static constexpr unsigned int kPixelsPerIteration{4};
+
+    const auto zero = _mm_setzero_si128();
+    const auto rounding = _mm_set1_epi16(128);
+    const auto full = _mm_set1_epi16(256);
+    // Spreads the weights of pixels 0 and 1 (or 2 and 3) over their channels
+    const auto spread_lo = _mm_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 4, 5, 4, 5, 4, 5, 4, 5);
+    const auto spread_hi = _mm_setr_epi8(8, 9, 8, 9, 8, 9, 8, 9, 12, 13, 12, 13, 12, 13, 12, 13);
+
+    unsigned int n = 0;
+    for (; n + kPixelsPerIteration <= count; n += kPixelsPerIteration) {
+        const auto a = _mm_setr_epi32(LoadPixel(row, first[n]), LoadPixel(row, first[n + 1]),
+                                      LoadPixel(row, first[n + 2]), LoadPixel(row, first[n + 3]));
+        const auto b = _mm_setr_epi32(LoadPixel(row, second[n]), LoadPixel(row, second[n + 1]),
+                                      LoadPixel(row, second[n + 2]), LoadPixel(row, second[n + 3]));
+        const auto w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + n));
+
+        const auto w_lo = _mm_shuffle_epi8(w, spread_lo);
+        const auto w_hi = _mm_shuffle_epi8(w, spread_hi);
+
+        const auto lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, w_lo)),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w_lo)), rounding), 8);
+        const auto hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, w_hi)),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w_hi)), rounding), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    if (n < count)
+        ScaleRowScalar(row, first + n, second + n, weight + n, count - n, out + n * 4);
+}
+
+AC_TARGET_AVX2 void ConvertRowsAVX2(const std::uint8_t *src0, const std::uint8_t *src1,
+                                    unsigned int width, std::uint8_t *y0, std::uint8_t *y1,
+                                    std::uint8_t *u, std::uint8_t *v, unsigned int uv_step,
+                                    const Coefficients &coefficients) {
+    static constexpr unsigned int kPixelsPerIteration{32};
+
+    const AVXConstants k(coefficients);
+    const auto interleave = _mm256_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15,
+                                             0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    const auto planar = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                         0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    unsigned int x = 0;
+    for (; x + kPixelsPerIteration <= width; x += kPixelsPerIteration) {
+        __m256i luma0[4], luma1[4], chroma[4];
+
+        for (int n = 0; n < 4; n++) {
+            const auto s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + (x + n * 8) * 4));
+            const auto s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + (x + n * 8) * 4));
+            Convert8(s0, s1, k, luma0[n], luma1[n], chroma[n]);
+        }
+
+        auto packed = _mm256_packus_epi16(_mm256_packs_epi32(luma0[0], luma0[1]), _mm256_packs_epi32(luma0[2], luma0[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y0 + x), _mm256_permutevar8x32_epi32(packed, k.dword_order));
+
+        packed = _mm256_packus_epi16(_mm256_packs_epi32(luma1[0], luma1[1]), _mm256_packs_epi32(luma1[2], luma1[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y1 + x), _mm256_permutevar8x32_epi32(packed, k.dword_order));
+
+        packed = _mm256_packus_epi16(_mm256_packs_epi32(chroma[0], chroma[1]), _mm256_packs_epi32(chroma[2], chroma[3]));
+        const auto uv = _mm256_permutevar8x32_epi32(packed, k.dword_order);
+        const auto offset = (x / 2) * uv_step;
+
+        if (uv_step == 2 && v == u + 1) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + offset), _mm256_shuffle_epi8(uv, interleave));
+        } else if (uv_step == 1) {
+            const auto separated = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(uv, planar), 0xd8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + offset), _mm256_castsi256_si128(separated));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(v + offset), _mm256_extracti128_si256(separated, 1));
+        } else {
+            break;
+        }
+    }
+
+    if (x < width)
+        ConvertRowsScalar(src0 + x * 4, src1 + x * 4, width - x, y0 + x, y1 + x,
+                          u + (x / 2) * uv_step, v + (x / 2) * uv_step, uv_step, coefficients);
+}
+
+AC_TARGET_AVX2 void BlendRowsAVX2(const std::uint8_t *top, const std::uint8_t *bottom,
+                                  unsigned int size, unsigned int weight, std::uint8_t *out) {
+    static constexpr unsigned int kBytesPerIteration{32};
+
+    const auto zero = _mm256_setzero_si256();
+    const auto rounding = _mm256_set1_epi16(128);
+    const auto second = _mm256_set1_epi16(weight);
+    const auto first = _mm256_set1_epi16(256 - weight);
+
+    // Unpacking and packing both work within 128 bit lanes so the byte
+    // order is preserved without any permutes.
+    unsigned int n = 0;
+    for (; n + kBytesPerIteration <= size; n += kBytesPerIteration) {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + n));
+        const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + n));
+
+        const auto lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), first),
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), second)), rounding), 8);
+        const auto hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), first),
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), second)), rounding), 8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + n), _mm256_packus_epi16(lo, hi));
+    }
+
+    if (n < size)
+        BlendRowsScalar(top + n, bottom + n, size - n, weight, out + n);
+}
+
+AC_TARGET_AVX2 void ScaleRowAVX2(const std::uint8_t *row, const std::int32_t *first,
+                                 const std::int32_t *second, const std::int32_t *weight,
+                                 unsigned int count, std::uint8_t *out) {
+    static constexpr unsigned int kPixelsPerIteration{8};
+
+    const auto zero = _mm256_setzero_si256();
+    const auto rounding = _mm256_set1_epi16(128);
+    const auto full = _mm256_set1_epi16(256);
+    const auto spread_lo = _mm256_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 4, 5, 4, 5, 4, 5, 4, 5,
+                                            0, 1, 0, 1, 0, 1, 0, 1, 4, 5, 4, 5, 4, 5, 4, 5);
+    const auto spread_hi = _mm256_setr_epi8(8, 9, 8, 9, 8, 9, 8, 9, 12, 13, 12, 13, 12, 13, 12, 13,
+                                            8, 9, 8, 9, 8, 9, 8, 9, 12, 13, 12, 13, 12, 13, 12, 13);
+    const auto pixels = reinterpret_cast<const int*>(row);
+
+    unsigned int n = 0;
+    for (; n + kPixelsPerIteration <= count; n += kPixelsPerIteration) {
+        const auto a = _mm256_i32gather_epi32(pixels, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + n)), 4);
+        const auto b = _mm256_i32gather_epi32(pixels, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + n)), 4);
+        const auto w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight + n));
+
+        const auto w_lo = _mm256_shuffle_epi8(w, spread_lo);
+        const auto w_hi = _mm256_shuffle_epi8(w, spread_hi);
+
+        const auto lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_sub_epi16(full, w_lo)),
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w_lo)), rounding), 8);
+        const auto hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_sub_epi16(full, w_hi)),
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w_hi)), rounding), 8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + n * 4), _mm256_packus_epi16(lo, hi));
+    }
+
+    if (n < count)
+        ScaleRowScalar(row, first + n, second + n, weight + n, count - n, out + n * 4);
+}
+
+} // namespace kernels
+} // namespace video
+} // namespace ac
+
+#endif
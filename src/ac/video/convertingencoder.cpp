@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/logger.h"
+
+#include "ac/video/convertingencoder.h"
+
+namespace ac {
+namespace video {
+
+ConvertingEncoder::Ptr ConvertingEncoder::Create(const BaseEncoder::Ptr &encoder,
+                                                 const ColorConverter::Config &conversion) {
+    if (!encoder)
+        return nullptr;
+
+    return std::shared_ptr<ConvertingEncoder>(new ConvertingEncoder(encoder, conversion));
+}
+
+ConvertingEncoder::ConvertingEncoder(const BaseEncoder::Ptr &encoder,
+                                     const ColorConverter::Config &conversion) :
+    encoder_(encoder),
+    conversion_(conversion) {
+
+    if (conversion_.source_stride == 0)
+        conversion_.source_stride = conversion_.source_width * 4;
+}
+
+void ConvertingEncoder::SetDelegate(const std::weak_ptr<BaseEncoder::Delegate> &delegate) {
+    encoder_->SetDelegate(delegate);
+}
+
+BaseEncoder::Config ConvertingEncoder::DefaultConfiguration() {
+    return encoder_->DefaultConfiguration();
+}
+
+bool ConvertingEncoder::Configure(const BaseEncoder::Config &config) {
+    auto conversion = conversion_;
+    conversion.width = config.width;
+    conversion.height = config.height;
+
+    auto converter = ColorConverter::Create(conversion);
+    if (!converter)
+        return false;
+
+    if (!encoder_->Configure(config))
+        return false;
+
+    std::lock_guard<std::mutex> lock(lock_);
+    converter_ = converter;
+    // Buffers of a previous configuration might have the wrong size
+    free_buffers_.clear();
+
+    return true;
+}
+
+void ConvertingEncoder::QueueBuffer(const Buffer::Ptr &buffer) {
+    const std::size_t required = conversion_.source_stride * (conversion_.source_height - 1) +
+            conversion_.source_width * 4;
+
+    // Configure might replace the converter while we're converting
+    ColorConverter::Ptr converter;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        converter = converter_;
+    }
+
+    // Native buffers are fine as long as their memory is mapped
+    if (!converter || !buffer->Data() || buffer->Length() < required) {
+        AC_WARNING("Dropping frame which can't be converted");
+        buffer->Release();
+        return;
+    }
+
+    auto output = AcquireBuffer(converter->OutputSize());
+    converter->Convert(buffer->Data(), output->Data());
+    output->SetTimestamp(buffer->Timestamp());
+
+    buffer->Release();
+
+    encoder_->QueueBuffer(output);
+}
+
+Buffer::Ptr ConvertingEncoder::AcquireBuffer(std::size_t size) {
+    std::lock_guard<std::mutex> lock(lock_);
+
+    // Free buffers belong to the current converter which isn't
+    // necessarily the one the caller is using.
+    if (!free_buffers_.empty() && free_buffers_.back()->Capacity() == size) {
+        auto buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+        return buffer;
+    }
+
+    auto buffer = Buffer::Create(size, MemoryBudget::Stage::kEncoder);
+    buffer->SetDelegate(shared_from_this());
+    return buffer;
+}
+
+void ConvertingEncoder::OnBufferFinished(const Buffer::Ptr &buffer) {
+    std::lock_guard<std::mutex> lock(lock_);
+
+    if (!converter_ || buffer->Capacity() != converter_->OutputSize())
+        return;
+
+    free_buffers_.push_back(buffer);
+}
+
+BaseEncoder::Config ConvertingEncoder::Configuration() const {
+    return encoder_->Configuration();
+}
+
+bool ConvertingEncoder::Running() const {
+    return encoder_->Running();
+}
+
+void ConvertingEncoder::SendIDRFrame() {
+    encoder_->SendIDRFrame();
+}
+
+bool ConvertingEncoder::SetBitrate(unsigned int bitrate) {
+    return encoder_->SetBitrate(bitrate);
+}
+
+unsigned int ConvertingEncoder::IntraRefreshPeriod() const {
+    return encoder_->IntraRefreshPeriod();
+}
+
+bool ConvertingEncoder::Start() {
+    return encoder_->Start();
+}
+
+bool ConvertingEncoder::Stop() {
+    return encoder_->Stop();
+}
+
+bool ConvertingEncoder::Execute() {
+    return encoder_->Execute();
+}
+
+std::string ConvertingEncoder::Name() const {
+    return encoder_->Name();
+}
+
+ac::TimestampUs ConvertingEncoder::LastProgress() const {
+    return encoder_->LastProgress();
+}
+
+} // namespace video
+} // namespace ac
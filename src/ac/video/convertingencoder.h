@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_CONVERTINGENCODER_H_
+#define AC_VIDEO_CONVERTINGENCODER_H_
+
+#include <mutex>
+#include <vector>
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/colorconverter.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Pipeline stage between a renderer producing RGBA frames in CPU
+ * memory, like those of ac::shm::Producer, and an encoder which expects
+ * NV12 or I420 input.
+ *
+ * Wraps the actual encoder and converts (and if needed scales) every
+ * queued buffer into the size the encoder is configured for. The input
+ * buffer is released right after the conversion; output buffers are
+ * recycled once the encoder is done with them.
+ */
+class ConvertingEncoder : public BaseEncoder,
+                          public Buffer::Delegate,
+                          public std::enable_shared_from_this<ConvertingEncoder> {
+public:
+    typedef std::shared_ptr<ConvertingEncoder> Ptr;
+
+    // The target size of the conversion config is ignored and taken
+    // from the encoder configuration instead.
+    static Ptr Create(const BaseEncoder::Ptr &encoder, const ColorConverter::Config &conversion);
+
+    void SetDelegate(const std::weak_ptr<BaseEncoder::Delegate> &delegate) override;
+
+    BaseEncoder::Config DefaultConfiguration() override;
+    bool Configure(const BaseEncoder::Config &config) override;
+    void QueueBuffer(const Buffer::Ptr &buffer) override;
+    BaseEncoder::Config Configuration() const override;
+    bool Running() const override;
+    void SendIDRFrame() override;
+    bool SetBitrate(unsigned int bitrate) override;
+    unsigned int IntraRefreshPeriod() const override;
+
+    // From ac::common::Executable
+    bool Start() override;
+    bool Stop() override;
+    bool Execute() override;
+    std::string Name() const override;
+    ac::TimestampUs LastProgress() const override;
+
+    // From ac::video::Buffer::Delegate
+    void OnBufferFinished(const Buffer::Ptr &buffer) override;
+
+private:
+    ConvertingEncoder(const BaseEncoder::Ptr &encoder, const ColorConverter::Config &conversion);
+
+    Buffer::Ptr AcquireBuffer(std::size_t size);
+
+private:
+    BaseEncoder::Ptr encoder_;
+    ColorConverter::Config conversion_;
+    ColorConverter::Ptr converter_;
+    std::mutex lock_;
+    std::vector<Buffer::Ptr> free_buffers_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
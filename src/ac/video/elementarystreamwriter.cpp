@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "ac/logger.h"
+
+#include "ac/video/elementarystreamwriter.h"
+
+namespace ac {
+namespace video {
+
+ElementaryStreamWriter::Ptr ElementaryStreamWriter::Create(const std::string &path) {
+    const auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        AC_ERROR("Failed to open %s: %s (%d)", path, ::strerror(errno), errno);
+        return nullptr;
+    }
+
+    return std::shared_ptr<ElementaryStreamWriter>(new ElementaryStreamWriter(fd));
+}
+
+ElementaryStreamWriter::ElementaryStreamWriter(int fd) :
+    fd_(fd) {
+}
+
+ElementaryStreamWriter::~ElementaryStreamWriter() {
+    ::close(fd_);
+}
+
+bool ElementaryStreamWriter::Start() {
+    return true;
+}
+
+bool ElementaryStreamWriter::Stop() {
+    return true;
+}
+
+bool ElementaryStreamWriter::Decode(const AccessUnit &unit) {
+    // Write the fragments straight out of the received packets
+    std::vector<struct iovec> vectors;
+    vectors.reserve(unit.fragments.size());
+
+    for (const auto &fragment : unit.fragments)
+        vectors.push_back({ fragment->Data(), fragment->Length() });
+
+    std::size_t offset = 0;
+    while (offset < vectors.size()) {
+        const auto count = std::min<std::size_t>(vectors.size() - offset, IOV_MAX);
+        auto written = ::writev(fd_, vectors.data() + offset, count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            AC_ERROR("Failed to write access unit: %s (%d)", ::strerror(errno), errno);
+            return false;
+        }
+
+        // Skip over everything written and continue with what is left
+        // of a partially written vector.
+        while (offset < vectors.size() && static_cast<std::size_t>(written) >= vectors[offset].iov_len) {
+            written -= vectors[offset].iov_len;
+            offset++;
+        }
+
+        if (offset < vectors.size()) {
+            vectors[offset].iov_base = static_cast<std::uint8_t*>(vectors[offset].iov_base) + written;
+            vectors[offset].iov_len -= written;
+        }
+    }
+
+    return true;
+}
+
+std::string ElementaryStreamWriter::Name() const {
+    return "ElementaryStreamWriter";
+}
+
+} // namespace video
+} // namespace ac
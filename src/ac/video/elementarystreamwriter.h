@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_ELEMENTARYSTREAMWRITER_H_
+#define AC_VIDEO_ELEMENTARYSTREAMWRITER_H_
+
+#include "ac/video/basedecoder.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Writes all received access units as raw elementary stream into
+ * a file which can be played back with any H.264 capable player.
+ */
+class ElementaryStreamWriter : public BaseDecoder {
+public:
+    typedef std::shared_ptr<ElementaryStreamWriter> Ptr;
+
+    static Ptr Create(const std::string &path);
+
+    ~ElementaryStreamWriter();
+
+    // From ac::video::BaseDecoder
+    bool Start() override;
+    bool Stop() override;
+    bool Decode(const AccessUnit &unit) override;
+    std::string Name() const override;
+
+private:
+    ElementaryStreamWriter(int fd);
+
+private:
+    int fd_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
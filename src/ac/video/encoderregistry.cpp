@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "ac/logger.h"
+
+#include "ac/video/encoderregistry.h"
+
+namespace {
+// Written as first line of the cache file. Files with anything else are
+// ignored as a whole.
+static constexpr const char *kCacheHeader{"aethercast-encoders 1"};
+
+std::string JoinProfiles(const std::vector<unsigned int> &profiles) {
+    if (profiles.empty())
+        return "-";
+
+    std::string result;
+    for (const auto profile : profiles) {
+        if (!result.empty())
+            result += ",";
+        result += std::to_string(profile);
+    }
+    return result;
+}
+
+std::vector<unsigned int> SplitProfiles(const std::string &value) {
+    std::vector<unsigned int> profiles;
+    if (value == "-")
+        return profiles;
+
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+        profiles.push_back(std::stoul(item));
+    return profiles;
+}
+}
+
+namespace ac {
+namespace video {
+
+bool EncoderRegistry::Capabilities::Supports(const BaseEncoder::Config &config) const {
+    if (config.profile_idc > 0 &&
+            std::find(profiles.begin(), profiles.end(), config.profile_idc) == profiles.end())
+        return false;
+
+    if (config.level_idc > max_level)
+        return false;
+
+    if (config.width > max_width || config.height > max_height)
+        return false;
+
+    if (config.framerate > 0 && static_cast<unsigned int>(config.framerate) > max_framerate)
+        return false;
+
+    // A backend which can't keep up with the stream in real time is of
+    // no use for us.
+    const std::uint64_t pixel_rate = std::uint64_t(config.width) * config.height *
+            std::max(config.framerate, 1);
+    if (throughput > 0 && throughput < pixel_rate)
+        return false;
+
+    return true;
+}
+
+EncoderRegistry::Ptr EncoderRegistry::Create(const std::string &cache_path) {
+    return std::shared_ptr<EncoderRegistry>(new EncoderRegistry(cache_path));
+}
+
+EncoderRegistry::EncoderRegistry(const std::string &cache_path) :
+    cache_path_(cache_path) {
+    LoadCache();
+}
+
+void EncoderRegistry::Register(const std::string &name, const std::string &version,
+                               const ProbeFunction &probe, const CreateFunction &create) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto &backend : backends_) {
+        if (backend.name == name) {
+            AC_WARNING("Encoder backend %s is already registered", name);
+            return;
+        }
+    }
+
+    Backend backend;
+    backend.name = name;
+    backend.version = version;
+    backend.probe = probe;
+    backend.create = create;
+    backend.probed = false;
+    backend.available = false;
+
+    // Caches of older versions might still carry failed probes
+    auto cached = cache_.find(name);
+    if (cached != cache_.end() && cached->second.version == version && cached->second.available) {
+        backend.probed = true;
+        backend.available = cached->second.available;
+        backend.capabilities = cached->second.capabilities;
+    }
+
+    backends_.push_back(backend);
+}
+
+std::vector<std::string> EncoderRegistry::Backends() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::string> names;
+    for (const auto &backend : backends_)
+        names.push_back(backend.name);
+    return names;
+}
+
+bool EncoderRegistry::CapabilitiesOf(const std::string &name, Capabilities *capabilities) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto backend = Probe(name);
+    if (!backend || !backend->available)
+        return false;
+
+    if (capabilities)
+        *capabilities = backend->capabilities;
+
+    return true;
+}
+
+BaseEncoder::Ptr EncoderRegistry::CreateBest(const BaseEncoder::Config &config, const EncoderReport::Ptr &report) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const Backend *best = nullptr;
+    for (auto &backend : backends_) {
+        Probe(backend.name);
+
+        if (!backend.available || !backend.capabilities.Supports(config))
+            continue;
+
+        // Backends registered first win when throughput is the same
+        if (!best || backend.capabilities.throughput > best->capabilities.throughput)
+            best = &backend;
+    }
+
+    if (!best) {
+        AC_ERROR("No encoder backend supports %dx%d@%d profile %d level %d",
+                 config.width, config.height, config.framerate,
+                 config.profile_idc, config.level_idc);
+        return nullptr;
+    }
+
+    AC_DEBUG("Using encoder backend %s", best->name);
+
+    const auto create = best->create;
+    lock.unlock();
+
+    return create(report);
+}
+
+EncoderRegistry::Backend* EncoderRegistry::Probe(const std::string &name) {
+    auto backend = std::find_if(backends_.begin(), backends_.end(), [&](const Backend &backend) {
+        return backend.name == name;
+    });
+
+    if (backend == backends_.end())
+        return nullptr;
+
+    if (backend->probed)
+        return &(*backend);
+
+    AC_DEBUG("Probing encoder backend %s", name);
+
+    const auto start = ac::Utils::GetNowUs();
+
+    backend->capabilities = Capabilities{};
+    backend->available = backend->probe && backend->probe(&backend->capabilities);
+    backend->probed = true;
+
+    AC_DEBUG("Probed encoder backend %s in %d ms: %s", name,
+             (ac::Utils::GetNowUs() - start) / 1000,
+             backend->available ? "available" : "not available");
+
+    // A failure might be down to the system being in a bad state just
+    // now, like mediaserver having crashed. Keeping it would disable the
+    // backend for good, so the next start probes it again.
+    if (!backend->available) {
+        if (cache_.erase(name) > 0)
+            StoreCache();
+        return &(*backend);
+    }
+
+    CacheEntry entry;
+    entry.version = backend->version;
+    entry.available = backend->available;
+    entry.capabilities = backend->capabilities;
+    cache_[name] = entry;
+
+    StoreCache();
+
+    return &(*backend);
+}
+
+void EncoderRegistry::LoadCache() {
+    if (cache_path_.empty())
+        return;
+
+    std::ifstream in(cache_path_);
+    if (!in.is_open())
+        return;
+
+    std::string line;
+    if (!std::getline(in, line) || line != kCacheHeader) {
+        AC_WARNING("Ignoring encoder cache %s with unknown format", cache_path_);
+        return;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+
+        std::string name, profiles;
+        CacheEntry entry;
+        int available = 0;
+
+        fields >> name >> entry.version >> available >> entry.capabilities.max_level
+               >> entry.capabilities.max_width >> entry.capabilities.max_height
+               >> entry.capabilities.max_framerate >> entry.capabilities.throughput
+               >> profiles;
+
+        if (fields.fail()) {
+            AC_WARNING("Ignoring invalid line in encoder cache %s", cache_path_);
+            continue;
+        }
+
+        try {
+            entry.capabilities.profiles = SplitProfiles(profiles);
+        } catch (const std::exception &) {
+            AC_WARNING("Ignoring invalid line in encoder cache %s", cache_path_);
+            continue;
+        }
+
+        entry.available = available != 0;
+        cache_[name] = entry;
+    }
+}
+
+void EncoderRegistry::StoreCache() {
+    if (cache_path_.empty())
+        return;
+
+    // Written to a separate file first so that a crash in between never
+    // leaves a truncated cache behind.
+    const auto temp_path = cache_path_ + ".tmp";
+
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out.is_open()) {
+            AC_WARNING("Failed to write encoder cache %s", temp_path);
+            return;
+        }
+
+        out << kCacheHeader << std::endl;
+
+        for (const auto &item : cache_) {
+            const auto &capabilities = item.second.capabilities;
+            out << item.first << " " << item.second.version << " "
+                << (item.second.available ? 1 : 0) << " "
+                << capabilities.max_level << " "
+                << capabilities.max_width << " " << capabilities.max_height << " "
+                << capabilities.max_framerate << " " << capabilities.throughput << " "
+                << JoinProfiles(capabilities.profiles) << std::endl;
+        }
+
+        if (!out.good()) {
+            AC_WARNING("Failed to write encoder cache %s", temp_path);
+            return;
+        }
+    }
+
+    if (::rename(temp_path.c_str(), cache_path_.c_str()) < 0)
+        AC_WARNING("Failed to replace encoder cache %s", cache_path_);
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef AC_VIDEO_ENCODERREGISTRY_H_
+#define AC_VIDEO_ENCODERREGISTRY_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/encoderreport.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Keeps track of the available encoder backends and what they are
+ * capable of so that the best one can be picked once the format with the
+ * sink is negotiated.
+ *
+ * Probing a backend can mean bringing up hardware or encoding a number of
+ * frames, so it only happens the first time a backend is needed and the
+ * results are stored in a cache file. The cached results of a backend are
+ * thrown away when the version it registers with changes. Failed probes
+ * aren't cached but only remembered until the process exits.
+ */
+class EncoderRegistry : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<EncoderRegistry> Ptr;
+
+    class Capabilities {
+    public:
+        Capabilities() :
+            max_level(0),
+            max_width(0),
+            max_height(0),
+            max_framerate(0),
+            throughput(0) {
+        }
+
+        bool Supports(const BaseEncoder::Config &config) const;
+
+        // Supported values of profile_idc
+        std::vector<unsigned int> profiles;
+        // Highest supported level_idc
+        unsigned int max_level;
+        unsigned int max_width;
+        unsigned int max_height;
+        unsigned int max_framerate;
+        // Pixels per second the backend managed to encode while probing
+        // or zero if it wasn't measured.
+        std::uint64_t throughput;
+    };
+
+    // Fills in the capabilities of the backend. Returns false if the
+    // backend isn't available at all on this system.
+    typedef std::function<bool(Capabilities *capabilities)> ProbeFunction;
+    typedef std::function<BaseEncoder::Ptr(const EncoderReport::Ptr &report)> CreateFunction;
+
+    // Probe results are cached in the file at cache_path unless it's empty.
+    static Ptr Create(const std::string &cache_path = "");
+
+    void Register(const std::string &name, const std::string &version,
+                  const ProbeFunction &probe, const CreateFunction &create);
+
+    std::vector<std::string> Backends() const;
+
+    bool CapabilitiesOf(const std::string &name, Capabilities *capabilities);
+
+    // Creates an encoder of the backend with the highest throughput of
+    // all backends supporting config.
+    BaseEncoder::Ptr CreateBest(const BaseEncoder::Config &config, const EncoderReport::Ptr &report);
+
+private:
+    EncoderRegistry(const std::string &cache_path);
+
+    struct Backend {
+        std::string name;
+        std::string version;
+        ProbeFunction probe;
+        CreateFunction create;
+        bool probed;
+        bool available;
+        Capabilities capabilities;
+    };
+
+    struct CacheEntry {
+        std::string version;
+        bool available;
+        Capabilities capabilities;
+    };
+
+    Backend* Probe(const std::string &name);
+
+    void LoadCache();
+    void StoreCache();
+
+private:
+    std::string cache_path_;
+    mutable std::mutex mutex_;
+    std::vector<Backend> backends_;
+    std::map<std::string, CacheEntry> cache_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "ac/logger.h"
+
+#include "ac/video/errorrecovery.h"
+#include "ac/video/utils.h"
+
+namespace {
+static constexpr std::uint8_t kNALTypeSEI{6};
+static constexpr std::uint8_t kNALTypeAccessUnitDelimiter{9};
+static constexpr std::uint8_t kSEIPayloadTypeRecoveryPoint{6};
+// Keeps the exp-golomb code of the frame count within two bytes and
+// the whole message free of anything needing emulation prevention.
+static constexpr unsigned int kMaxRecoveryFrameCount{127};
+// A new frame contributes 1/kAverageWeight to the average frame size
+static constexpr std::int64_t kAverageWeight{16};
+
+class BitWriter {
+public:
+    BitWriter() :
+        current_(0),
+        bits_(0) {
+    }
+
+    void Write(std::uint32_t value, unsigned int count) {
+        while (count-- > 0) {
+            current_ = (current_ << 1) | ((value >> count) & 1);
+            if (++bits_ == 8) {
+                data_.push_back(current_);
+                current_ = 0;
+                bits_ = 0;
+            }
+        }
+    }
+
+    void WriteExpGolomb(std::uint32_t value) {
+        unsigned int length = 0;
+        while ((value + 1) >> (length + 1))
+            length++;
+        Write(0, length);
+        Write(value + 1, length + 1);
+    }
+
+    // Writes a one bit followed by zero bits up to the next byte boundary
+    void Align() {
+        Write(1, 1);
+        while (bits_ != 0)
+            Write(0, 1);
+    }
+
+    const std::vector<std::uint8_t>& Data() const {
+        return data_;
+    }
+
+private:
+    std::vector<std::uint8_t> data_;
+    std::uint8_t current_;
+    unsigned int bits_;
+};
+
+// ITU-T H.264 D.1.7: the picture is correct in content again after the
+// given number of frames have been decoded.
+std::vector<std::uint8_t> CreateRecoveryPointSEI(unsigned int recovery_frame_count) {
+    BitWriter payload;
+    payload.WriteExpGolomb(std::min(recovery_frame_count, kMaxRecoveryFrameCount));
+    payload.Write(0, 1); // exact_match_flag
+    payload.Write(0, 1); // broken_link_flag
+    payload.Write(0, 2); // changing_slice_group_idc
+    payload.Align();
+
+    std::vector<std::uint8_t> nal = { 0x00, 0x00, 0x00, 0x01, kNALTypeSEI,
+                                      kSEIPayloadTypeRecoveryPoint,
+                                      static_cast<std::uint8_t>(payload.Data().size()) };
+    nal.insert(nal.end(), payload.Data().begin(), payload.Data().end());
+    // rbsp_trailing_bits
+    nal.push_back(0x80);
+    return nal;
+}
+
+// SEI messages have to follow an access unit delimiter if there is one
+std::size_t SEIInsertPosition(const ac::video::Buffer::Ptr &buffer) {
+    const auto data = buffer->Data();
+    const auto size = buffer->Length();
+
+    std::size_t start_code_size = 0;
+    if (size >= 4 && data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01)
+        start_code_size = 3;
+    else if (size >= 5 && data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x00 && data[3] == 0x01)
+        start_code_size = 4;
+
+    if (start_code_size == 0 || (data[start_code_size] & 0x1f) != kNALTypeAccessUnitDelimiter)
+        return 0;
+
+    // NAL header and primary_pic_type with its trailing bits
+    return std::min<std::size_t>(start_code_size + 2, size);
+}
+
+ac::video::Buffer::Ptr MarkRecoveryPoint(const ac::video::Buffer::Ptr &buffer, unsigned int recovery_frame_count) {
+    const auto sei = CreateRecoveryPointSEI(recovery_frame_count);
+    const auto position = SEIInsertPosition(buffer);
+
+    auto result = ac::video::Buffer::Create(buffer->Length() + sei.size(), buffer->Timestamp());
+    result->SetTemporalLayer(buffer->TemporalLayer());
+    auto ptr = result->Data();
+    ::memcpy(ptr, buffer->Data(), position);
+    ptr += position;
+    ::memcpy(ptr, sei.data(), sei.size());
+    ptr += sei.size();
+    ::memcpy(ptr, buffer->Data() + position, buffer->Length() - position);
+
+    return result;
+}
+}
+
+namespace ac {
+namespace video {
+
+std::string ErrorRecovery::StrategyToString(Strategy strategy) {
+    switch (strategy) {
+    case Strategy::kIntraRefresh:
+        return "intra-refresh";
+    default:
+        break;
+    }
+    return "idr";
+}
+
+ErrorRecovery::Ptr ErrorRecovery::Create(const BaseEncoder::Ptr &encoder, const Config &config) {
+    return std::shared_ptr<ErrorRecovery>(new ErrorRecovery(encoder, config));
+}
+
+ErrorRecovery::ErrorRecovery(const BaseEncoder::Ptr &encoder, const Config &config) :
+    encoder_(encoder),
+    config_(config),
+    state_(State::kIdle),
+    recovery_started_(0),
+    frames_left_(0),
+    mark_recovery_point_(false),
+    peak_frame_size_(0) {
+}
+
+void ErrorRecovery::SetDelegate(const std::weak_ptr<BaseEncoder::Delegate> &delegate) {
+    delegate_ = delegate;
+}
+
+ErrorRecovery::Statistics ErrorRecovery::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ErrorRecovery::RequestRecovery() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const ac::TimestampUs now = ac::Utils::GetNowUs();
+
+    stats_.requests++;
+
+    switch (state_) {
+    case State::kWaitingForIDR:
+        // Already on its way
+        return;
+    case State::kRefreshing:
+        if (now - recovery_started_ >= std::chrono::duration_cast<std::chrono::microseconds>(config_.timeout).count()) {
+            AC_WARNING("Intra refresh didn't recover the stream in time; requesting IDR frame");
+            stats_.fallbacks++;
+            RequestIDRFrame(now);
+            return;
+        }
+        // The sink lost something again while we were refreshing so the
+        // parts already refreshed may be broken again.
+        frames_left_ = encoder_->IntraRefreshPeriod();
+        mark_recovery_point_ = true;
+        return;
+    default:
+        break;
+    }
+
+    const auto period = encoder_->IntraRefreshPeriod();
+    if (config_.strategy != Strategy::kIntraRefresh || period == 0) {
+        RequestIDRFrame(now);
+        return;
+    }
+
+    AC_DEBUG("Recovering through intra refresh over %d frames", period);
+
+    state_ = State::kRefreshing;
+    recovery_started_ = now;
+    frames_left_ = period;
+    mark_recovery_point_ = true;
+    peak_frame_size_ = 0;
+    stats_.intra_refreshes++;
+}
+
+void ErrorRecovery::RequestIDRFrame(ac::TimestampUs now) {
+    if (state_ == State::kIdle) {
+        recovery_started_ = now;
+        peak_frame_size_ = 0;
+    }
+
+    state_ = State::kWaitingForIDR;
+    stats_.idr_frames++;
+
+    encoder_->SendIDRFrame();
+}
+
+void ErrorRecovery::FinishRecovery(ac::TimestampUs now) {
+    stats_.last_recovery_time = std::chrono::microseconds{now - recovery_started_};
+    stats_.last_peak_frame_size = peak_frame_size_;
+
+    AC_DEBUG("Recovered after %d ms; largest frame %d bytes (average %d bytes)",
+             stats_.last_recovery_time.count() / 1000, peak_frame_size_, stats_.average_frame_size);
+
+    state_ = State::kIdle;
+}
+
+void ErrorRecovery::OnBufferAvailable(const Buffer::Ptr &buffer) {
+    auto output = buffer;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const ac::TimestampUs now = ac::Utils::GetNowUs();
+
+        if (state_ == State::kIdle) {
+            const std::int64_t size = buffer->Length();
+            const std::int64_t average = stats_.average_frame_size;
+            stats_.average_frame_size = average == 0 ? size : average + (size - average) / kAverageWeight;
+        }
+        else {
+            peak_frame_size_ = std::max<std::size_t>(peak_frame_size_, buffer->Length());
+
+            if (DoesBufferContainIDRFrame(buffer)) {
+                FinishRecovery(now);
+            }
+            else if (state_ == State::kRefreshing) {
+                if (mark_recovery_point_) {
+                    output = MarkRecoveryPoint(buffer, frames_left_);
+                    mark_recovery_point_ = false;
+                }
+
+                if (--frames_left_ == 0)
+                    FinishRecovery(now);
+            }
+        }
+    }
+
+    if (auto sp = delegate_.lock())
+        sp->OnBufferAvailable(output);
+}
+
+void ErrorRecovery::OnBufferWithCodecConfig(const Buffer::Ptr &buffer) {
+    if (auto sp = delegate_.lock())
+        sp->OnBufferWithCodecConfig(buffer);
+}
+
+void ErrorRecovery::OnBufferReturned() {
+    if (auto sp = delegate_.lock())
+        sp->OnBufferReturned();
+}
+
+} // namespace video
+} // namespace ac
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_ERRORRECOVERY_H_
+#define AC_VIDEO_ERRORRECOVERY_H_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ac/utils.h"
+
+#include "ac/video/baseencoder.h"
+#include "ac/video/buffer.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Decides how the stream recovers once the sink lost parts of it.
+ *
+ * Sits between the encoder and the consumer of its output. A full IDR
+ * frame is several times the size of a P frame and on an already lossy
+ * link that spike easily causes the next loss. So if the encoder does
+ * intra refresh we rather let it refresh the picture gradually and only
+ * mark the start of the refresh with a recovery point SEI message. An
+ * IDR frame is only requested if the sink keeps asking for recovery for
+ * longer than the configured timeout.
+ */
+class ErrorRecovery : public BaseEncoder::Delegate {
+public:
+    typedef std::shared_ptr<ErrorRecovery> Ptr;
+
+    enum class Strategy {
+        kIDR,
+        kIntraRefresh
+    };
+
+    static std::string StrategyToString(Strategy strategy);
+
+    class Config {
+    public:
+        Config() :
+            strategy(Strategy::kIntraRefresh),
+            timeout(std::chrono::milliseconds{1000}) {
+        }
+
+        Strategy strategy;
+        std::chrono::milliseconds timeout;
+    };
+
+    class Statistics {
+    public:
+        Statistics() :
+            requests(0),
+            intra_refreshes(0),
+            idr_frames(0),
+            fallbacks(0),
+            last_recovery_time(0),
+            last_peak_frame_size(0),
+            average_frame_size(0) {
+        }
+
+        std::uint64_t requests;
+        std::uint64_t intra_refreshes;
+        std::uint64_t idr_frames;
+        // IDR frames requested because intra refresh didn't help in time
+        std::uint64_t fallbacks;
+        // Time between the request and the last frame needed to recover
+        std::chrono::microseconds last_recovery_time;
+        // Largest frame sent while recovering the last time
+        std::size_t last_peak_frame_size;
+        // Average size of frames sent while not recovering
+        std::size_t average_frame_size;
+    };
+
+    static Ptr Create(const BaseEncoder::Ptr &encoder, const Config &config = Config{});
+
+    void SetDelegate(const std::weak_ptr<BaseEncoder::Delegate> &delegate);
+
+    // To be called whenever the sink asks for an IDR picture or we
+    // noticed parts of the stream got lost.
+    void RequestRecovery();
+
+    Statistics Stats() const;
+
+    // From ac::video::BaseEncoder::Delegate
+    void OnBufferAvailable(const Buffer::Ptr &buffer) override;
+    void OnBufferWithCodecConfig(const Buffer::Ptr &buffer) override;
+    void OnBufferReturned() override;
+
+private:
+    enum class State {
+        kIdle,
+        kRefreshing,
+        kWaitingForIDR
+    };
+
+    ErrorRecovery(const BaseEncoder::Ptr &encoder, const Config &config);
+
+    void RequestIDRFrame(ac::TimestampUs now);
+    void FinishRecovery(ac::TimestampUs now);
+
+private:
+    BaseEncoder::Ptr encoder_;
+    Config config_;
+    std::weak_ptr<BaseEncoder::Delegate> delegate_;
+
+    mutable std::mutex mutex_;
+    State state_;
+    ac::TimestampUs recovery_started_;
+    unsigned int frames_left_;
+    bool mark_recovery_point_;
+    std::size_t peak_frame_size_;
+    Statistics stats_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+
+#include "ac/logger.h"
+
+#include "ac/video/memorybudget.h"
+
+namespace {
+// Well above what a healthy pipeline holds (a few MB) but small
+// enough to not get us killed on devices with 1 GB of memory.
+static constexpr std::size_t kDefaultLimit{64 * 1024 * 1024};
+
+// Usage relative to the limit (in percent) at which the different
+// pressure levels are entered. A level is only left again once the
+// usage is kHysteresis percent below its threshold.
+static constexpr std::size_t kDropFramesThreshold{75};
+static constexpr std::size_t kReduceBitrateThreshold{100};
+static constexpr std::size_t kHysteresis{15};
+
+static constexpr ac::TimestampUs kSampleIntervalUs{1000000};
+}
+
+namespace ac {
+namespace video {
+
+std::string MemoryBudget::StageToString(Stage stage) {
+    switch (stage) {
+    case Stage::kEncoder:
+        return "encoder";
+    case Stage::kCodecConfig:
+        return "codec-config";
+    case Stage::kPacketizer:
+        return "packetizer";
+    case Stage::kSender:
+        return "sender";
+    case Stage::kReceiver:
+        return "receiver";
+    default:
+        break;
+    }
+    return "other";
+}
+
+std::string MemoryBudget::PressureToString(Pressure pressure) {
+    switch (pressure) {
+    case Pressure::kDropFrames:
+        return "drop-frames";
+    case Pressure::kReduceBitrate:
+        return "reduce-bitrate";
+    default:
+        break;
+    }
+    return "none";
+}
+
+MemoryBudget::Ptr MemoryBudget::Instance() {
+    static const auto instance = []() {
+        auto limit = kDefaultLimit;
+        const auto value = ac::Utils::GetEnvValue("AETHERCAST_MEMORY_LIMIT");
+        if (value.length() > 0)
+            limit = std::strtoull(value.c_str(), nullptr, 10);
+        return Create(limit);
+    }();
+    return instance;
+}
+
+MemoryBudget::Ptr MemoryBudget::Create(std::size_t limit) {
+    return std::shared_ptr<MemoryBudget>(new MemoryBudget(limit));
+}
+
+MemoryBudget::MemoryBudget(std::size_t limit) :
+    limit_(limit),
+    total_(0),
+    pressure_(static_cast<int>(Pressure::kNone)),
+    last_sample_(0) {
+    for (auto &usage : usage_)
+        usage = 0;
+}
+
+void MemoryBudget::SetLimit(std::size_t limit) {
+    limit_ = limit;
+    UpdatePressure(total_);
+}
+
+std::size_t MemoryBudget::Limit() const {
+    return limit_;
+}
+
+void MemoryBudget::SetReport(const MemoryReport::Ptr &report) {
+    std::lock_guard<std::mutex> lock(report_lock_);
+    report_ = report;
+}
+
+void MemoryBudget::Acquire(Stage stage, std::size_t bytes) {
+    usage_[static_cast<int>(stage)] += bytes;
+    const auto total = total_ += bytes;
+
+    UpdatePressure(total);
+    SampleUsage();
+}
+
+void MemoryBudget::Release(Stage stage, std::size_t bytes) {
+    usage_[static_cast<int>(stage)] -= bytes;
+    const auto total = total_ -= bytes;
+
+    UpdatePressure(total);
+}
+
+std::size_t MemoryBudget::Usage(Stage stage) const {
+    return usage_[static_cast<int>(stage)];
+}
+
+std::size_t MemoryBudget::TotalUsage() const {
+    return total_;
+}
+
+MemoryBudget::Pressure MemoryBudget::CurrentPressure() const {
+    return static_cast<Pressure>(pressure_.load());
+}
+
+void MemoryBudget::UpdatePressure(std::size_t total) {
+    const std::size_t limit = limit_;
+    if (limit == 0)
+        return;
+
+    const auto percent = total * 100 / limit;
+    const auto current = CurrentPressure();
+
+    auto next = current;
+    if (percent >= kReduceBitrateThreshold)
+        next = Pressure::kReduceBitrate;
+    else if (percent >= kDropFramesThreshold && current == Pressure::kNone)
+        next = Pressure::kDropFrames;
+    else if (current == Pressure::kReduceBitrate && percent + kHysteresis < kReduceBitrateThreshold)
+        next = percent + kHysteresis < kDropFramesThreshold ? Pressure::kNone : Pressure::kDropFrames;
+    else if (current == Pressure::kDropFrames && percent + kHysteresis < kDropFramesThreshold)
+        next = Pressure::kNone;
+
+    if (next == current)
+        return;
+
+    int expected = static_cast<int>(current);
+    if (!pressure_.compare_exchange_strong(expected, static_cast<int>(next)))
+        return;
+
+    AC_WARNING("Memory pressure changed to %s (%d of %d bytes in use)",
+               PressureToString(next), total, limit);
+
+    std::lock_guard<std::mutex> lock(report_lock_);
+    if (report_)
+        report_->PressureChanged(static_cast<int>(next), total, limit);
+}
+
+void MemoryBudget::SampleUsage() {
+    std::unique_lock<std::mutex> lock(report_lock_, std::try_to_lock);
+    if (!lock.owns_lock() || !report_)
+        return;
+
+    const auto now = ac::Utils::GetNowUs();
+    if (now - last_sample_ < kSampleIntervalUs)
+        return;
+
+    last_sample_ = now;
+
+    for (int n = 0; n < static_cast<int>(Stage::kCount); n++)
+        report_->StageUsage(StageToString(static_cast<Stage>(n)), usage_[n]);
+}
+
+} // namespace video
+} // namespace ac
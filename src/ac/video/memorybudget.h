@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_MEMORYBUDGET_H_
+#define AC_VIDEO_MEMORYBUDGET_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/memoryreport.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Accounts the memory held by buffers in the different stages of
+ * the streaming pipeline against a configurable ceiling.
+ *
+ * The budget doesn't refuse any allocation. Instead it derives a pressure
+ * level from the current usage which the pipeline stages are expected to
+ * react on: first by dropping frames and if that isn't enough by lowering
+ * the encoder bitrate.
+ */
+class MemoryBudget : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<MemoryBudget> Ptr;
+
+    enum class Stage {
+        kOther = 0,
+        kEncoder,
+        kCodecConfig,
+        kPacketizer,
+        kSender,
+        kReceiver,
+        kCount
+    };
+
+    enum class Pressure {
+        kNone = 0,
+        kDropFrames,
+        kReduceBitrate
+    };
+
+    static std::string StageToString(Stage stage);
+    static std::string PressureToString(Pressure pressure);
+
+    // Process wide instance all buffers are accounted to. Its limit is
+    // taken from AETHERCAST_MEMORY_LIMIT (in bytes) if set.
+    static Ptr Instance();
+
+    static Ptr Create(std::size_t limit);
+
+    void SetLimit(std::size_t limit);
+    std::size_t Limit() const;
+
+    void SetReport(const MemoryReport::Ptr &report);
+
+    void Acquire(Stage stage, std::size_t bytes);
+    void Release(Stage stage, std::size_t bytes);
+
+    std::size_t Usage(Stage stage) const;
+    std::size_t TotalUsage() const;
+
+    Pressure CurrentPressure() const;
+
+private:
+    MemoryBudget(std::size_t limit);
+
+    void UpdatePressure(std::size_t total);
+    void SampleUsage();
+
+private:
+    std::atomic<std::size_t> limit_;
+    std::atomic<std::size_t> total_;
+    std::atomic<std::size_t> usage_[static_cast<int>(Stage::kCount)];
+    std::atomic<int> pressure_;
+    std::mutex report_lock_;
+    MemoryReport::Ptr report_;
+    ac::TimestampUs last_sample_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
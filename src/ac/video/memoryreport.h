@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_MEMORYREPORT_H_
+#define AC_VIDEO_MEMORYREPORT_H_
+
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+#include "ac/utils.h"
+
+namespace ac {
+namespace video {
+
+class MemoryReport : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<MemoryReport> Ptr;
+
+    virtual void StageUsage(const std::string &stage, const size_t &bytes) = 0;
+    virtual void PressureChanged(const int &level, const size_t &total, const size_t &limit) = 0;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
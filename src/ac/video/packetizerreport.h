@@ -32,6 +32,12 @@ public:
     typedef std::shared_ptr<PacketizerReport> Ptr;
 
     virtual void PacketizedFrame(const ac::TimestampUs &timestamp) = 0;
+    virtual void PaddedFrame(const ac::TimestampUs &timestamp, const size_t &padding, const size_t &total) = 0;
+    // A frame nothing else depends on was dropped to relieve congestion.
+    virtual void DroppedFrame(const ac::TimestampUs &timestamp, const int &layer) = 0;
+    // The rate frames leave the sender at changed as a result of dropping
+    // frames at the given level (zero when nothing is dropped anymore).
+    virtual void FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level) = 0;
 };
 
 } // namespace video
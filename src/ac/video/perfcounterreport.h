@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_PERFCOUNTERREPORT_H_
+#define AC_VIDEO_PERFCOUNTERREPORT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+#include "ac/utils.h"
+
+namespace ac {
+namespace video {
+
+class PerfCounterReport : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<PerfCounterReport> Ptr;
+
+    // Hardware counters of a pipeline stage summed up over the iterations
+    // it ran since the last sample. Counters not available are -1.
+    virtual void CountersSampled(const std::string &stage, const std::uint64_t &iterations,
+                                 const std::int64_t &cycles, const std::int64_t &instructions,
+                                 const std::int64_t &cache_misses, const std::int64_t &branch_misses) = 0;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <ratio>
+
+#include "ac/video/qualityestimator.h"
+
+namespace {
+// A gap between two frames counts as freeze if it is longer than
+// this many frame intervals but at least kMinFreezeUs.
+static constexpr unsigned int kFreezeFrameIntervals{3};
+static constexpr ac::TimestampUs kMinFreezeUs{200000};
+
+static constexpr ac::TimestampUs kBitrateWindowUs{1000000};
+
+// Maximum penalties of the different factors; they sum up to 100.
+static constexpr double kFramerateWeight{30};
+static constexpr double kLatencyWeight{20};
+static constexpr double kFreezeWeight{25};
+static constexpr double kRecoveryWeight{10};
+static constexpr double kBitrateWeight{10};
+static constexpr double kLossWeight{15};
+
+// Latency (95th percentile) below kGoodLatencyUs isn't penalized and
+// from kBadLatencyUs on the full penalty applies.
+static constexpr ac::TimestampUs kGoodLatencyUs{100000};
+static constexpr ac::TimestampUs kBadLatencyUs{500000};
+
+// Values at which the other factors get the full penalty
+static constexpr double kBadFrozenFraction{0.1};
+static constexpr double kBadFreezesPerMinute{6};
+static constexpr double kBadRecoveriesPerMinute{6};
+static constexpr double kBadBitrateVariation{0.5};
+static constexpr double kBadLossRate{0.05};
+
+double Clamp(double value) {
+    return std::min(1.0, std::max(0.0, value));
+}
+}
+
+namespace ac {
+namespace video {
+
+constexpr std::size_t QualityEstimator::kLatencyBins;
+
+QualityEstimator::Ptr QualityEstimator::Create(unsigned int expected_framerate) {
+    return std::shared_ptr<QualityEstimator>(new QualityEstimator(expected_framerate));
+}
+
+QualityEstimator::QualityEstimator(unsigned int expected_framerate) :
+    expected_framerate_(expected_framerate),
+    freeze_threshold_(kMinFreezeUs),
+    running_(false),
+    started_(0),
+    duration_(0),
+    frames_(0),
+    last_frame_timestamp_(0),
+    last_frame_time_(0),
+    freezes_(0),
+    frozen_time_(0),
+    recoveries_(0),
+    window_started_(0),
+    window_bytes_(0),
+    windows_(0),
+    window_bits_sum_(0),
+    window_bits_square_sum_(0),
+    packets_delivered_(0),
+    packets_lost_(0) {
+
+    latencies_.fill(0);
+
+    if (expected_framerate_ > 0)
+        freeze_threshold_ = std::max<ac::TimestampUs>(freeze_threshold_,
+                kFreezeFrameIntervals * std::micro::den / expected_framerate_);
+}
+
+void QualityEstimator::Start(ac::TimestampUs now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return;
+
+    running_ = true;
+    started_ = now;
+    // The first frame after a (re)start takes as long as the encoder
+    // needs to come up and isn't a freeze.
+    last_frame_time_ = 0;
+    window_started_ = now;
+    window_bytes_ = 0;
+}
+
+void QualityEstimator::Stop(ac::TimestampUs now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+        return;
+
+    running_ = false;
+    duration_ += now - started_;
+}
+
+void QualityEstimator::PacketSent(ac::TimestampUs timestamp, std::size_t size, ac::TimestampUs now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+        return;
+
+    while (now - window_started_ >= kBitrateWindowUs) {
+        CloseBitrateWindow();
+        window_started_ += kBitrateWindowUs;
+    }
+    window_bytes_ += size;
+
+    if (frames_ > 0 && timestamp <= last_frame_timestamp_)
+        return;
+
+    frames_++;
+    last_frame_timestamp_ = timestamp;
+
+    const auto gap = now - last_frame_time_;
+    if (last_frame_time_ > 0 && gap > freeze_threshold_) {
+        freezes_++;
+        frozen_time_ += gap;
+    }
+    last_frame_time_ = now;
+
+    const auto latency = now > timestamp ? (now - timestamp) / 1000 : 0;
+    latencies_[std::min<ac::TimestampUs>(latency, kLatencyBins - 1)]++;
+}
+
+void QualityEstimator::RecoveryRequested() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recoveries_++;
+}
+
+void QualityEstimator::PacketsDelivered(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_delivered_ += count;
+}
+
+void QualityEstimator::PacketsLost(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_lost_ += count;
+}
+
+void QualityEstimator::CloseBitrateWindow() {
+    const double bits = window_bytes_ * 8.0;
+    windows_++;
+    window_bits_sum_ += bits;
+    window_bits_square_sum_ += bits * bits;
+    window_bytes_ = 0;
+}
+
+ac::TimestampUs QualityEstimator::LatencyPercentile(unsigned int percent) const {
+    if (frames_ == 0)
+        return 0;
+
+    const auto wanted = (frames_ * percent + 99) / 100;
+    std::uint64_t count = 0;
+    for (std::size_t n = 0; n < kLatencyBins; n++) {
+        count += latencies_[n];
+        if (count >= wanted)
+            return n * 1000;
+    }
+    return (kLatencyBins - 1) * 1000;
+}
+
+QualityEstimator::Result QualityEstimator::Estimate(ac::TimestampUs now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Result result;
+    result.duration = duration_ + (running_ ? now - started_ : 0);
+    result.frames = frames_;
+    result.expected_framerate = expected_framerate_;
+    result.latency_p50 = LatencyPercentile(50);
+    result.latency_p95 = LatencyPercentile(95);
+    result.latency_p99 = LatencyPercentile(99);
+    result.freezes = freezes_;
+    result.frozen_time = frozen_time_;
+    result.recoveries = recoveries_;
+
+    if (result.duration == 0 || frames_ == 0)
+        return result;
+
+    const double seconds = static_cast<double>(result.duration) / std::micro::den;
+    const double minutes = seconds / 60;
+
+    result.framerate = frames_ / seconds;
+
+    if (windows_ > 0) {
+        const double mean = window_bits_sum_ / windows_;
+        const double variance = window_bits_square_sum_ / windows_ - mean * mean;
+        result.bitrate = static_cast<std::uint64_t>(mean);
+        if (mean > 0)
+            result.bitrate_variation = std::sqrt(std::max(0.0, variance)) / mean;
+    }
+
+    const auto packets = packets_delivered_ + packets_lost_;
+    if (packets > 0)
+        result.loss_rate = static_cast<double>(packets_lost_) / packets;
+
+    double penalty = 0;
+
+    if (expected_framerate_ > 0)
+        penalty += kFramerateWeight * Clamp(1.0 - result.framerate / expected_framerate_);
+
+    penalty += kLatencyWeight * Clamp(static_cast<double>(result.latency_p95 - kGoodLatencyUs) /
+                                      (kBadLatencyUs - kGoodLatencyUs));
+
+    const double frozen_fraction = static_cast<double>(frozen_time_) / result.duration;
+    penalty += kFreezeWeight * std::max(Clamp(frozen_fraction / kBadFrozenFraction),
+                                        Clamp(freezes_ / minutes / kBadFreezesPerMinute));
+
+    penalty += kRecoveryWeight * Clamp(recoveries_ / minutes / kBadRecoveriesPerMinute);
+    penalty += kBitrateWeight * Clamp(result.bitrate_variation / kBadBitrateVariation);
+
+    if (result.loss_rate >= 0)
+        penalty += kLossWeight * Clamp(result.loss_rate / kBadLossRate);
+
+    result.score = std::max(0.0, 100.0 - penalty);
+
+    return result;
+}
+
+} // namespace video
+} // namespace ac
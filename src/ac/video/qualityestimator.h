@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_QUALITYESTIMATOR_H_
+#define AC_VIDEO_QUALITYESTIMATOR_H_
+
+#include <array>
+#include <memory>
+#include <mutex>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Condenses the telemetry of a streaming session into a single
+ * quality of experience score.
+ *
+ * All inputs are fed incrementally from the report events the pipeline
+ * emits anyway and only constant memory is used, regardless of how long
+ * the session runs. The score ranges from 0 to 100 and starts from 100
+ * with penalties subtracted for a frame rate below the negotiated one,
+ * high latency, freezes, frequent recovery, an unstable bitrate and
+ * packet loss (if known).
+ */
+class QualityEstimator : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<QualityEstimator> Ptr;
+
+    class Result {
+    public:
+        Result() :
+            score(0),
+            duration(0),
+            frames(0),
+            framerate(0),
+            expected_framerate(0),
+            latency_p50(0),
+            latency_p95(0),
+            latency_p99(0),
+            freezes(0),
+            frozen_time(0),
+            recoveries(0),
+            bitrate(0),
+            bitrate_variation(0),
+            loss_rate(-1) {
+        }
+
+        double score;
+        // Time the pipeline was actually running
+        ac::TimestampUs duration;
+        std::uint64_t frames;
+        double framerate;
+        unsigned int expected_framerate;
+        // Time between capturing a frame and handing it to the network
+        ac::TimestampUs latency_p50;
+        ac::TimestampUs latency_p95;
+        ac::TimestampUs latency_p99;
+        std::uint64_t freezes;
+        ac::TimestampUs frozen_time;
+        std::uint64_t recoveries;
+        // Average bitrate in bits per second and its coefficient of
+        // variation over one second windows
+        std::uint64_t bitrate;
+        double bitrate_variation;
+        // Fraction of packets lost or -1 if nothing reported loss
+        double loss_rate;
+    };
+
+    static Ptr Create(unsigned int expected_framerate);
+
+    // Marks the periods the pipeline is running. Gaps between them are
+    // neither accounted as freezes nor do they lower the frame rate.
+    void Start(ac::TimestampUs now = ac::Utils::GetNowUs());
+    void Stop(ac::TimestampUs now = ac::Utils::GetNowUs());
+
+    // To be called for every packet sent. Packets carry the capture
+    // timestamp of the frame they belong to so the first packet with a
+    // new timestamp marks a new frame.
+    void PacketSent(ac::TimestampUs timestamp, std::size_t size,
+                    ac::TimestampUs now = ac::Utils::GetNowUs());
+    void RecoveryRequested();
+    void PacketsDelivered(std::size_t count);
+    void PacketsLost(std::size_t count);
+
+    Result Estimate(ac::TimestampUs now = ac::Utils::GetNowUs()) const;
+
+private:
+    // Latencies are binned by millisecond with everything above the
+    // last bin accounted to it.
+    static constexpr std::size_t kLatencyBins{1000};
+
+    QualityEstimator(unsigned int expected_framerate);
+
+    ac::TimestampUs LatencyPercentile(unsigned int percent) const;
+    void CloseBitrateWindow();
+
+private:
+    unsigned int expected_framerate_;
+    ac::TimestampUs freeze_threshold_;
+
+    mutable std::mutex mutex_;
+    bool running_;
+    ac::TimestampUs started_;
+    ac::TimestampUs duration_;
+
+    std::uint64_t frames_;
+    ac::TimestampUs last_frame_timestamp_;
+    ac::TimestampUs last_frame_time_;
+    std::array<std::uint64_t, kLatencyBins> latencies_;
+
+    std::uint64_t freezes_;
+    ac::TimestampUs frozen_time_;
+    std::uint64_t recoveries_;
+
+    ac::TimestampUs window_started_;
+    std::uint64_t window_bytes_;
+    std::uint64_t windows_;
+    double window_bits_sum_;
+    double window_bits_square_sum_;
+
+    std::uint64_t packets_delivered_;
+    std::uint64_t packets_lost_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ac/video/qualityhistory.h"
+
+namespace ac {
+namespace video {
+
+constexpr std::size_t QualityHistory::kMaxSessions;
+
+QualityHistory::Ptr QualityHistory::Instance() {
+    static const auto instance = Create();
+    return instance;
+}
+
+QualityHistory::Ptr QualityHistory::Create() {
+    return std::shared_ptr<QualityHistory>(new QualityHistory);
+}
+
+void QualityHistory::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    delegate_ = delegate;
+}
+
+void QualityHistory::ResetDelegate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    delegate_.reset();
+}
+
+void QualityHistory::Add(const Session &session) {
+    std::shared_ptr<Delegate> delegate;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.push_back(session);
+        while (sessions_.size() > kMaxSessions)
+            sessions_.pop_front();
+
+        delegate = delegate_.lock();
+    }
+
+    if (delegate)
+        delegate->OnSessionFinished(session);
+}
+
+std::deque<QualityHistory::Session> QualityHistory::Sessions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_;
+}
+
+} // namespace video
+} // namespace ac
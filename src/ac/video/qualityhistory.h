@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_QUALITYHISTORY_H_
+#define AC_VIDEO_QUALITYHISTORY_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ac/non_copyable.h"
+#include "ac/utils.h"
+
+#include "ac/video/qualityestimator.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Keeps the quality estimates of the most recent sessions
+ * together with what is known about the connection they ran on.
+ */
+class QualityHistory : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<QualityHistory> Ptr;
+
+    class Session {
+    public:
+        Session() :
+            width(0),
+            height(0),
+            framerate(0),
+            started(0),
+            idr_frames(0) {
+        }
+
+        std::string remote_address;
+        unsigned int width;
+        unsigned int height;
+        unsigned int framerate;
+        ac::TimestampUs started;
+        std::uint64_t idr_frames;
+        QualityEstimator::Result quality;
+    };
+
+    class Delegate : private ac::NonCopyable {
+    public:
+        virtual void OnSessionFinished(const Session &session) = 0;
+
+    protected:
+        Delegate() = default;
+    };
+
+    static constexpr std::size_t kMaxSessions{16};
+
+    // Process wide history all source sessions are recorded to
+    static Ptr Instance();
+
+    static Ptr Create();
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+    void ResetDelegate();
+
+    void Add(const Session &session);
+
+    std::deque<Session> Sessions() const;
+
+private:
+    QualityHistory() = default;
+
+private:
+    mutable std::mutex mutex_;
+    std::deque<Session> sessions_;
+    std::weak_ptr<Delegate> delegate_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
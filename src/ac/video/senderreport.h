@@ -19,6 +19,7 @@
 #define AC_VIDEO_SENDERREPORT_H_
 
 #include <memory>
+#include <string>
 
 #include "ac/non_copyable.h"
 
@@ -32,6 +33,12 @@ public:
     typedef std::shared_ptr<SenderReport> Ptr;
 
     virtual void SentPacket(const ac::TimestampUs &timestamp, const size_t &size) = 0;
+    // The stream couldn't get the packet out in time and dropped it
+    virtual void DroppedPacket(const ac::TimestampUs &timestamp, const size_t &size) = 0;
+    // The kernel saw a sent packet pass the given point on its way out
+    // of the device, delay microseconds after we wrote it.
+    virtual void TransmittedPacket(const ac::TimestampUs &timestamp, const std::string &point,
+                                   const ac::TimestampUs &delay) = 0;
 };
 
 } // namespace video
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/logger.h"
+#include "ac/utils.h"
+
+#include "ac/video/thermalgovernor.h"
+
+namespace {
+// Used for zones which don't expose a passive trip point. Most SoCs
+// start to throttle somewhere between 80 and 95 degrees.
+static constexpr int kDefaultTripPoint{85000};
+
+// Headroom to the trip point below which the different levels are
+// entered. A level is only left again once the headroom is kHysteresis
+// larger than its threshold.
+static constexpr int kReduceFramerateHeadroom{15000};
+static constexpr int kReduceBitrateHeadroom{10000};
+static constexpr int kReduceResolutionHeadroom{5000};
+static constexpr int kHysteresis{3000};
+
+// Sensors which are not connected or broken report values far off
+static constexpr int kMinPlausibleTemperature{0};
+static constexpr int kMaxPlausibleTemperature{200000};
+
+bool ReadValue(const boost::filesystem::path &path, std::string &value) {
+    std::ifstream in(path.string());
+    if (!in)
+        return false;
+
+    return static_cast<bool>(std::getline(in, value));
+}
+
+bool ReadValue(const boost::filesystem::path &path, int &value) {
+    std::ifstream in(path.string());
+    if (!in)
+        return false;
+
+    return static_cast<bool>(in >> value);
+}
+
+// Lowest passive trip point of the zone if it has any
+int TripPointOf(const boost::filesystem::path &zone) {
+    int trip_point = INT_MAX;
+
+    for (int n = 0; ; n++) {
+        const auto prefix = "trip_point_" + std::to_string(n);
+
+        std::string type;
+        if (!ReadValue(zone / (prefix + "_type"), type))
+            break;
+
+        int temperature = 0;
+        if (type != "passive" || !ReadValue(zone / (prefix + "_temp"), temperature))
+            continue;
+
+        if (temperature > kMinPlausibleTemperature && temperature < trip_point)
+            trip_point = temperature;
+    }
+
+    return trip_point == INT_MAX ? kDefaultTripPoint : trip_point;
+}
+
+ac::video::ThermalGovernor::Level LevelFor(int headroom) {
+    if (headroom <= kReduceResolutionHeadroom)
+        return ac::video::ThermalGovernor::Level::kReduceResolution;
+    else if (headroom <= kReduceBitrateHeadroom)
+        return ac::video::ThermalGovernor::Level::kReduceBitrate;
+    else if (headroom <= kReduceFramerateHeadroom)
+        return ac::video::ThermalGovernor::Level::kReduceFramerate;
+
+    return ac::video::ThermalGovernor::Level::kNone;
+}
+}
+
+namespace ac {
+namespace video {
+
+constexpr const char *ThermalGovernor::kDefaultRoot;
+
+std::string ThermalGovernor::LevelToString(Level level) {
+    switch (level) {
+    case Level::kReduceFramerate:
+        return "reduce-framerate";
+    case Level::kReduceBitrate:
+        return "reduce-bitrate";
+    case Level::kReduceResolution:
+        return "reduce-resolution";
+    default:
+        break;
+    }
+    return "none";
+}
+
+ThermalGovernor::Ptr ThermalGovernor::Instance() {
+    static const auto instance = []() {
+        auto root = ac::Utils::GetEnvValue("AETHERCAST_THERMAL_ROOT");
+        if (root.length() == 0)
+            root = kDefaultRoot;
+        return Create(root);
+    }();
+    return instance;
+}
+
+ThermalGovernor::Ptr ThermalGovernor::Create(const std::string &root) {
+    return std::shared_ptr<ThermalGovernor>(new ThermalGovernor(root));
+}
+
+ThermalGovernor::ThermalGovernor(const std::string &root) :
+    root_(root),
+    level_(static_cast<int>(Level::kNone)) {
+}
+
+void ThermalGovernor::SetReport(const ThermalReport::Ptr &report) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_ = report;
+}
+
+void ThermalGovernor::SetDelegate(const std::weak_ptr<Delegate> &delegate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    delegate_ = delegate;
+}
+
+void ThermalGovernor::ResetDelegate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    delegate_.reset();
+}
+
+bool ThermalGovernor::Update() {
+    Status hottest;
+    bool found = false;
+
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(root_, ec), end; !ec && it != end; it.increment(ec)) {
+        const auto zone = it->path();
+        if (zone.filename().string().compare(0, 12, "thermal_zone") != 0)
+            continue;
+
+        int temperature = 0;
+        if (!ReadValue(zone / "temp", temperature) ||
+                temperature <= kMinPlausibleTemperature ||
+                temperature >= kMaxPlausibleTemperature)
+            continue;
+
+        const auto headroom = TripPointOf(zone) - temperature;
+        if (found && headroom >= hottest.headroom)
+            continue;
+
+        std::string type;
+        if (!ReadValue(zone / "type", type))
+            type = zone.filename().string();
+
+        hottest.zone = type;
+        hottest.temperature = temperature;
+        hottest.headroom = headroom;
+        found = true;
+    }
+
+    if (!found)
+        return false;
+
+    const auto current = CurrentLevel();
+    hottest.level = NextLevel(current, hottest.headroom);
+
+    ThermalReport::Ptr report;
+    std::shared_ptr<Delegate> delegate;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_ = hottest;
+        report = report_;
+        delegate = delegate_.lock();
+    }
+
+    if (report)
+        report->TemperatureSampled(hottest.zone, hottest.temperature, hottest.headroom);
+
+    if (hottest.level == current)
+        return true;
+
+    level_ = static_cast<int>(hottest.level);
+
+    AC_WARNING("Thermal level changed to %s (%s at %d mC, %d mC below throttling)",
+               LevelToString(hottest.level), hottest.zone, hottest.temperature, hottest.headroom);
+
+    if (report)
+        report->LevelChanged(static_cast<int>(hottest.level), hottest.zone, hottest.temperature);
+
+    if (delegate)
+        delegate->OnThermalLevelChanged(hottest);
+
+    return true;
+}
+
+ThermalGovernor::Level ThermalGovernor::NextLevel(Level current, int headroom) const {
+    const auto next = LevelFor(headroom);
+    if (next >= current)
+        return next;
+
+    // Cooling down; every level is left only once we're kHysteresis
+    // away from where it was entered.
+    return std::min(current, LevelFor(headroom - kHysteresis));
+}
+
+ThermalGovernor::Level ThermalGovernor::CurrentLevel() const {
+    return static_cast<Level>(level_.load());
+}
+
+ThermalGovernor::Status ThermalGovernor::CurrentStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+} // namespace video
+} // namespace ac
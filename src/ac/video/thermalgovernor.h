@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef AC_VIDEO_THERMALGOVERNOR_H_
+#define AC_VIDEO_THERMALGOVERNOR_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ac/non_copyable.h"
+
+#include "ac/video/thermalreport.h"
+
+namespace ac {
+namespace video {
+
+/**
+ * @brief Throttles the streaming pipeline before the kernel does.
+ *
+ * The governor samples the thermal zones below a sysfs style root and
+ * derives a level from how far the hottest zone is away from its first
+ * passive trip point, which is where the kernel starts to cap the CPU
+ * and GPU clocks. The pipeline stages look at the current level and
+ * step down frame rate, then bitrate and then resolution. A level is
+ * only left again once the temperature fell noticeably below where it
+ * was entered.
+ *
+ * All temperatures are in millidegree Celsius as used by the kernel.
+ */
+class ThermalGovernor : public ac::NonCopyable {
+public:
+    typedef std::shared_ptr<ThermalGovernor> Ptr;
+
+    static constexpr const char *kDefaultRoot{"/sys/class/thermal"};
+
+    enum class Level {
+        kNone = 0,
+        kReduceFramerate,
+        kReduceBitrate,
+        kReduceResolution
+    };
+
+    class Status {
+    public:
+        Status() :
+            level(Level::kNone),
+            temperature(0),
+            headroom(0) {
+        }
+
+        Level level;
+        // Zone with the least headroom left and its temperature
+        std::string zone;
+        int temperature;
+        int headroom;
+    };
+
+    class Delegate : private ac::NonCopyable {
+    public:
+        virtual void OnThermalLevelChanged(const Status &status) = 0;
+
+    protected:
+        Delegate() = default;
+    };
+
+    static std::string LevelToString(Level level);
+
+    // Process wide instance the pipeline stages look at. Its zones are
+    // read from below AETHERCAST_THERMAL_ROOT if set.
+    static Ptr Instance();
+
+    static Ptr Create(const std::string &root = kDefaultRoot);
+
+    void SetReport(const ThermalReport::Ptr &report);
+
+    void SetDelegate(const std::weak_ptr<Delegate> &delegate);
+    void ResetDelegate();
+
+    // Samples all zones once and updates the level accordingly. Returns
+    // false if no zone could be read.
+    bool Update();
+
+    Level CurrentLevel() const;
+    Status CurrentStatus() const;
+
+private:
+    ThermalGovernor(const std::string &root);
+
+    Level NextLevel(Level current, int headroom) const;
+
+private:
+    std::string root_;
+    std::atomic<int> level_;
+    mutable std::mutex mutex_;
+    Status status_;
+    ThermalReport::Ptr report_;
+    std::weak_ptr<Delegate> delegate_;
+};
+
+} // namespace video
+} // namespace ac
+
+#endif
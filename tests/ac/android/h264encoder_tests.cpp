@@ -17,6 +17,8 @@
 
 #include <gmock/gmock.h>
 
+#include <future>
+
 // Ignore all warnings coming from the external Android headers as
 // we don't control them and also don't want to get any warnings
 // from them which will only pollute our build output.
@@ -432,6 +434,9 @@ TEST_F(H264EncoderFixture, CorrectConfiguration) {
 
     const auto stored_config = encoder->Configuration();
     EXPECT_EQ(config, stored_config);
+
+    // 10% of the 3600 macroblocks are refreshed with every frame
+    EXPECT_EQ(10, encoder->IntraRefreshPeriod());
 }
 
 TEST_F(H264EncoderFixture, CorrectStartAndStopBehavior) {
@@ -636,6 +641,35 @@ TEST_F(H264EncoderFixture, SourceReadFailsForInvalidState) {
     EXPECT_GE(0, source_read_callback(nullptr, source_read_callback_data));
 }
 
+TEST_F(H264EncoderFixture, PendingSourceReadReturnsOnStop) {
+    auto mock = std::make_shared<ac::test::android::MockMedia>();
+
+    auto encoder = ac::android::H264Encoder::Create(mock_report);
+
+    const auto config = encoder->DefaultConfiguration();
+
+    ExpectValidConfiguration(config, mock);
+
+    ExpectValidStartAndStop(mock);
+
+    EXPECT_TRUE(encoder->Configure(config));
+    EXPECT_TRUE(encoder->Start());
+
+    // Nothing gets queued so the read can only return once we stop
+    MediaBufferWrapper *output_buffer = nullptr;
+    auto result = std::async(std::launch::async, [&]() {
+        return source_read_callback(&output_buffer, source_read_callback_data);
+    });
+
+    EXPECT_EQ(std::future_status::timeout, result.wait_for(std::chrono::milliseconds{50}));
+
+    EXPECT_TRUE(encoder->Stop());
+
+    EXPECT_EQ(std::future_status::ready, result.wait_for(std::chrono::milliseconds{500}));
+    EXPECT_GE(0, result.get());
+    EXPECT_EQ(nullptr, output_buffer);
+}
+
 TEST_F(H264EncoderFixture, QueueBufferDoesNotCrashWhenInactive) {
     auto mock = std::make_shared<ac::test::android::MockMedia>();
 
@@ -807,3 +841,19 @@ TEST_F(H264EncoderFixture, HandsBuffersWithCodecSpecificDataBack) {
 
     EXPECT_TRUE(encoder->Stop());
 }
+
+TEST_F(H264EncoderFixture, NotAvailableInRegistryWithoutHardware) {
+    auto mock = std::make_shared<ac::test::android::MockMedia>();
+
+    // One attempt for each of the probed display modes
+    EXPECT_CALL(*mock, media_message_create())
+            .Times(5)
+            .WillRepeatedly(Return(nullptr));
+
+    auto registry = ac::video::EncoderRegistry::Create();
+    ac::android::H264Encoder::Register(registry);
+
+    EXPECT_EQ(std::vector<std::string>{"android"}, registry->Backends());
+    EXPECT_FALSE(registry->CapabilitiesOf("android", nullptr));
+    EXPECT_EQ(nullptr, registry->CreateBest(ac::video::BaseEncoder::Config{}, mock_report));
+}
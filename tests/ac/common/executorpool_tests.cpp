@@ -17,11 +17,19 @@
 
 #include <gmock/gmock.h>
 
+#include <future>
+#include <thread>
+
 #include "ac/common/executorpool.h"
+#include "ac/common/threadedexecutorfactory.h"
 
 using namespace ::testing;
 
 namespace {
+static constexpr std::chrono::milliseconds kStopTimeout{100};
+// Slack for the scheduler on top of the timeout
+static constexpr std::chrono::milliseconds kStopSlack{400};
+
 class MockExecutable : public ac::common::Executable {
 public:
     MOCK_METHOD0(Start, bool());
@@ -44,6 +52,54 @@ class MockExecutorFactory : public ac::common::ExecutorFactory {
 public:
     MOCK_METHOD1(Create, ac::common::Executor::Ptr(const ac::common::Executable::Ptr&));
 };
+
+// Stands in for a sink stuck in a call which doesn't return when asked
+// to stop, like a send() to a peer which went away.
+class StalledExecutable : public ac::common::Executable {
+public:
+    StalledExecutable() :
+        released_(release_.get_future().share()) {
+    }
+
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+
+    bool Execute() override {
+        entered_.set_value();
+        released_.wait();
+        finished_.set_value();
+        return false;
+    }
+
+    std::string Name() const override {
+        return "StalledExecutable";
+    }
+
+    void Release() { release_.set_value(); }
+    std::future<void> Entered() { return entered_.get_future(); }
+    std::future<void> Finished() { return finished_.get_future(); }
+
+private:
+    std::promise<void> entered_;
+    std::promise<void> release_;
+    std::shared_future<void> released_;
+    std::promise<void> finished_;
+};
+
+class IdleExecutable : public ac::common::Executable {
+public:
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+
+    bool Execute() override {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return true;
+    }
+
+    std::string Name() const override {
+        return "IdleExecutable";
+    }
+};
 }
 
 TEST(ExecutorPool, PoolSizeIsRespected) {
@@ -195,3 +251,33 @@ TEST(ExecutorPool, OnlyStopsWhenAllExecutorsAreStopped) {
     EXPECT_FALSE(pool.Stop());
     EXPECT_TRUE(pool.Running());
 }
+
+TEST(ExecutorPool, StopIsBoundWithStalledExecutor) {
+    auto factory = std::make_shared<ac::common::ThreadedExecutorFactory>();
+    auto stalled = std::make_shared<StalledExecutable>();
+    auto entered = stalled->Entered();
+    auto finished = stalled->Finished();
+
+    ac::common::ExecutorPool pool(factory, 3, kStopTimeout);
+
+    EXPECT_TRUE(pool.Add(std::make_shared<IdleExecutable>()));
+    EXPECT_TRUE(pool.Add(stalled));
+    EXPECT_TRUE(pool.Add(std::make_shared<IdleExecutable>()));
+
+    EXPECT_TRUE(pool.Start());
+    entered.wait();
+
+    const auto started = std::chrono::steady_clock::now();
+    EXPECT_FALSE(pool.Stop());
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+
+    EXPECT_LT(elapsed, kStopTimeout + kStopSlack);
+
+    // The stalled executable is still busy so the pool can't be reused
+    EXPECT_TRUE(pool.Running());
+    EXPECT_FALSE(pool.Start());
+
+    // Let the thread we gave up on finish before the test goes away
+    stalled->Release();
+    EXPECT_EQ(std::future_status::ready, finished.wait_for(kStopSlack));
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <condition_variable>
+#include <future>
+#include <thread>
+
+#include "ac/common/lockprofiler.h"
+
+using namespace ::testing;
+
+namespace {
+class MockLockReport : public ac::video::LockReport {
+public:
+    MOCK_METHOD5(LockSampled, void(const std::string&, const std::uint64_t&, const std::uint64_t&,
+                                   const std::uint64_t&, const std::uint64_t&));
+};
+}
+
+TEST(LockProfiler, CountsUncontendedAcquisitions) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex mutex("queue", profiler);
+
+    for (int n = 0; n < 3; n++) {
+        std::lock_guard<ac::common::ProfiledMutex> l(mutex);
+    }
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+
+    const auto hottest = profiler->Hottest();
+    ASSERT_EQ(1, hottest.size());
+    EXPECT_EQ("queue", hottest[0].site);
+    EXPECT_EQ(4, hottest[0].acquisitions);
+    EXPECT_EQ(0, hottest[0].contentions);
+    EXPECT_EQ(std::chrono::nanoseconds::zero(), hottest[0].wait);
+}
+
+TEST(LockProfiler, RecordsWaitAndHoldOfContendedLock) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex mutex("sender", profiler);
+
+    std::promise<void> locked;
+    std::thread holder([&]() {
+        std::lock_guard<ac::common::ProfiledMutex> l(mutex);
+        locked.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    });
+
+    locked.get_future().wait();
+    mutex.lock();
+    mutex.unlock();
+    holder.join();
+
+    const auto hottest = profiler->Hottest();
+    ASSERT_EQ(1, hottest.size());
+    EXPECT_EQ(2, hottest[0].acquisitions);
+    EXPECT_EQ(1, hottest[0].contentions);
+    EXPECT_GT(hottest[0].wait, std::chrono::nanoseconds::zero());
+    EXPECT_EQ(hottest[0].wait, hottest[0].max_wait);
+    EXPECT_GE(hottest[0].max_hold, std::chrono::milliseconds{20});
+}
+
+TEST(LockProfiler, RanksSitesByWaitTime) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex cold("cold", profiler);
+    ac::common::ProfiledMutex hot("hot", profiler);
+    ac::common::ProfiledMutex idle("idle", profiler);
+
+    profiler->Record(profiler->Register("cold"), true, std::chrono::nanoseconds{100}, std::chrono::nanoseconds{1});
+    profiler->Record(profiler->Register("hot"), true, std::chrono::nanoseconds{5000}, std::chrono::nanoseconds{1});
+
+    const auto hottest = profiler->Hottest();
+    // Sites never acquired are left out
+    ASSERT_EQ(2, hottest.size());
+    EXPECT_EQ("hot", hottest[0].site);
+    EXPECT_EQ("cold", hottest[1].site);
+
+    EXPECT_EQ(1, profiler->Hottest(1).size());
+}
+
+TEST(LockProfiler, LocksWithSameNameShareSite) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex first("BufferQueue", profiler);
+    ac::common::ProfiledMutex second("unnamed", profiler);
+    second.SetSite("BufferQueue");
+
+    first.lock();
+    first.unlock();
+    second.lock();
+    second.unlock();
+
+    const auto hottest = profiler->Hottest();
+    ASSERT_EQ(1, hottest.size());
+    EXPECT_EQ(2, hottest[0].acquisitions);
+}
+
+TEST(LockProfiler, ResetClearsStatistics) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex mutex("queue", profiler);
+
+    mutex.lock();
+    mutex.unlock();
+
+    profiler->Reset();
+
+    EXPECT_EQ(0, profiler->Hottest().size());
+}
+
+TEST(LockProfiler, WorksWithConditionVariable) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    ac::common::ProfiledMutex mutex("queue", profiler);
+    std::condition_variable_any cond;
+    bool ready = false;
+
+    std::thread producer([&]() {
+        std::lock_guard<ac::common::ProfiledMutex> l(mutex);
+        ready = true;
+        cond.notify_one();
+    });
+
+    {
+        std::unique_lock<ac::common::ProfiledMutex> l(mutex);
+        EXPECT_TRUE(cond.wait_for(l, std::chrono::seconds{5}, [&]() { return ready; }));
+    }
+
+    producer.join();
+
+    EXPECT_GE(profiler->Hottest()[0].acquisitions, 2);
+}
+
+TEST(LockProfiler, SamplesSitesToReport) {
+    const auto profiler = ac::common::LockProfiler::Create();
+    const auto report = std::make_shared<MockLockReport>();
+    profiler->SetReport(report);
+
+    ac::common::ProfiledMutex mutex("queue", profiler);
+
+    EXPECT_CALL(*report, LockSampled(std::string("queue"), 1, 0, _, _))
+            .Times(1);
+
+    // Only the first release within an interval is reported
+    mutex.lock();
+    mutex.unlock();
+    mutex.lock();
+    mutex.unlock();
+}
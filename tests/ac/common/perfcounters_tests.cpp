@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "ac/common/perfcounters.h"
+
+namespace {
+typedef ac::common::PerfCounters::Counter Counter;
+
+std::int64_t& CountOf(ac::common::PerfCounters::Values &values, Counter counter) {
+    return values.counts[static_cast<int>(counter)];
+}
+}
+
+TEST(PerfCounters, DifferenceOfUnavailableCounterIsUnavailable) {
+    ac::common::PerfCounters::Values before, after;
+    CountOf(before, Counter::kCycles) = 100;
+    CountOf(after, Counter::kCycles) = 350;
+    CountOf(after, Counter::kInstructions) = 20;
+
+    auto delta = after - before;
+
+    EXPECT_EQ(250, CountOf(delta, Counter::kCycles));
+    EXPECT_EQ(-1, CountOf(delta, Counter::kInstructions));
+    EXPECT_EQ(-1, CountOf(delta, Counter::kCacheMisses));
+}
+
+TEST(PerfCounters, AccumulatesOnlyAvailableCounters) {
+    ac::common::PerfCounters::Values total, delta;
+    CountOf(delta, Counter::kCycles) = 10;
+    CountOf(delta, Counter::kBranchMisses) = 1;
+
+    total += delta;
+    total += delta;
+
+    EXPECT_EQ(20, CountOf(total, Counter::kCycles));
+    EXPECT_EQ(2, CountOf(total, Counter::kBranchMisses));
+    EXPECT_EQ(-1, CountOf(total, Counter::kInstructions));
+}
+
+TEST(PerfCounters, CountsWorkOfCurrentThread) {
+    const auto counters = ac::common::PerfCounters::OpenForCurrentThread();
+    // Not permitted or no PMU; the pipeline goes on without counters then.
+    if (!counters)
+        return;
+
+    ac::common::PerfCounters::Values before, after;
+    EXPECT_TRUE(counters->Read(&before));
+
+    volatile std::uint64_t sum = 0;
+    for (std::uint64_t n = 0; n < 1000000; n++)
+        sum += n;
+
+    EXPECT_TRUE(counters->Read(&after));
+
+    auto delta = after - before;
+    for (const auto counter : { Counter::kCycles, Counter::kInstructions }) {
+        if (CountOf(before, counter) >= 0) {
+            EXPECT_LT(0, CountOf(delta, counter));
+        }
+    }
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+#include "ac/common/executorpool.h"
+#include "ac/common/stallwatchdog.h"
+#include "ac/common/threadedexecutorfactory.h"
+
+using namespace ::testing;
+
+namespace {
+typedef ac::common::StallWatchdog::Action WatchdogAction;
+
+static constexpr ac::TimestampUs kSecond{1000000};
+
+class MockExecutable : public ac::common::Executable {
+public:
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+    MOCK_CONST_METHOD0(LastProgress, ac::TimestampUs());
+
+    std::string Name() const override {
+        return "MockExecutable";
+    }
+};
+
+class MockExecutor : public ac::common::Executor {
+public:
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_CONST_METHOD0(Running, bool());
+};
+
+class MockExecutorFactory : public ac::common::ExecutorFactory {
+public:
+    MOCK_METHOD1(Create, ac::common::Executor::Ptr(const ac::common::Executable::Ptr&));
+};
+
+class MockDelegate : public ac::common::StallWatchdog::Delegate {
+public:
+    MOCK_METHOD1(OnStallAction, void(WatchdogAction));
+};
+
+// Pool which doesn't run anything; the executables report whatever
+// progress the test wants them to.
+class FakePipeline {
+public:
+    FakePipeline() :
+        factory(std::make_shared<NiceMock<MockExecutorFactory>>()),
+        pool(factory, 2) {
+        ON_CALL(*factory, Create(_))
+                .WillByDefault(Invoke([](const ac::common::Executable::Ptr&) {
+            auto executor = std::make_shared<NiceMock<MockExecutor>>();
+            ON_CALL(*executor, Start()).WillByDefault(Return(true));
+            ON_CALL(*executor, Stop()).WillByDefault(Return(true));
+            return executor;
+        }));
+    }
+
+    std::shared_ptr<NiceMock<MockExecutable>> Add(const std::chrono::milliseconds &budget =
+            ac::common::ExecutorPool::kDefaultStallBudget) {
+        auto executable = std::make_shared<NiceMock<MockExecutable>>();
+        pool.Add(executable, budget);
+        return executable;
+    }
+
+    std::shared_ptr<NiceMock<MockExecutorFactory>> factory;
+    ac::common::ExecutorPool pool;
+};
+
+// Makes progress with every iteration until told to get stuck in one,
+// like an encoder which stops returning buffers.
+class StallingExecutable : public ac::common::Executable {
+public:
+    StallingExecutable() :
+        stall_(false),
+        last_progress_(0),
+        released_(release_.get_future().share()) {
+    }
+
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+
+    bool Execute() override {
+        if (stall_)
+            released_.wait();
+
+        last_progress_ = ac::Utils::GetNowUs();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return true;
+    }
+
+    std::string Name() const override {
+        return "StallingExecutable";
+    }
+
+    ac::TimestampUs LastProgress() const override {
+        return last_progress_;
+    }
+
+    void Stall() { stall_ = true; }
+
+    void Release() {
+        stall_ = false;
+        release_.set_value();
+    }
+
+private:
+    std::atomic<bool> stall_;
+    std::atomic<ac::TimestampUs> last_progress_;
+    std::promise<void> release_;
+    std::shared_future<void> released_;
+};
+}
+
+TEST(StallWatchdog, LeavesProgressingPipelineAlone) {
+    FakePipeline pipeline;
+    auto executable = pipeline.Add();
+
+    ASSERT_TRUE(pipeline.pool.Start());
+
+    const ac::TimestampUs started = ac::Utils::GetNowUs();
+    ac::TimestampUs progress = started;
+    EXPECT_CALL(*executable, LastProgress())
+            .WillRepeatedly(ReturnPointee(&progress));
+
+    auto watchdog = ac::common::StallWatchdog::Create();
+    auto delegate = std::make_shared<MockDelegate>();
+    watchdog->SetDelegate(delegate);
+
+    EXPECT_CALL(*delegate, OnStallAction(_))
+            .Times(0);
+
+    for (ac::TimestampUs now = started; now < started + 10 * kSecond; now += kSecond / 4) {
+        progress = now - kSecond / 2;
+        EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+    }
+
+    EXPECT_TRUE(watchdog->Records().empty());
+}
+
+TEST(StallWatchdog, EscalatesOneStepAtATime) {
+    FakePipeline pipeline;
+    auto healthy = pipeline.Add();
+    auto stalled = pipeline.Add();
+
+    ASSERT_TRUE(pipeline.pool.Start());
+
+    const ac::TimestampUs started = ac::Utils::GetNowUs();
+    ac::TimestampUs now = started;
+
+    EXPECT_CALL(*healthy, LastProgress())
+            .WillRepeatedly(ReturnPointee(&now));
+    EXPECT_CALL(*stalled, LastProgress())
+            .WillRepeatedly(Return(started));
+
+    auto watchdog = ac::common::StallWatchdog::Create();
+    auto delegate = std::make_shared<MockDelegate>();
+    watchdog->SetDelegate(delegate);
+
+    {
+        InSequence s;
+        EXPECT_CALL(*delegate, OnStallAction(WatchdogAction::kRequestIDR));
+        EXPECT_CALL(*delegate, OnStallAction(WatchdogAction::kFlushQueues));
+        EXPECT_CALL(*delegate, OnStallAction(WatchdogAction::kRestartEncoder));
+        EXPECT_CALL(*delegate, OnStallAction(WatchdogAction::kTeardown));
+    }
+
+    // Within the budget
+    now = started + kSecond / 2;
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+
+    now = started + 3 * kSecond / 2;
+    EXPECT_EQ(WatchdogAction::kRequestIDR, watchdog->Check(pipeline.pool, now));
+
+    // Every action gets some time to show an effect
+    now += kSecond / 2;
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+
+    now += kSecond / 2;
+    EXPECT_EQ(WatchdogAction::kFlushQueues, watchdog->Check(pipeline.pool, now));
+    now += kSecond;
+    EXPECT_EQ(WatchdogAction::kRestartEncoder, watchdog->Check(pipeline.pool, now));
+    now += kSecond;
+    EXPECT_EQ(WatchdogAction::kTeardown, watchdog->Check(pipeline.pool, now));
+
+    // Nothing left to try after tearing down
+    now += 10 * kSecond;
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+    EXPECT_EQ(WatchdogAction::kTeardown, watchdog->LastAction());
+
+    const auto records = watchdog->Records();
+    ASSERT_EQ(4, records.size());
+    EXPECT_EQ(WatchdogAction::kRequestIDR, records[0].action);
+    EXPECT_EQ(WatchdogAction::kTeardown, records[3].action);
+    for (const auto &record : records) {
+        EXPECT_EQ("MockExecutable", record.stage);
+        EXPECT_EQ(record.time - started, record.stalled_for);
+    }
+}
+
+TEST(StallWatchdog, StartsOverOnceRecovered) {
+    FakePipeline pipeline;
+    auto executable = pipeline.Add();
+
+    ASSERT_TRUE(pipeline.pool.Start());
+
+    const ac::TimestampUs started = ac::Utils::GetNowUs();
+    ac::TimestampUs progress = started;
+    EXPECT_CALL(*executable, LastProgress())
+            .WillRepeatedly(ReturnPointee(&progress));
+
+    auto watchdog = ac::common::StallWatchdog::Create();
+
+    ac::TimestampUs now = started + 2 * kSecond;
+    EXPECT_EQ(WatchdogAction::kRequestIDR, watchdog->Check(pipeline.pool, now));
+
+    // The IDR frame got things going again but not for long enough
+    // to count as recovered.
+    for (int n = 0; n < 4; n++) {
+        now += kSecond;
+        progress = now;
+        EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+    }
+    EXPECT_EQ(WatchdogAction::kRequestIDR, watchdog->LastAction());
+
+    now += 2 * kSecond;
+    EXPECT_EQ(WatchdogAction::kFlushQueues, watchdog->Check(pipeline.pool, now));
+
+    for (int n = 0; n < 6; n++) {
+        now += kSecond;
+        progress = now;
+        watchdog->Check(pipeline.pool, now);
+    }
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->LastAction());
+
+    now += 2 * kSecond;
+    EXPECT_EQ(WatchdogAction::kRequestIDR, watchdog->Check(pipeline.pool, now));
+}
+
+TEST(StallWatchdog, IgnoresUntrackedAndStoppedExecutables) {
+    FakePipeline pipeline;
+    auto executable = pipeline.Add();
+
+    EXPECT_CALL(*executable, LastProgress())
+            .WillRepeatedly(Return(-1));
+
+    auto watchdog = ac::common::StallWatchdog::Create();
+
+    const auto now = ac::Utils::GetNowUs() + 10 * kSecond;
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+
+    ASSERT_TRUE(pipeline.pool.Start());
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pipeline.pool, now));
+    EXPECT_TRUE(pipeline.pool.FindStalled(now).empty());
+}
+
+TEST(StallWatchdog, DetectsExecutableStuckInIteration) {
+    static constexpr std::chrono::milliseconds kBudget{50};
+
+    auto executable = std::make_shared<StallingExecutable>();
+
+    ac::common::ExecutorPool pool(std::make_shared<ac::common::ThreadedExecutorFactory>(), 1,
+                                  std::chrono::milliseconds{100});
+    pool.Add(executable, kBudget);
+    ASSERT_TRUE(pool.Start());
+
+    auto watchdog = ac::common::StallWatchdog::Create();
+
+    std::this_thread::sleep_for(kBudget * 2);
+    EXPECT_EQ(WatchdogAction::kNone, watchdog->Check(pool, ac::Utils::GetNowUs()));
+
+    executable->Stall();
+    std::this_thread::sleep_for(kBudget * 3);
+
+    const auto stalls = pool.FindStalled(ac::Utils::GetNowUs());
+    ASSERT_EQ(1, stalls.size());
+    EXPECT_EQ("StallingExecutable", stalls[0].name);
+    EXPECT_GE(stalls[0].duration, 2 * kBudget.count() * 1000);
+
+    EXPECT_EQ(WatchdogAction::kRequestIDR, watchdog->Check(pool, ac::Utils::GetNowUs()));
+
+    executable->Release();
+    pool.Stop();
+}
@@ -17,7 +17,10 @@
 
 #include <gmock/gmock.h>
 
+#include <future>
+
 #include "ac/common/executable.h"
+#include "ac/common/perfcounters.h"
 #include "ac/common/threadedexecutor.h"
 
 using namespace ::testing;
@@ -33,6 +36,13 @@ public:
         return "MockExecutable";
     }
 };
+
+class MockPerfCounterReport : public ac::video::PerfCounterReport {
+public:
+    MOCK_METHOD6(CountersSampled, void(const std::string&, const std::uint64_t&,
+                                       const std::int64_t&, const std::int64_t&,
+                                       const std::int64_t&, const std::int64_t&));
+};
 }
 
 TEST(ThreadedExecutor, CorrectStartAndStopBehaviour) {
@@ -118,3 +128,79 @@ TEST(ThreadedExecutor, IgnoresFailedStopFromExecutable) {
     EXPECT_TRUE(executor->Stop());
     EXPECT_FALSE(executor->Running());
 }
+
+TEST(ThreadedExecutor, RefusesToStartAfterGivingUpOnThread) {
+    auto executable = std::make_shared<MockExecutable>();
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> entered;
+    std::promise<void> finished;
+
+    EXPECT_CALL(*executable, Start())
+            .Times(1)
+            .WillOnce(Return(true));
+    EXPECT_CALL(*executable, Stop())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    // Hangs like an encoder stuck in the driver
+    EXPECT_CALL(*executable, Execute())
+            .Times(1)
+            .WillOnce(Invoke([&]() {
+                entered.set_value();
+                released.wait();
+                finished.set_value();
+                return false;
+            }));
+
+    const auto executor = std::make_shared<ac::common::ThreadedExecutor>(executable);
+
+    EXPECT_TRUE(executor->Start());
+    entered.get_future().wait();
+    EXPECT_FALSE(executor->StopUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds{50}));
+    EXPECT_FALSE(executor->Running());
+
+    // The executable is still in use by the thread left behind
+    EXPECT_FALSE(executor->Start());
+
+    release.set_value();
+    EXPECT_EQ(std::future_status::ready, finished.get_future().wait_for(std::chrono::seconds{5}));
+}
+
+TEST(ThreadedExecutor, SamplesPerfCountersIfAvailable) {
+    auto executable = std::make_shared<MockExecutable>();
+    auto report = std::make_shared<MockPerfCounterReport>();
+
+    std::atomic<unsigned int> count{0};
+
+    EXPECT_CALL(*executable, Start())
+            .WillOnce(Return(true));
+    EXPECT_CALL(*executable, Stop())
+            .WillOnce(Return(true));
+    EXPECT_CALL(*executable, Execute())
+            .WillRepeatedly(Invoke([&]() {
+                count++;
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                return true;
+            }));
+
+    // Without permission to open them (or a PMU) the executor has to run
+    // just as it would without a report.
+    if (ac::common::PerfCounters::OpenForCurrentThread())
+        EXPECT_CALL(*report, CountersSampled("MockExecutable", Gt(0u), Ge(0), _, _, _))
+                .Times(AtLeast(1));
+    else
+        EXPECT_CALL(*report, CountersSampled(_, _, _, _, _, _))
+                .Times(0);
+
+    const auto executor = std::make_shared<ac::common::ThreadedExecutor>(executable, report);
+
+    EXPECT_TRUE(executor->Start());
+
+    std::this_thread::sleep_for(ac::common::ThreadedExecutor::kPerfCounterInterval +
+                                std::chrono::milliseconds{300});
+
+    EXPECT_TRUE(executor->Stop());
+    EXPECT_LT(0u, count.load());
+}
@@ -36,6 +36,9 @@ struct MockController : public ac::Controller {
     MOCK_CONST_METHOD0(Enabled, bool());
 
     MOCK_METHOD1(SetEnabled, ac::Error(bool));
+
+    MOCK_METHOD1(RegisterInputProvider, ac::Error(const ac::InputProvider::Ptr &));
+    MOCK_METHOD1(UnregisterInputProvider, ac::Error(const ac::InputProvider::Ptr &));
 };
 }
 
@@ -63,6 +66,8 @@ TEST(ControllerSkeleton, ForwardsCallsToImpl) {
     EXPECT_CALL(*impl, Scanning()).Times(1).WillRepeatedly(Return(true));
     EXPECT_CALL(*impl, Enabled()).Times(1).WillRepeatedly(Return(true));
     EXPECT_CALL(*impl, SetEnabled(false)).Times(1).WillRepeatedly(Return(ac::Error::kNone));
+    EXPECT_CALL(*impl, RegisterInputProvider(_)).Times(1).WillRepeatedly(Return(ac::Error::kNone));
+    EXPECT_CALL(*impl, UnregisterInputProvider(_)).Times(1).WillRepeatedly(Return(ac::Error::kNone));
 
     auto fmc = ac::dbus::ControllerSkeleton::Create(impl);
     fmc->SetDelegate(std::shared_ptr<ac::Controller::Delegate>{});
@@ -76,6 +81,8 @@ TEST(ControllerSkeleton, ForwardsCallsToImpl) {
     fmc->Scanning();
     fmc->Enabled();
     fmc->SetEnabled(false);
+    fmc->RegisterInputProvider(ac::InputProvider::Ptr{});
+    fmc->UnregisterInputProvider(ac::InputProvider::Ptr{});
 
     Mock::AllowLeak(impl.get());
 }
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <vector>
+
+#include <boost/accumulators/accumulators.hpp>
+#include <boost/accumulators/statistics/max.hpp>
+#include <boost/accumulators/statistics/mean.hpp>
+#include <boost/accumulators/statistics/min.hpp>
+#include <boost/accumulators/statistics/stats.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/video/colorconverter.h"
+
+namespace ba = boost::accumulators;
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kWidth{1920};
+static constexpr unsigned int kHeight{1080};
+static constexpr unsigned int kFramerate{60};
+static constexpr unsigned int kFrameCount{120};
+// Share of a single core we allow the conversion of a 1080p60 stream
+// to take up.
+static constexpr double kMaxCoreLoad{0.5};
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::duration<double> Seconds;
+
+typedef ba::accumulator_set<double, ba::stats<ba::tag::min, ba::tag::max, ba::tag::mean>> Statistics;
+
+Statistics MeasureConversion(const ac::video::ColorConverter::Config &config) {
+    Statistics stats;
+
+    auto converter = ac::video::ColorConverter::Create(config);
+    EXPECT_NE(nullptr, converter);
+    if (!converter)
+        return stats;
+
+    std::vector<std::uint8_t> source(config.source_width * config.source_height * 4);
+    for (std::size_t n = 0; n < source.size(); n++)
+        source[n] = n * 7;
+
+    std::vector<std::uint8_t> target(converter->OutputSize());
+
+    for (unsigned int n = 0; n < kFrameCount; n++) {
+        const auto start = Clock::now();
+        converter->Convert(source.data(), target.data());
+        stats(std::chrono::duration_cast<Seconds>(Clock::now() - start).count());
+    }
+
+    AC_DEBUG("%s kernel %dx%d -> %dx%d: mean %f ms min %f ms max %f ms",
+             ac::video::ColorConverter::KernelToString(converter->ActiveKernel()),
+             config.source_width, config.source_height, config.width, config.height,
+             ba::mean(stats) * 1000, ba::min(stats) * 1000, ba::max(stats) * 1000);
+
+    return stats;
+}
+}
+
+TEST(ColorConverterPerformance, Converts1080p60WithinFractionOfCore) {
+    ac::video::ColorConverter::Config config;
+    config.source_width = kWidth;
+    config.source_height = kHeight;
+    config.width = kWidth;
+    config.height = kHeight;
+
+    const auto stats = MeasureConversion(config);
+
+    EXPECT_LT(ba::mean(stats) * kFramerate, kMaxCoreLoad);
+}
+
+TEST(ColorConverterPerformance, SIMDIsFasterThanScalar) {
+    ac::video::ColorConverter::Config config;
+    config.source_width = kWidth;
+    config.source_height = kHeight;
+    config.width = kWidth;
+    config.height = kHeight;
+
+    auto converter = ac::video::ColorConverter::Create(config);
+    ASSERT_NE(nullptr, converter);
+    if (converter->ActiveKernel() == ac::video::ColorConverter::Kernel::kScalar)
+        return;
+
+    const auto simd = MeasureConversion(config);
+
+    config.kernel = ac::video::ColorConverter::Kernel::kScalar;
+    const auto scalar = MeasureConversion(config);
+
+    EXPECT_LT(ba::mean(simd), ba::mean(scalar));
+}
+
+TEST(ColorConverterPerformance, Downscales1080pTo720p) {
+    ac::video::ColorConverter::Config config;
+    config.source_width = kWidth;
+    config.source_height = kHeight;
+    config.width = 1280;
+    config.height = 720;
+
+    MeasureConversion(config);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+
+#include <boost/accumulators/accumulators.hpp>
+#include <boost/accumulators/statistics/max.hpp>
+#include <boost/accumulators/statistics/min.hpp>
+#include <boost/accumulators/statistics/mean.hpp>
+#include <boost/accumulators/statistics/stats.hpp>
+#include <boost/accumulators/statistics/variance.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/report/null/packetizerreport.h"
+
+#include "ac/streaming/mpegtsdemuxer.h"
+#include "ac/streaming/mpegtspacketizer.h"
+
+#include "tests/common/benchmark.h"
+
+namespace ba = boost::accumulators;
+
+using namespace ::testing;
+
+namespace {
+// Roughly what the encoder produces for 720p with 5 MBit/s
+static constexpr std::size_t kFrameSize{20000};
+static constexpr std::size_t kFrameCount{1000};
+static constexpr std::size_t kTrialCount{25};
+static constexpr std::size_t kTSPacketSize{188};
+// What the RTPSender puts into a single datagram
+static constexpr std::size_t kTSPacketsPerRTPPacket{7};
+// Packet rate of a 50 MBit/s stream, well above what any WiFi Display
+// sink gets to see.
+static constexpr double kRequiredPacketsPerSecond{50000000.0 / (kTSPacketSize * 8)};
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef ac::testing::Benchmark::Result::Timing::Seconds Resolution;
+
+typedef ba::accumulator_set<
+    Resolution::rep,
+    ba::stats<ba::tag::count, ba::tag::min, ba::tag::max, ba::tag::mean, ba::tag::variance>
+> Statistics;
+
+class DemuxerBenchmark : public ac::testing::Benchmark {
+public:
+    DemuxerBenchmark() :
+        packet_count_(0) {
+        auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                    std::make_shared<ac::report::null::PacketizerReport>());
+        auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+        auto frame = ac::video::Buffer::Create(kFrameSize);
+        ::memset(frame->Data(), 0xab, frame->Length());
+
+        for (std::size_t n = 0; n < kFrameCount; n++) {
+            frame->SetTimestamp(n * 33333);
+
+            ac::video::Buffer::Ptr packets;
+            packetizer->Packetize(track, frame, &packets, n % 3 == 0 ?
+                                  ac::streaming::Packetizer::kEmitPATandPMT : 0);
+
+            // Split up like the RTPSender does it
+            const auto size = kTSPacketsPerRTPPacket * kTSPacketSize;
+            for (std::uint32_t offset = 0; offset < packets->Length(); offset += size)
+                datagrams_.push_back(ac::video::Buffer::Create(packets, offset,
+                                                               std::min<std::uint32_t>(size, packets->Length() - offset)));
+
+            packet_count_ += packets->Length() / kTSPacketSize;
+        }
+    }
+
+    std::size_t PacketCount() const {
+        return packet_count_;
+    }
+
+    // Measures the time it takes to demux the whole stream
+    ac::testing::Benchmark::Result Run() {
+        Statistics stats;
+        ac::testing::Benchmark::Result result;
+
+        std::vector<ac::video::AccessUnit> units;
+        units.reserve(kFrameCount);
+
+        for (std::size_t trial = 0; trial < kTrialCount; trial++) {
+            auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+            units.clear();
+
+            const auto start = Clock::now();
+
+            for (const auto &datagram : datagrams_)
+                demuxer->Demux(datagram, &units);
+
+            const auto seconds = std::chrono::duration_cast<Resolution>(Clock::now() - start);
+            stats(seconds.count());
+            result.timing.sample.push_back(seconds);
+
+            EXPECT_EQ(kFrameCount, units.size());
+        }
+
+        result.sample_size = ba::count(stats);
+        result.timing.min = Resolution{ba::min(stats)};
+        result.timing.max = Resolution{ba::max(stats)};
+        result.timing.mean = Resolution{ba::mean(stats)};
+        result.timing.std_dev = Resolution{std::sqrt(ba::variance(stats))};
+
+        return result;
+    }
+
+private:
+    std::vector<ac::video::Buffer::Ptr> datagrams_;
+    std::size_t packet_count_;
+};
+}
+
+TEST(DemuxerPerformance, DemuxesFasterThanRealtime) {
+    DemuxerBenchmark benchmark;
+
+    const auto result = benchmark.Run();
+    const auto packets_per_second = benchmark.PacketCount() / result.timing.mean.count();
+
+    AC_DEBUG("%f packets/s (%f MBit/s)", packets_per_second,
+             packets_per_second * kTSPacketSize * 8 / 1000000.0);
+
+    EXPECT_GT(packets_per_second, kRequiredPacketsPerSecond);
+}
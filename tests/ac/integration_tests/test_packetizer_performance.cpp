@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+
+#include <boost/accumulators/accumulators.hpp>
+#include <boost/accumulators/statistics/max.hpp>
+#include <boost/accumulators/statistics/min.hpp>
+#include <boost/accumulators/statistics/mean.hpp>
+#include <boost/accumulators/statistics/stats.hpp>
+#include <boost/accumulators/statistics/variance.hpp>
+#include <boost/concept_check.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/streaming/mpegtspacketizer.h"
+
+#include "tests/common/benchmark.h"
+
+namespace ba = boost::accumulators;
+
+using namespace ::testing;
+
+namespace {
+// Roughly what the encoder produces for 720p with 5 MBit/s
+static constexpr std::size_t kFrameSize{20000};
+static constexpr std::size_t kFramesPerTrial{1000};
+static constexpr std::size_t kTrialCount{25};
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef ac::testing::Benchmark::Result::Timing::Seconds Resolution;
+
+typedef ba::accumulator_set<
+    Resolution::rep,
+    ba::stats<ba::tag::count, ba::tag::min, ba::tag::max, ba::tag::mean, ba::tag::variance>
+> Statistics;
+
+class NullPacketizerReport : public ac::video::PacketizerReport {
+public:
+    void PacketizedFrame(const ac::TimestampUs &timestamp) override {
+        boost::ignore_unused_variable_warning(timestamp);
+    }
+
+    void PaddedFrame(const ac::TimestampUs &timestamp, const size_t &padding, const size_t &total) override {
+        boost::ignore_unused_variable_warning(timestamp);
+        boost::ignore_unused_variable_warning(padding);
+        boost::ignore_unused_variable_warning(total);
+    }
+
+    void DroppedFrame(const ac::TimestampUs &timestamp, const int &layer) override {
+        boost::ignore_unused_variable_warning(timestamp);
+        boost::ignore_unused_variable_warning(layer);
+    }
+
+    void FrameRateChanged(const unsigned int &framerate, const unsigned int &drop_level) override {
+        boost::ignore_unused_variable_warning(framerate);
+        boost::ignore_unused_variable_warning(drop_level);
+    }
+};
+
+class PacketizerBenchmark : public ac::testing::Benchmark {
+public:
+    // Measures the time it takes to packetize kFramesPerTrial frames
+    ac::testing::Benchmark::Result ForConfiguration(const ac::streaming::MPEGTSPacketizer::Config &config) {
+        Statistics stats;
+        ac::testing::Benchmark::Result result;
+
+        auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                    std::make_shared<NullPacketizerReport>(), config);
+        auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+        auto frame = ac::video::Buffer::Create(kFrameSize);
+        ::memset(frame->Data(), 0xab, frame->Length());
+
+        for (std::size_t trial = 0; trial < kTrialCount; trial++) {
+            const auto start = Clock::now();
+
+            for (std::size_t n = 0; n < kFramesPerTrial; n++) {
+                frame->SetTimestamp(n * 33333);
+
+                ac::video::Buffer::Ptr packets;
+                packetizer->Packetize(track, frame, &packets, n % 3 == 0 ?
+                                      ac::streaming::Packetizer::kEmitPATandPMT : 0);
+            }
+
+            const auto seconds = std::chrono::duration_cast<Resolution>(Clock::now() - start);
+            stats(seconds.count());
+            result.timing.sample.push_back(seconds);
+        }
+
+        result.sample_size = ba::count(stats);
+        result.timing.min = Resolution{ba::min(stats)};
+        result.timing.max = Resolution{ba::max(stats)};
+        result.timing.mean = Resolution{ba::mean(stats)};
+        result.timing.std_dev = Resolution{std::sqrt(ba::variance(stats))};
+
+        return result;
+    }
+};
+}
+
+TEST(PacketizerPerformance, SingleTrackFastPathIsNotSlower) {
+    PacketizerBenchmark benchmark;
+
+    ac::streaming::MPEGTSPacketizer::Config generic_config;
+    generic_config.single_track_fast_path = false;
+    const auto generic = benchmark.ForConfiguration(generic_config);
+
+    const auto fast = benchmark.ForConfiguration(ac::streaming::MPEGTSPacketizer::Config{});
+
+    AC_DEBUG("generic path: %f frames/s, fast path: %f frames/s",
+             kFramesPerTrial / generic.timing.mean.count(),
+             kFramesPerTrial / fast.timing.mean.count());
+
+    EXPECT_FALSE(fast.timing.is_significantly_slower_than_reference(generic.timing));
+}
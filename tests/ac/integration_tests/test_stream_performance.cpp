@@ -41,6 +41,8 @@
 
 #include "ac/systemcontroller.h"
 
+#include "ac/common/lockprofiler.h"
+
 #include "tests/common/benchmark.h"
 #include "tests/common/statistics.h"
 #include "tests/common/glibhelpers.h"
@@ -55,6 +57,9 @@ using namespace ::testing;
 namespace {
 static constexpr unsigned int kStreamMaxUnitSize = 1472;
 static constexpr const char *kNullIpAddress{"0.0.0.0"};
+// Locks listed after a run. Only builds with AETHERCAST_LOCK_PROFILING
+// have any.
+static constexpr std::size_t kHottestLocks{10};
 
 class MockStream : public ac::network::Stream {
 public:
@@ -158,6 +163,8 @@ public:
 
         media_manager->SetSinkRtpPorts(port, 0);
 
+        ac::common::LockProfiler::Instance()->Reset();
+
         media_manager->InitOptimalVideoFormat(sink_native_format, sink_codecs);
         media_manager->Play();
 
@@ -168,11 +175,27 @@ public:
 
         media_manager->Teardown();
 
+        ReportHottestLocks();
+
         system_controller->DisplayStateLock()->Release(ac::DisplayState::Off);
 
         FillResultsFromStatistics(benchmark_result, stats);
         return benchmark_result;
     }
+
+private:
+    void ReportHottestLocks() {
+        const auto hottest = ac::common::LockProfiler::Instance()->Hottest(kHottestLocks);
+        for (std::size_t n = 0; n < hottest.size(); n++) {
+            const auto &lock = hottest[n];
+            AC_INFO("#%d %s: %d acquisitions %d contended wait %d us (max %d us) hold %d us (max %d us)",
+                    n + 1, lock.site, lock.acquisitions, lock.contentions,
+                    std::chrono::duration_cast<std::chrono::microseconds>(lock.wait).count(),
+                    std::chrono::duration_cast<std::chrono::microseconds>(lock.max_wait).count(),
+                    std::chrono::duration_cast<std::chrono::microseconds>(lock.hold).count(),
+                    std::chrono::duration_cast<std::chrono::microseconds>(lock.max_hold).count());
+        }
+    }
 };
 }
 
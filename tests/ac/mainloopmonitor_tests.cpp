@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <thread>
+
+#include "ac/mainloopmonitor.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::chrono::milliseconds kThreshold{20};
+static constexpr std::chrono::milliseconds kBlockingCallDuration{100};
+
+// Stands in for something like g_bus_get_sync
+gboolean BlockingCallback(gpointer user_data) {
+    std::this_thread::sleep_for(kBlockingCallDuration);
+    *static_cast<bool*>(user_data) = true;
+    return FALSE;
+}
+
+gboolean QuickCallback(gpointer user_data) {
+    *static_cast<bool*>(user_data) = true;
+    return FALSE;
+}
+
+class MainLoopMonitorFixture : public ::testing::Test {
+protected:
+    MainLoopMonitorFixture() :
+        context(g_main_context_new()) {
+        ac::MainLoopMonitor::Config config;
+        config.threshold = kThreshold;
+        config.debug = true;
+        monitor = ac::MainLoopMonitor::Create(context, config);
+    }
+
+    ~MainLoopMonitorFixture() {
+        monitor.reset();
+        g_main_context_unref(context);
+    }
+
+    void AddSource(GSource *source, GSourceFunc callback, bool *dispatched, const char *name = nullptr) {
+        if (name)
+            g_source_set_name(source, name);
+        g_source_set_callback(source, callback, dispatched, nullptr);
+        g_source_attach(source, context);
+        g_source_unref(source);
+    }
+
+    // The iteration of a dispatch is only accounted once the context
+    // polls again.
+    void RunUntil(const bool &dispatched) {
+        while (!dispatched)
+            g_main_context_iteration(context, TRUE);
+        g_main_context_iteration(context, FALSE);
+    }
+
+    GMainContext *context;
+    ac::MainLoopMonitor::Ptr monitor;
+};
+}
+
+TEST(MainLoopMonitorHistogram, CountsIntoBuckets) {
+    ac::MainLoopMonitor::Histogram histogram;
+
+    EXPECT_EQ(0, histogram.Percentile(50));
+
+    for (int n = 0; n < 98; n++)
+        histogram.Add(500);
+    histogram.Add(30000);
+    histogram.Add(5000000);
+
+    EXPECT_EQ(100, histogram.Count());
+    EXPECT_EQ(1000, histogram.Percentile(50));
+    EXPECT_EQ(50000, histogram.Percentile(99));
+    EXPECT_EQ(-1, histogram.Percentile(100));
+
+    const auto buckets = histogram.Buckets();
+    ASSERT_EQ(12, buckets.size());
+    EXPECT_EQ(1000, buckets.front().upper_bound);
+    EXPECT_EQ(98, buckets.front().count);
+    EXPECT_EQ(-1, buckets.back().upper_bound);
+    EXPECT_EQ(1, buckets.back().count);
+}
+
+TEST_F(MainLoopMonitorFixture, OnlyOneMonitorRunsAtATime) {
+    EXPECT_TRUE(monitor->Start());
+    EXPECT_FALSE(monitor->Start());
+
+    auto other = ac::MainLoopMonitor::Create(context);
+    EXPECT_FALSE(other->Start());
+
+    monitor->Stop();
+    EXPECT_FALSE(monitor->Running());
+
+    EXPECT_TRUE(other->Start());
+    other->Stop();
+}
+
+TEST_F(MainLoopMonitorFixture, QuickDispatchesAreNotAttributed) {
+    ASSERT_TRUE(monitor->Start());
+
+    bool dispatched = false;
+    AddSource(g_idle_source_new(), &QuickCallback, &dispatched);
+    RunUntil(dispatched);
+
+    const auto statistics = monitor->CurrentStatistics();
+    EXPECT_LE(1, statistics.dispatch.Count());
+    EXPECT_EQ(0, statistics.slow_dispatches);
+    EXPECT_TRUE(statistics.slow_sources.empty());
+}
+
+TEST_F(MainLoopMonitorFixture, AttributesSlowDispatchToSourceName) {
+    ASSERT_TRUE(monitor->Start());
+
+    bool dispatched = false;
+    AddSource(g_idle_source_new(), &BlockingCallback, &dispatched, "blocking-source");
+    RunUntil(dispatched);
+
+    const auto statistics = monitor->CurrentStatistics();
+    EXPECT_EQ(1, statistics.slow_dispatches);
+    EXPECT_GE(statistics.longest_dispatch, kBlockingCallDuration.count() * 1000);
+
+    ASSERT_EQ(1, statistics.slow_sources.size());
+    EXPECT_THAT(statistics.slow_sources.begin()->first, StartsWith("blocking-source"));
+    EXPECT_EQ(1, statistics.slow_sources.begin()->second.count);
+}
+
+TEST_F(MainLoopMonitorFixture, AttributesUnnamedSourceToCallback) {
+    ASSERT_TRUE(monitor->Start());
+
+    bool dispatched = false;
+    AddSource(g_idle_source_new(), &BlockingCallback, &dispatched);
+    RunUntil(dispatched);
+
+    const auto statistics = monitor->CurrentStatistics();
+    ASSERT_EQ(1, statistics.slow_sources.size());
+
+    // Depending on whether the test binary exports its symbols we get
+    // either the name of the callback or its offset.
+    const auto source = statistics.slow_sources.begin()->first;
+    EXPECT_NE("unknown", source);
+    EXPECT_THAT(source, AnyOf(HasSubstr("BlockingCallback"), HasSubstr("mainloopmonitor_tests+0x")));
+}
+
+TEST_F(MainLoopMonitorFixture, ProbeSeesDelayCausedByOtherSources) {
+    ASSERT_TRUE(monitor->Start());
+
+    // Blocks over the point in time the probe is due
+    const auto block_at = ac::MainLoopMonitor::kProbeInterval - kBlockingCallDuration / 2;
+
+    bool dispatched = false;
+    AddSource(g_timeout_source_new(block_at.count()), &BlockingCallback, &dispatched);
+    RunUntil(dispatched);
+
+    const auto deadline = std::chrono::steady_clock::now() + kBlockingCallDuration;
+    while (monitor->CurrentStatistics().probe_delay.Count() == 0 &&
+           std::chrono::steady_clock::now() < deadline)
+        g_main_context_iteration(context, FALSE);
+
+    const auto statistics = monitor->CurrentStatistics();
+    ASSERT_EQ(1, statistics.probe_delay.Count());
+    EXPECT_GE(statistics.probe_delay.Percentile(100), kBlockingCallDuration.count() * 1000 / 4);
+}
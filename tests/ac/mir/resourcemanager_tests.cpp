@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "mockmir.h"
+
+#include "ac/mir/resourcemanager.h"
+
+using namespace ::testing;
+
+namespace {
+class FakeEncoder : public ac::video::BaseEncoder {
+public:
+    ac::video::BaseEncoder::Config DefaultConfiguration() override { return Config{}; }
+    bool Configure(const Config &config) override { config_ = config; return true; }
+    void QueueBuffer(const ac::video::Buffer::Ptr&) override { }
+    Config Configuration() const override { return config_; }
+    bool Running() const override { return false; }
+    void SendIDRFrame() override { }
+    std::string Name() const override { return "FakeEncoder"; }
+    bool Start() override { return true; }
+    bool Stop() override { return true; }
+    bool Execute() override { return true; }
+
+private:
+    Config config_;
+};
+
+class NullReportFactory : public ac::report::ReportFactory {
+public:
+    ac::video::EncoderReport::Ptr CreateEncoderReport() override { return nullptr; }
+    ac::video::RendererReport::Ptr CreateRendererReport() override { return nullptr; }
+    ac::video::PacketizerReport::Ptr CreatePacketizerReport() override { return nullptr; }
+    ac::video::SenderReport::Ptr CreateSenderReport() override { return nullptr; }
+    ac::video::MemoryReport::Ptr CreateMemoryReport() override { return nullptr; }
+    ac::video::JitterBufferReport::Ptr CreateJitterBufferReport() override { return nullptr; }
+    ac::video::ThermalReport::Ptr CreateThermalReport() override { return nullptr; }
+    ac::video::PerfCounterReport::Ptr CreatePerfCounterReport() override { return nullptr; }
+    ac::video::LockReport::Ptr CreateLockReport() override { return nullptr; }
+};
+
+class ResourceManagerFixture : public ::testing::Test {
+public:
+    ResourceManagerFixture() :
+        encoders(ac::video::EncoderRegistry::Create()),
+        budget(ac::video::MemoryBudget::Create(1000)),
+        created(0) {
+        encoders->Register("fake", "1",
+                           [](ac::video::EncoderRegistry::Capabilities *capabilities) {
+                               capabilities->profiles = { 66 };
+                               capabilities->max_level = 42;
+                               capabilities->max_width = 1920;
+                               capabilities->max_height = 1080;
+                               capabilities->max_framerate = 60;
+                               return true;
+                           },
+                           [this](const ac::video::EncoderReport::Ptr&) {
+                               if (encoder_gate.valid())
+                                   encoder_gate.wait();
+                               created++;
+                               return std::make_shared<FakeEncoder>();
+                           });
+    }
+
+    ac::mir::ResourceManager::Ptr CreateManager() {
+        return ac::mir::ResourceManager::Create(encoders, std::make_shared<NullReportFactory>(),
+                                                ac::mir::ResourceManager::kDefaultIdleTimeout, budget);
+    }
+
+    static ac::video::BaseEncoder::Config Format(unsigned int width, unsigned int height) {
+        ac::video::BaseEncoder::Config config;
+        config.width = width;
+        config.height = height;
+        config.framerate = 30;
+        config.profile_idc = 66;
+        config.level_idc = 31;
+        return config;
+    }
+
+    static bool WaitForWarmEncoder(const ac::mir::ResourceManager::Ptr &resources) {
+        for (int n = 0; n < 100 && !resources->HasWarmEncoder(); n++)
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        return resources->HasWarmEncoder();
+    }
+
+    void ExpectConnection(MirConnection *connection) {
+        EXPECT_CALL(mir, mir_connect_sync(_, _))
+                .Times(1)
+                .WillOnce(Return(connection));
+        EXPECT_CALL(mir, mir_connection_is_valid(connection))
+                .WillRepeatedly(Return(true));
+    }
+
+    ac::test::mir::MockMir mir;
+    ac::video::EncoderRegistry::Ptr encoders;
+    ac::video::MemoryBudget::Ptr budget;
+    std::atomic<int> created;
+    std::shared_future<void> encoder_gate;
+};
+}
+
+TEST_F(ResourceManagerFixture, ReusesConnectionAcrossSessions) {
+    auto connection = reinterpret_cast<MirConnection*>(1);
+    ExpectConnection(connection);
+
+    auto resources = CreateManager();
+
+    const auto first = resources->TakeConnection();
+    ASSERT_NE(nullptr, first);
+    EXPECT_EQ(connection, first->Handle());
+    EXPECT_EQ(first, resources->TakeConnection());
+
+    EXPECT_CALL(mir, mir_connection_release(connection))
+            .Times(1);
+}
+
+TEST_F(ResourceManagerFixture, PrewarmConnectsAheadOfSession) {
+    auto connection = reinterpret_cast<MirConnection*>(1);
+    ExpectConnection(connection);
+
+    auto resources = CreateManager();
+    resources->Prewarm();
+
+    EXPECT_EQ(connection, resources->TakeConnection()->Handle());
+
+    EXPECT_CALL(mir, mir_connection_release(connection))
+            .Times(1);
+
+    resources->Release();
+    EXPECT_FALSE(resources->HasWarmConnection());
+}
+
+TEST_F(ResourceManagerFixture, PrewarmsEncoderForLastFormat) {
+    auto connection = reinterpret_cast<MirConnection*>(1);
+    ExpectConnection(connection);
+    EXPECT_CALL(mir, mir_connection_release(connection))
+            .Times(1);
+
+    auto resources = CreateManager();
+
+    auto encoder = resources->TakeEncoder(Format(1280, 720), nullptr);
+    ASSERT_NE(nullptr, encoder);
+    EXPECT_EQ(1280, encoder->Configuration().width);
+    EXPECT_EQ(1, created);
+
+    // Next session expects the same format
+    resources->Prewarm();
+    resources->TakeConnection();
+    EXPECT_TRUE(WaitForWarmEncoder(resources));
+    EXPECT_EQ(2, created);
+
+    encoder = resources->TakeEncoder(Format(1280, 720), nullptr);
+    EXPECT_EQ(1280, encoder->Configuration().width);
+    EXPECT_EQ(2, created);
+    EXPECT_FALSE(resources->HasWarmEncoder());
+
+    // A different format can't use the pre-warmed encoder
+    resources->Prewarm();
+    encoder = resources->TakeEncoder(Format(1920, 1080), nullptr);
+    EXPECT_EQ(1920, encoder->Configuration().width);
+    EXPECT_EQ(4, created);
+}
+
+TEST_F(ResourceManagerFixture, DoesNotPrewarmUnderMemoryPressure) {
+    EXPECT_CALL(mir, mir_connect_sync(_, _))
+            .Times(0);
+
+    budget->Acquire(ac::video::MemoryBudget::Stage::kSender, 1000);
+
+    auto resources = CreateManager();
+    resources->Prewarm();
+
+    EXPECT_FALSE(resources->HasWarmConnection());
+    EXPECT_FALSE(resources->HasWarmEncoder());
+
+    budget->Release(ac::video::MemoryBudget::Stage::kSender, 1000);
+}
+
+TEST_F(ResourceManagerFixture, TakingConnectionDoesNotWaitForEncoderWarmup) {
+    auto connection = reinterpret_cast<MirConnection*>(1);
+    ExpectConnection(connection);
+    EXPECT_CALL(mir, mir_connection_release(connection))
+            .Times(1);
+
+    auto resources = CreateManager();
+    resources->TakeEncoder(Format(1280, 720), nullptr);
+
+    // Configuring the encoder for the next session takes a while
+    std::promise<void> gate;
+    encoder_gate = gate.get_future().share();
+
+    resources->Prewarm();
+
+    auto taken = std::async(std::launch::async, [&]() { return resources->TakeConnection(); });
+    const auto status = taken.wait_for(std::chrono::seconds{1});
+    EXPECT_FALSE(resources->HasWarmEncoder());
+
+    gate.set_value();
+    ASSERT_EQ(std::future_status::ready, status);
+    EXPECT_EQ(connection, taken.get()->Handle());
+    EXPECT_TRUE(WaitForWarmEncoder(resources));
+    EXPECT_EQ(2, created);
+}
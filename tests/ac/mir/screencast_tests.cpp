@@ -121,6 +121,42 @@ TEST(Screencast, NoDisplayConfigurationAvailable) {
     EXPECT_FALSE(screencast->Setup(output));
 }
 
+TEST(Screencast, UsesGivenConnection) {
+    auto mir = std::make_shared<ac::test::mir::MockMir>();
+
+    auto handle = reinterpret_cast<MirConnection*>(1);
+
+    EXPECT_CALL(*mir, mir_connect_sync(_, _))
+            .Times(1)
+            .WillOnce(Return(handle));
+
+    EXPECT_CALL(*mir, mir_connection_is_valid(handle))
+            .Times(1)
+            .WillOnce(Return(true));
+
+    auto connection = ac::mir::Connection::Create();
+
+    // Doesn't connect on its own and leaves the connection alone
+    EXPECT_CALL(*mir, mir_connection_create_display_config(handle))
+            .Times(1)
+            .WillOnce(Return(nullptr));
+
+    EXPECT_CALL(*mir, mir_connection_get_error_message(handle))
+            .Times(1)
+            .WillOnce(Return("Error message from mock"));
+
+    ac::video::DisplayOutput output;
+    output.mode = ac::video::DisplayOutput::Mode::kExtend;
+    auto screencast = std::make_shared<ac::mir::Screencast>(connection);
+    EXPECT_FALSE(screencast->Setup(output));
+    screencast.reset();
+
+    EXPECT_CALL(*mir, mir_connection_release(handle))
+            .Times(1);
+
+    connection.reset();
+}
+
 TEST(Screencast, NoUsableDisplayConfigurationAvailable) {
     auto mir = std::make_shared<ac::test::mir::MockMir>();
 
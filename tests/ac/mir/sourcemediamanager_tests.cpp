@@ -17,6 +17,8 @@
 
 #include <gmock/gmock.h>
 
+#include <future>
+
 #include "tests/common/glibhelpers.h"
 
 #include "ac/mir/sourcemediamanager.h"
@@ -60,6 +62,11 @@ public:
     MOCK_METHOD0(CreateRendererReport, ac::video::RendererReport::Ptr());
     MOCK_METHOD0(CreatePacketizerReport, ac::video::PacketizerReport::Ptr());
     MOCK_METHOD0(CreateSenderReport, ac::video::SenderReport::Ptr());
+    MOCK_METHOD0(CreateMemoryReport, ac::video::MemoryReport::Ptr());
+    MOCK_METHOD0(CreateJitterBufferReport, ac::video::JitterBufferReport::Ptr());
+    MOCK_METHOD0(CreateThermalReport, ac::video::ThermalReport::Ptr());
+    MOCK_METHOD0(CreatePerfCounterReport, ac::video::PerfCounterReport::Ptr());
+    MOCK_METHOD0(CreateLockReport, ac::video::LockReport::Ptr());
 };
 
 class MockExecutorFactory : public ac::common::ExecutorFactory {
@@ -67,6 +74,12 @@ public:
     MOCK_METHOD1(Create, ac::common::Executor::Ptr(const ac::common::Executable::Ptr&));
 };
 
+class MockCpuLatencyLock : public ac::SystemController::Lock<ac::CpuLatencyState> {
+public:
+    MOCK_METHOD1(Acquire, void(ac::CpuLatencyState));
+    MOCK_METHOD1(Release, void(ac::CpuLatencyState));
+};
+
 class MockExecutor : public ac::common::Executor {
 public:
     MOCK_METHOD0(Start, bool());
@@ -74,9 +87,25 @@ public:
     MOCK_CONST_METHOD0(Running, bool());
 };
 
+class MockSourceMediaManagerDelegate : public ac::BaseSourceMediaManager::Delegate {
+public:
+    MOCK_METHOD0(OnSourceNetworkError, void());
+};
+
 class SourceMediaManagerFixture : public Test {
 public:
+    // Negotiates the format and waits for the setup running in the
+    // background to finish.
     bool Configure(const ac::mir::SourceMediaManager::Ptr &manager) {
+        if (!StartConfigure(manager))
+            return false;
+
+        WaitForSetup(manager);
+
+        return manager->CurrentSetupState() == ac::mir::SourceMediaManager::SetupState::Done;
+    }
+
+    bool StartConfigure(const ac::mir::SourceMediaManager::Ptr &manager) {
         std::vector<wds::H264VideoCodec> sink_supported_codecs;
         wds::RateAndResolutionsBitmap cea_rr;
         wds::RateAndResolutionsBitmap vesa_rr;
@@ -94,6 +123,37 @@ public:
         return manager->InitOptimalVideoFormat(sink_native_format, sink_supported_codecs);
     }
 
+    void WaitForSetup(const ac::mir::SourceMediaManager::Ptr &manager) {
+        while (manager->CurrentSetupState() == ac::mir::SourceMediaManager::SetupState::Pending)
+            ac::testing::RunMainLoopIteration();
+    }
+
+    // Lets the producer setup of the configurations expected from now
+    // on block until the returned promise is set.
+    std::shared_ptr<std::promise<void>> BlockProducerSetup() {
+        auto release = std::make_shared<std::promise<void>>();
+        producer_released = release->get_future().share();
+        producer_entered = std::make_shared<std::promise<void>>();
+        return release;
+    }
+
+    void WaitForProducerSetup() {
+        producer_entered->get_future().wait();
+    }
+
+    void ExpectProducerSetup() {
+        const auto released = producer_released;
+        const auto entered = producer_entered;
+        EXPECT_CALL(*mock_buffer_producer, Setup(_))
+                .WillOnce(InvokeWithoutArgs([released, entered]() {
+                    if (entered)
+                        entered->set_value();
+                    if (released.valid())
+                        released.wait();
+                    return true;
+                }));
+    }
+
     void ExpectCorrectConfiguration() {
         EXPECT_CALL(*mock_executor_factory, Create(_))
                 .Times(4)
@@ -105,8 +165,7 @@ public:
         EXPECT_CALL(*mock_output_stream, MaxUnitSize())
                 .WillOnce(Return(1000));
 
-        EXPECT_CALL(*mock_buffer_producer, Setup(_))
-                .WillOnce(Return(true));
+        ExpectProducerSetup();
 
         EXPECT_CALL(*mock_buffer_producer, OutputMode())
                 .WillRepeatedly(Return(ac::video::DisplayOutput{}));
@@ -128,6 +187,9 @@ public:
 
         EXPECT_CALL(*mock_report_factory, CreatePacketizerReport())
                 .WillOnce(Return(nullptr));
+
+        EXPECT_CALL(*mock_report_factory, CreateMemoryReport())
+                .WillOnce(Return(nullptr));
     }
 
     std::string remote_address = "127.0.0.1";
@@ -137,6 +199,8 @@ public:
     std::shared_ptr<MockOutputStream> mock_output_stream = std::make_shared<MockOutputStream>();
     std::shared_ptr<MockEncoder> mock_encoder = std::make_shared<MockEncoder>();
     std::shared_ptr<MockReportFactory> mock_report_factory = std::make_shared<MockReportFactory>();
+    std::shared_future<void> producer_released;
+    std::shared_ptr<std::promise<void>> producer_entered;
 };
 }
 
@@ -249,6 +313,47 @@ TEST_F(SourceMediaManagerFixture, StateSwitching) {
     EXPECT_TRUE(manager->IsPaused());
 }
 
+TEST_F(SourceMediaManagerFixture, HoldsLowCpuLatencyOnlyWhilePlaying) {
+    ExpectCorrectConfiguration();
+
+    EXPECT_CALL(*mock_executor, Start())
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*mock_executor, Stop())
+            .WillRepeatedly(Return(true));
+
+    const auto latency_lock = std::make_shared<MockCpuLatencyLock>();
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory,
+                nullptr,
+                nullptr,
+                latency_lock);
+
+    EXPECT_TRUE(Configure(manager));
+
+    {
+        InSequence s;
+        EXPECT_CALL(*latency_lock, Acquire(ac::CpuLatencyState::Low));
+        EXPECT_CALL(*latency_lock, Release(ac::CpuLatencyState::Low));
+        EXPECT_CALL(*latency_lock, Acquire(ac::CpuLatencyState::Low));
+        EXPECT_CALL(*latency_lock, Release(ac::CpuLatencyState::Low));
+    }
+
+    manager->Play();
+    // Already playing; nothing to request again
+    manager->Play();
+    manager->Pause();
+    manager->Pause();
+
+    manager->Play();
+    manager->Teardown();
+}
+
 TEST_F(SourceMediaManagerFixture, SendsIDRPicture) {
     const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
                 remote_address,
@@ -263,3 +368,257 @@ TEST_F(SourceMediaManagerFixture, SendsIDRPicture) {
 
     manager->SendIDRPicture();
 }
+
+TEST_F(SourceMediaManagerFixture, PicksEncoderForNegotiatedFormat) {
+    ExpectCorrectConfiguration();
+
+    EXPECT_CALL(*mock_report_factory, CreateEncoderReport())
+            .WillOnce(Return(nullptr));
+
+    auto registry = ac::video::EncoderRegistry::Create();
+    registry->Register("mock", "1",
+                       [](ac::video::EncoderRegistry::Capabilities *capabilities) {
+                           capabilities->profiles = { 66 };
+                           capabilities->max_level = 42;
+                           capabilities->max_width = 1920;
+                           capabilities->max_height = 1080;
+                           capabilities->max_framerate = 60;
+                           return true;
+                       },
+                       [&](const ac::video::EncoderReport::Ptr&) {
+                           return mock_encoder;
+                       });
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                nullptr,
+                mock_output_stream,
+                mock_report_factory,
+                registry);
+
+    EXPECT_TRUE(Configure(manager));
+}
+
+TEST_F(SourceMediaManagerFixture, ConfigureFailsWithoutSuitableEncoder) {
+    EXPECT_CALL(*mock_output_stream, Connect(remote_address, _))
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*mock_buffer_producer, Setup(_))
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*mock_report_factory, CreateEncoderReport())
+            .WillOnce(Return(nullptr));
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                nullptr,
+                mock_output_stream,
+                mock_report_factory,
+                ac::video::EncoderRegistry::Create());
+
+    EXPECT_FALSE(Configure(manager));
+}
+
+TEST_F(SourceMediaManagerFixture, ConfigureDoesNotWaitForSetup) {
+    const auto release = BlockProducerSetup();
+    ExpectCorrectConfiguration();
+
+    EXPECT_CALL(*mock_output_stream, LocalPort())
+            .WillOnce(Return(1234));
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+
+    EXPECT_TRUE(StartConfigure(manager));
+    EXPECT_EQ(ac::mir::SourceMediaManager::SetupState::Pending, manager->CurrentSetupState());
+
+    // The sink is told about our port before the setup is done
+    EXPECT_EQ(1234, manager->GetLocalRtpPort());
+
+    release->set_value();
+    WaitForSetup(manager);
+
+    EXPECT_EQ(ac::mir::SourceMediaManager::SetupState::Done, manager->CurrentSetupState());
+}
+
+TEST_F(SourceMediaManagerFixture, FailedSetupIsReportedToDelegate) {
+    EXPECT_CALL(*mock_output_stream, Connect(remote_address, _))
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*mock_buffer_producer, Setup(_))
+            .WillOnce(Return(false));
+
+    EXPECT_CALL(*mock_executor_factory, Create(_))
+            .Times(0);
+
+    const auto delegate = std::make_shared<MockSourceMediaManagerDelegate>();
+    EXPECT_CALL(*delegate, OnSourceNetworkError())
+            .Times(1);
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+    manager->SetDelegate(delegate);
+
+    EXPECT_TRUE(StartConfigure(manager));
+    WaitForSetup(manager);
+
+    EXPECT_EQ(ac::mir::SourceMediaManager::SetupState::Failed, manager->CurrentSetupState());
+}
+
+TEST_F(SourceMediaManagerFixture, StartsPipelineOnceSetupIsDone) {
+    const auto release = BlockProducerSetup();
+    ExpectCorrectConfiguration();
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+
+    EXPECT_TRUE(StartConfigure(manager));
+
+    EXPECT_CALL(*mock_executor, Start())
+            .Times(0);
+
+    // The delayed start passes while we are still busy
+    manager->Play();
+    ac::testing::RunMainLoop(std::chrono::seconds{1});
+    EXPECT_FALSE(manager->IsPaused());
+    Mock::VerifyAndClearExpectations(mock_executor.get());
+
+    EXPECT_CALL(*mock_executor, Start())
+            .Times(4)
+            .WillRepeatedly(Return(true));
+    EXPECT_CALL(*mock_executor, Stop())
+            .Times(4)
+            .WillRepeatedly(Return(true));
+
+    release->set_value();
+    WaitForSetup(manager);
+
+    manager->Teardown();
+}
+
+TEST_F(SourceMediaManagerFixture, TearsDownInsteadOfRestartingHungPipeline) {
+    ExpectCorrectConfiguration();
+
+    const auto delegate = std::make_shared<MockSourceMediaManagerDelegate>();
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+    manager->SetDelegate(delegate);
+
+    EXPECT_TRUE(Configure(manager));
+
+    EXPECT_CALL(*mock_executor, Start())
+            .Times(4)
+            .WillRepeatedly(Return(true));
+
+    manager->Play();
+    ac::testing::RunMainLoop(std::chrono::seconds{1});
+    Mock::VerifyAndClearExpectations(mock_executor.get());
+
+    // A stage is stuck and has to be left behind; it must not be
+    // started a second time.
+    EXPECT_CALL(*mock_executor, Stop())
+            .WillRepeatedly(Return(false));
+    EXPECT_CALL(*mock_executor, Start())
+            .Times(0);
+    EXPECT_CALL(*delegate, OnSourceNetworkError())
+            .Times(1);
+
+    manager->OnStallAction(ac::common::StallWatchdog::Action::kRestartEncoder);
+
+    Mock::VerifyAndClearExpectations(delegate.get());
+}
+
+TEST_F(SourceMediaManagerFixture, TeardownCancelsPendingSetup) {
+    EXPECT_CALL(*mock_output_stream, Connect(remote_address, _))
+            .WillOnce(Return(true));
+
+    const auto release = BlockProducerSetup();
+    ExpectProducerSetup();
+
+    // Nothing past the producer is set up anymore
+    EXPECT_CALL(*mock_encoder, Configure(_))
+            .Times(0);
+    EXPECT_CALL(*mock_executor_factory, Create(_))
+            .Times(0);
+
+    const auto delegate = std::make_shared<MockSourceMediaManagerDelegate>();
+    EXPECT_CALL(*delegate, OnSourceNetworkError())
+            .Times(0);
+
+    const auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+    manager->SetDelegate(delegate);
+
+    EXPECT_TRUE(StartConfigure(manager));
+    WaitForProducerSetup();
+
+    manager->Play();
+    manager->Teardown();
+
+    EXPECT_EQ(ac::mir::SourceMediaManager::SetupState::Idle, manager->CurrentSetupState());
+
+    release->set_value();
+    ac::testing::RunMainLoop(std::chrono::seconds{1});
+
+    EXPECT_EQ(ac::mir::SourceMediaManager::SetupState::Idle, manager->CurrentSetupState());
+    EXPECT_TRUE(manager->IsPaused());
+}
+
+TEST_F(SourceMediaManagerFixture, SetupOutlivesDestroyedManager) {
+    EXPECT_CALL(*mock_output_stream, Connect(remote_address, _))
+            .WillOnce(Return(true));
+
+    const auto release = BlockProducerSetup();
+    ExpectProducerSetup();
+
+    EXPECT_CALL(*mock_encoder, Configure(_))
+            .Times(0);
+    EXPECT_CALL(*mock_executor_factory, Create(_))
+            .Times(0);
+
+    auto manager = std::make_shared<ac::mir::SourceMediaManager>(
+                remote_address,
+                mock_executor_factory,
+                mock_buffer_producer,
+                mock_encoder,
+                mock_output_stream,
+                mock_report_factory);
+
+    EXPECT_TRUE(StartConfigure(manager));
+    WaitForProducerSetup();
+
+    manager.reset();
+
+    release->set_value();
+    ac::testing::RunMainLoop(std::chrono::seconds{1});
+}
@@ -18,18 +18,28 @@
 #include <gmock/gmock.h>
 
 #include <atomic>
+#include <fstream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
 
 #include "ac/mir/streamrenderer.h"
 
 using namespace ::testing;
 
 namespace {
+// 60 Hz display streamed with 30 fps
+static constexpr ac::TimestampUs kRefreshInterval{16667};
+static constexpr ac::TimestampUs kFrameInterval{2 * kRefreshInterval};
+
 class MockBufferProducer : public ac::video::BufferProducer {
 public:
     MOCK_METHOD1(Setup, bool(const ac::video::DisplayOutput&));
     MOCK_METHOD0(SwapBuffers, void());
     MOCK_CONST_METHOD0(CurrentBuffer, void*());
     MOCK_CONST_METHOD0(OutputMode, ac::video::DisplayOutput());
+    MOCK_CONST_METHOD0(CurrentTimestamp, ac::TimestampUs());
+    MOCK_CONST_METHOD0(RefreshInterval, ac::TimestampUs());
 };
 
 class MockEncoder : public ac::video::BaseEncoder {
@@ -40,6 +50,7 @@ public:
     MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
     MOCK_CONST_METHOD0(Running, bool());
     MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_METHOD1(SetBitrate, bool(unsigned int));
     MOCK_CONST_METHOD0(Name, std::string());
     MOCK_METHOD0(Start, bool());
     MOCK_METHOD0(Stop, bool());
@@ -65,6 +76,10 @@ public:
 
         EXPECT_CALL(*mock_buffer_producer, OutputMode())
                 .WillRepeatedly(Return(output_mode));
+        EXPECT_CALL(*mock_buffer_producer, CurrentTimestamp())
+                .WillRepeatedly(Return(0));
+        EXPECT_CALL(*mock_buffer_producer, RefreshInterval())
+                .WillRepeatedly(Return(0));
 
         ac::video::BaseEncoder::Config encoder_config{};
         // Need to set a framerate here as otherwise the renderer will sleep
@@ -75,6 +90,31 @@ public:
                 .WillRepeatedly(Return(encoder_config));
     }
 
+    // Hands buffers right back to the renderer and remembers their
+    // timestamps.
+    std::vector<ac::TimestampUs> CaptureTimestamps(const ac::mir::StreamRenderer::Ptr &renderer, int count) {
+        std::vector<ac::TimestampUs> timestamps;
+
+        EXPECT_CALL(*mock_renderer_report, BeganFrame())
+                .Times(count);
+        EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+                .Times(count);
+        EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+                .Times(count);
+        EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+                .WillRepeatedly(Return(reinterpret_cast<void*>(1)));
+        EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+                .WillRepeatedly(Invoke([&](const ac::video::Buffer::Ptr &buffer) {
+                    timestamps.push_back(buffer->Timestamp());
+                    renderer->OnBufferFinished(buffer);
+                }));
+
+        for (int n = 0; n < count; n++)
+            EXPECT_TRUE(renderer->Execute());
+
+        return timestamps;
+    }
+
     std::shared_ptr<MockBufferProducer> mock_buffer_producer;
     std::shared_ptr<MockEncoder> mock_encoder;
     std::shared_ptr<MockRendererReport> mock_renderer_report;
@@ -238,3 +278,159 @@ TEST_F(StreamRendererFixture, KeepsExecutingWhenNoFreeSlots) {
 
     EXPECT_EQ(2, buffers->Size());
 }
+
+TEST_F(StreamRendererFixture, CapturesOnEveryOtherRefresh) {
+    ExpectValidConfiguration();
+
+    EXPECT_CALL(*mock_buffer_producer, RefreshInterval())
+            .WillRepeatedly(Return(kRefreshInterval));
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+
+    const auto start = ac::Utils::GetNowUs();
+    const auto timestamps = CaptureTimestamps(renderer, 6);
+    const auto duration = ac::Utils::GetNowUs() - start;
+
+    // Timestamps stay on the refresh aligned grid even though the time
+    // we capture at jitters.
+    for (std::size_t n = 1; n < timestamps.size(); n++) {
+        EXPECT_LT(timestamps[n - 1], timestamps[n]);
+        EXPECT_EQ(0, (timestamps[n] - timestamps[0]) % kFrameInterval);
+    }
+
+    // Waiting for the next frame doesn't add up the time spent in
+    // capturing the current one.
+    EXPECT_LE(6 * kFrameInterval - kRefreshInterval, duration);
+    EXPECT_GE(6 * kFrameInterval + kFrameInterval, duration);
+}
+
+TEST_F(StreamRendererFixture, UsesProducerTimestamps) {
+    ExpectValidConfiguration();
+
+    static constexpr ac::TimestampUs kStart{1000000};
+
+    EXPECT_CALL(*mock_buffer_producer, RefreshInterval())
+            .WillRepeatedly(Return(kRefreshInterval));
+    EXPECT_CALL(*mock_buffer_producer, CurrentTimestamp())
+            .WillOnce(Return(kStart))
+            .WillOnce(Return(kStart + 33000))
+            .WillOnce(Return(kStart + 67500))
+            .WillOnce(Return(kStart + 99000));
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report);
+
+    const auto timestamps = CaptureTimestamps(renderer, 4);
+
+    ASSERT_EQ(4, timestamps.size());
+    EXPECT_EQ(kStart, timestamps[0]);
+    EXPECT_EQ(kStart + kFrameInterval, timestamps[1]);
+    EXPECT_EQ(kStart + 2 * kFrameInterval, timestamps[2]);
+    EXPECT_EQ(kStart + 3 * kFrameInterval, timestamps[3]);
+}
+
+TEST_F(StreamRendererFixture, HalvesFramerateWhenRunningHot) {
+    ExpectValidConfiguration();
+
+    const auto root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(root / "thermal_zone0");
+    std::ofstream(((root / "thermal_zone0") / "temp").string()) << 72000;
+
+    // 13 degrees below the default trip point
+    const auto thermal = ac::video::ThermalGovernor::Create(root.string());
+    EXPECT_TRUE(thermal->Update());
+    EXPECT_EQ(ac::video::ThermalGovernor::Level::kReduceFramerate, thermal->CurrentLevel());
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report,
+                thermal);
+
+    EXPECT_CALL(*mock_renderer_report, BeganFrame())
+            .Times(3);
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+            .Times(3);
+    EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+            .Times(3);
+    EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+            .WillRepeatedly(Return(reinterpret_cast<void*>(1)));
+    EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+            .WillRepeatedly(Invoke([&](const ac::video::Buffer::Ptr &buffer) {
+                renderer->OnBufferFinished(buffer);
+            }));
+
+    for (int n = 0; n < 6; n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    boost::filesystem::remove_all(root);
+}
+
+TEST_F(StreamRendererFixture, RestoresBitrateWhenCooledDown) {
+    ExpectValidConfiguration();
+
+    static constexpr unsigned int kBitrate{5000000};
+
+    // Encoder takes the new bitrate over into its configuration
+    ac::video::BaseEncoder::Config encoder_config{};
+    encoder_config.framerate = 30;
+    encoder_config.bitrate = kBitrate;
+
+    EXPECT_CALL(*mock_encoder, Configuration())
+            .WillRepeatedly(ReturnPointee(&encoder_config));
+    EXPECT_CALL(*mock_encoder, SetBitrate(_))
+            .Times(2)
+            .WillRepeatedly(Invoke([&](unsigned int bitrate) {
+                encoder_config.bitrate = bitrate;
+                return true;
+            }));
+
+    const auto root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(root / "thermal_zone0");
+    const auto temp = ((root / "thermal_zone0") / "temp").string();
+    std::ofstream(temp) << 77000;
+
+    const auto thermal = ac::video::ThermalGovernor::Create(root.string());
+    EXPECT_TRUE(thermal->Update());
+    EXPECT_EQ(ac::video::ThermalGovernor::Level::kReduceBitrate, thermal->CurrentLevel());
+
+    const auto renderer = std::make_shared<ac::mir::StreamRenderer>(
+                mock_buffer_producer,
+                mock_encoder,
+                mock_renderer_report,
+                thermal);
+
+    EXPECT_CALL(*mock_renderer_report, BeganFrame())
+            .Times(AnyNumber());
+    EXPECT_CALL(*mock_renderer_report, FinishedFrame(_))
+            .Times(AnyNumber());
+    EXPECT_CALL(*mock_buffer_producer, SwapBuffers())
+            .Times(AnyNumber());
+    EXPECT_CALL(*mock_buffer_producer, CurrentBuffer())
+            .WillRepeatedly(Return(reinterpret_cast<void*>(1)));
+    EXPECT_CALL(*mock_encoder, QueueBuffer(_))
+            .WillRepeatedly(Invoke([&](const ac::video::Buffer::Ptr &buffer) {
+                renderer->OnBufferFinished(buffer);
+            }));
+
+    for (int n = 0; n < 2; n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    EXPECT_GT(kBitrate, encoder_config.bitrate);
+
+    std::ofstream(temp) << 40000;
+    EXPECT_TRUE(thermal->Update());
+    EXPECT_EQ(ac::video::ThermalGovernor::Level::kNone, thermal->CurrentLevel());
+
+    for (int n = 0; n < 2; n++)
+        EXPECT_TRUE(renderer->Execute());
+
+    EXPECT_EQ(kBitrate, encoder_config.bitrate);
+
+    boost::filesystem::remove_all(root);
+}
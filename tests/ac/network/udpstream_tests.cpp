@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "ac/network/udpstream.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kPacketCount{10};
+static constexpr unsigned int kPacketSize{1316};
+static constexpr std::chrono::milliseconds kTimestampTimeout{2000};
+
+class LoopbackSink {
+public:
+    LoopbackSink() :
+        socket_(::socket(AF_INET, SOCK_DGRAM, 0)),
+        port_(0) {
+
+        struct sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        ::bind(socket_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+
+        socklen_t length = sizeof(addr);
+        ::getsockname(socket_, reinterpret_cast<struct sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+    }
+
+    ~LoopbackSink() {
+        ::close(socket_);
+    }
+
+    ac::network::Port Port() const {
+        return port_;
+    }
+
+private:
+    int socket_;
+    ac::network::Port port_;
+};
+
+// The socket a stream writes through, so that we can write past it
+int FindSocketOf(const ac::network::UdpStream &stream) {
+    for (int fd = 3; fd < 1024; fd++) {
+        struct sockaddr_in addr;
+        socklen_t length = sizeof(addr);
+        if (::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &length) < 0)
+            continue;
+
+        if (addr.sin_family == AF_INET && ntohs(addr.sin_port) == stream.LocalPort())
+            return fd;
+    }
+    return -1;
+}
+
+std::vector<ac::network::Stream::TransmitTimestamp> WaitForTimestamps(ac::network::UdpStream &stream,
+                                                                      std::size_t count) {
+    std::vector<ac::network::Stream::TransmitTimestamp> timestamps;
+    const auto deadline = std::chrono::steady_clock::now() + kTimestampTimeout;
+    while (timestamps.size() < count && std::chrono::steady_clock::now() < deadline) {
+        for (const auto &timestamp : stream.ReadTransmitTimestamps())
+            timestamps.push_back(timestamp);
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    return timestamps;
+}
+}
+
+TEST(UdpStream, HasNoTransmitTimestampsByDefault) {
+    LoopbackSink sink;
+    ac::network::UdpStream stream;
+
+    ASSERT_TRUE(stream.Connect("127.0.0.1", sink.Port()));
+
+    std::vector<std::uint8_t> packet(kPacketSize, 0x47);
+    EXPECT_EQ(ac::network::Stream::Error::kNone, stream.Write(packet.data(), packet.size(), 1000));
+
+    EXPECT_EQ(0, WaitForTimestamps(stream, 1).size());
+}
+
+TEST(UdpStream, CorrelatesTransmitTimestampsWithPackets) {
+    LoopbackSink sink;
+
+    ac::network::UdpStream::Config config;
+    config.transmit_timestamps = true;
+    ac::network::UdpStream stream(config);
+
+    ASSERT_TRUE(stream.Connect("127.0.0.1", sink.Port()));
+
+    std::vector<std::uint8_t> packet(kPacketSize, 0x47);
+    for (unsigned int n = 0; n < kPacketCount; n++)
+        EXPECT_EQ(ac::network::Stream::Error::kNone,
+                  stream.Write(packet.data(), packet.size(), (n + 1) * 1000));
+
+    // Loopback has no hardware timestamps but every packet passes the
+    // packet scheduler and the driver.
+    const auto timestamps = WaitForTimestamps(stream, kPacketCount * 2);
+    ASSERT_EQ(kPacketCount * 2, timestamps.size());
+
+    std::vector<ac::TimestampUs> scheduled, sent;
+    for (const auto &timestamp : timestamps) {
+        EXPECT_GE(timestamp.delay, 0);
+        EXPECT_LT(timestamp.delay, std::chrono::duration_cast<std::chrono::microseconds>(kTimestampTimeout).count());
+
+        if (timestamp.point == ac::network::Stream::TransmitPoint::kScheduled)
+            scheduled.push_back(timestamp.timestamp);
+        else if (timestamp.point == ac::network::Stream::TransmitPoint::kSoftware)
+            sent.push_back(timestamp.timestamp);
+    }
+
+    ASSERT_EQ(kPacketCount, scheduled.size());
+    ASSERT_EQ(kPacketCount, sent.size());
+
+    std::sort(scheduled.begin(), scheduled.end());
+    std::sort(sent.begin(), sent.end());
+    for (unsigned int n = 0; n < kPacketCount; n++) {
+        EXPECT_EQ((n + 1) * 1000, scheduled[n]);
+        EXPECT_EQ((n + 1) * 1000, sent[n]);
+    }
+}
+
+TEST(UdpStream, ResynchronizesWithIdsUsedUpByOthers) {
+    LoopbackSink sink;
+
+    ac::network::UdpStream::Config config;
+    config.transmit_timestamps = true;
+    ac::network::UdpStream stream(config);
+
+    ASSERT_TRUE(stream.Connect("127.0.0.1", sink.Port()));
+
+    const auto socket = FindSocketOf(stream);
+    ASSERT_LE(0, socket);
+
+    std::vector<std::uint8_t> packet(kPacketSize, 0x47);
+    for (unsigned int n = 0; n < kPacketCount; n++) {
+        // Uses up an id like a failed write might, but gets its own
+        // timestamps which mustn't be taken for ours.
+        if (n == kPacketCount / 2) {
+            ASSERT_EQ(packet.size(), ::send(socket, packet.data(), packet.size(), 0));
+        }
+
+        EXPECT_EQ(ac::network::Stream::Error::kNone,
+                  stream.Write(packet.data(), packet.size(), (n + 1) * 1000));
+    }
+
+    const auto timestamps = WaitForTimestamps(stream, kPacketCount * 2);
+    ASSERT_EQ(kPacketCount * 2, timestamps.size());
+
+    std::vector<ac::TimestampUs> scheduled, sent;
+    for (const auto &timestamp : timestamps) {
+        EXPECT_GE(timestamp.delay, 0);
+
+        if (timestamp.point == ac::network::Stream::TransmitPoint::kScheduled)
+            scheduled.push_back(timestamp.timestamp);
+        else if (timestamp.point == ac::network::Stream::TransmitPoint::kSoftware)
+            sent.push_back(timestamp.timestamp);
+    }
+
+    ASSERT_EQ(kPacketCount, scheduled.size());
+    ASSERT_EQ(kPacketCount, sent.size());
+
+    for (unsigned int n = 0; n < kPacketCount; n++) {
+        EXPECT_EQ((n + 1) * 1000, scheduled[n]);
+        EXPECT_EQ((n + 1) * 1000, sent[n]);
+    }
+}
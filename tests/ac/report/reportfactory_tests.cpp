@@ -45,3 +45,14 @@ TEST_F(ReportFactoryFixture, InvalidTypesGiveNull) {
     ExceptCorrectType<ac::report::NullReportFactory>("lalalal");
     ExceptCorrectType<ac::report::NullReportFactory>("12343asd123");
 }
+
+TEST_F(ReportFactoryFixture, PerfCountersAreDisabledByDefault) {
+    unsetenv("AETHERCAST_REPORT_PERF_COUNTERS");
+    EXPECT_FALSE(ac::report::LoggingReportFactory().CreatePerfCounterReport());
+
+    setenv("AETHERCAST_REPORT_PERF_COUNTERS", "1", 1);
+    EXPECT_TRUE(!!ac::report::LoggingReportFactory().CreatePerfCounterReport());
+    // Nothing would ever look at them
+    EXPECT_FALSE(ac::report::NullReportFactory().CreatePerfCounterReport());
+    unsetenv("AETHERCAST_REPORT_PERF_COUNTERS");
+}
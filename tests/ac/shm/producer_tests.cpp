@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "ac/shm/client.h"
+#include "ac/shm/producer.h"
+
+#include "ac/video/convertingencoder.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kWidth{64};
+static constexpr unsigned int kHeight{32};
+
+class MockEncoder : public ac::video::BaseEncoder {
+public:
+    MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
+    MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
+    MOCK_CONST_METHOD0(Running, bool());
+    MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_CONST_METHOD0(Name, std::string());
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+};
+
+std::string SocketPath() {
+    return ac::Utils::Sprintf("/tmp/aethercast-shm-test-%d", ::getpid());
+}
+
+ac::video::DisplayOutput Output(unsigned int width = kWidth, unsigned int height = kHeight) {
+    return ac::video::DisplayOutput{ac::video::DisplayOutput::Mode::kExtend, width, height, 60.0};
+}
+
+// The producer only starts listening in Setup so keep trying for a while
+ac::shm::Client::Ptr ConnectClient(unsigned int width = kWidth, unsigned int height = kHeight) {
+    for (int n = 0; n < 100; n++) {
+        if (::access(SocketPath().c_str(), F_OK) == 0) {
+            auto client = ac::shm::Client::Connect(SocketPath(), width, height);
+            if (client)
+                return client;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    return nullptr;
+}
+
+void FillSlot(const ac::shm::Client::Ptr &client, int slot, std::uint8_t value) {
+    ::memset(client->SlotData(slot), value, client->Stride() * kHeight);
+}
+}
+
+TEST(SharedMemoryProducer, FramesArriveWithoutCopies) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() { return ConnectClient(); });
+    EXPECT_TRUE(producer->Setup(Output()));
+    auto client = client_future.get();
+    ASSERT_NE(nullptr, client);
+
+    EXPECT_EQ(nullptr, producer->CurrentBuffer());
+    EXPECT_EQ(0, producer->CurrentTimestamp());
+    EXPECT_EQ(16666, producer->RefreshInterval());
+
+    const auto slot = client->DequeueSlot(0);
+    ASSERT_LE(0, slot);
+    FillSlot(client, slot, 0xab);
+    EXPECT_TRUE(client->QueueSlot(slot, 1234));
+
+    producer->SwapBuffers();
+
+    auto frame = reinterpret_cast<ac::shm::Producer::Frame*>(producer->CurrentBuffer());
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(slot, static_cast<int>(frame->slot));
+    EXPECT_EQ(kWidth, frame->width);
+    EXPECT_EQ(kHeight, frame->height);
+    EXPECT_EQ(client->Stride(), frame->stride);
+    EXPECT_EQ(1234, frame->timestamp);
+    EXPECT_EQ(1234, producer->CurrentTimestamp());
+    EXPECT_EQ(0xab, frame->data[0]);
+    EXPECT_EQ(0xab, frame->data[frame->stride * kHeight - 1]);
+
+    // Both sides look at the very same memory
+    client->SlotData(slot)[0] = 0xcd;
+    EXPECT_EQ(0xcd, frame->data[0]);
+}
+
+TEST(SharedMemoryProducer, FramesCanBeConvertedForEncoding) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() { return ConnectClient(); });
+    EXPECT_TRUE(producer->Setup(Output()));
+    auto client = client_future.get();
+    ASSERT_NE(nullptr, client);
+
+    const auto slot = client->DequeueSlot(0);
+    ASSERT_LE(0, slot);
+    FillSlot(client, slot, 0xff);
+    EXPECT_TRUE(client->QueueSlot(slot, 1234));
+
+    producer->SwapBuffers();
+
+    auto encoder = std::make_shared<MockEncoder>();
+
+    ac::video::ColorConverter::Config conversion;
+    conversion.source_width = kWidth;
+    conversion.source_height = kHeight;
+    conversion.source_stride = client->Stride();
+    auto converting_encoder = ac::video::ConvertingEncoder::Create(encoder, conversion);
+
+    ac::video::BaseEncoder::Config config;
+    config.width = kWidth;
+    config.height = kHeight;
+
+    EXPECT_CALL(*encoder, Configure(_))
+            .WillOnce(Return(true));
+    EXPECT_TRUE(converting_encoder->Configure(config));
+
+    ac::video::Buffer::Ptr output;
+    EXPECT_CALL(*encoder, QueueBuffer(_))
+            .WillOnce(SaveArg<0>(&output));
+
+    auto input = producer->CreateBuffer();
+    EXPECT_EQ(producer->CurrentBuffer(), input->NativeHandle());
+    converting_encoder->QueueBuffer(input);
+
+    ASSERT_NE(nullptr, output);
+    EXPECT_EQ(kWidth * kHeight * 3 / 2, output->Length());
+    // White in limited range
+    EXPECT_EQ(235, output->Data()[0]);
+    EXPECT_EQ(128, output->Data()[kWidth * kHeight]);
+}
+
+TEST(SharedMemoryProducer, ReleasesSlotsNotInUseAnymore) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() { return ConnectClient(); });
+    EXPECT_TRUE(producer->Setup(Output()));
+    auto client = client_future.get();
+    ASSERT_NE(nullptr, client);
+
+    for (int n = 0; n < static_cast<int>(ac::shm::Client::kDefaultSlotCount); n++) {
+        EXPECT_EQ(n, client->DequeueSlot(0));
+        EXPECT_TRUE(client->QueueSlot(n, n));
+    }
+
+    EXPECT_EQ(-1, client->DequeueSlot(0));
+
+    // Only the most recent frame is kept and all others come back
+    producer->SwapBuffers();
+
+    auto frame = reinterpret_cast<ac::shm::Producer::Frame*>(producer->CurrentBuffer());
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(2u, frame->slot);
+
+    EXPECT_EQ(0, client->DequeueSlot(1000));
+    EXPECT_TRUE(client->QueueSlot(0, 3));
+    EXPECT_EQ(1, client->DequeueSlot(1000));
+    EXPECT_TRUE(client->QueueSlot(1, 4));
+    EXPECT_EQ(-1, client->DequeueSlot(0));
+
+    // The slot we had so far is released once the next one is current
+    producer->SwapBuffers();
+
+    frame = reinterpret_cast<ac::shm::Producer::Frame*>(producer->CurrentBuffer());
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(1u, frame->slot);
+
+    EXPECT_EQ(0, client->DequeueSlot(1000));
+    EXPECT_TRUE(client->QueueSlot(0, 5));
+    EXPECT_EQ(2, client->DequeueSlot(1000));
+}
+
+TEST(SharedMemoryProducer, KeepsCurrentFrameWithoutNewOne) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() { return ConnectClient(); });
+    EXPECT_TRUE(producer->Setup(Output()));
+    auto client = client_future.get();
+    ASSERT_NE(nullptr, client);
+
+    EXPECT_TRUE(client->QueueSlot(client->DequeueSlot(0), 1));
+    producer->SwapBuffers();
+
+    const auto frame = producer->CurrentBuffer();
+    EXPECT_NE(nullptr, frame);
+
+    producer->SwapBuffers();
+    EXPECT_EQ(frame, producer->CurrentBuffer());
+
+    // Even without the client we keep the last frame around
+    client.reset();
+    producer->SwapBuffers();
+    EXPECT_EQ(frame, producer->CurrentBuffer());
+}
+
+TEST(SharedMemoryProducer, RejectsMismatchingFrameSize) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() { return ConnectClient(kWidth * 2, kHeight); });
+    EXPECT_FALSE(producer->Setup(Output()));
+    EXPECT_EQ(nullptr, client_future.get());
+}
+
+TEST(SharedMemoryProducer, RejectsUnsealedMemory) {
+    auto producer = ac::shm::Producer::Create(SocketPath());
+
+    auto client_future = std::async(std::launch::async, []() {
+        while (::access(SocketPath().c_str(), F_OK) != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        struct sockaddr_un addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        ::strncpy(addr.sun_path, SocketPath().c_str(), sizeof(addr.sun_path) - 1);
+
+        int sock = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (::connect(sock, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            ::close(sock);
+            return false;
+        }
+
+        const auto size = kWidth * 4 * kHeight;
+        int fd = ::syscall(__NR_memfd_create, "unsealed", 0);
+        EXPECT_EQ(0, ::ftruncate(fd, size));
+
+        ac::shm::protocol::Hello hello;
+        hello.type = ac::shm::protocol::MessageType::kHello;
+        hello.magic = ac::shm::protocol::kMagic;
+        hello.version = ac::shm::protocol::kVersion;
+        hello.memory = ac::shm::protocol::MemoryType::kMemFd;
+        hello.format = ac::shm::protocol::PixelFormat::kRGBA8888;
+        hello.width = kWidth;
+        hello.height = kHeight;
+        hello.stride = kWidth * 4;
+        hello.slot_count = 1;
+        hello.slot_size = size;
+        ac::shm::protocol::Send(sock, &hello, sizeof(hello), fd);
+        ::close(fd);
+
+        ac::shm::protocol::Welcome welcome;
+        welcome.accepted = 0;
+        ac::shm::protocol::Receive(sock, &welcome, sizeof(welcome), 5000);
+        ::close(sock);
+
+        return welcome.accepted != 0;
+    });
+
+    EXPECT_FALSE(producer->Setup(Output()));
+    EXPECT_FALSE(client_future.get());
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "ac/report/null/jitterbufferreport.h"
+
+#include "ac/streaming/jitterbuffer.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::chrono::milliseconds kNoWait{0};
+static constexpr std::chrono::milliseconds kWait{100};
+static constexpr std::size_t kTracePacketCount{6000};
+static constexpr ac::TimestampUs kTraceStart{1000000};
+
+ac::video::Buffer::Ptr PacketWithId(std::uint8_t id, ac::TimestampUs arrival = ac::Utils::GetNowUs()) {
+    auto packet = ac::video::Buffer::Create(1, arrival);
+    packet->Data()[0] = id;
+    return packet;
+}
+
+int IdOf(const ac::video::Buffer::Ptr &packet) {
+    return packet ? packet->Data()[0] : -1;
+}
+
+ac::streaming::JitterBuffer::Ptr CreateBuffer(const ac::streaming::JitterBuffer::Config &config =
+        ac::streaming::JitterBuffer::Config{}) {
+    return ac::streaming::JitterBuffer::Create(std::make_shared<ac::report::null::JitterBufferReport>(), config);
+}
+
+class MockJitterBufferReport : public ac::video::JitterBufferReport {
+public:
+    MOCK_METHOD2(DeliveredPacket, void(const uint16_t&, const int64_t&));
+    MOCK_METHOD1(LatePacket, void(const uint16_t&));
+    MOCK_METHOD1(DuplicatePacket, void(const uint16_t&));
+    MOCK_METHOD2(LostPackets, void(const uint16_t&, const size_t&));
+    MOCK_METHOD1(TargetDelayChanged, void(const int64_t&));
+};
+
+// Packets of a 30 fps stream with 20 packets per frame as seen by the
+// receiver. Like our RTPSender the sender stamps each packet with the
+// time it was sent. There are no captures of real impairments around so
+// the traces are generated from a fixed seed instead.
+struct TracePacket {
+    std::uint16_t sequence_number;
+    std::uint32_t rtp_timestamp;
+    ac::TimestampUs arrival;
+};
+
+class Trace {
+public:
+    Trace() : random_(42) {
+    }
+
+    static std::uint32_t RtpTimestampOf(std::size_t n) {
+        return SentAt(n) * 9 / 100;
+    }
+
+    static ac::TimestampUs SentAt(std::size_t n) {
+        return kTraceStart + (n / 20) * 33333 + (n % 20) * 500;
+    }
+
+    // No impairments apart from a constant network delay
+    std::vector<TracePacket> Clean() {
+        std::vector<TracePacket> packets;
+        for (std::size_t n = 0; n < kTracePacketCount; n++)
+            packets.push_back(TracePacket{static_cast<std::uint16_t>(n), RtpTimestampOf(n), SentAt(n) + 2000});
+        return packets;
+    }
+
+    // Typical WiFi behaviour: a few ms of jitter and every other second a
+    // spike where packets queue up behind a retransmission for 30 ms.
+    std::vector<TracePacket> WiFi() {
+        std::exponential_distribution<double> jitter(1.0 / 2000);
+        std::vector<TracePacket> packets;
+        ac::TimestampUs last = 0;
+        for (std::size_t n = 0; n < kTracePacketCount; n++) {
+            auto arrival = SentAt(n) + 2000 + static_cast<ac::TimestampUs>(jitter(random_));
+            if ((n / 20) % 60 == 30 && n % 20 < 10)
+                arrival += 30000;
+            // A queue doesn't reorder
+            arrival = std::max(arrival, last);
+            last = arrival;
+            packets.push_back(TracePacket{static_cast<std::uint16_t>(n), RtpTimestampOf(n), arrival});
+        }
+        return packets;
+    }
+
+    // Gilbert-Elliott model with 1% loss in the good and 30% in the bad state
+    std::vector<TracePacket> BurstyLoss(std::size_t *dropped) {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::vector<TracePacket> packets;
+        bool bad = false;
+        *dropped = 0;
+        for (std::size_t n = 0; n < kTracePacketCount; n++) {
+            bad = bad ? uniform(random_) > 0.2 : uniform(random_) < 0.01;
+            if (uniform(random_) < (bad ? 0.3 : 0.01)) {
+                (*dropped)++;
+                continue;
+            }
+            packets.push_back(TracePacket{static_cast<std::uint16_t>(n), RtpTimestampOf(n), SentAt(n) + 2000});
+        }
+        return packets;
+    }
+
+    // Packets swapped with one of their next few neighbours and some
+    // sent twice
+    std::vector<TracePacket> Reordering(std::size_t *duplicated) {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::uniform_int_distribution<int> distance(1, 4);
+        auto packets = Clean();
+        for (std::size_t n = 0; n + 4 < packets.size(); n++) {
+            // Only packets of the same frame get reordered
+            if (n % 20 < 16 && uniform(random_) < 0.05)
+                std::swap(packets[n].sequence_number, packets[n + distance(random_)].sequence_number);
+        }
+        for (auto &packet : packets)
+            packet.rtp_timestamp = RtpTimestampOf(packet.sequence_number);
+
+        std::vector<TracePacket> result;
+        *duplicated = 0;
+        for (const auto &packet : packets) {
+            result.push_back(packet);
+            if (uniform(random_) < 0.02) {
+                result.push_back(packet);
+                (*duplicated)++;
+            }
+        }
+        return result;
+    }
+
+private:
+    std::mt19937 random_;
+};
+
+// Feeds the trace to the buffer in simulated time and returns the
+// sequence numbers handed out.
+std::vector<std::uint16_t> Replay(const ac::streaming::JitterBuffer::Ptr &buffer,
+                                  const std::vector<TracePacket> &packets) {
+    std::vector<std::uint16_t> delivered;
+    auto drain = [&](ac::TimestampUs now) {
+        while (auto payload = buffer->Pop(now))
+            delivered.push_back(payload->Data()[0] | (payload->Data()[1] << 8));
+    };
+
+    for (const auto &packet : packets) {
+        drain(packet.arrival);
+
+        auto payload = ac::video::Buffer::Create(2, packet.arrival);
+        payload->Data()[0] = packet.sequence_number & 0xff;
+        payload->Data()[1] = packet.sequence_number >> 8;
+        buffer->Insert(packet.sequence_number, packet.rtp_timestamp, payload);
+
+        drain(packet.arrival);
+    }
+
+    drain(packets.back().arrival + 1000000);
+
+    return delivered;
+}
+
+void ExpectStrictlyIncreasing(const std::vector<std::uint16_t> &sequence_numbers) {
+    for (std::size_t n = 1; n < sequence_numbers.size(); n++)
+        ASSERT_LT(sequence_numbers[n - 1], sequence_numbers[n]);
+}
+}
+
+TEST(JitterBuffer, PassesPacketsInOrderRightAway) {
+    auto buffer = CreateBuffer();
+
+    for (std::uint8_t n = 0; n < 10; n++)
+        buffer->Insert(100 + n, n * 90, PacketWithId(n));
+
+    for (int n = 0; n < 10; n++)
+        EXPECT_EQ(n, IdOf(buffer->Next(kNoWait)));
+
+    EXPECT_EQ(nullptr, buffer->Next(kNoWait));
+}
+
+TEST(JitterBuffer, ReordersPackets) {
+    auto buffer = CreateBuffer();
+
+    buffer->Insert(0, 0, PacketWithId(0));
+    buffer->Insert(2, 0, PacketWithId(2));
+    buffer->Insert(3, 0, PacketWithId(3));
+
+    EXPECT_EQ(0, IdOf(buffer->Next(kNoWait)));
+    // Packet 1 is still missing so nothing else is ready yet
+    EXPECT_EQ(nullptr, buffer->Next(kNoWait));
+
+    buffer->Insert(1, 0, PacketWithId(1));
+
+    for (int n = 1; n < 4; n++)
+        EXPECT_EQ(n, IdOf(buffer->Next(kNoWait)));
+}
+
+TEST(JitterBuffer, GivesUpOnLostPacketsAfterDelay) {
+    ac::streaming::JitterBuffer::Config config;
+    config.min_delay = std::chrono::milliseconds{20};
+    auto buffer = CreateBuffer(config);
+
+    buffer->Insert(0, 0, PacketWithId(0));
+    buffer->Insert(2, 0, PacketWithId(2));
+
+    EXPECT_EQ(0, IdOf(buffer->Next(kNoWait)));
+
+    const auto start = ac::Utils::GetNowUs();
+    EXPECT_EQ(2, IdOf(buffer->Next(kWait)));
+    EXPECT_GE(ac::Utils::GetNowUs() - start, 15000);
+
+    // Packet 1 arriving now is too late
+    buffer->Insert(1, 0, PacketWithId(1));
+    EXPECT_EQ(nullptr, buffer->Next(kNoWait));
+}
+
+TEST(JitterBuffer, DropsDuplicates) {
+    auto buffer = CreateBuffer();
+
+    buffer->Insert(0, 0, PacketWithId(0));
+    buffer->Insert(0, 0, PacketWithId(1));
+    EXPECT_EQ(0, IdOf(buffer->Next(kNoWait)));
+    buffer->Insert(0, 0, PacketWithId(2));
+    EXPECT_EQ(nullptr, buffer->Next(kNoWait));
+}
+
+TEST(JitterBuffer, HandlesSequenceNumberWrap) {
+    auto buffer = CreateBuffer();
+
+    buffer->Insert(65534, 0, PacketWithId(0));
+    buffer->Insert(0, 0, PacketWithId(2));
+    buffer->Insert(65535, 0, PacketWithId(1));
+    buffer->Insert(1, 0, PacketWithId(3));
+
+    for (int n = 0; n < 4; n++)
+        EXPECT_EQ(n, IdOf(buffer->Next(kNoWait)));
+}
+
+TEST(JitterBuffer, ReleasesPacketsWhenFull) {
+    ac::streaming::JitterBuffer::Config config;
+    config.min_delay = std::chrono::seconds{10};
+    config.max_delay = std::chrono::seconds{10};
+    config.capacity = 4;
+    auto buffer = CreateBuffer(config);
+
+    buffer->Insert(0, 0, PacketWithId(0));
+    EXPECT_EQ(0, IdOf(buffer->Next(kNoWait)));
+
+    for (std::uint8_t n = 2; n < 6; n++)
+        buffer->Insert(n, 0, PacketWithId(n));
+
+    EXPECT_EQ(2, IdOf(buffer->Next(kNoWait)));
+}
+
+TEST(JitterBuffer, DelayFollowsJitter) {
+    ac::streaming::JitterBuffer::Config config;
+    config.min_delay = std::chrono::milliseconds{1};
+    config.max_delay = std::chrono::milliseconds{500};
+    auto buffer = CreateBuffer(config);
+
+    // Packets sent every 10 ms which arrive alternating 0 and 20 ms late
+    ac::TimestampUs base = 1000000;
+    for (std::uint16_t n = 0; n < 200; n++) {
+        const auto arrival = base + n * 10000 + (n % 2) * 20000;
+        buffer->Insert(n, n * 900, PacketWithId(0, arrival));
+    }
+
+    EXPECT_GT(buffer->Delay(), std::chrono::milliseconds{20});
+    EXPECT_LT(buffer->Delay(), std::chrono::milliseconds{100});
+}
+
+TEST(JitterBuffer, CountsLateDuplicateAndLostPackets) {
+    auto report = std::make_shared<MockJitterBufferReport>();
+    ac::streaming::JitterBuffer::Config config;
+    config.min_delay = std::chrono::milliseconds{10};
+    auto buffer = ac::streaming::JitterBuffer::Create(report, config);
+
+    EXPECT_CALL(*report, DeliveredPacket(_, _)).Times(3);
+    EXPECT_CALL(*report, LostPackets(1, 2)).Times(1);
+    EXPECT_CALL(*report, LatePacket(2)).Times(1);
+    EXPECT_CALL(*report, DuplicatePacket(3)).Times(1);
+
+    const ac::TimestampUs now = 1000000;
+    buffer->Insert(0, 0, PacketWithId(0, now));
+    buffer->Insert(3, 0, PacketWithId(3, now));
+    buffer->Insert(4, 0, PacketWithId(4, now));
+
+    EXPECT_EQ(0, IdOf(buffer->Pop(now)));
+    EXPECT_EQ(nullptr, buffer->Pop(now + 5000));
+    EXPECT_EQ(3, IdOf(buffer->Pop(now + 10000)));
+    EXPECT_EQ(4, IdOf(buffer->Pop(now + 10000)));
+
+    buffer->Insert(2, 0, PacketWithId(2, now + 11000));
+    buffer->Insert(3, 0, PacketWithId(3, now + 11000));
+
+    const auto stats = buffer->Stats();
+    EXPECT_EQ(5, stats.received);
+    EXPECT_EQ(3, stats.delivered);
+    EXPECT_EQ(2, stats.lost);
+    EXPECT_EQ(1, stats.late);
+    EXPECT_EQ(1, stats.duplicates);
+    EXPECT_EQ(0, stats.overflows);
+    EXPECT_EQ(std::chrono::microseconds{(0 + 10000 + 10000) / 3}, stats.average_playout_delay);
+}
+
+TEST(JitterBuffer, CountsOverflows) {
+    ac::streaming::JitterBuffer::Config config;
+    config.capacity = 4;
+    auto buffer = CreateBuffer(config);
+
+    for (std::uint8_t n = 0; n < 6; n++)
+        buffer->Insert(n, 0, PacketWithId(n));
+
+    EXPECT_EQ(2, IdOf(buffer->Next(kNoWait)));
+    EXPECT_EQ(2, buffer->Stats().overflows);
+}
+
+TEST(JitterBuffer, RestartsOnSequenceNumberJump) {
+    auto buffer = CreateBuffer();
+
+    for (std::uint8_t n = 0; n < 3; n++)
+        buffer->Insert(5000 + n, 0, PacketWithId(n));
+    for (int n = 0; n < 3; n++)
+        EXPECT_EQ(n, IdOf(buffer->Next(kNoWait)));
+
+    buffer->Insert(10, 0, PacketWithId(10));
+    EXPECT_EQ(10, IdOf(buffer->Next(kNoWait)));
+}
+
+TEST(JitterBuffer, CleanTraceHasMinimalDelay) {
+    Trace trace;
+    auto buffer = CreateBuffer();
+
+    const auto delivered = Replay(buffer, trace.Clean());
+
+    EXPECT_EQ(kTracePacketCount, delivered.size());
+    ExpectStrictlyIncreasing(delivered);
+
+    const auto stats = buffer->Stats();
+    EXPECT_EQ(0, stats.lost);
+    EXPECT_EQ(ac::streaming::JitterBuffer::Config{}.min_delay, stats.target_delay);
+    // In order packets never wait
+    EXPECT_EQ(std::chrono::microseconds{0}, stats.average_playout_delay);
+}
+
+TEST(JitterBuffer, WiFiTraceDelayStaysWithinBounds) {
+    Trace trace;
+    ac::streaming::JitterBuffer::Config config;
+    auto buffer = CreateBuffer(config);
+
+    const auto delivered = Replay(buffer, trace.WiFi());
+
+    EXPECT_EQ(kTracePacketCount, delivered.size());
+    ExpectStrictlyIncreasing(delivered);
+
+    const auto stats = buffer->Stats();
+    EXPECT_EQ(0, stats.lost);
+    EXPECT_EQ(0, stats.late);
+    EXPECT_GT(stats.target_delay, config.min_delay);
+    EXPECT_LE(stats.target_delay, config.max_delay);
+    EXPECT_GT(stats.jitter, std::chrono::microseconds{0});
+}
+
+TEST(JitterBuffer, BurstyLossTraceAccountsEveryPacket) {
+    Trace trace;
+    std::size_t dropped = 0;
+    auto buffer = CreateBuffer();
+
+    const auto packets = trace.BurstyLoss(&dropped);
+    const auto delivered = Replay(buffer, packets);
+
+    ASSERT_GT(dropped, 0);
+    ExpectStrictlyIncreasing(delivered);
+    EXPECT_EQ(packets.size(), delivered.size());
+
+    // Losses before the first and after the last packet we received
+    // can't be noticed.
+    const std::size_t unnoticed = packets.front().sequence_number +
+            (kTracePacketCount - 1 - packets.back().sequence_number);
+
+    const auto stats = buffer->Stats();
+    EXPECT_EQ(dropped - unnoticed, stats.lost);
+    EXPECT_EQ(0, stats.late);
+}
+
+TEST(JitterBuffer, ReorderingTraceIsRestored) {
+    Trace trace;
+    std::size_t duplicated = 0;
+    ac::streaming::JitterBuffer::Config config;
+    // Reordered packets arrive less than a frame late
+    config.min_delay = std::chrono::milliseconds{10};
+    auto buffer = CreateBuffer(config);
+
+    const auto delivered = Replay(buffer, trace.Reordering(&duplicated));
+
+    EXPECT_EQ(kTracePacketCount, delivered.size());
+    ExpectStrictlyIncreasing(delivered);
+
+    const auto stats = buffer->Stats();
+    EXPECT_EQ(0, stats.lost);
+    EXPECT_EQ(duplicated, stats.duplicates);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/report/null/jitterbufferreport.h"
+#include "ac/report/null/packetizerreport.h"
+
+#include "ac/streaming/mediareceiver.h"
+#include "ac/streaming/mpegtspacketizer.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::uint32_t kTSPacketsPerRTPPacket{7};
+static constexpr std::uint32_t kTSPacketSize{188};
+
+class MockDecoder : public ac::video::BaseDecoder {
+public:
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD1(Decode, bool(const ac::video::AccessUnit&));
+    MOCK_CONST_METHOD0(Name, std::string());
+};
+}
+
+TEST(MediaReceiver, DecodesReceivedFrames) {
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                std::make_shared<ac::report::null::PacketizerReport>());
+    auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+    auto jitter_buffer = ac::streaming::JitterBuffer::Create(std::make_shared<ac::report::null::JitterBufferReport>());
+    auto decoder = std::make_shared<MockDecoder>();
+
+    EXPECT_CALL(*decoder, Start()).WillOnce(Return(true));
+    EXPECT_CALL(*decoder, Stop()).WillRepeatedly(Return(true));
+
+    auto receiver = std::make_shared<ac::streaming::MediaReceiver>(
+                jitter_buffer, ac::streaming::MPEGTSDemuxer::Create(), decoder);
+
+    EXPECT_TRUE(receiver->Start());
+
+    std::uint16_t sequence_number = 0;
+    for (int n = 0; n < 3; n++) {
+        auto frame = ac::video::Buffer::Create(3000);
+        frame->SetTimestamp(n * 33333);
+
+        ac::video::Buffer::Ptr packets;
+        packetizer->Packetize(track, frame, &packets, ac::streaming::Packetizer::kEmitPATandPMT);
+
+        // Split up like the RTPSender does it
+        for (std::uint32_t offset = 0; offset < packets->Length(); offset += kTSPacketsPerRTPPacket * kTSPacketSize) {
+            const auto size = std::min(packets->Length() - offset, kTSPacketsPerRTPPacket * kTSPacketSize);
+            auto payload = ac::video::Buffer::Create(packets, offset, size);
+            payload->SetTimestamp(ac::Utils::GetNowUs());
+            jitter_buffer->Insert(sequence_number++, 0, payload);
+        }
+    }
+
+    EXPECT_CALL(*decoder, Decode(Field(&ac::video::AccessUnit::size, Eq(3000))))
+            .Times(3)
+            .WillRepeatedly(Return(true));
+
+    for (std::uint16_t n = 0; n < sequence_number; n++)
+        EXPECT_TRUE(receiver->Execute());
+
+    EXPECT_TRUE(receiver->Stop());
+}
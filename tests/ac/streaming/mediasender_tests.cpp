@@ -17,6 +17,8 @@
 
 #include <gmock/gmock.h>
 
+#include <cstring>
+
 #include "ac/streaming/mediasender.h"
 
 using namespace ::testing;
@@ -35,6 +37,71 @@ public:
     MOCK_METHOD4(Packetize, bool(TrackId, const ac::video::Buffer::Ptr&,
                                  ac::video::Buffer::Ptr*, int));
 };
+
+class MockPacketizerReport : public ac::video::PacketizerReport {
+public:
+    MOCK_METHOD1(PacketizedFrame, void(const ac::TimestampUs&));
+    MOCK_METHOD3(PaddedFrame, void(const ac::TimestampUs&, const size_t&, const size_t&));
+    MOCK_METHOD2(DroppedFrame, void(const ac::TimestampUs&, const int&));
+    MOCK_METHOD2(FrameRateChanged, void(const unsigned int&, const unsigned int&));
+};
+
+// NAL unit headers of a reference and a non-reference P slice
+static constexpr uint8_t kReferenceSlice{0x41};
+static constexpr uint8_t kNonReferenceSlice{0x01};
+static constexpr uint8_t kIDRSlice{0x65};
+
+static constexpr unsigned int kBitrate{1000000};
+// 200 ms worth of data at kBitrate waiting to be sent
+static constexpr std::size_t kCongestedBacklog{kBitrate / 8 / 5};
+
+ac::video::Buffer::Ptr CreateFrame(uint8_t nal_header, int temporal_layer = -1) {
+    static const uint8_t aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+
+    auto frame = ac::video::Buffer::Create(64);
+    ::memset(frame->Data(), 0xab, frame->Length());
+    ::memcpy(frame->Data(), aud, sizeof(aud));
+    ::memcpy(frame->Data() + sizeof(aud), "\x00\x00\x00\x01", 4);
+    frame->Data()[sizeof(aud) + 4] = nal_header;
+    frame->SetTemporalLayer(temporal_layer);
+    return frame;
+}
+
+class CongestionTest {
+public:
+    CongestionTest() :
+        packetizer(std::make_shared<NiceMock<MockPacketizer>>()),
+        transport(std::make_shared<NiceMock<MockTransportSender>>()),
+        report(std::make_shared<NiceMock<MockPacketizerReport>>()),
+        budget(ac::video::MemoryBudget::Create(0)),
+        packets(ac::video::Buffer::Create(188)) {
+
+        ON_CALL(*packetizer, AddTrack(_))
+                .WillByDefault(Return(1));
+        ON_CALL(*packetizer, Packetize(_, _, _, _))
+                .WillByDefault(DoAll(SetArgPointee<2>(packets), Return(true)));
+        ON_CALL(*transport, Queue(_))
+                .WillByDefault(Return(true));
+
+        ac::video::BaseEncoder::Config config;
+        config.bitrate = kBitrate;
+        config.framerate = 30;
+
+        sender = std::make_shared<ac::streaming::MediaSender>(packetizer, transport, config, report, budget);
+    }
+
+    void Send(const ac::video::Buffer::Ptr &frame) {
+        sender->OnBufferAvailable(frame);
+        EXPECT_TRUE(sender->Execute());
+    }
+
+    std::shared_ptr<NiceMock<MockPacketizer>> packetizer;
+    std::shared_ptr<NiceMock<MockTransportSender>> transport;
+    std::shared_ptr<NiceMock<MockPacketizerReport>> report;
+    ac::video::MemoryBudget::Ptr budget;
+    ac::video::Buffer::Ptr packets;
+    ac::streaming::MediaSender::Ptr sender;
+};
 }
 
 TEST(MediaSender, WitNothingAndNoCrash) {
@@ -222,3 +289,110 @@ TEST(MediaSender, RequestsPCRandPATandPMTEvery100ms) {
 
     EXPECT_TRUE(sender->Stop());
 }
+
+TEST(MediaSender, KeepsAllFramesWithoutCongestion) {
+    CongestionTest test;
+
+    EXPECT_CALL(*test.packetizer, Packetize(_, _, _, _))
+            .Times(60);
+    EXPECT_CALL(*test.report, DroppedFrame(_, _))
+            .Times(0);
+    EXPECT_CALL(*test.report, FrameRateChanged(_, _))
+            .Times(0);
+
+    for (int n = 0; n < 60; n++)
+        test.Send(CreateFrame(n % 2 ? kNonReferenceSlice : kReferenceSlice));
+}
+
+TEST(MediaSender, DropsNonReferenceFramesUnderCongestion) {
+    CongestionTest test;
+
+    test.budget->Acquire(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+
+    // Shedding starts after the first 15 frames and then takes every
+    // non-reference frame.
+    EXPECT_CALL(*test.packetizer, Packetize(_, _, _, _))
+            .Times(60 - 23);
+    EXPECT_CALL(*test.report, DroppedFrame(_, -1))
+            .Times(23);
+
+    InSequence seq;
+    EXPECT_CALL(*test.report, FrameRateChanged(22, 1));
+    EXPECT_CALL(*test.report, FrameRateChanged(15, _));
+
+    for (int n = 0; n < 60; n++)
+        test.Send(CreateFrame(n % 2 ? kNonReferenceSlice : kReferenceSlice));
+
+    test.budget->Release(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+}
+
+TEST(MediaSender, NeverDropsReferenceFrames) {
+    CongestionTest test;
+
+    test.budget->Acquire(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+
+    EXPECT_CALL(*test.packetizer, Packetize(_, _, _, _))
+            .Times(90);
+    EXPECT_CALL(*test.report, DroppedFrame(_, _))
+            .Times(0);
+
+    for (int n = 0; n < 90; n++)
+        test.Send(CreateFrame(n % 30 ? kReferenceSlice : kIDRSlice));
+
+    // Frames of unknown structure are kept too
+    EXPECT_CALL(*test.packetizer, Packetize(_, _, _, _))
+            .Times(2);
+
+    test.Send(ac::video::Buffer::Create(1));
+    test.Send(ac::video::Buffer::Create(nullptr));
+
+    test.budget->Release(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+}
+
+TEST(MediaSender, ShedsHighestTemporalLayerFirst) {
+    CongestionTest test;
+
+    test.budget->Acquire(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+
+    // Layers of a dyadic hierarchy with four frames per group. The first
+    // level of shedding takes the odd frames of layer 2 from frame 15 on,
+    // the second one also the ones of layer 1 from frame 31 on.
+    static const int layers[] = { 0, 2, 1, 2 };
+
+    EXPECT_CALL(*test.report, DroppedFrame(_, 2))
+            .Times(16);
+    EXPECT_CALL(*test.report, DroppedFrame(_, 1))
+            .Times(4);
+    EXPECT_CALL(*test.report, DroppedFrame(_, 0))
+            .Times(0);
+
+    // The temporal layer is taken from the encoder and the NAL unit
+    // header which says otherwise is ignored.
+    for (int n = 0; n < 47; n++)
+        test.Send(CreateFrame(kReferenceSlice, layers[n % 4]));
+
+    test.budget->Release(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+}
+
+TEST(MediaSender, StopsDroppingOnceBacklogIsGone) {
+    CongestionTest test;
+
+    test.budget->Acquire(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+
+    EXPECT_CALL(*test.packetizer, Packetize(_, _, _, _))
+            .Times(60 - 8);
+    EXPECT_CALL(*test.report, DroppedFrame(_, _))
+            .Times(8);
+
+    InSequence seq;
+    EXPECT_CALL(*test.report, FrameRateChanged(22, 1));
+    EXPECT_CALL(*test.report, FrameRateChanged(30, 0));
+
+    for (int n = 0; n < 30; n++)
+        test.Send(CreateFrame(n % 2 ? kNonReferenceSlice : kReferenceSlice));
+
+    test.budget->Release(ac::video::MemoryBudget::Stage::kSender, kCongestedBacklog);
+
+    for (int n = 30; n < 60; n++)
+        test.Send(CreateFrame(n % 2 ? kNonReferenceSlice : kReferenceSlice));
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "ac/report/null/packetizerreport.h"
+
+#include "ac/streaming/mpegtsdemuxer.h"
+#include "ac/streaming/mpegtspacketizer.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::uint32_t kTSPacketSize{188};
+
+ac::video::Buffer::Ptr CreateFrame(std::uint32_t size, std::uint8_t seed) {
+    auto frame = ac::video::Buffer::Create(size);
+    for (std::uint32_t n = 0; n < size; n++)
+        frame->Data()[n] = seed + n * 7;
+    return frame;
+}
+
+std::vector<std::uint8_t> Flatten(const ac::video::AccessUnit &unit) {
+    std::vector<std::uint8_t> data;
+    for (const auto &fragment : unit.fragments)
+        data.insert(data.end(), fragment->Data(), fragment->Data() + fragment->Length());
+    return data;
+}
+
+void ExpectRoundTrip(const ac::streaming::MPEGTSPacketizer::Config &config) {
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                std::make_shared<ac::report::null::PacketizerReport>(), config);
+    auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+
+    // Includes frames too large for the PES packet length field
+    const std::uint32_t sizes[] = { 100, 4000, 170, 171, 70000, 20000, 1 };
+
+    std::vector<ac::video::Buffer::Ptr> frames;
+    std::vector<ac::video::AccessUnit> units;
+
+    for (std::uint8_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        auto frame = CreateFrame(sizes[n], n);
+        frame->SetTimestamp(1000000 + n * 33333);
+        frames.push_back(frame);
+
+        ac::video::Buffer::Ptr packets;
+        ASSERT_TRUE(packetizer->Packetize(track, frame, &packets, n == 0 ?
+                                          ac::streaming::Packetizer::kEmitPATandPMT : 0));
+
+        demuxer->Demux(packets, &units);
+    }
+
+    // The last unit only completes with the next one if its size is unknown
+    ASSERT_LE(frames.size() - 1, units.size());
+
+    for (std::size_t n = 0; n < units.size(); n++) {
+        const auto data = Flatten(units[n]);
+        EXPECT_EQ(frames[n]->Length(), units[n].size);
+        EXPECT_EQ(std::vector<std::uint8_t>(frames[n]->Data(), frames[n]->Data() + frames[n]->Length()), data)
+                << "frame " << n;
+        EXPECT_NEAR(frames[n]->Timestamp(), units[n].timestamp, 20);
+        EXPECT_EQ(units[n].timestamp, units[n].decode_timestamp);
+    }
+
+    const auto stats = demuxer->Stats();
+    EXPECT_EQ(units.size(), stats.units);
+    EXPECT_EQ(0, stats.continuity_errors);
+    EXPECT_EQ(0, stats.sync_losses);
+}
+
+// Packetizes count frames of the given size into a single buffer
+ac::video::Buffer::Ptr CreateStream(std::size_t count, std::uint32_t size, int flags = 0) {
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                std::make_shared<ac::report::null::PacketizerReport>());
+    auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+
+    std::vector<std::uint8_t> stream;
+    for (std::size_t n = 0; n < count; n++) {
+        auto frame = CreateFrame(size, n);
+        frame->SetTimestamp(1000000 + n * 33333);
+
+        ac::video::Buffer::Ptr packets;
+        packetizer->Packetize(track, frame, &packets, flags |
+                              (n == 0 ? ac::streaming::Packetizer::kEmitPATandPMT : 0));
+        stream.insert(stream.end(), packets->Data(), packets->Data() + packets->Length());
+    }
+
+    auto buffer = ac::video::Buffer::Create(stream.size());
+    ::memcpy(buffer->Data(), stream.data(), stream.size());
+    return buffer;
+}
+
+ac::video::Buffer::Ptr Remove(const ac::video::Buffer::Ptr &stream, std::uint32_t offset, std::uint32_t size) {
+    auto result = ac::video::Buffer::Create(stream->Length() - size);
+    ::memcpy(result->Data(), stream->Data(), offset);
+    ::memcpy(result->Data() + offset, stream->Data() + offset + size, stream->Length() - offset - size);
+    return result;
+}
+
+ac::video::Buffer::Ptr Insert(const ac::video::Buffer::Ptr &stream, std::uint32_t offset,
+                              const std::uint8_t *data, std::uint32_t size) {
+    auto result = ac::video::Buffer::Create(stream->Length() + size);
+    ::memcpy(result->Data(), stream->Data(), offset);
+    ::memcpy(result->Data() + offset, data, size);
+    ::memcpy(result->Data() + offset + size, stream->Data() + offset, stream->Length() - offset);
+    return result;
+}
+
+void WriteTimestamp(std::uint8_t *ptr, std::uint8_t prefix, std::uint64_t value) {
+    ptr[0] = (prefix << 4) | (((value >> 30) & 7) << 1) | 1;
+    ptr[1] = (value >> 22) & 0xff;
+    ptr[2] = (((value >> 15) & 0x7f) << 1) | 1;
+    ptr[3] = (value >> 7) & 0xff;
+    ptr[4] = ((value & 0x7f) << 1) | 1;
+}
+}
+
+TEST(MPEGTSDemuxer, RoundTripsPacketizedFrames) {
+    ExpectRoundTrip(ac::streaming::MPEGTSPacketizer::Config{});
+}
+
+TEST(MPEGTSDemuxer, RoundTripsGenericPacketizerOutput) {
+    ac::streaming::MPEGTSPacketizer::Config config;
+    config.single_track_fast_path = false;
+    ExpectRoundTrip(config);
+}
+
+TEST(MPEGTSDemuxer, ReferencesReceivedPackets) {
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                std::make_shared<ac::report::null::PacketizerReport>());
+    auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+
+    ac::video::Buffer::Ptr packets;
+    ASSERT_TRUE(packetizer->Packetize(track, CreateFrame(5000, 0), &packets,
+                                      ac::streaming::Packetizer::kEmitPATandPMT));
+
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(packets, &units);
+    ASSERT_EQ(1, units.size());
+
+    const auto begin = packets->Data();
+    const auto end = begin + packets->Length();
+
+    for (const auto &fragment : units[0].fragments) {
+        EXPECT_GE(fragment->Data(), begin);
+        EXPECT_LE(fragment->Data() + fragment->Length(), end);
+    }
+}
+
+TEST(MPEGTSDemuxer, IgnoresStreamBeforeProgramTables) {
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(
+                std::make_shared<ac::report::null::PacketizerReport>());
+    auto track = packetizer->AddTrack(ac::streaming::Packetizer::TrackFormat{"video/avc"});
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+
+    ac::video::Buffer::Ptr packets;
+    ASSERT_TRUE(packetizer->Packetize(track, CreateFrame(1000, 0), &packets, 0));
+
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(packets, &units);
+    EXPECT_EQ(0, units.size());
+}
+
+TEST(MPEGTSDemuxer, DropsUnitWithMissingPacket) {
+    // Frames of 17 packets each behind PAT and PMT
+    auto stream = CreateStream(3, 3000);
+    stream = Remove(stream, (2 + 25) * kTSPacketSize, kTSPacketSize);
+
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(stream, &units);
+
+    ASSERT_EQ(2, units.size());
+    EXPECT_EQ(0, Flatten(units[0])[0]);
+    EXPECT_EQ(2, Flatten(units[1])[0]);
+    EXPECT_EQ(1, demuxer->Stats().continuity_errors);
+    EXPECT_EQ(1, demuxer->Stats().dropped_units);
+}
+
+TEST(MPEGTSDemuxer, IgnoresDuplicatePackets) {
+    auto stream = CreateStream(2, 3000);
+    const auto offset = 5 * kTSPacketSize;
+    std::vector<std::uint8_t> copy(stream->Data() + offset, stream->Data() + offset + kTSPacketSize);
+    stream = Insert(stream, offset + kTSPacketSize, copy.data(), copy.size());
+
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(stream, &units);
+
+    ASSERT_EQ(2, units.size());
+    EXPECT_EQ(3000, units[0].size);
+    EXPECT_EQ(1, demuxer->Stats().duplicates);
+    EXPECT_EQ(0, demuxer->Stats().continuity_errors);
+}
+
+TEST(MPEGTSDemuxer, ResynchronizesAfterJunk) {
+    const std::uint8_t junk[] = { 0x00, 0x47, 0x12, 0x34, 0x47, 0x00, 0x00, 0x01, 0xff };
+
+    auto stream = CreateStream(4, 1000);
+    // In front of the stream and between the second and third frame
+    stream = Insert(stream, (2 + 2 * 6) * kTSPacketSize, junk, sizeof(junk));
+    stream = Insert(stream, 0, junk, sizeof(junk));
+
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(stream, &units);
+
+    ASSERT_EQ(4, units.size());
+    for (std::size_t n = 0; n < units.size(); n++)
+        EXPECT_EQ(n, Flatten(units[n])[0]);
+    EXPECT_EQ(2, demuxer->Stats().sync_losses);
+}
+
+TEST(MPEGTSDemuxer, ExtractsPCR) {
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    EXPECT_EQ(-1, demuxer->Stats().pcr);
+
+    // The packetizer takes the PCR from the system clock. Its base only
+    // has 33 bits of 90 kHz ticks so it wraps every ~26 hours.
+    const ac::TimestampUs wrap = (1ll << 33) * 100 / 9;
+    const auto before = ac::Utils::GetNowUs();
+    const auto stream = CreateStream(2, 1000, ac::streaming::Packetizer::kEmitPCR);
+    const auto after = ac::Utils::GetNowUs();
+
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(stream, &units);
+
+    EXPECT_NEAR(static_cast<ac::TimestampUs>(before % wrap), demuxer->Stats().pcr, after - before + 1);
+}
+
+TEST(MPEGTSDemuxer, ExtractsDecodeTimestamp) {
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    std::vector<ac::video::AccessUnit> units;
+
+    // Take PAT and PMT from the packetizer
+    auto stream = CreateStream(1, 100);
+    demuxer->Demux(ac::video::Buffer::Create(stream, 0, 2 * kTSPacketSize), &units);
+
+    const int pid = ((stream->Data()[2 * kTSPacketSize + 1] & 0x1f) << 8) | stream->Data()[2 * kTSPacketSize + 2];
+
+    auto packet = ac::video::Buffer::Create(kTSPacketSize);
+    std::uint8_t *ptr = packet->Data();
+    *ptr++ = 0x47;
+    *ptr++ = 0x40 | (pid >> 8);
+    *ptr++ = pid & 0xff;
+    *ptr++ = 0x10;
+    const std::uint32_t payload_size = kTSPacketSize - 4 - 19;
+    const std::uint32_t packet_length = 3 + 10 + payload_size;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xe0;
+    *ptr++ = packet_length >> 8;
+    *ptr++ = packet_length & 0xff;
+    *ptr++ = 0x84;
+    *ptr++ = 0xc0;
+    *ptr++ = 10;
+    WriteTimestamp(ptr, 0x3, 90000 * 2);
+    WriteTimestamp(ptr + 5, 0x1, 90000);
+    ::memset(ptr + 10, 0xab, payload_size);
+
+    demuxer->Demux(packet, &units);
+
+    ASSERT_EQ(1, units.size());
+    EXPECT_EQ(2000000, units[0].timestamp);
+    EXPECT_EQ(1000000, units[0].decode_timestamp);
+    EXPECT_EQ(payload_size, units[0].size);
+}
+
+TEST(MPEGTSDemuxer, SurvivesFuzzedStreams) {
+    const auto original = CreateStream(8, 5000, ac::streaming::Packetizer::kEmitPCR);
+    std::mt19937 random(1234);
+
+    for (int iteration = 0; iteration < 2000; iteration++) {
+        std::uniform_int_distribution<std::uint32_t> position(0, original->Length() - 1);
+
+        // Work on a copy which is cut at a random position and has a
+        // few random bytes replaced
+        const auto length = position(random) + 1;
+        auto stream = ac::video::Buffer::Create(length);
+        ::memcpy(stream->Data(), original->Data(), length);
+
+        std::uniform_int_distribution<std::uint32_t> corrupt(0, length - 1);
+        for (int n = 0; n < iteration % 32; n++)
+            stream->Data()[corrupt(random)] = random();
+
+        auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+        std::vector<ac::video::AccessUnit> units;
+        demuxer->Demux(stream, &units);
+
+        const auto begin = stream->Data();
+        const auto end = begin + stream->Length();
+        for (const auto &unit : units) {
+            std::size_t size = 0;
+            for (const auto &fragment : unit.fragments) {
+                ASSERT_GE(fragment->Data(), begin);
+                ASSERT_LE(fragment->Data() + fragment->Length(), end);
+                size += fragment->Length();
+            }
+            ASSERT_EQ(size, unit.size);
+        }
+    }
+}
+
+TEST(MPEGTSDemuxer, SurvivesGarbage) {
+    auto demuxer = ac::streaming::MPEGTSDemuxer::Create();
+    auto packets = CreateFrame(kTSPacketSize * 50, 0x47);
+
+    // Make every packet look like one with a valid sync byte
+    for (std::uint32_t n = 0; n < packets->Length(); n += kTSPacketSize)
+        packets->Data()[n] = 0x47;
+
+    std::vector<ac::video::AccessUnit> units;
+    demuxer->Demux(packets, &units);
+    SUCCEED();
+}
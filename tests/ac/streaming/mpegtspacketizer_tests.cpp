@@ -106,8 +106,39 @@ private:
 class MockPacketizerReport : public ac::video::PacketizerReport {
 public:
     MOCK_METHOD1(PacketizedFrame, void(const ac::TimestampUs&));
+    MOCK_METHOD3(PaddedFrame, void(const ac::TimestampUs&, const size_t&, const size_t&));
+    MOCK_METHOD2(DroppedFrame, void(const ac::TimestampUs&, const int&));
+    MOCK_METHOD2(FrameRateChanged, void(const unsigned int&, const unsigned int&));
 };
 
+unsigned int PIDOf(const uint8_t *packet) {
+    return ((packet[1] & 0x1f) << 8) | packet[2];
+}
+
+uint64_t PCROf(const uint8_t *packet) {
+    uint64_t base = (uint64_t(packet[6]) << 25) | (packet[7] << 17) |
+            (packet[8] << 9) | (packet[9] << 1) | (packet[10] >> 7);
+    uint64_t ext = ((packet[10] & 1) << 8) | packet[11];
+    return base * 300 + ext;
+}
+
+std::vector<uint8_t> PacketizeConstantBitrateStream(const ac::streaming::Packetizer::Ptr &packetizer,
+                                                    ac::streaming::Packetizer::TrackId id,
+                                                    int num_frames) {
+    std::vector<uint8_t> stream;
+    for (int n = 0; n < num_frames; n++) {
+        // Every 10th frame is a large one like an IDR frame would be
+        auto buffer = CreateFrame(n % 10 == 0 ? 40000 : 4000 + (n % 7) * 500);
+        buffer->SetTimestamp(1000000ll + n * 33333ll);
+
+        ac::video::Buffer::Ptr out;
+        EXPECT_TRUE(packetizer->Packetize(id, buffer, &out, ac::streaming::Packetizer::kEmitPATandPMT));
+        EXPECT_EQ(0, out->Length() % kMPEGTSPacketLength);
+        stream.insert(stream.end(), out->Data(), out->Data() + out->Length());
+    }
+    return stream;
+}
+
 }
 
 TEST(MPEGTSPacketizer, AddTrackWithoutAnythingSet) {
@@ -254,3 +285,140 @@ TEST(MPEGTSPacketizer, IncreasingContinuityCounter) {
         matcher.At(3).ExpectData(buffer->Data(), buffer->Length());
     }
 }
+
+TEST(MPEGTSPacketizer, ConstantBitrateInsertsNullPacketsAndPCR) {
+    auto report = std::make_shared<NiceMock<MockPacketizerReport>>();
+
+    ac::streaming::MPEGTSPacketizer::Config config;
+    config.mux_rate = 8000000;
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report, config);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc", 66, 31});
+
+    // Large frames exceed the rate and don't get any padding
+    EXPECT_CALL(*report, PaddedFrame(_, _, _))
+            .Times(AnyNumber());
+    EXPECT_CALL(*report, PaddedFrame(_, Gt(0u), _))
+            .Times(AtLeast(1));
+
+    static constexpr int kNumFrames{60};
+    const auto stream = PacketizeConstantBitrateStream(packetizer, id, kNumFrames);
+
+    const size_t num_packets = stream.size() / kMPEGTSPacketLength;
+    const double ticks_per_packet = kMPEGTSPacketLength * 8 * 27000000.0 / config.mux_rate;
+
+    // The stream covers all frames with the configured rate
+    const double expected_packets = kNumFrames * 0.033333 * config.mux_rate / (kMPEGTSPacketLength * 8);
+    EXPECT_NEAR(expected_packets, num_packets, expected_packets * 0.05);
+
+    size_t num_null_packets = 0;
+    int64_t last_pcr_index = -1;
+    uint64_t last_pcr = 0;
+
+    for (size_t n = 0; n < num_packets; n++) {
+        const uint8_t *packet = &stream[n * kMPEGTSPacketLength];
+        EXPECT_EQ(kMPEGTSStartByte, packet[0]);
+
+        const auto pid = PIDOf(packet);
+        if (pid == 0x1fff) {
+            num_null_packets++;
+            continue;
+        }
+
+        if (pid != 0x1000)
+            continue;
+
+        const auto pcr = PCROf(packet);
+        if (last_pcr_index >= 0) {
+            // PCR has to match the position of the packet within the stream
+            const double expected = (n - last_pcr_index) * ticks_per_packet;
+            EXPECT_NEAR(expected, static_cast<double>(pcr - last_pcr), 1.0);
+            // and needs to be sent at least every 40ms
+            EXPECT_LE(pcr - last_pcr, 40 * 27000 + ticks_per_packet);
+        }
+
+        last_pcr_index = n;
+        last_pcr = pcr;
+    }
+
+    EXPECT_GT(num_null_packets, 0u);
+    EXPECT_LT(0, last_pcr_index);
+}
+
+TEST(MPEGTSPacketizer, ConstantBitrateRespectsTransportBuffer) {
+    auto report = std::make_shared<NiceMock<MockPacketizerReport>>();
+
+    // Muxing with a rate way above what the level allows forces the
+    // multiplexer to hold back video packets.
+    ac::streaming::MPEGTSPacketizer::Config config;
+    config.mux_rate = 40000000;
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report, config);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc", 66, 31});
+
+    const auto stream = PacketizeConstantBitrateStream(packetizer, id, 20);
+
+    const double seconds_per_packet = kMPEGTSPacketLength * 8.0 / config.mux_rate;
+    const double leak_per_second = 1.2 * 1200 * 14000 / 8.0;
+
+    double transport_buffer = 0.0;
+    for (size_t n = 0; n < stream.size() / kMPEGTSPacketLength; n++) {
+        transport_buffer = std::max(0.0, transport_buffer - seconds_per_packet * leak_per_second);
+        if (PIDOf(&stream[n * kMPEGTSPacketLength]) != 0x1011)
+            continue;
+        transport_buffer += kMPEGTSPacketLength;
+        EXPECT_LE(transport_buffer, 512.0 + 1.0);
+    }
+}
+
+TEST(MPEGTSPacketizer, VariableBitrateByDefault) {
+    auto report = std::make_shared<MockPacketizerReport>();
+    auto packetizer = ac::streaming::MPEGTSPacketizer::Create(report);
+    auto id = packetizer->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    EXPECT_CALL(*report, PacketizedFrame(_))
+            .Times(1);
+    EXPECT_CALL(*report, PaddedFrame(_, _, _))
+            .Times(0);
+
+    ac::video::Buffer::Ptr out;
+    packetizer->Packetize(id, CreateFrame(100), &out);
+
+    MPEGTSPacketMatcher matcher(out);
+    matcher.ExpectPackets(1);
+}
+
+TEST(MPEGTSPacketizer, SingleTrackFastPathMatchesGenericPath) {
+    auto report = std::make_shared<NiceMock<MockPacketizerReport>>();
+
+    ac::streaming::MPEGTSPacketizer::Config generic_config;
+    generic_config.single_track_fast_path = false;
+
+    auto generic = ac::streaming::MPEGTSPacketizer::Create(report, generic_config);
+    auto fast = ac::streaming::MPEGTSPacketizer::Create(report);
+
+    auto generic_id = generic->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+    auto fast_id = fast->AddTrack(ac::streaming::MPEGTSPacketizer::TrackFormat{"video/avc"});
+
+    // Sizes around the packet boundaries and one exceeding the maximum
+    // PES packet length.
+    const std::vector<int> sizes = { 1, 160, 161, 162, 345, 346, 1000, 70000 };
+
+    int n = 0;
+    for (auto size : sizes) {
+        auto buffer = CreateFrame(size);
+        for (size_t m = sizeof(slice_header); m < buffer->Length(); m++)
+            buffer->Data()[m] = m & 0xff;
+        buffer->SetTimestamp(1234567ll * (n + 1));
+
+        const int flags = (n % 2 == 0) ? ac::streaming::Packetizer::kEmitPATandPMT : 0;
+
+        ac::video::Buffer::Ptr generic_out, fast_out;
+        EXPECT_TRUE(generic->Packetize(generic_id, buffer, &generic_out, flags));
+        EXPECT_TRUE(fast->Packetize(fast_id, buffer, &fast_out, flags));
+
+        ASSERT_EQ(generic_out->Length(), fast_out->Length());
+        EXPECT_EQ(0, ::memcmp(generic_out->Data(), fast_out->Data(), generic_out->Length()));
+        EXPECT_EQ(generic_out->Timestamp(), fast_out->Timestamp());
+
+        n++;
+    }
+}
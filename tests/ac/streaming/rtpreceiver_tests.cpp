@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ac/report/null/jitterbufferreport.h"
+
+#include "ac/streaming/rtpreceiver.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::chrono::milliseconds kWait{100};
+
+class LocalSender {
+public:
+    LocalSender(ac::network::Port port) :
+        socket_(::socket(AF_INET, SOCK_DGRAM, 0)) {
+        struct sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        ::connect(socket_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr));
+    }
+
+    ~LocalSender() {
+        ::close(socket_);
+    }
+
+    void Send(std::uint16_t sequence_number, std::uint8_t payload_type = 33,
+              std::uint8_t flags = 0, std::vector<std::uint8_t> extra = {}) {
+        std::vector<std::uint8_t> packet = {
+            static_cast<std::uint8_t>(0x80 | flags), payload_type,
+            static_cast<std::uint8_t>(sequence_number >> 8), static_cast<std::uint8_t>(sequence_number & 0xff),
+            0x00, 0x00, 0x00, 0x00,
+            0xde, 0xad, 0xbe, 0xef
+        };
+        packet.insert(packet.end(), extra.begin(), extra.end());
+        packet.push_back(sequence_number & 0xff);
+        ::send(socket_, packet.data(), packet.size(), 0);
+    }
+
+private:
+    int socket_;
+};
+}
+
+TEST(RTPReceiver, PicksRandomPort) {
+    auto receiver = ac::streaming::RTPReceiver::Create(ac::streaming::JitterBuffer::Create(
+                std::make_shared<ac::report::null::JitterBufferReport>()));
+    ASSERT_NE(nullptr, receiver);
+    EXPECT_NE(0, receiver->LocalPort());
+    EXPECT_NE(0, receiver->Name().length());
+}
+
+TEST(RTPReceiver, StripsHeadersAndQueuesPayloads) {
+    auto jitter_buffer = ac::streaming::JitterBuffer::Create(std::make_shared<ac::report::null::JitterBufferReport>());
+    auto receiver = ac::streaming::RTPReceiver::Create(jitter_buffer);
+    ASSERT_NE(nullptr, receiver);
+
+    LocalSender sender(receiver->LocalPort());
+    sender.Send(10);
+    // With a CSRC and a header extension
+    sender.Send(11, 33, 0x11, { 0, 0, 0, 1, 0xbe, 0xde, 0x00, 0x01, 0, 0, 0, 0 });
+    sender.Send(12);
+
+    EXPECT_TRUE(receiver->Execute());
+
+    for (int n = 10; n < 13; n++) {
+        const auto payload = jitter_buffer->Next(kWait);
+        ASSERT_NE(nullptr, payload);
+        EXPECT_EQ(1, payload->Length());
+        EXPECT_EQ(n, payload->Data()[0]);
+    }
+}
+
+TEST(RTPReceiver, IgnoresOtherPayloadTypes) {
+    auto jitter_buffer = ac::streaming::JitterBuffer::Create(std::make_shared<ac::report::null::JitterBufferReport>());
+    auto receiver = ac::streaming::RTPReceiver::Create(jitter_buffer);
+    ASSERT_NE(nullptr, receiver);
+
+    LocalSender sender(receiver->LocalPort());
+    sender.Send(1, 96);
+
+    EXPECT_TRUE(receiver->Execute());
+    EXPECT_EQ(nullptr, jitter_buffer->Next(std::chrono::milliseconds{0}));
+}
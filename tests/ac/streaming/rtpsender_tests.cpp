@@ -17,6 +17,10 @@
 
 #include <gmock/gmock.h>
 
+#include <chrono>
+#include <future>
+#include <thread>
+
 #include <boost/concept_check.hpp>
 
 #include "ac/network/stream.h"
@@ -44,6 +48,19 @@ public:
 class MockSenderReport : public ac::video::SenderReport {
 public:
     MOCK_METHOD2(SentPacket, void(const ac::TimestampUs&, const size_t&));
+    MOCK_METHOD2(DroppedPacket, void(const ac::TimestampUs&, const size_t&));
+    MOCK_METHOD3(TransmittedPacket, void(const ac::TimestampUs&, const std::string&, const ac::TimestampUs&));
+};
+
+class TimestampingNetworkStream : public MockNetworkStream {
+public:
+    std::vector<TransmitTimestamp> ReadTransmitTimestamps() override {
+        std::vector<TransmitTimestamp> timestamps;
+        timestamps.swap(timestamps_);
+        return timestamps;
+    }
+
+    std::vector<TransmitTimestamp> timestamps_;
 };
 }
 
@@ -142,6 +159,31 @@ TEST(RTPSender, QueuesUpPackagesAndSendsAll) {
     EXPECT_TRUE(sender->Execute());
 }
 
+TEST(RTPSender, StopsDrainingQueueWhenStopped) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    // Teardown happens while we're busy sending to the peer
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(1)
+            .WillOnce(DoAll(InvokeWithoutArgs([&]() { sender->Stop(); }),
+                            Return(ac::network::Stream::Error::kNone)));
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+
+    EXPECT_TRUE(sender->Start());
+    EXPECT_TRUE(sender->Queue(packets));
+    EXPECT_TRUE(sender->Execute());
+}
+
 TEST(RTPSender, WritePackageFails) {
     auto mock_stream = std::make_shared<MockNetworkStream>();
     auto mock_report = std::make_shared<MockSenderReport>();
@@ -161,6 +203,33 @@ TEST(RTPSender, WritePackageFails) {
     EXPECT_FALSE(sender->Execute());
 }
 
+TEST(RTPSender, ReportsPacketsDroppedByStream) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(3)
+            .WillOnce(Return(ac::network::Stream::Error::kNone))
+            .WillOnce(Return(ac::network::Stream::Error::kTimedOut))
+            .WillOnce(Return(ac::network::Stream::Error::kNone));
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _))
+            .Times(2);
+    EXPECT_CALL(*mock_report, DroppedPacket(_, _))
+            .Times(1);
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+
+    EXPECT_TRUE(sender->Queue(packets));
+    // A dropped packet isn't a network error and the ones after it still go out
+    EXPECT_TRUE(sender->Execute());
+}
+
 TEST(RTPSender, ConstructsCorrectRTPHeader) {
     auto mock_stream = std::make_shared<MockNetworkStream>();
     auto mock_report = std::make_shared<MockSenderReport>();
@@ -230,3 +299,157 @@ TEST(RTPSender, ConstructsCorrectRTPHeader) {
     if (output_data)
         delete output_data;
 }
+
+TEST(RTPSender, PacesPacketsWithConfiguredRate) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _))
+            .Times(5);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    std::vector<ac::TimestampUs> send_times;
+
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(5)
+            .WillRepeatedly(DoAll(InvokeWithoutArgs([&]() { send_times.push_back(ac::Utils::GetNowUs()); }),
+                                  Return(ac::network::Stream::Error::kNone)));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    // Seven TS packets per RTP packet should leave every 5ms
+    sender->SetPacingRate(kMPEGTSPacketSize * 7 * 8 * 200);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 7 * 5);
+    EXPECT_TRUE(sender->Queue(packets));
+
+    for (int n = 0; n < 5; n++)
+        EXPECT_TRUE(sender->Execute());
+
+    ASSERT_EQ(5u, send_times.size());
+    EXPECT_GE(send_times.back() - send_times.front(), 4 * 5000 - 500);
+}
+
+TEST(RTPSender, StopWakesUpPacing) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _))
+            .Times(1);
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .Times(1)
+            .WillRepeatedly(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    // One RTP packet every ten seconds
+    sender->SetPacingRate(kMPEGTSPacketSize * 7 * 8 / 10);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 7 * 2);
+    EXPECT_TRUE(sender->Start());
+    EXPECT_TRUE(sender->Queue(packets));
+    EXPECT_TRUE(sender->Execute());
+
+    auto execute = std::async(std::launch::async, [&]() { return sender->Execute(); });
+    EXPECT_EQ(std::future_status::timeout, execute.wait_for(std::chrono::milliseconds{50}));
+
+    EXPECT_TRUE(sender->Stop());
+    ASSERT_EQ(std::future_status::ready, execute.wait_for(std::chrono::seconds{1}));
+    EXPECT_TRUE(execute.get());
+
+    // Stopped senders don't send the rest either
+    EXPECT_TRUE(sender->Execute());
+}
+
+TEST(RTPSender, ProducerIsNotBlockedBySocketWrites) {
+    auto mock_stream = std::make_shared<MockNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_report, SentPacket(_, _))
+            .Times(AnyNumber());
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    std::promise<void> write_entered;
+    std::promise<void> write_released;
+    auto released = write_released.get_future().share();
+
+    // The first write hangs like one to a congested socket would
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .WillOnce(DoAll(InvokeWithoutArgs([&]() {
+                                write_entered.set_value();
+                                released.wait();
+                            }),
+                            Return(ac::network::Stream::Error::kNone)))
+            .WillRepeatedly(Return(ac::network::Stream::Error::kNone));
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize * 15);
+    EXPECT_TRUE(sender->Queue(packets));
+
+    auto execute = std::async(std::launch::async, [&]() { return sender->Execute(); });
+    write_entered.get_future().wait();
+
+    // The producer only has to hand over its packets and doesn't wait
+    // for the write to finish.
+    auto queue = std::async(std::launch::async, [&]() {
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_TRUE(sender->Queue(packets));
+        return std::chrono::steady_clock::now() - start;
+    });
+
+    const auto finished = queue.wait_for(std::chrono::seconds{5});
+    write_released.set_value();
+
+    ASSERT_EQ(std::future_status::ready, finished);
+    EXPECT_LT(queue.get(), std::chrono::milliseconds{50});
+
+    EXPECT_TRUE(execute.get());
+    // What was queued meanwhile goes out with the next iteration
+    EXPECT_TRUE(sender->Execute());
+}
+
+TEST(RTPSender, ReportsTransmitTimestampsOfStream) {
+    auto mock_stream = std::make_shared<TimestampingNetworkStream>();
+    auto mock_report = std::make_shared<MockSenderReport>();
+
+    EXPECT_CALL(*mock_stream, MaxUnitSize())
+            .WillRepeatedly(Return(kStreamMaxUnitSize));
+
+    EXPECT_CALL(*mock_stream, Write(_, _, _))
+            .WillOnce(InvokeWithoutArgs([&]() {
+                // Timestamps of a previous packet which show up meanwhile
+                mock_stream->timestamps_.push_back(ac::network::Stream::TransmitTimestamp{
+                    1000, ac::network::Stream::TransmitPoint::kScheduled, 20});
+                mock_stream->timestamps_.push_back(ac::network::Stream::TransmitTimestamp{
+                    1000, ac::network::Stream::TransmitPoint::kSoftware, 150});
+                return ac::network::Stream::Error::kNone;
+            }));
+
+    EXPECT_CALL(*mock_report, SentPacket(2000, _))
+            .Times(1);
+
+    {
+        InSequence s;
+        EXPECT_CALL(*mock_report, TransmittedPacket(1000, std::string("scheduled"), 20))
+                .Times(1);
+        EXPECT_CALL(*mock_report, TransmittedPacket(1000, std::string("software"), 150))
+                .Times(1);
+    }
+
+    auto sender = std::make_shared<ac::streaming::RTPSender>(mock_stream, mock_report);
+
+    auto packets = ac::video::Buffer::Create(kMPEGTSPacketSize);
+    packets->SetTimestamp(2000);
+
+    EXPECT_TRUE(sender->Queue(packets));
+    EXPECT_TRUE(sender->Execute());
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/logger.h"
+
+#include "ac/ubuntu/pmqoslatencylock.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::chrono::microseconds kTarget{50};
+
+// Roughly what the renderer does between two frames at 30 fps
+static constexpr std::chrono::milliseconds kSleepTime{5};
+static constexpr unsigned int kWakeups{200};
+
+typedef std::chrono::steady_clock Clock;
+
+// Stands in for /dev/cpu_dma_latency which only root can write to
+class FakeDeviceNode {
+public:
+    FakeDeviceNode() :
+        path_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {
+        std::ofstream(path_.string());
+    }
+
+    ~FakeDeviceNode() {
+        boost::filesystem::remove(path_);
+    }
+
+    std::string Path() const {
+        return path_.string();
+    }
+
+    std::vector<std::int32_t> Requests() const {
+        std::vector<std::int32_t> requests;
+        std::ifstream in(path_.string(), std::ios::binary);
+        std::int32_t value = 0;
+        while (in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+            requests.push_back(value);
+        return requests;
+    }
+
+    // Number of file descriptors we have open for the node
+    unsigned int OpenCount() const {
+        unsigned int count = 0;
+        for (boost::filesystem::directory_iterator it("/proc/self/fd"), end; it != end; ++it) {
+            boost::system::error_code ec;
+            if (boost::filesystem::read_symlink(it->path(), ec) == path_)
+                count++;
+        }
+        return count;
+    }
+
+private:
+    boost::filesystem::path path_;
+};
+
+struct WakeupStatistics {
+    std::chrono::microseconds p50;
+    std::chrono::microseconds p99;
+    std::chrono::microseconds cpu_time;
+};
+
+// Measures how late we wake up from a sleep and how much CPU time the
+// whole run took as proxy for the time not spent idle.
+WakeupStatistics MeasureWakeups() {
+    std::vector<Clock::duration> delays;
+
+    struct rusage before;
+    ::getrusage(RUSAGE_THREAD, &before);
+
+    for (unsigned int n = 0; n < kWakeups; n++) {
+        const auto start = Clock::now();
+        std::this_thread::sleep_for(kSleepTime);
+        delays.push_back(Clock::now() - start - kSleepTime);
+    }
+
+    struct rusage after;
+    ::getrusage(RUSAGE_THREAD, &after);
+
+    std::sort(delays.begin(), delays.end());
+
+    const auto to_us = [](const struct timeval &tv) {
+        return std::chrono::seconds{tv.tv_sec} + std::chrono::microseconds{tv.tv_usec};
+    };
+
+    WakeupStatistics statistics;
+    statistics.p50 = std::chrono::duration_cast<std::chrono::microseconds>(delays[kWakeups / 2]);
+    statistics.p99 = std::chrono::duration_cast<std::chrono::microseconds>(delays[kWakeups * 99 / 100]);
+    statistics.cpu_time = (to_us(after.ru_utime) + to_us(after.ru_stime)) -
+                          (to_us(before.ru_utime) + to_us(before.ru_stime));
+    return statistics;
+}
+}
+
+TEST(PmQosLatencyLock, HoldsRequestWhileAcquired) {
+    FakeDeviceNode node;
+    auto lock = ac::ubuntu::PmQosLatencyLock::Create(kTarget, node.Path());
+
+    EXPECT_FALSE(lock->Held());
+    EXPECT_EQ(0u, node.OpenCount());
+
+    lock->Acquire(ac::CpuLatencyState::Low);
+    EXPECT_TRUE(lock->Held());
+    EXPECT_EQ(1u, node.OpenCount());
+    EXPECT_THAT(node.Requests(), ElementsAre(kTarget.count()));
+
+    // Nested requests share the same one
+    lock->Acquire(ac::CpuLatencyState::Low);
+    lock->Release(ac::CpuLatencyState::Low);
+    EXPECT_TRUE(lock->Held());
+    EXPECT_EQ(1u, node.OpenCount());
+    EXPECT_EQ(1u, node.Requests().size());
+
+    lock->Release(ac::CpuLatencyState::Low);
+    EXPECT_FALSE(lock->Held());
+    EXPECT_EQ(0u, node.OpenCount());
+
+    // Unbalanced releases are ignored
+    lock->Release(ac::CpuLatencyState::Low);
+    EXPECT_FALSE(lock->Held());
+}
+
+TEST(PmQosLatencyLock, ReleasesRequestOnDestruction) {
+    FakeDeviceNode node;
+
+    {
+        auto lock = ac::ubuntu::PmQosLatencyLock::Create(kTarget, node.Path());
+        lock->Acquire(ac::CpuLatencyState::Low);
+        EXPECT_EQ(1u, node.OpenCount());
+    }
+
+    EXPECT_EQ(0u, node.OpenCount());
+}
+
+TEST(PmQosLatencyLock, MissingDeviceIsNotFatal) {
+    auto lock = ac::ubuntu::PmQosLatencyLock::Create(kTarget, "/does/not/exist");
+
+    lock->Acquire(ac::CpuLatencyState::Low);
+    EXPECT_FALSE(lock->Held());
+    lock->Release(ac::CpuLatencyState::Low);
+    EXPECT_FALSE(lock->Held());
+}
+
+TEST(PmQosLatencyLock, MeasuresWakeupLatencyAndIdleCost) {
+    FakeDeviceNode node;
+    auto lock = ac::ubuntu::PmQosLatencyLock::Create(kTarget, node.Path());
+
+    const auto unconstrained = MeasureWakeups();
+
+    lock->Acquire(ac::CpuLatencyState::Low);
+    const auto constrained = MeasureWakeups();
+    lock->Release(ac::CpuLatencyState::Low);
+
+    // A fake node has no effect on the idle states so this only gives a
+    // baseline; run with a real device to see the difference.
+    AC_DEBUG("wakeup delay p50/p99 unconstrained %d/%d us, constrained %d/%d us",
+             unconstrained.p50.count(), unconstrained.p99.count(),
+             constrained.p50.count(), constrained.p99.count());
+    AC_DEBUG("cpu time unconstrained %d us, constrained %d us",
+             unconstrained.cpu_time.count(), constrained.cpu_time.count());
+
+    // Holding the request itself must not keep us busy
+    EXPECT_LT(constrained.cpu_time, std::chrono::milliseconds{kWakeups});
+    EXPECT_FALSE(lock->Held());
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/uibc/genericinputencoder.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kWidth{1280};
+static constexpr unsigned int kHeight{720};
+static constexpr std::size_t kPointerMessageSize{13};
+static constexpr std::size_t kKeyMessageSize{12};
+
+struct input_event Event(std::uint16_t type, std::uint16_t code, std::int32_t value) {
+    struct input_event event;
+    ::memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+void Report(ac::uibc::GenericInputEncoder &encoder, std::vector<std::uint8_t> &out,
+            std::initializer_list<struct input_event> events) {
+    for (const auto &event : events)
+        encoder.Process(event, out);
+    encoder.Process(Event(EV_SYN, SYN_REPORT, 0), out);
+}
+
+std::vector<std::uint8_t> PointerMessage(ac::uibc::GenericInputEncoder::InputId id,
+                                         std::uint16_t x, std::uint16_t y) {
+    return std::vector<std::uint8_t>{
+        0x00, 0x00, 0x00, kPointerMessageSize,
+        static_cast<std::uint8_t>(id), 0x00, 0x06,
+        0x01, 0x00, static_cast<std::uint8_t>(x >> 8), static_cast<std::uint8_t>(x & 0xff),
+        static_cast<std::uint8_t>(y >> 8), static_cast<std::uint8_t>(y & 0xff)
+    };
+}
+}
+
+TEST(GenericInputEncoder, CoalescesPointerMotion) {
+    ac::uibc::GenericInputEncoder encoder{kWidth, kHeight};
+    std::vector<std::uint8_t> out;
+
+    for (int n = 0; n < 10; n++)
+        Report(encoder, out, { Event(EV_REL, REL_X, 5), Event(EV_REL, REL_Y, -2) });
+
+    // Nothing written until flushed
+    EXPECT_TRUE(out.empty());
+    EXPECT_TRUE(encoder.HasPendingMotion());
+
+    encoder.Flush(out);
+
+    EXPECT_FALSE(encoder.HasPendingMotion());
+    EXPECT_EQ(PointerMessage(ac::uibc::GenericInputEncoder::InputId::kMouseMove,
+                             kWidth / 2 + 50, kHeight / 2 - 20), out);
+}
+
+TEST(GenericInputEncoder, ClampsToDisplay) {
+    ac::uibc::GenericInputEncoder encoder{kWidth, kHeight};
+    std::vector<std::uint8_t> out;
+
+    Report(encoder, out, { Event(EV_REL, REL_X, 10000), Event(EV_REL, REL_Y, -10000) });
+    encoder.Flush(out);
+
+    EXPECT_EQ(PointerMessage(ac::uibc::GenericInputEncoder::InputId::kMouseMove,
+                             kWidth - 1, 0), out);
+}
+
+TEST(GenericInputEncoder, MovesBeforeClicking) {
+    ac::uibc::GenericInputEncoder encoder{kWidth, kHeight};
+    std::vector<std::uint8_t> out;
+
+    Report(encoder, out, { Event(EV_ABS, ABS_X, 100), Event(EV_ABS, ABS_Y, 200) });
+    Report(encoder, out, { Event(EV_KEY, BTN_LEFT, 1) });
+
+    auto expected = PointerMessage(ac::uibc::GenericInputEncoder::InputId::kMouseMove, 100, 200);
+    const auto down = PointerMessage(ac::uibc::GenericInputEncoder::InputId::kLeftMouseDown, 100, 200);
+    expected.insert(expected.end(), down.begin(), down.end());
+
+    EXPECT_EQ(expected, out);
+    EXPECT_FALSE(encoder.HasPendingMotion());
+
+    out.clear();
+    Report(encoder, out, { Event(EV_KEY, BTN_LEFT, 0) });
+
+    EXPECT_EQ(PointerMessage(ac::uibc::GenericInputEncoder::InputId::kLeftMouseUp, 100, 200), out);
+}
+
+TEST(GenericInputEncoder, EncodesKeys) {
+    ac::uibc::GenericInputEncoder encoder;
+    std::vector<std::uint8_t> out;
+
+    Report(encoder, out, { Event(EV_KEY, KEY_A, 1) });
+    // Auto repeat isn't forwarded
+    Report(encoder, out, { Event(EV_KEY, KEY_A, 2) });
+    Report(encoder, out, { Event(EV_KEY, KEY_A, 0) });
+    // Neither are keys without a key code
+    Report(encoder, out, { Event(EV_KEY, KEY_LEFTSHIFT, 1) });
+
+    const std::vector<std::uint8_t> expected{
+        0x00, 0x00, 0x00, kKeyMessageSize, 0x03, 0x00, 0x05, 0x00, 0x00, 'a', 0x00, 0x00,
+        0x00, 0x00, 0x00, kKeyMessageSize, 0x04, 0x00, 0x05, 0x00, 0x00, 'a', 0x00, 0x00,
+    };
+    EXPECT_EQ(expected, out);
+}
+
+TEST(GenericInputEncoder, EncodesScrolling) {
+    ac::uibc::GenericInputEncoder encoder;
+    std::vector<std::uint8_t> out;
+
+    // Two notches down and one to the right
+    Report(encoder, out, { Event(EV_REL, REL_WHEEL, -2), Event(EV_REL, REL_HWHEEL, 1) });
+
+    const std::vector<std::uint8_t> expected{
+        0x00, 0x00, 0x00, 0x09, 0x06, 0x00, 0x02, 0x60, 0x02,
+        0x00, 0x00, 0x00, 0x09, 0x07, 0x00, 0x02, 0x60, 0x01,
+    };
+    EXPECT_EQ(expected, out);
+}
+
+TEST(GenericInputEncoder, DiscardsDroppedReport) {
+    ac::uibc::GenericInputEncoder encoder;
+    std::vector<std::uint8_t> out;
+
+    encoder.Process(Event(EV_KEY, KEY_A, 1), out);
+    encoder.Process(Event(EV_SYN, SYN_DROPPED, 0), out);
+    encoder.Process(Event(EV_SYN, SYN_REPORT, 0), out);
+
+    EXPECT_TRUE(out.empty());
+}
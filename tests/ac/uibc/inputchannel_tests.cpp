@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "ac/logger.h"
+
+#include "ac/common/threadedexecutor.h"
+
+#include "ac/network/tcpstream.h"
+
+#include "ac/uibc/inputchannel.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::size_t kPointerMessageSize{13};
+static constexpr unsigned int kSamples{100};
+static constexpr std::chrono::milliseconds kReceiveTimeout{2000};
+// Generous to not fail on loaded machines; on an idle one input is on
+// the wire well below a millisecond.
+static constexpr std::chrono::milliseconds kMaxLatency{50};
+
+typedef std::chrono::steady_clock Clock;
+
+class LoopbackRemote {
+public:
+    LoopbackRemote() :
+        listener_(::socket(AF_INET, SOCK_STREAM, 0)),
+        connection_(-1),
+        port_(0) {
+
+        struct sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        ::bind(listener_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        ::listen(listener_, 1);
+
+        socklen_t length = sizeof(addr);
+        ::getsockname(listener_, reinterpret_cast<struct sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+    }
+
+    ~LoopbackRemote() {
+        if (connection_ >= 0)
+            ::close(connection_);
+        ::close(listener_);
+    }
+
+    ac::network::Port Port() const {
+        return port_;
+    }
+
+    bool Accept() {
+        struct pollfd fds{listener_, POLLIN, 0};
+        if (::poll(&fds, 1, kReceiveTimeout.count()) <= 0)
+            return false;
+
+        connection_ = ::accept(listener_, nullptr, nullptr);
+        return connection_ >= 0;
+    }
+
+    std::vector<std::uint8_t> Receive(std::size_t size) {
+        std::vector<std::uint8_t> data(size);
+        std::size_t offset = 0;
+        while (offset < size) {
+            struct pollfd fds{connection_, POLLIN, 0};
+            if (::poll(&fds, 1, kReceiveTimeout.count()) <= 0)
+                break;
+
+            const auto bytes = ::read(connection_, data.data() + offset, size - offset);
+            if (bytes <= 0)
+                break;
+            offset += bytes;
+        }
+        data.resize(offset);
+        return data;
+    }
+
+    // Everything received until nothing arrives for a while
+    std::vector<std::uint8_t> ReceiveAll() {
+        std::vector<std::uint8_t> data;
+        std::uint8_t buffer[1024];
+        while (true) {
+            struct pollfd fds{connection_, POLLIN, 0};
+            if (::poll(&fds, 1, 200) <= 0)
+                break;
+
+            const auto bytes = ::read(connection_, buffer, sizeof(buffer));
+            if (bytes <= 0)
+                break;
+            data.insert(data.end(), buffer, buffer + bytes);
+        }
+        return data;
+    }
+
+private:
+    int listener_;
+    int connection_;
+    ac::network::Port port_;
+};
+
+class InputChannelFixture : public ::testing::Test {
+public:
+    void SetUp() override {
+        int fds[2];
+        ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        provider_ = fds[1];
+
+        auto channel = ac::uibc::InputChannel::Create(fds[0], std::make_shared<ac::network::TcpStream>(),
+                                                      "127.0.0.1", remote_.Port());
+        executor_ = std::make_shared<ac::common::ThreadedExecutor>(channel);
+        ASSERT_TRUE(executor_->Start());
+        ASSERT_TRUE(remote_.Accept());
+    }
+
+    void TearDown() override {
+        executor_->Stop();
+        ::close(provider_);
+    }
+
+    void Write(std::initializer_list<struct input_event> events) {
+        std::vector<struct input_event> report{events};
+        struct input_event syn;
+        ::memset(&syn, 0, sizeof(syn));
+        syn.type = EV_SYN;
+        syn.code = SYN_REPORT;
+        report.push_back(syn);
+
+        ASSERT_EQ(static_cast<ssize_t>(report.size() * sizeof(struct input_event)),
+                  ::write(provider_, report.data(), report.size() * sizeof(struct input_event)));
+    }
+
+    static struct input_event Event(std::uint16_t type, std::uint16_t code, std::int32_t value) {
+        struct input_event event;
+        ::memset(&event, 0, sizeof(event));
+        event.type = type;
+        event.code = code;
+        event.value = value;
+        return event;
+    }
+
+protected:
+    LoopbackRemote remote_;
+    int provider_;
+    ac::common::Executor::Ptr executor_;
+};
+}
+
+TEST_F(InputChannelFixture, InputToWireLatency) {
+    std::vector<Clock::duration> latencies;
+
+    for (unsigned int n = 0; n < kSamples; n++) {
+        const auto start = Clock::now();
+        Write({ Event(EV_KEY, BTN_LEFT, n % 2 == 0 ? 1 : 0) });
+
+        const auto message = remote_.Receive(kPointerMessageSize);
+        ASSERT_EQ(kPointerMessageSize, message.size());
+        latencies.push_back(Clock::now() - start);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto median = std::chrono::duration_cast<std::chrono::microseconds>(latencies[kSamples / 2]);
+    const auto p95 = std::chrono::duration_cast<std::chrono::microseconds>(latencies[kSamples * 95 / 100]);
+
+    AC_DEBUG("input to wire latency: median %d us, 95th percentile %d us", median.count(), p95.count());
+
+    EXPECT_LT(p95, kMaxLatency);
+}
+
+TEST_F(InputChannelFixture, CoalescesMotion) {
+    static constexpr unsigned int kReports{200};
+
+    for (unsigned int n = 0; n < kReports; n++)
+        Write({ Event(EV_ABS, ABS_X, n), Event(EV_ABS, ABS_Y, n) });
+
+    const auto data = remote_.ReceiveAll();
+
+    ASSERT_GE(data.size(), kPointerMessageSize);
+    ASSERT_EQ(0u, data.size() % kPointerMessageSize);
+    EXPECT_LT(data.size() / kPointerMessageSize, kReports);
+
+    // The last position always makes it to the remote
+    const auto last = data.end() - kPointerMessageSize;
+    EXPECT_EQ(kReports - 1, static_cast<unsigned int>(last[9] << 8 | last[10]));
+    EXPECT_EQ(kReports - 1, static_cast<unsigned int>(last[11] << 8 | last[12]));
+}
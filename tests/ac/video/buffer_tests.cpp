@@ -104,3 +104,33 @@ TEST(Buffer, RangeSelection) {
     buffer->SetRange(-1, -1);
     EXPECT_EQ(test_data[1], buffer->Data()[0]);
 }
+
+TEST(Buffer, ViewReferencesParent) {
+    uint8_t test_data[] = { 0xff, 0xee, 0xdd, 0xcc };
+
+    auto parent = Buffer::Create(test_data, sizeof(test_data));
+    parent->SetTimestamp(1234);
+
+    auto view = Buffer::Create(parent, 1, 2);
+    ASSERT_NE(nullptr, view);
+    EXPECT_EQ(parent->Data() + 1, view->Data());
+    EXPECT_EQ(2, view->Length());
+    EXPECT_EQ(1234, view->Timestamp());
+
+    // The view keeps the memory alive
+    parent.reset();
+    EXPECT_EQ(test_data[1], view->Data()[0]);
+    EXPECT_EQ(test_data[2], view->Data()[1]);
+
+    parent = Buffer::Create(test_data, sizeof(test_data));
+    EXPECT_EQ(nullptr, Buffer::Create(parent, 3, 2));
+    EXPECT_EQ(nullptr, Buffer::Create(parent, 5, 0));
+}
+
+TEST(Buffer, TemporalLayerUnknownByDefault) {
+    auto buffer = Buffer::Create(10);
+    EXPECT_EQ(-1, buffer->TemporalLayer());
+
+    buffer->SetTemporalLayer(2);
+    EXPECT_EQ(2, buffer->TemporalLayer());
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <random>
+#include <vector>
+
+#include "ac/video/colorconverter.h"
+
+using namespace ::testing;
+
+namespace {
+static const ac::video::ColorConverter::Kernel kAllKernels[] = {
+    ac::video::ColorConverter::Kernel::kSSE41,
+    ac::video::ColorConverter::Kernel::kAVX2,
+    ac::video::ColorConverter::Kernel::kNEON,
+};
+
+std::vector<std::uint8_t> RandomImage(unsigned int stride, unsigned int height) {
+    std::mt19937 generator(stride * height);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<std::uint8_t> image(stride * height);
+    for (auto &value : image)
+        value = distribution(generator);
+    return image;
+}
+
+std::vector<std::uint8_t> UniformImage(unsigned int width, unsigned int height,
+                                       std::uint8_t r, std::uint8_t g, std::uint8_t b) {
+    std::vector<std::uint8_t> image(width * height * 4);
+    for (unsigned int n = 0; n < width * height; n++) {
+        image[n * 4] = r;
+        image[n * 4 + 1] = g;
+        image[n * 4 + 2] = b;
+        image[n * 4 + 3] = 0xff;
+    }
+    return image;
+}
+
+std::vector<std::uint8_t> Convert(const ac::video::ColorConverter::Config &config,
+                                  const std::vector<std::uint8_t> &image) {
+    auto converter = ac::video::ColorConverter::Create(config);
+    EXPECT_NE(nullptr, converter);
+    if (!converter)
+        return std::vector<std::uint8_t>{};
+
+    std::vector<std::uint8_t> output(converter->OutputSize(), 0);
+    converter->Convert(image.data(), output.data());
+    return output;
+}
+
+ac::video::ColorConverter::Config ConfigFor(unsigned int width, unsigned int height) {
+    ac::video::ColorConverter::Config config;
+    config.source_width = width;
+    config.source_height = height;
+    config.width = width;
+    config.height = height;
+    return config;
+}
+}
+
+TEST(ColorConverter, ConvertsKnownColors) {
+    auto config = ConfigFor(16, 16);
+    config.matrix = ac::video::ColorConverter::Matrix::kBT601;
+    config.kernel = ac::video::ColorConverter::Kernel::kScalar;
+
+    struct {
+        std::uint8_t r, g, b;
+        std::uint8_t y, u, v;
+    } colors[] = {
+        { 0x00, 0x00, 0x00, 16, 128, 128 },
+        { 0xff, 0xff, 0xff, 235, 128, 128 },
+        { 0xff, 0x00, 0x00, 82, 90, 240 },
+        { 0x00, 0xff, 0x00, 144, 54, 34 },
+        { 0x00, 0x00, 0xff, 41, 240, 110 },
+    };
+
+    for (const auto &color : colors) {
+        const auto output = Convert(config, UniformImage(16, 16, color.r, color.g, color.b));
+        ASSERT_EQ(16u * 16 * 3 / 2, output.size());
+
+        EXPECT_EQ(color.y, output[0]);
+        EXPECT_EQ(color.y, output[16 * 16 - 1]);
+        // NV12 has the chroma samples interleaved after the luma plane
+        EXPECT_EQ(color.u, output[16 * 16]);
+        EXPECT_EQ(color.v, output[16 * 16 + 1]);
+        EXPECT_EQ(color.v, output[output.size() - 1]);
+    }
+}
+
+TEST(ColorConverter, KeepsGraysNeutral) {
+    for (const auto matrix : { ac::video::ColorConverter::Matrix::kBT601,
+                               ac::video::ColorConverter::Matrix::kBT709 }) {
+        auto config = ConfigFor(16, 16);
+        config.matrix = matrix;
+
+        for (unsigned int level = 0; level < 256; level += 15) {
+            const auto output = Convert(config, UniformImage(16, 16, level, level, level));
+            ASSERT_EQ(16u * 16 * 3 / 2, output.size());
+
+            EXPECT_EQ(128, output[16 * 16]);
+            EXPECT_EQ(128, output[16 * 16 + 1]);
+        }
+    }
+}
+
+TEST(ColorConverter, SIMDKernelsAreBitExact) {
+    const unsigned int sizes[][2] = { { 2, 2 }, { 16, 2 }, { 30, 4 }, { 32, 2 }, { 34, 6 },
+                                      { 66, 10 }, { 130, 8 }, { 1920, 16 } };
+
+    for (const auto kernel : kAllKernels) {
+        if (!ac::video::ColorConverter::IsKernelSupported(kernel))
+            continue;
+
+        for (const auto format : { ac::video::ColorConverter::Format::kNV12,
+                                   ac::video::ColorConverter::Format::kI420 }) {
+            for (const auto &size : sizes) {
+                auto config = ConfigFor(size[0], size[1]);
+                config.format = format;
+                const auto image = RandomImage(size[0] * 4, size[1]);
+
+                config.kernel = ac::video::ColorConverter::Kernel::kScalar;
+                const auto reference = Convert(config, image);
+
+                config.kernel = kernel;
+                EXPECT_EQ(reference, Convert(config, image))
+                        << ac::video::ColorConverter::KernelToString(kernel) << " "
+                        << size[0] << "x" << size[1];
+            }
+        }
+    }
+}
+
+TEST(ColorConverter, SIMDKernelsScaleBitExact) {
+    // Source and target sizes in both directions
+    const unsigned int sizes[][4] = { { 1920, 16, 1280, 10 }, { 37, 9, 66, 14 },
+                                      { 640, 4, 22, 2 }, { 50, 50, 50, 34 } };
+
+    for (const auto kernel : kAllKernels) {
+        if (!ac::video::ColorConverter::IsKernelSupported(kernel))
+            continue;
+
+        for (const auto &size : sizes) {
+            auto config = ConfigFor(size[0], size[1]);
+            config.width = size[2];
+            config.height = size[3];
+            const auto image = RandomImage(size[0] * 4, size[1]);
+
+            config.kernel = ac::video::ColorConverter::Kernel::kScalar;
+            const auto reference = Convert(config, image);
+
+            config.kernel = kernel;
+            EXPECT_EQ(reference, Convert(config, image))
+                    << ac::video::ColorConverter::KernelToString(kernel) << " "
+                    << size[0] << "x" << size[1] << " -> " << size[2] << "x" << size[3];
+        }
+    }
+}
+
+TEST(ColorConverter, AutoSelectsSupportedKernel) {
+    auto converter = ac::video::ColorConverter::Create(ConfigFor(64, 64));
+    ASSERT_NE(nullptr, converter);
+
+    EXPECT_NE(ac::video::ColorConverter::Kernel::kAuto, converter->ActiveKernel());
+    EXPECT_TRUE(ac::video::ColorConverter::IsKernelSupported(converter->ActiveKernel()));
+}
+
+TEST(ColorConverter, RespectsSourceStride) {
+    auto config = ConfigFor(34, 4);
+    config.source_stride = 40 * 4;
+
+    auto padded = RandomImage(config.source_stride, 4);
+    std::vector<std::uint8_t> packed;
+    for (unsigned int line = 0; line < 4; line++)
+        packed.insert(packed.end(), padded.begin() + line * config.source_stride,
+                      padded.begin() + line * config.source_stride + 34 * 4);
+
+    const auto expected = Convert(ConfigFor(34, 4), packed);
+    EXPECT_EQ(expected, Convert(config, padded));
+}
+
+TEST(ColorConverter, ThreadsDontChangeOutput) {
+    auto config = ConfigFor(320, 240);
+    const auto image = RandomImage(320 * 4, 240);
+
+    const auto reference = Convert(config, image);
+
+    config.threads = 3;
+    EXPECT_EQ(reference, Convert(config, image));
+
+    config.width = 160;
+    config.height = 90;
+    config.threads = 1;
+    const auto scaled = Convert(config, image);
+
+    config.threads = 4;
+    EXPECT_EQ(scaled, Convert(config, image));
+}
+
+TEST(ColorConverter, ScalesUniformImages) {
+    auto config = ConfigFor(1920, 1080);
+    config.width = 1280;
+    config.height = 720;
+    config.matrix = ac::video::ColorConverter::Matrix::kBT601;
+
+    const auto output = Convert(config, UniformImage(1920, 1080, 0xff, 0x00, 0x00));
+    ASSERT_EQ(1280u * 720 * 3 / 2, output.size());
+
+    for (unsigned int n = 0; n < 1280 * 720; n++)
+        ASSERT_EQ(82, output[n]);
+
+    for (unsigned int n = 1280 * 720; n < output.size(); n += 2) {
+        ASSERT_EQ(90, output[n]);
+        ASSERT_EQ(240, output[n + 1]);
+    }
+}
+
+TEST(ColorConverter, ScalesGradientsSmoothly) {
+    // A horizontal gradient stays a monotonic gradient when downscaled
+    std::vector<std::uint8_t> image(256 * 4 * 4);
+    for (unsigned int line = 0; line < 4; line++) {
+        for (unsigned int x = 0; x < 256; x++) {
+            for (unsigned int c = 0; c < 3; c++)
+                image[(line * 256 + x) * 4 + c] = x;
+        }
+    }
+
+    auto config = ConfigFor(256, 4);
+    config.width = 100;
+    config.height = 2;
+
+    const auto output = Convert(config, image);
+    for (unsigned int x = 1; x < 100; x++)
+        EXPECT_LE(output[x - 1], output[x]);
+
+    EXPECT_GT(output[99] - output[0], 150);
+}
+
+TEST(ColorConverter, RejectsInvalidConfigurations) {
+    EXPECT_EQ(nullptr, ac::video::ColorConverter::Create(ac::video::ColorConverter::Config{}));
+    EXPECT_EQ(nullptr, ac::video::ColorConverter::Create(ConfigFor(15, 16)));
+    EXPECT_EQ(nullptr, ac::video::ColorConverter::Create(ConfigFor(16, 15)));
+
+    auto config = ConfigFor(16, 16);
+    config.source_stride = 16;
+    EXPECT_EQ(nullptr, ac::video::ColorConverter::Create(config));
+
+    for (const auto kernel : kAllKernels) {
+        config = ConfigFor(16, 16);
+        config.kernel = kernel;
+        EXPECT_EQ(ac::video::ColorConverter::IsKernelSupported(kernel),
+                  ac::video::ColorConverter::Create(config) != nullptr);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <memory.h>
+
+#include "ac/video/convertingencoder.h"
+
+using namespace ::testing;
+
+namespace {
+class MockEncoder : public ac::video::BaseEncoder {
+public:
+    MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
+    MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
+    MOCK_CONST_METHOD0(Running, bool());
+    MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_CONST_METHOD0(Name, std::string());
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+};
+
+class MockBufferDelegate : public ac::video::Buffer::Delegate {
+public:
+    MOCK_METHOD1(OnBufferFinished, void(const ac::video::Buffer::Ptr&));
+};
+
+ac::video::ColorConverter::Config SourceConfig() {
+    ac::video::ColorConverter::Config config;
+    config.source_width = 64;
+    config.source_height = 32;
+    return config;
+}
+
+ac::video::BaseEncoder::Config EncoderConfig(unsigned int width, unsigned int height) {
+    ac::video::BaseEncoder::Config config;
+    config.width = width;
+    config.height = height;
+    return config;
+}
+}
+
+TEST(ConvertingEncoder, ConvertsQueuedBuffers) {
+    auto encoder = std::make_shared<MockEncoder>();
+    auto converting_encoder = ac::video::ConvertingEncoder::Create(encoder, SourceConfig());
+
+    EXPECT_CALL(*encoder, Configure(_))
+            .WillOnce(Return(true));
+
+    EXPECT_TRUE(converting_encoder->Configure(EncoderConfig(32, 16)));
+
+    auto input = ac::video::Buffer::Create(64 * 32 * 4);
+    ::memset(input->Data(), 0xff, input->Length());
+    input->SetTimestamp(42);
+
+    auto delegate = std::make_shared<MockBufferDelegate>();
+    input->SetDelegate(delegate);
+
+    EXPECT_CALL(*delegate, OnBufferFinished(Eq(input)))
+            .Times(1);
+
+    ac::video::Buffer::Ptr output;
+    EXPECT_CALL(*encoder, QueueBuffer(_))
+            .WillOnce(SaveArg<0>(&output));
+
+    converting_encoder->QueueBuffer(input);
+
+    ASSERT_NE(nullptr, output);
+    EXPECT_EQ(32u * 16 * 3 / 2, output->Length());
+    EXPECT_EQ(42, output->Timestamp());
+    // White in limited range
+    EXPECT_EQ(235, output->Data()[0]);
+    EXPECT_EQ(128, output->Data()[32 * 16]);
+}
+
+TEST(ConvertingEncoder, RecyclesReleasedBuffers) {
+    auto encoder = std::make_shared<MockEncoder>();
+    auto converting_encoder = ac::video::ConvertingEncoder::Create(encoder, SourceConfig());
+
+    EXPECT_CALL(*encoder, Configure(_))
+            .WillOnce(Return(true));
+
+    EXPECT_TRUE(converting_encoder->Configure(EncoderConfig(64, 32)));
+
+    std::vector<ac::video::Buffer::Ptr> outputs;
+    EXPECT_CALL(*encoder, QueueBuffer(_))
+            .Times(3)
+            .WillRepeatedly(Invoke([&](const ac::video::Buffer::Ptr &buffer) { outputs.push_back(buffer); }));
+
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(64 * 32 * 4));
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(64 * 32 * 4));
+    ASSERT_EQ(2u, outputs.size());
+    EXPECT_NE(outputs[0], outputs[1]);
+
+    outputs[0]->Release();
+
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(64 * 32 * 4));
+    ASSERT_EQ(3u, outputs.size());
+    EXPECT_EQ(outputs[0], outputs[2]);
+}
+
+TEST(ConvertingEncoder, DropsBuffersWhichCantBeConverted) {
+    auto encoder = std::make_shared<MockEncoder>();
+    auto converting_encoder = ac::video::ConvertingEncoder::Create(encoder, SourceConfig());
+
+    EXPECT_CALL(*encoder, QueueBuffer(_))
+            .Times(0);
+
+    // Not configured yet
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(64 * 32 * 4));
+
+    EXPECT_CALL(*encoder, Configure(_))
+            .WillOnce(Return(true));
+
+    EXPECT_TRUE(converting_encoder->Configure(EncoderConfig(64, 32)));
+
+    // Too small and not in CPU memory
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(64 * 4));
+    int native_buffer = 0;
+    converting_encoder->QueueBuffer(ac::video::Buffer::Create(&native_buffer));
+}
+
+TEST(ConvertingEncoder, RejectsSizesItCantConvertTo) {
+    auto encoder = std::make_shared<MockEncoder>();
+    auto converting_encoder = ac::video::ConvertingEncoder::Create(encoder, SourceConfig());
+
+    EXPECT_CALL(*encoder, Configure(_))
+            .Times(0);
+
+    EXPECT_FALSE(converting_encoder->Configure(EncoderConfig(63, 32)));
+}
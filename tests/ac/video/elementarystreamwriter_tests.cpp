@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <iterator>
+
+#include "ac/video/elementarystreamwriter.h"
+
+using namespace ::testing;
+
+TEST(ElementaryStreamWriter, WritesFragmentsInOrder) {
+    char path[] = "/tmp/aethercast-es-XXXXXX";
+    ::close(::mkstemp(path));
+
+    auto writer = ac::video::ElementaryStreamWriter::Create(path);
+    ASSERT_NE(nullptr, writer);
+    EXPECT_TRUE(writer->Start());
+
+    std::vector<std::uint8_t> expected;
+
+    for (int n = 0; n < 3; n++) {
+        ac::video::AccessUnit unit;
+        for (int m = 0; m < 5; m++) {
+            auto fragment = ac::video::Buffer::Create(100 + m);
+            ::memset(fragment->Data(), n * 5 + m, fragment->Length());
+            expected.insert(expected.end(), fragment->Data(), fragment->Data() + fragment->Length());
+            unit.Append(fragment);
+        }
+        EXPECT_TRUE(writer->Decode(unit));
+    }
+
+    EXPECT_TRUE(writer->Stop());
+    writer.reset();
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<std::uint8_t> written{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    EXPECT_EQ(expected, written);
+
+    ::unlink(path);
+}
+
+TEST(ElementaryStreamWriter, FailsOnInvalidPath) {
+    EXPECT_EQ(nullptr, ac::video::ElementaryStreamWriter::Create("/nonexistent/dir/file.h264"));
+}
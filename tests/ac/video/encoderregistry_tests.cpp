@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gmock/gmock.h>
+
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include "ac/video/encoderregistry.h"
+
+using namespace ::testing;
+
+namespace {
+class MockEncoder : public ac::video::BaseEncoder {
+public:
+    MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
+    MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
+    MOCK_CONST_METHOD0(Running, bool());
+    MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_CONST_METHOD0(Name, std::string());
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+};
+
+class FakeBackend {
+public:
+    FakeBackend(unsigned int max_width, unsigned int max_height, std::uint64_t throughput) :
+        available(true),
+        probes(0),
+        encoder(std::make_shared<MockEncoder>()) {
+        capabilities.profiles = { 66, 100 };
+        capabilities.max_level = 42;
+        capabilities.max_width = max_width;
+        capabilities.max_height = max_height;
+        capabilities.max_framerate = 60;
+        capabilities.throughput = throughput;
+    }
+
+    void Register(const ac::video::EncoderRegistry::Ptr &registry, const std::string &name,
+                  const std::string &version = "1") {
+        registry->Register(name, version,
+                           [this](ac::video::EncoderRegistry::Capabilities *result) {
+                               probes++;
+                               *result = capabilities;
+                               return available;
+                           },
+                           [this](const ac::video::EncoderReport::Ptr&) {
+                               return encoder;
+                           });
+    }
+
+    bool available;
+    int probes;
+    ac::video::EncoderRegistry::Capabilities capabilities;
+    std::shared_ptr<MockEncoder> encoder;
+};
+
+ac::video::BaseEncoder::Config Format(unsigned int width, unsigned int height, int framerate = 30) {
+    ac::video::BaseEncoder::Config config;
+    config.width = width;
+    config.height = height;
+    config.framerate = framerate;
+    config.profile_idc = 66;
+    config.level_idc = 31;
+    return config;
+}
+
+std::string CachePath() {
+    char path[] = "/tmp/aethercast-encoders-XXXXXX";
+    ::close(::mkstemp(path));
+    ::unlink(path);
+    return path;
+}
+}
+
+TEST(EncoderRegistry, PicksBackendWithHighestThroughput) {
+    auto registry = ac::video::EncoderRegistry::Create();
+
+    FakeBackend slow(1920, 1080, 1920 * 1080 * 30);
+    FakeBackend fast(1920, 1080, 1920 * 1080 * 60);
+    slow.Register(registry, "slow");
+    fast.Register(registry, "fast");
+
+    EXPECT_EQ(fast.encoder, registry->CreateBest(Format(1280, 720), nullptr));
+    EXPECT_EQ((std::vector<std::string>{"slow", "fast"}), registry->Backends());
+}
+
+TEST(EncoderRegistry, SkipsBackendsNotSupportingFormat) {
+    auto registry = ac::video::EncoderRegistry::Create();
+
+    FakeBackend small(1280, 720, 1920 * 1080 * 120);
+    FakeBackend large(1920, 1080, 1920 * 1080 * 60);
+    small.Register(registry, "small");
+    large.Register(registry, "large");
+
+    EXPECT_EQ(large.encoder, registry->CreateBest(Format(1920, 1080), nullptr));
+
+    auto format = Format(1280, 720);
+    format.profile_idc = 77;
+    EXPECT_EQ(nullptr, registry->CreateBest(format, nullptr));
+
+    format = Format(1280, 720);
+    format.level_idc = 51;
+    EXPECT_EQ(nullptr, registry->CreateBest(format, nullptr));
+
+    EXPECT_EQ(nullptr, registry->CreateBest(Format(1920, 1080, 120), nullptr));
+}
+
+TEST(EncoderRegistry, SkipsBackendsTooSlowForRealTime) {
+    auto registry = ac::video::EncoderRegistry::Create();
+
+    FakeBackend backend(1920, 1080, 1280 * 720 * 30);
+    backend.Register(registry, "backend");
+
+    EXPECT_EQ(backend.encoder, registry->CreateBest(Format(1280, 720), nullptr));
+    EXPECT_EQ(nullptr, registry->CreateBest(Format(1920, 1080), nullptr));
+}
+
+TEST(EncoderRegistry, SkipsUnavailableBackends) {
+    auto registry = ac::video::EncoderRegistry::Create();
+
+    FakeBackend missing(1920, 1080, 1920 * 1080 * 60);
+    missing.available = false;
+    missing.Register(registry, "missing");
+
+    EXPECT_EQ(nullptr, registry->CreateBest(Format(1280, 720), nullptr));
+    EXPECT_FALSE(registry->CapabilitiesOf("missing", nullptr));
+    EXPECT_FALSE(registry->CapabilitiesOf("unknown", nullptr));
+}
+
+TEST(EncoderRegistry, ProbesOnlyWhenNeeded) {
+    auto registry = ac::video::EncoderRegistry::Create();
+
+    FakeBackend backend(1920, 1080, 0);
+    backend.Register(registry, "backend");
+    EXPECT_EQ(0, backend.probes);
+
+    ac::video::EncoderRegistry::Capabilities capabilities;
+    EXPECT_TRUE(registry->CapabilitiesOf("backend", &capabilities));
+    EXPECT_EQ(1920, capabilities.max_width);
+    EXPECT_EQ(1080, capabilities.max_height);
+
+    registry->CreateBest(Format(1280, 720), nullptr);
+    registry->CreateBest(Format(1920, 1080), nullptr);
+    EXPECT_EQ(1, backend.probes);
+}
+
+TEST(EncoderRegistry, CachesProbeResultsOnDisk) {
+    const auto path = CachePath();
+
+    FakeBackend first(1920, 1080, 1920 * 1080 * 60);
+    {
+        auto registry = ac::video::EncoderRegistry::Create(path);
+        first.Register(registry, "backend");
+        registry->CreateBest(Format(1280, 720), nullptr);
+        EXPECT_EQ(1, first.probes);
+    }
+
+    // Capabilities are restored from the cache written by the first
+    // registry without probing again.
+    FakeBackend second(1280, 720, 0);
+    auto registry = ac::video::EncoderRegistry::Create(path);
+    second.Register(registry, "backend");
+
+    ac::video::EncoderRegistry::Capabilities capabilities;
+    EXPECT_TRUE(registry->CapabilitiesOf("backend", &capabilities));
+    EXPECT_EQ(0, second.probes);
+    EXPECT_EQ(1920, capabilities.max_width);
+    EXPECT_EQ(1080, capabilities.max_height);
+    EXPECT_EQ(60, capabilities.max_framerate);
+    EXPECT_EQ(42, capabilities.max_level);
+    EXPECT_EQ((std::vector<unsigned int>{66, 100}), capabilities.profiles);
+    EXPECT_EQ(1920 * 1080 * 60, capabilities.throughput);
+
+    // A new version of the backend is probed again
+    FakeBackend updated(1280, 720, 0);
+    registry = ac::video::EncoderRegistry::Create(path);
+    updated.Register(registry, "backend", "2");
+    EXPECT_TRUE(registry->CapabilitiesOf("backend", &capabilities));
+    EXPECT_EQ(1, updated.probes);
+    EXPECT_EQ(1280, capabilities.max_width);
+
+    ::unlink(path.c_str());
+}
+
+TEST(EncoderRegistry, ProbesUnavailableBackendsAgainAfterRestart) {
+    const auto path = CachePath();
+
+    FakeBackend failing(1920, 1080, 0);
+    failing.available = false;
+    {
+        auto registry = ac::video::EncoderRegistry::Create(path);
+        failing.Register(registry, "backend");
+        EXPECT_FALSE(registry->CapabilitiesOf("backend", nullptr));
+        EXPECT_FALSE(registry->CapabilitiesOf("backend", nullptr));
+        EXPECT_EQ(1, failing.probes);
+    }
+
+    FakeBackend recovered(1920, 1080, 0);
+    auto registry = ac::video::EncoderRegistry::Create(path);
+    recovered.Register(registry, "backend");
+
+    EXPECT_TRUE(registry->CapabilitiesOf("backend", nullptr));
+    EXPECT_EQ(1, recovered.probes);
+
+    ::unlink(path.c_str());
+}
+
+TEST(EncoderRegistry, IgnoresCorruptCache) {
+    const auto path = CachePath();
+
+    FILE *file = ::fopen(path.c_str(), "w");
+    ASSERT_NE(nullptr, file);
+    ::fputs("something else\nbackend 1 1 x\n", file);
+    ::fclose(file);
+
+    FakeBackend backend(1920, 1080, 0);
+    auto registry = ac::video::EncoderRegistry::Create(path);
+    backend.Register(registry, "backend");
+
+    EXPECT_TRUE(registry->CapabilitiesOf("backend", nullptr));
+    EXPECT_EQ(1, backend.probes);
+
+    ::unlink(path.c_str());
+}
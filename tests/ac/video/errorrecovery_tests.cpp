@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <memory.h>
+
+#include <thread>
+
+#include "ac/video/errorrecovery.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr std::size_t kPFrameSize{10000};
+// What hardware encoders typically produce in relation to a P frame
+static constexpr std::size_t kIDRFrameSize{8 * kPFrameSize};
+static constexpr std::size_t kIntraRefreshFrameSize{kPFrameSize * 12 / 10};
+
+class MockEncoder : public ac::video::BaseEncoder {
+public:
+    MOCK_METHOD0(DefaultConfiguration, ac::video::BaseEncoder::Config());
+    MOCK_METHOD1(Configure, bool(const ac::video::BaseEncoder::Config&));
+    MOCK_METHOD1(QueueBuffer, void(const ac::video::Buffer::Ptr&));
+    MOCK_CONST_METHOD0(Configuration, ac::video::BaseEncoder::Config());
+    MOCK_CONST_METHOD0(Running, bool());
+    MOCK_METHOD0(SendIDRFrame, void());
+    MOCK_CONST_METHOD0(IntraRefreshPeriod, unsigned int());
+    MOCK_CONST_METHOD0(Name, std::string());
+    MOCK_METHOD0(Start, bool());
+    MOCK_METHOD0(Stop, bool());
+    MOCK_METHOD0(Execute, bool());
+};
+
+class CollectingDelegate : public ac::video::BaseEncoder::Delegate {
+public:
+    void OnBufferAvailable(const ac::video::Buffer::Ptr &buffer) override {
+        buffers.push_back(buffer);
+    }
+
+    void OnBufferWithCodecConfig(const ac::video::Buffer::Ptr &buffer) override {
+        buffers.push_back(buffer);
+    }
+
+    std::vector<ac::video::Buffer::Ptr> buffers;
+};
+
+ac::video::Buffer::Ptr CreateFrame(std::uint8_t nal_type, std::size_t size, bool with_delimiter = false) {
+    auto frame = ac::video::Buffer::Create(size);
+    ::memset(frame->Data(), 0xab, size);
+
+    std::uint8_t *ptr = frame->Data();
+    if (with_delimiter) {
+        const std::uint8_t delimiter[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+        ::memcpy(ptr, delimiter, sizeof(delimiter));
+        ptr += sizeof(delimiter);
+    }
+
+    const std::uint8_t start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+    ::memcpy(ptr, start_code, sizeof(start_code));
+    ptr[4] = 0x60 | nal_type;
+
+    return frame;
+}
+
+ac::video::Buffer::Ptr CreatePFrame(std::size_t size = kPFrameSize) {
+    return CreateFrame(1, size);
+}
+
+ac::video::Buffer::Ptr CreateIDRFrame(std::size_t size = kIDRFrameSize) {
+    return CreateFrame(5, size);
+}
+
+// Returns the recovery_frame_cnt of a recovery point SEI message right
+// at offset or -1 if there is none.
+int RecoveryFrameCountAt(const ac::video::Buffer::Ptr &buffer, std::size_t offset) {
+    const std::uint8_t *data = buffer->Data() + offset;
+    if (data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x00 || data[3] != 0x01 ||
+            data[4] != 0x06 || data[5] != 0x06)
+        return -1;
+
+    // Decode the leading exp-golomb code of the payload
+    const std::uint32_t bits = (data[7] << 8) | data[8];
+    int leading_zeros = 0;
+    while (!(bits & (0x8000 >> leading_zeros)))
+        leading_zeros++;
+
+    return ((bits >> (16 - 2 * leading_zeros - 1)) & ((1 << (leading_zeros + 1)) - 1)) - 1;
+}
+
+struct RecoveryUnderTest {
+    RecoveryUnderTest(unsigned int intra_refresh_period,
+          const ac::video::ErrorRecovery::Config &config = ac::video::ErrorRecovery::Config{}) :
+        encoder(std::make_shared<MockEncoder>()),
+        delegate(std::make_shared<CollectingDelegate>()) {
+        EXPECT_CALL(*encoder, IntraRefreshPeriod())
+                .WillRepeatedly(Return(intra_refresh_period));
+        recovery = ac::video::ErrorRecovery::Create(encoder, config);
+        recovery->SetDelegate(delegate);
+    }
+
+    std::shared_ptr<MockEncoder> encoder;
+    std::shared_ptr<CollectingDelegate> delegate;
+    ac::video::ErrorRecovery::Ptr recovery;
+};
+}
+
+TEST(ErrorRecovery, PassesBuffersThrough) {
+    RecoveryUnderTest setup(10);
+
+    auto config = ac::video::Buffer::Create(10);
+    auto frame = CreatePFrame();
+    setup.recovery->OnBufferWithCodecConfig(config);
+    setup.recovery->OnBufferAvailable(frame);
+
+    ASSERT_EQ(2, setup.delegate->buffers.size());
+    EXPECT_EQ(config, setup.delegate->buffers[0]);
+    EXPECT_EQ(frame, setup.delegate->buffers[1]);
+}
+
+TEST(ErrorRecovery, RecoversThroughIntraRefresh) {
+    RecoveryUnderTest setup(10);
+
+    EXPECT_CALL(*setup.encoder, SendIDRFrame()).Times(0);
+
+    setup.recovery->RequestRecovery();
+
+    for (int n = 0; n < 12; n++)
+        setup.recovery->OnBufferAvailable(CreatePFrame());
+
+    ASSERT_EQ(12, setup.delegate->buffers.size());
+
+    // Only the first frame of the refresh marks the recovery point
+    const auto marked = setup.delegate->buffers[0];
+    EXPECT_EQ(10, RecoveryFrameCountAt(marked, 0));
+    EXPECT_GT(marked->Length(), kPFrameSize);
+    EXPECT_EQ(0x61, marked->Data()[marked->Length() - kPFrameSize + 4]);
+
+    for (std::size_t n = 1; n < setup.delegate->buffers.size(); n++)
+        EXPECT_EQ(kPFrameSize, setup.delegate->buffers[n]->Length());
+
+    const auto stats = setup.recovery->Stats();
+    EXPECT_EQ(1, stats.requests);
+    EXPECT_EQ(1, stats.intra_refreshes);
+    EXPECT_EQ(0, stats.idr_frames);
+}
+
+TEST(ErrorRecovery, PlacesRecoveryPointBehindAccessUnitDelimiter) {
+    RecoveryUnderTest setup(10);
+
+    setup.recovery->RequestRecovery();
+    setup.recovery->OnBufferAvailable(CreateFrame(1, kPFrameSize, true));
+
+    ASSERT_EQ(1, setup.delegate->buffers.size());
+    const auto marked = setup.delegate->buffers[0];
+    EXPECT_EQ(0x09, marked->Data()[4]);
+    EXPECT_EQ(10, RecoveryFrameCountAt(marked, 6));
+}
+
+TEST(ErrorRecovery, UsesIDRFrameWithoutIntraRefresh) {
+    RecoveryUnderTest setup(0);
+
+    EXPECT_CALL(*setup.encoder, SendIDRFrame()).Times(1);
+
+    setup.recovery->RequestRecovery();
+    // Further requests until the IDR frame arrives are covered by it
+    setup.recovery->RequestRecovery();
+
+    setup.recovery->OnBufferAvailable(CreatePFrame());
+    setup.recovery->OnBufferAvailable(CreateIDRFrame());
+
+    EXPECT_EQ(-1, RecoveryFrameCountAt(setup.delegate->buffers[0], 0));
+    EXPECT_EQ(1, setup.recovery->Stats().idr_frames);
+}
+
+TEST(ErrorRecovery, UsesIDRFrameWhenConfigured) {
+    ac::video::ErrorRecovery::Config config;
+    config.strategy = ac::video::ErrorRecovery::Strategy::kIDR;
+    RecoveryUnderTest setup(10, config);
+
+    EXPECT_CALL(*setup.encoder, SendIDRFrame()).Times(1);
+
+    setup.recovery->RequestRecovery();
+}
+
+TEST(ErrorRecovery, RestartsRefreshOnRepeatedRequest) {
+    RecoveryUnderTest setup(10);
+
+    EXPECT_CALL(*setup.encoder, SendIDRFrame()).Times(0);
+
+    setup.recovery->RequestRecovery();
+    for (int n = 0; n < 5; n++)
+        setup.recovery->OnBufferAvailable(CreatePFrame());
+
+    setup.recovery->RequestRecovery();
+    for (int n = 0; n < 5; n++)
+        setup.recovery->OnBufferAvailable(CreatePFrame());
+
+    EXPECT_EQ(10, RecoveryFrameCountAt(setup.delegate->buffers[5], 0));
+    // Still refreshing so a new request doesn't start another one
+    setup.recovery->RequestRecovery();
+    EXPECT_EQ(1, setup.recovery->Stats().intra_refreshes);
+}
+
+TEST(ErrorRecovery, FallsBackToIDRFrameOnTimeout) {
+    ac::video::ErrorRecovery::Config config;
+    config.timeout = std::chrono::milliseconds{20};
+    RecoveryUnderTest setup(10, config);
+
+    EXPECT_CALL(*setup.encoder, SendIDRFrame()).Times(1);
+
+    setup.recovery->RequestRecovery();
+    setup.recovery->OnBufferAvailable(CreatePFrame());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{30});
+
+    setup.recovery->RequestRecovery();
+    setup.recovery->OnBufferAvailable(CreateIDRFrame());
+
+    const auto stats = setup.recovery->Stats();
+    EXPECT_EQ(1, stats.fallbacks);
+    EXPECT_EQ(1, stats.idr_frames);
+    EXPECT_GE(stats.last_recovery_time, std::chrono::milliseconds{30});
+}
+
+TEST(ErrorRecovery, IntraRefreshAvoidsBitrateSpike) {
+    // Feeds what an encoder typically produces for either strategy and
+    // compares the largest frame and the number of frames until the
+    // picture is correct again.
+    struct Result {
+        std::size_t peak_frame_size;
+        std::size_t frames;
+    };
+
+    auto run = [](ac::video::ErrorRecovery::Strategy strategy) {
+        ac::video::ErrorRecovery::Config config;
+        config.strategy = strategy;
+        RecoveryUnderTest setup(10, config);
+
+        bool idr_requested = false;
+        EXPECT_CALL(*setup.encoder, SendIDRFrame())
+                .WillRepeatedly(Invoke([&]() { idr_requested = true; }));
+
+        for (int n = 0; n < 30; n++)
+            setup.recovery->OnBufferAvailable(CreatePFrame());
+
+        setup.recovery->RequestRecovery();
+
+        Result result{0, 0};
+        while (setup.recovery->Stats().last_peak_frame_size == 0) {
+            if (idr_requested) {
+                setup.recovery->OnBufferAvailable(CreateIDRFrame());
+                idr_requested = false;
+            }
+            else {
+                setup.recovery->OnBufferAvailable(CreatePFrame(kIntraRefreshFrameSize));
+            }
+            result.frames++;
+        }
+
+        const auto stats = setup.recovery->Stats();
+        EXPECT_EQ(kPFrameSize, stats.average_frame_size);
+        result.peak_frame_size = stats.last_peak_frame_size;
+        return result;
+    };
+
+    const auto idr = run(ac::video::ErrorRecovery::Strategy::kIDR);
+    const auto intra_refresh = run(ac::video::ErrorRecovery::Strategy::kIntraRefresh);
+
+    EXPECT_EQ(kIDRFrameSize, idr.peak_frame_size);
+    EXPECT_EQ(kIntraRefreshFrameSize, intra_refresh.peak_frame_size);
+    // ... at the price of a slower recovery
+    EXPECT_EQ(1, idr.frames);
+    EXPECT_EQ(10, intra_refresh.frames);
+}
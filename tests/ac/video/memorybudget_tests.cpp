@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/video/buffer.h"
+#include "ac/video/memorybudget.h"
+
+using namespace ::testing;
+
+namespace {
+class MockMemoryReport : public ac::video::MemoryReport {
+public:
+    MOCK_METHOD2(StageUsage, void(const std::string&, const size_t&));
+    MOCK_METHOD3(PressureChanged, void(const int&, const size_t&, const size_t&));
+};
+}
+
+TEST(MemoryBudget, AccountsPerStage) {
+    auto budget = ac::video::MemoryBudget::Create(0);
+
+    budget->Acquire(ac::video::MemoryBudget::Stage::kEncoder, 100);
+    budget->Acquire(ac::video::MemoryBudget::Stage::kSender, 50);
+    budget->Acquire(ac::video::MemoryBudget::Stage::kSender, 50);
+
+    EXPECT_EQ(100u, budget->Usage(ac::video::MemoryBudget::Stage::kEncoder));
+    EXPECT_EQ(100u, budget->Usage(ac::video::MemoryBudget::Stage::kSender));
+    EXPECT_EQ(0u, budget->Usage(ac::video::MemoryBudget::Stage::kPacketizer));
+    EXPECT_EQ(200u, budget->TotalUsage());
+
+    budget->Release(ac::video::MemoryBudget::Stage::kSender, 50);
+
+    EXPECT_EQ(50u, budget->Usage(ac::video::MemoryBudget::Stage::kSender));
+    EXPECT_EQ(150u, budget->TotalUsage());
+
+    // Without a limit there is never any pressure
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kNone, budget->CurrentPressure());
+}
+
+TEST(MemoryBudget, PressureLevelsWithHysteresis) {
+    auto budget = ac::video::MemoryBudget::Create(1000);
+    auto report = std::make_shared<NiceMock<MockMemoryReport>>();
+    budget->SetReport(report);
+
+    EXPECT_CALL(*report, PressureChanged(_, _, 1000u))
+            .Times(4);
+
+    const auto stage = ac::video::MemoryBudget::Stage::kPacketizer;
+
+    budget->Acquire(stage, 700);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kNone, budget->CurrentPressure());
+
+    budget->Acquire(stage, 100);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kDropFrames, budget->CurrentPressure());
+
+    budget->Acquire(stage, 200);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kReduceBitrate, budget->CurrentPressure());
+
+    // Still close to the limit so we stay where we are
+    budget->Release(stage, 100);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kReduceBitrate, budget->CurrentPressure());
+
+    budget->Release(stage, 100);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kDropFrames, budget->CurrentPressure());
+
+    budget->Release(stage, 100);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kDropFrames, budget->CurrentPressure());
+
+    budget->Release(stage, 200);
+    EXPECT_EQ(ac::video::MemoryBudget::Pressure::kNone, budget->CurrentPressure());
+}
+
+TEST(MemoryBudget, BuffersAreAccounted) {
+    auto budget = ac::video::MemoryBudget::Instance();
+    const auto stage = ac::video::MemoryBudget::Stage::kCodecConfig;
+    const auto before = budget->Usage(stage);
+
+    {
+        auto buffer = ac::video::Buffer::Create(1234, stage);
+        EXPECT_EQ(before + 1234, budget->Usage(stage));
+    }
+
+    EXPECT_EQ(before, budget->Usage(stage));
+}
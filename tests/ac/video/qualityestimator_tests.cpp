@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include "ac/video/qualityestimator.h"
+#include "ac/video/qualityhistory.h"
+
+using namespace ::testing;
+
+namespace {
+static constexpr unsigned int kFramerate{30};
+static constexpr ac::TimestampUs kFrameInterval{33333};
+static constexpr ac::TimestampUs kLatency{20000};
+static constexpr std::size_t kPacketSize{1328};
+static constexpr std::size_t kPacketsPerFrame{10};
+static constexpr unsigned int kFrames{30 * 60};
+
+// Sends frames every kFrameInterval, each kLatency after capture
+ac::TimestampUs SendFrames(const ac::video::QualityEstimator::Ptr &estimator,
+                           ac::TimestampUs now, unsigned int frames,
+                           ac::TimestampUs interval = kFrameInterval) {
+    for (unsigned int n = 0; n < frames; n++) {
+        for (std::size_t p = 0; p < kPacketsPerFrame; p++)
+            estimator->PacketSent(now - kLatency, kPacketSize, now);
+        now += interval;
+    }
+    return now;
+}
+
+class MockHistoryDelegate : public ac::video::QualityHistory::Delegate {
+public:
+    MOCK_METHOD1(OnSessionFinished, void(const ac::video::QualityHistory::Session&));
+};
+}
+
+TEST(QualityEstimator, PerfectSessionScoresFull) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    ac::TimestampUs now = 1000000;
+    estimator->Start(now);
+    now = SendFrames(estimator, now, kFrames);
+    estimator->Stop(now);
+
+    const auto result = estimator->Estimate(now);
+
+    EXPECT_EQ(kFrames, result.frames);
+    EXPECT_NEAR(kFramerate, result.framerate, 0.1);
+    EXPECT_EQ(kLatency, result.latency_p50);
+    EXPECT_EQ(kLatency, result.latency_p99);
+    EXPECT_EQ(0u, result.freezes);
+    EXPECT_NEAR(0.0, result.bitrate_variation, 0.05);
+    EXPECT_LT(result.loss_rate, 0.0);
+    EXPECT_GT(result.score, 95.0);
+}
+
+TEST(QualityEstimator, FreezesLowerScore) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    ac::TimestampUs now = 1000000;
+    estimator->Start(now);
+    for (unsigned int n = 0; n < 10; n++) {
+        // Half a second without a single frame
+        if (n > 0)
+            now += 500000;
+        now = SendFrames(estimator, now, kFrames / 10);
+    }
+    estimator->Stop(now);
+
+    const auto result = estimator->Estimate(now);
+
+    EXPECT_EQ(9u, result.freezes);
+    EXPECT_GE(result.frozen_time, 9 * 500000);
+    EXPECT_LT(result.score, 80.0);
+}
+
+TEST(QualityEstimator, PausesAreNotFreezes) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    ac::TimestampUs now = 1000000;
+    estimator->Start(now);
+    now = SendFrames(estimator, now, kFrames / 2);
+    estimator->Stop(now);
+
+    now += 10000000;
+
+    estimator->Start(now);
+    now = SendFrames(estimator, now, kFrames / 2);
+    estimator->Stop(now);
+
+    const auto result = estimator->Estimate(now);
+
+    EXPECT_EQ(0u, result.freezes);
+    EXPECT_NEAR(kFramerate, result.framerate, 0.1);
+}
+
+TEST(QualityEstimator, LatencyPercentiles) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    ac::TimestampUs now = 1000000;
+    estimator->Start(now);
+    for (unsigned int n = 0; n < 100; n++) {
+        // Every tenth frame takes 400 ms to get out
+        const ac::TimestampUs latency = n % 10 == 0 ? 400000 : 10000;
+        const auto timestamp = now + n * kFrameInterval;
+        estimator->PacketSent(timestamp, kPacketSize, timestamp + latency);
+    }
+    now += 100 * kFrameInterval;
+
+    const auto result = estimator->Estimate(now);
+
+    EXPECT_EQ(10000, result.latency_p50);
+    EXPECT_EQ(400000, result.latency_p95);
+    EXPECT_EQ(400000, result.latency_p99);
+}
+
+TEST(QualityEstimator, LowFramerateRecoveriesAndLossLowerScore) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    ac::TimestampUs now = 1000000;
+    estimator->Start(now);
+    now = SendFrames(estimator, now, kFrames / 2, 2 * kFrameInterval);
+    estimator->Stop(now);
+
+    const auto good = estimator->Estimate(now);
+    EXPECT_NEAR(kFramerate / 2, good.framerate, 0.1);
+
+    for (unsigned int n = 0; n < 10; n++)
+        estimator->RecoveryRequested();
+    estimator->PacketsDelivered(900);
+    estimator->PacketsLost(100);
+
+    const auto bad = estimator->Estimate(now);
+    EXPECT_EQ(10u, bad.recoveries);
+    EXPECT_DOUBLE_EQ(0.1, bad.loss_rate);
+    EXPECT_LT(bad.score, good.score - 20);
+}
+
+TEST(QualityEstimator, NoFramesScoresZero) {
+    auto estimator = ac::video::QualityEstimator::Create(kFramerate);
+
+    estimator->Start(1000000);
+    estimator->Stop(2000000);
+
+    const auto result = estimator->Estimate(2000000);
+
+    EXPECT_EQ(1000000, result.duration);
+    EXPECT_EQ(0u, result.frames);
+    EXPECT_EQ(0.0, result.score);
+}
+
+TEST(QualityHistory, KeepsRecentSessionsAndNotifiesDelegate) {
+    auto history = ac::video::QualityHistory::Create();
+    auto delegate = std::make_shared<MockHistoryDelegate>();
+    history->SetDelegate(delegate);
+
+    EXPECT_CALL(*delegate, OnSessionFinished(_))
+            .Times(ac::video::QualityHistory::kMaxSessions + 1);
+
+    for (std::size_t n = 0; n <= ac::video::QualityHistory::kMaxSessions; n++) {
+        ac::video::QualityHistory::Session session;
+        session.framerate = n;
+        history->Add(session);
+    }
+
+    const auto sessions = history->Sessions();
+    EXPECT_EQ(ac::video::QualityHistory::kMaxSessions, sessions.size());
+    EXPECT_EQ(1u, sessions.front().framerate);
+    EXPECT_EQ(ac::video::QualityHistory::kMaxSessions, sessions.back().framerate);
+}
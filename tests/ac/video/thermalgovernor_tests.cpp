@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gmock/gmock.h>
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "ac/video/thermalgovernor.h"
+
+using namespace ::testing;
+
+namespace {
+class MockThermalReport : public ac::video::ThermalReport {
+public:
+    MOCK_METHOD3(TemperatureSampled, void(const std::string&, const int&, const int&));
+    MOCK_METHOD3(LevelChanged, void(const int&, const std::string&, const int&));
+};
+
+class MockDelegate : public ac::video::ThermalGovernor::Delegate {
+public:
+    MOCK_METHOD1(OnThermalLevelChanged, void(const ac::video::ThermalGovernor::Status&));
+};
+
+// Lays out thermal zones the same way the kernel does below
+// /sys/class/thermal.
+class FakeThermalRoot {
+public:
+    FakeThermalRoot() :
+        path_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {
+        boost::filesystem::create_directories(path_);
+    }
+
+    ~FakeThermalRoot() {
+        boost::filesystem::remove_all(path_);
+    }
+
+    std::string Path() const {
+        return path_.string();
+    }
+
+    void AddZone(int index, const std::string &type, int temperature,
+                 const std::vector<std::pair<std::string, int>> &trip_points = {}) {
+        const auto zone = ZonePath(index);
+        boost::filesystem::create_directories(zone);
+
+        Write(zone / "type", type);
+        SetTemperature(index, temperature);
+
+        for (std::size_t n = 0; n < trip_points.size(); n++) {
+            const auto prefix = "trip_point_" + std::to_string(n);
+            Write(zone / (prefix + "_type"), trip_points[n].first);
+            Write(zone / (prefix + "_temp"), std::to_string(trip_points[n].second));
+        }
+    }
+
+    void SetTemperature(int index, int temperature) {
+        Write(ZonePath(index) / "temp", std::to_string(temperature));
+    }
+
+private:
+    boost::filesystem::path ZonePath(int index) const {
+        return path_ / ("thermal_zone" + std::to_string(index));
+    }
+
+    static void Write(const boost::filesystem::path &path, const std::string &value) {
+        std::ofstream out(path.string());
+        out << value << std::endl;
+    }
+
+    boost::filesystem::path path_;
+};
+}
+
+TEST(ThermalGovernor, FailsWithoutZones) {
+    FakeThermalRoot root;
+    auto governor = ac::video::ThermalGovernor::Create(root.Path());
+
+    EXPECT_FALSE(governor->Update());
+    EXPECT_EQ(ac::video::ThermalGovernor::Level::kNone, governor->CurrentLevel());
+
+    auto missing = ac::video::ThermalGovernor::Create(root.Path() + "/does-not-exist");
+    EXPECT_FALSE(missing->Update());
+}
+
+TEST(ThermalGovernor, StepsDownAndRecoversWithHysteresis) {
+    FakeThermalRoot root;
+    root.AddZone(0, "cpu", 60000, {{"passive", 85000}, {"critical", 105000}});
+
+    auto governor = ac::video::ThermalGovernor::Create(root.Path());
+
+    const auto expect_level = [&](int temperature, ac::video::ThermalGovernor::Level level) {
+        root.SetTemperature(0, temperature);
+        EXPECT_TRUE(governor->Update());
+        EXPECT_EQ(level, governor->CurrentLevel()) << "at " << temperature;
+    };
+
+    expect_level(60000, ac::video::ThermalGovernor::Level::kNone);
+    expect_level(71000, ac::video::ThermalGovernor::Level::kReduceFramerate);
+    expect_level(76000, ac::video::ThermalGovernor::Level::kReduceBitrate);
+    expect_level(81000, ac::video::ThermalGovernor::Level::kReduceResolution);
+
+    // Only just below where the levels were entered; nothing changes
+    expect_level(78000, ac::video::ThermalGovernor::Level::kReduceResolution);
+
+    expect_level(74000, ac::video::ThermalGovernor::Level::kReduceBitrate);
+    expect_level(72000, ac::video::ThermalGovernor::Level::kReduceBitrate);
+    expect_level(60000, ac::video::ThermalGovernor::Level::kNone);
+
+    // Heating up again can skip levels
+    expect_level(82000, ac::video::ThermalGovernor::Level::kReduceResolution);
+}
+
+TEST(ThermalGovernor, PicksZoneClosestToThrottling) {
+    FakeThermalRoot root;
+    // Without a passive trip point throttling is assumed to start at 85C
+    root.AddZone(0, "battery", 72000, {{"critical", 80000}});
+    root.AddZone(1, "gpu", 68000, {{"passive", 75000}, {"passive", 78000}});
+    // Disconnected sensors
+    root.AddZone(2, "pa", -40000);
+    root.AddZone(3, "modem", 250000);
+
+    auto governor = ac::video::ThermalGovernor::Create(root.Path());
+    EXPECT_TRUE(governor->Update());
+
+    const auto status = governor->CurrentStatus();
+    EXPECT_EQ("gpu", status.zone);
+    EXPECT_EQ(68000, status.temperature);
+    EXPECT_EQ(7000, status.headroom);
+    EXPECT_EQ(ac::video::ThermalGovernor::Level::kReduceBitrate, status.level);
+}
+
+TEST(ThermalGovernor, ReportsDecisions) {
+    FakeThermalRoot root;
+    root.AddZone(0, "cpu", 60000, {{"passive", 85000}});
+
+    auto governor = ac::video::ThermalGovernor::Create(root.Path());
+    auto report = std::make_shared<MockThermalReport>();
+    auto delegate = std::make_shared<MockDelegate>();
+    governor->SetReport(report);
+    governor->SetDelegate(delegate);
+
+    EXPECT_CALL(*report, TemperatureSampled(std::string("cpu"), _, _))
+            .Times(3);
+    EXPECT_CALL(*report, LevelChanged(static_cast<int>(ac::video::ThermalGovernor::Level::kReduceFramerate),
+                                      std::string("cpu"), 72000))
+            .Times(1);
+    EXPECT_CALL(*delegate, OnThermalLevelChanged(Field(&ac::video::ThermalGovernor::Status::level,
+                                                       ac::video::ThermalGovernor::Level::kReduceFramerate)))
+            .Times(1);
+
+    EXPECT_TRUE(governor->Update());
+
+    root.SetTemperature(0, 72000);
+    EXPECT_TRUE(governor->Update());
+    EXPECT_TRUE(governor->Update());
+}
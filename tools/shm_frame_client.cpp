@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdlib>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <ac/logger.h>
+#include <ac/shm/client.h>
+
+namespace {
+static constexpr unsigned int kFramerate = 30;
+static constexpr int kDequeueTimeoutMs = 1000;
+
+// Draws vertical color bars moving by a few pixels with every frame
+void RenderFrame(std::uint8_t *data, unsigned int width, unsigned int height,
+                 unsigned int stride, unsigned int frame) {
+    static constexpr std::uint32_t kBars[] = {
+        0xffffffff, 0xff00ffff, 0xffffff00, 0xff00ff00,
+        0xffff00ff, 0xff0000ff, 0xffff0000, 0xff000000
+    };
+    static constexpr unsigned int kBarCount = sizeof(kBars) / sizeof(kBars[0]);
+
+    for (unsigned int y = 0; y < height; y++) {
+        auto line = reinterpret_cast<std::uint32_t*>(data + y * stride);
+        for (unsigned int x = 0; x < width; x++)
+            line[x] = kBars[((x + frame * 4) * kBarCount / width) % kBarCount];
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cout << "Usage: " << std::endl
+                  << " " << argv[0] << " <socket> <width> <height> [<frames>]" << std::endl;
+        return -EINVAL;
+    }
+
+    const unsigned int width = std::strtoul(argv[2], nullptr, 10);
+    const unsigned int height = std::strtoul(argv[3], nullptr, 10);
+    const unsigned int frame_count = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 0;
+
+    auto client = ac::shm::Client::Connect(argv[1], width, height);
+    if (!client) {
+        AC_ERROR("Failed to connect to %s", argv[1]);
+        return -EIO;
+    }
+
+    const auto frame_interval = std::chrono::microseconds{1000000 / kFramerate};
+
+    for (unsigned int frame = 0; frame_count == 0 || frame < frame_count; frame++) {
+        const auto start = std::chrono::steady_clock::now();
+
+        const auto slot = client->DequeueSlot(kDequeueTimeoutMs);
+        if (slot < 0) {
+            AC_ERROR("Lost connection to producer");
+            return -EIO;
+        }
+
+        RenderFrame(client->SlotData(slot), width, height, client->Stride(), frame);
+
+        if (!client->QueueSlot(slot, ac::Utils::GetNowUs()))
+            return -EIO;
+
+        std::this_thread::sleep_until(start + frame_interval);
+    }
+
+    return 0;
+}
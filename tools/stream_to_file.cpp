@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Canonical, Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <signal.h>
+
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include <ac/logger.h>
+#include <ac/glib_wrapper.h>
+
+#include <ac/common/executorpool.h>
+#include <ac/common/threadedexecutorfactory.h>
+
+#include <ac/report/reportfactory.h>
+
+#include <ac/streaming/jitterbuffer.h>
+#include <ac/streaming/mediareceiver.h>
+#include <ac/streaming/mpegtsdemuxer.h>
+#include <ac/streaming/rtpreceiver.h>
+
+#include <ac/video/elementarystreamwriter.h>
+
+static GMainLoop *main_loop = nullptr;
+
+namespace {
+static gboolean OnSignalRaised(gpointer user_data) {
+    AC_DEBUG("Exiting");
+    g_main_loop_quit(main_loop);
+    return FALSE;
+}
+}
+
+int main(int argc, char **argv) {
+    std::string output;
+    int port = 0;
+    bool debug = false;
+
+    g_unix_signal_add(SIGINT, OnSignalRaised, nullptr);
+    g_unix_signal_add(SIGTERM, OnSignalRaised, nullptr);
+
+    boost::program_options::options_description desc("Usage");
+    desc.add_options()
+        ("help,h", "displays this message")
+        ("port,p",
+            boost::program_options::value<int>(&port), "Port to receive the RTP stream on")
+        ("output,o",
+            boost::program_options::value<std::string>(&output), "File to write the H.264 stream to")
+        ("debug,d",
+            boost::program_options::bool_switch(&debug), "Enable verbose debug output");
+
+    boost::program_options::variables_map vm;
+    try {
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+        boost::program_options::notify(vm);
+    }
+    catch(boost::program_options::error& e) {
+        std::cerr << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if (output.length() == 0 || port <= 0) {
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (debug)
+        ac::Log().Init(ac::Logger::Severity::kDebug);
+
+    auto decoder = ac::video::ElementaryStreamWriter::Create(output);
+    if (!decoder)
+        return EXIT_FAILURE;
+
+    auto jitter_buffer = ac::streaming::JitterBuffer::Create(
+                ac::report::ReportFactory::Create()->CreateJitterBufferReport());
+
+    auto receiver = ac::streaming::RTPReceiver::Create(jitter_buffer, port);
+    if (!receiver)
+        return EXIT_FAILURE;
+
+    auto media_receiver = std::make_shared<ac::streaming::MediaReceiver>(
+                jitter_buffer, ac::streaming::MPEGTSDemuxer::Create(), decoder);
+
+    ac::common::ExecutorPool pipeline(std::make_shared<ac::common::ThreadedExecutorFactory>(), 2);
+    pipeline.Add(receiver);
+    pipeline.Add(media_receiver);
+
+    if (!pipeline.Start())
+        return EXIT_FAILURE;
+
+    main_loop = g_main_loop_new(nullptr, FALSE);
+    g_main_loop_run(main_loop);
+    g_main_loop_unref(main_loop);
+
+    pipeline.Stop();
+
+    return EXIT_SUCCESS;
+}